@@ -397,8 +397,8 @@ static size_t bzimage_load_initrd ( struct image *image,
 		offset = ( ( offset + 0x03 ) & ~0x03 );
 	}
 
-	/* Copy in initrd image body */
-	if ( address )
+	/* Copy in initrd image body (unless already in place) */
+	if ( address && ( userptr_add ( address, offset ) != initrd->data ) )
 		memmove_user ( address, offset, initrd->data, 0, initrd->len );
 	if ( address ) {
 		DBGC ( image, "bzImage %p initrd %p [%#08lx,%#08lx,%#08lx)"
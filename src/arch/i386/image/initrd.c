@@ -19,6 +19,7 @@
 
 FILE_LICENCE ( GPL2_OR_LATER );
 
+#include <string.h>
 #include <errno.h>
 #include <initrd.h>
 #include <ipxe/image.h>
@@ -38,6 +39,205 @@ userptr_t initrd_top;
 /** Minimum address available for initrd */
 userptr_t initrd_bottom;
 
+/**
+ * Calculate final position of initrd
+ *
+ * @v initrd		initrd
+ * @v top		Highest possible address
+ * @ret final		Final position of initrd
+ *
+ * The initrds are laid out in image list order, packed against the
+ * highest possible address.
+ */
+static userptr_t initrd_final ( struct image *initrd, userptr_t top ) {
+	struct image *other;
+	size_t len = 0;
+
+	for_each_image ( other ) {
+		if ( other == initrd )
+			len = 0;
+		len += ( ( other->len + INITRD_ALIGN - 1 ) &
+			 ~( INITRD_ALIGN - 1 ) );
+	}
+	return userptr_add ( top, -len );
+}
+
+/**
+ * Check whether or not a region overlaps an initrd
+ *
+ * @v start		Start of region
+ * @v len		Length of region
+ * @v initrd		initrd
+ * @ret overlaps	Region overlaps initrd
+ */
+static int initrd_overlaps ( userptr_t start, size_t len,
+			     struct image *initrd ) {
+
+	return ( ( userptr_sub ( start, initrd->data ) <
+		   ( ( off_t ) initrd->len ) ) &&
+		 ( userptr_sub ( initrd->data, start ) < ( ( off_t ) len ) ) );
+}
+
+/**
+ * Check whether or not an initrd may be moved to its final position
+ *
+ * @v initrd		initrd
+ * @v final		Final position of initrd
+ * @v top		Highest possible address
+ * @ret blocked		Final position is occupied by another initrd
+ */
+static int initrd_blocked ( struct image *initrd, userptr_t final,
+			    userptr_t top ) {
+	struct image *other;
+
+	for_each_image ( other ) {
+		if ( ( other != initrd ) &&
+		     ( other->data != initrd_final ( other, top ) ) &&
+		     initrd_overlaps ( final, initrd->len, other ) ) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Move an initrd out of the way of the final initrd layout
+ *
+ * @v top		Highest possible address
+ * @v bottom		Lowest address available for initrds
+ * @ret rc		Return status code
+ *
+ * The smallest initrd currently occupying part of the final layout
+ * is moved to the highest free space below both the final layout
+ * and any other initrd not yet in its final position.
+ */
+static int initrd_evict ( userptr_t top, userptr_t bottom ) {
+	struct image *initrd;
+	struct image *smallest = NULL;
+	userptr_t start;
+	userptr_t limit;
+	userptr_t dest;
+
+	/* Find start of final layout */
+	start = top;
+	for_each_image ( initrd ) {
+		start = userptr_add ( start, -( ( initrd->len +
+						  INITRD_ALIGN - 1 ) &
+						~( INITRD_ALIGN - 1 ) ) );
+	}
+
+	if ( userptr_sub ( start, bottom ) < 0 )
+		return -ENOSPC;
+
+	/* Find smallest initrd within the final layout but not yet in
+	 * its final position, and the highest address below which
+	 * there are no initrds not yet in their final positions.
+	 */
+	limit = start;
+	for_each_image ( initrd ) {
+		if ( initrd->data == initrd_final ( initrd, top ) )
+			continue;
+		if ( userptr_sub ( initrd->data, top ) >= 0 )
+			continue;
+		if ( userptr_sub ( initrd->data, start ) >= 0 ) {
+			if ( ( smallest == NULL ) ||
+			     ( initrd->len < smallest->len ) )
+				smallest = initrd;
+		} else if ( initrd_overlaps ( bottom,
+					      userptr_sub ( limit, bottom ),
+					      initrd ) ) {
+			limit = initrd->data;
+			if ( userptr_sub ( limit, bottom ) < 0 )
+				limit = bottom;
+		}
+	}
+	if ( ! smallest )
+		return -ENOENT;
+
+	/* Check for sufficient free space */
+	dest = userptr_add ( limit, -( ( smallest->len + INITRD_ALIGN - 1 ) &
+				       ~( INITRD_ALIGN - 1 ) ) );
+	if ( userptr_sub ( dest, bottom ) < 0 )
+		return -ENOSPC;
+
+	/* Move initrd out of the way */
+	DBGC ( &images, "INITRD evicting %s [%#08lx,%#08lx)->"
+	       "[%#08lx,%#08lx)\n", smallest->name,
+	       user_to_phys ( smallest->data, 0 ),
+	       user_to_phys ( smallest->data, smallest->len ),
+	       user_to_phys ( dest, 0 ),
+	       user_to_phys ( dest, smallest->len ) );
+	memmove_user ( dest, 0, smallest->data, 0, smallest->len );
+	smallest->data = dest;
+
+	return 0;
+}
+
+/**
+ * Move initrds directly to their final positions
+ *
+ * @v top		Highest possible address
+ * @v bottom		Lowest address available for initrds
+ * @ret rc		Return status code
+ *
+ * Each initrd is moved directly to its final position as soon as
+ * that position is no longer occupied by any other initrd.  Where
+ * the remaining initrds block each other (e.g. when they were
+ * downloaded in reverse order), one initrd is first moved out of the
+ * way into free space below the final layout.  Each initrd is
+ * therefore copied at most twice, and not at all if it is already in
+ * its final position.
+ *
+ * If there is insufficient free space to break a cycle, then the
+ * initrds are left in a valid (but unsorted) state and an error is
+ * returned.
+ */
+static int initrd_place ( userptr_t top, userptr_t bottom ) {
+	struct image *initrd;
+	userptr_t final;
+	int remaining;
+	int moved;
+	int rc;
+
+	do {
+		remaining = 0;
+		moved = 0;
+
+		/* Move any unblocked initrds to their final positions */
+		for_each_image ( initrd ) {
+			final = initrd_final ( initrd, top );
+			if ( initrd->data == final )
+				continue;
+			if ( initrd_blocked ( initrd, final, top ) ) {
+				remaining++;
+				continue;
+			}
+			DBGC ( &images, "INITRD placing %s [%#08lx,%#08lx)->"
+			       "[%#08lx,%#08lx)\n", initrd->name,
+			       user_to_phys ( initrd->data, 0 ),
+			       user_to_phys ( initrd->data, initrd->len ),
+			       user_to_phys ( final, 0 ),
+			       user_to_phys ( final, initrd->len ) );
+			memmove_user ( final, 0, initrd->data, 0,
+				       initrd->len );
+			initrd->data = final;
+			moved++;
+		}
+
+		/* Break any cycles by moving an initrd out of the way */
+		if ( remaining && ! moved ) {
+			if ( ( rc = initrd_evict ( top, bottom ) ) != 0 ) {
+				DBGC ( &images, "INITRD could not place "
+				       "directly: %s\n", strerror ( rc ) );
+				return rc;
+			}
+		}
+
+	} while ( remaining );
+
+	return 0;
+}
+
 /**
  * Squash initrds as high as possible in memory
  *
@@ -70,6 +270,8 @@ static userptr_t initrd_squash_high ( userptr_t top ) {
 		len = ( ( highest->len + INITRD_ALIGN - 1 ) &
 			~( INITRD_ALIGN - 1 ) );
 		current = userptr_sub ( current, len );
+		if ( highest->data == current )
+			continue;
 		DBGC ( &images, "INITRD squashing %s [%#08lx,%#08lx)->"
 		       "[%#08lx,%#08lx)\n", highest->name,
 		       user_to_phys ( highest->data, 0 ),
@@ -238,6 +440,12 @@ void initrd_reshuffle ( userptr_t bottom ) {
 	       user_to_phys ( bottom, 0 ), user_to_phys ( top, 0 ) );
 	initrd_dump();
 
+	/* Move initrds directly to their final positions, if possible */
+	if ( initrd_place ( top, bottom ) == 0 ) {
+		initrd_dump();
+		return;
+	}
+
 	/* Squash initrds as high as possible in memory */
 	used = initrd_squash_high ( top );
 
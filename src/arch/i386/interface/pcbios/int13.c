@@ -27,6 +27,8 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <assert.h>
 #include <ipxe/list.h>
 #include <ipxe/blockdev.h>
+#include <ipxe/blockcache.h>
+#include <ipxe/umalloc.h>
 #include <ipxe/io.h>
 #include <ipxe/open.h>
 #include <ipxe/uri.h>
@@ -64,6 +66,47 @@ FILE_LICENCE ( GPL2_OR_LATER );
  */
 #define INT13_COMMAND_TIMEOUT ( 15 * TICKS_PER_SEC )
 
+/** Maximum number of INT 13 commands in flight (across all drives) */
+#define INT13_MAX_COMMANDS 16
+
+/** Maximum number of read-ahead commands in flight
+ *
+ * Read-ahead commands are limited to a subset of the command slots,
+ * so that direct reads are never starved.
+ */
+#define INT13_MAX_READAHEAD_COMMANDS 8
+
+/** Number of read-ahead windows per drive
+ *
+ * Using two windows allows one window to be refilled while the
+ * reader consumes the other.
+ */
+#define INT13_READAHEAD_WINDOWS 2
+
+/** Total read-ahead length per drive (in bytes) */
+#define INT13_READAHEAD_LEN ( 256 * 1024 )
+
+/** Maximum length of a single read-ahead command (in bytes) */
+#define INT13_READAHEAD_FRAG_LEN ( 16 * 1024 )
+
+/** Maximum block cache size per drive (in bytes) */
+#define INT13_CACHE_MAX_LEN ( 16 * 1024 * 1024 )
+
+/** Fraction of system memory to use for each drive's block cache */
+#define INT13_CACHE_FRACTION 64
+
+/** An INT 13 read-ahead window */
+struct int13_readahead {
+	/** Data buffer */
+	userptr_t buffer;
+	/** Starting logical block address (in underlying blocks) */
+	uint64_t lba;
+	/** Number of blocks in window (or zero if window is unused) */
+	unsigned int count;
+	/** Number of blocks for which commands have been issued */
+	unsigned int issued;
+};
+
 /** An INT 13 emulated drive */
 struct int13_drive {
 	/** Reference count */
@@ -134,6 +177,15 @@ struct int13_drive {
 	int block_rc;
 	/** Status of last operation */
 	int last_status;
+
+	/** Logical block address following the most recent transfer
+	 * (in underlying blocks)
+	 */
+	uint64_t next_lba;
+	/** Read-ahead windows */
+	struct int13_readahead readahead[INT13_READAHEAD_WINDOWS];
+	/** Block cache */
+	struct block_cache cache;
 };
 
 /** Vector for chaining to other INT 13 handlers */
@@ -233,8 +285,17 @@ struct int13_command {
 	struct interface block;
 	/** Command timeout timer */
 	struct retry_timer timer;
+	/** Starting logical block address (in underlying blocks) */
+	uint64_t lba;
+	/** Number of blocks (in underlying blocks) */
+	unsigned int count;
+	/** Read-ahead window (if this is a read-ahead command) */
+	struct int13_readahead *readahead;
 };
 
+/** INT 13 command slots */
+static struct int13_command int13_commands[INT13_MAX_COMMANDS];
+
 /**
  * Record INT 13 drive capacity
  *
@@ -310,38 +371,106 @@ static int int13_reopen_block ( struct int13_drive *int13 ) {
 }
 
 /**
- * Prepare to issue INT 13 command
+ * Allocate INT 13 command slot
+ *
+ * @ret command		INT 13 command, or NULL if all slots are in use
+ */
+static struct int13_command * int13_command_alloc ( void ) {
+	struct int13_command *command;
+	unsigned int i;
+
+	for ( i = 0 ; i < INT13_MAX_COMMANDS ; i++ ) {
+		command = &int13_commands[i];
+		if ( command->int13 == NULL ) {
+			intf_init ( &command->block, &int13_command_desc,
+				    NULL );
+			timer_init ( &command->timer, int13_command_expired,
+				     NULL );
+			return command;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Count INT 13 commands in progress
+ *
+ * @v int13		Emulated drive
+ * @v readahead		Read-ahead window, or NULL for direct commands
+ * @ret count		Number of commands in progress
+ */
+static unsigned int int13_command_pending ( struct int13_drive *int13,
+					    struct int13_readahead *readahead ) {
+	struct int13_command *command;
+	unsigned int count = 0;
+	unsigned int i;
+
+	for ( i = 0 ; i < INT13_MAX_COMMANDS ; i++ ) {
+		command = &int13_commands[i];
+		if ( ( command->int13 == int13 ) &&
+		     ( command->readahead == readahead ) &&
+		     ( command->rc == -EINPROGRESS ) )
+			count++;
+	}
+	return count;
+}
+
+/**
+ * Prepare to issue INT 13 commands
  *
- * @v command		INT 13 command
  * @v int13		Emulated drive
  * @ret rc		Return status code
+ *
+ * Reopens the underlying block device if necessary, and waits for
+ * its control interface to become ready.
  */
-static int int13_command_start ( struct int13_command *command,
-				 struct int13_drive *int13 ) {
+static int int13_prepare ( struct int13_drive *int13 ) {
+	unsigned long started;
 	int rc;
 
-	/* Sanity check */
-	assert ( command->int13 == NULL );
-	assert ( ! timer_running ( &command->timer ) );
-
 	/* Reopen block device if necessary */
 	if ( ( int13->block_rc != 0 ) &&
 	     ( ( rc = int13_reopen_block ( int13 ) ) != 0 ) )
 		return rc;
 
-	/* Initialise command */
-	command->rc = -EINPROGRESS;
-	command->int13 = int13;
-	start_timer_fixed ( &command->timer, INT13_COMMAND_TIMEOUT );
-
 	/* Wait for block control interface to become ready */
-	while ( ( command->rc == -EINPROGRESS ) &&
-		( xfer_window ( &int13->block ) == 0 ) ) {
+	started = currticks();
+	while ( xfer_window ( &int13->block ) == 0 ) {
+		if ( int13->block_rc != 0 )
+			return int13->block_rc;
+		if ( ( currticks() - started ) >= INT13_COMMAND_TIMEOUT )
+			return -ETIMEDOUT;
 		step();
 	}
 
-	return ( ( command->rc == -EINPROGRESS ) ?
-		 int13->block_rc : command->rc );
+	return 0;
+}
+
+/**
+ * Start INT 13 command
+ *
+ * @v command		INT 13 command
+ * @v int13		Emulated drive
+ * @v lba		Starting logical block address
+ * @v count		Number of blocks
+ * @v readahead		Read-ahead window, or NULL
+ */
+static void int13_command_start ( struct int13_command *command,
+				  struct int13_drive *int13, uint64_t lba,
+				  unsigned int count,
+				  struct int13_readahead *readahead ) {
+
+	/* Sanity check */
+	assert ( command->int13 == NULL );
+	assert ( ! timer_running ( &command->timer ) );
+
+	/* Initialise command */
+	command->rc = -EINPROGRESS;
+	command->int13 = int13;
+	command->lba = lba;
+	command->count = count;
+	command->readahead = readahead;
+	start_timer_fixed ( &command->timer, INT13_COMMAND_TIMEOUT );
 }
 
 /**
@@ -369,15 +498,422 @@ static int int13_command_wait ( struct int13_command *command ) {
  * @v command		INT 13 command
  */
 static void int13_command_stop ( struct int13_command *command ) {
+
+	/* Abort command if still in progress */
+	if ( command->rc == -EINPROGRESS )
+		int13_command_close ( command, -ECANCELED );
+
 	stop_timer ( &command->timer );
 	command->int13 = NULL;
+	command->readahead = NULL;
 }
 
-/** The single active INT 13 command */
-static struct int13_command int13_command = {
-	.block = INTF_INIT ( int13_command_desc ),
-	.timer = TIMER_INIT ( int13_command_expired ),
-};
+/**
+ * Discard INT 13 read-ahead window
+ *
+ * @v int13		Emulated drive
+ * @v readahead		Read-ahead window
+ */
+static void int13_readahead_retire ( struct int13_drive *int13,
+				     struct int13_readahead *readahead ) {
+	struct int13_command *command;
+	unsigned int i;
+
+	/* Abort any outstanding read-ahead commands */
+	for ( i = 0 ; i < INT13_MAX_COMMANDS ; i++ ) {
+		command = &int13_commands[i];
+		if ( ( command->int13 == int13 ) &&
+		     ( command->readahead == readahead ) )
+			int13_command_stop ( command );
+	}
+
+	/* Mark window as unused */
+	readahead->count = 0;
+	readahead->issued = 0;
+}
+
+/**
+ * Discard all INT 13 read-ahead windows
+ *
+ * @v int13		Emulated drive
+ */
+static void int13_readahead_discard ( struct int13_drive *int13 ) {
+	unsigned int i;
+
+	for ( i = 0 ; i < INT13_READAHEAD_WINDOWS ; i++ )
+		int13_readahead_retire ( int13, &int13->readahead[i] );
+}
+
+/**
+ * Collect completed INT 13 commands
+ *
+ * @v int13		Emulated drive
+ * @ret rc		Status of first failed direct command, if any
+ *
+ * Completed direct commands are released.  Completed read-ahead
+ * commands are released, and a failed read-ahead command causes its
+ * window to be discarded.
+ */
+static int int13_reap ( struct int13_drive *int13 ) {
+	struct int13_command *command;
+	unsigned int i;
+	int rc = 0;
+
+	for ( i = 0 ; i < INT13_MAX_COMMANDS ; i++ ) {
+		command = &int13_commands[i];
+		if ( ( command->int13 != int13 ) ||
+		     ( command->rc == -EINPROGRESS ) )
+			continue;
+		if ( command->readahead ) {
+			if ( command->rc != 0 ) {
+				DBGC ( int13, "INT13 drive %02x read-ahead "
+				       "failed: %s\n", int13->drive,
+				       strerror ( command->rc ) );
+				int13_readahead_retire ( int13,
+							 command->readahead );
+				continue;
+			}
+		} else if ( rc == 0 ) {
+			rc = command->rc;
+		}
+		int13_command_stop ( command );
+	}
+
+	return rc;
+}
+
+/**
+ * Issue INT 13 read-ahead commands
+ *
+ * @v int13		Emulated drive
+ *
+ * Issues as many outstanding read-ahead fragments as the underlying
+ * device and the read-ahead command limit allow.
+ */
+static void int13_readahead_pump ( struct int13_drive *int13 ) {
+	struct int13_readahead *readahead;
+	struct int13_command *command;
+	unsigned int pending = 0;
+	unsigned int frag_count;
+	unsigned int max_count;
+	size_t blksize = int13->capacity.blksize;
+	unsigned int i;
+	int rc;
+
+	/* Do nothing if block device is not usable */
+	if ( int13->block_rc != 0 )
+		return;
+
+	/* Count read-ahead commands already in flight */
+	for ( i = 0 ; i < INT13_READAHEAD_WINDOWS ; i++ ) {
+		pending += int13_command_pending ( int13,
+						   &int13->readahead[i] );
+	}
+
+	/* Determine read-ahead fragment size */
+	max_count = ( INT13_READAHEAD_FRAG_LEN / blksize );
+	if ( max_count > int13->capacity.max_count )
+		max_count = int13->capacity.max_count;
+	if ( ! max_count )
+		max_count = 1;
+
+	/* Issue fragments from each window in turn */
+	for ( i = 0 ; i < INT13_READAHEAD_WINDOWS ; i++ ) {
+		readahead = &int13->readahead[i];
+		while ( readahead->issued < readahead->count ) {
+
+			/* Leave room for direct commands */
+			if ( pending >= INT13_MAX_READAHEAD_COMMANDS )
+				return;
+			if ( xfer_window ( &int13->block ) == 0 )
+				return;
+			command = int13_command_alloc();
+			if ( ! command )
+				return;
+
+			/* Issue command */
+			frag_count = ( readahead->count - readahead->issued );
+			if ( frag_count > max_count )
+				frag_count = max_count;
+			int13_command_start ( command, int13,
+					      ( readahead->lba +
+						readahead->issued ),
+					      frag_count, readahead );
+			if ( ( rc = block_read ( &int13->block,
+						 &command->block,
+						 command->lba, frag_count,
+						 userptr_add ( readahead->buffer,
+							       ( readahead->issued *
+								 blksize ) ),
+						 ( frag_count *
+						   blksize ) ) ) != 0 ) {
+				int13_command_stop ( command );
+				int13_readahead_retire ( int13, readahead );
+				return;
+			}
+			readahead->issued += frag_count;
+			pending++;
+		}
+	}
+}
+
+/**
+ * Extend INT 13 read-ahead beyond a sequential read
+ *
+ * @v int13		Emulated drive
+ * @v lba		Next logical block address expected to be read
+ */
+static void int13_readahead_extend ( struct int13_drive *int13,
+				     uint64_t lba ) {
+	struct int13_readahead *readahead;
+	size_t blksize = int13->capacity.blksize;
+	unsigned int window_count = ( INT13_READAHEAD_LEN /
+				      INT13_READAHEAD_WINDOWS / blksize );
+	uint64_t next;
+	unsigned int i;
+	int extended;
+
+	/* Sanity check */
+	if ( ! window_count )
+		return;
+
+	/* Discard windows which are entirely behind the reader, or
+	 * too far ahead to be useful.
+	 */
+	for ( i = 0 ; i < INT13_READAHEAD_WINDOWS ; i++ ) {
+		readahead = &int13->readahead[i];
+		if ( readahead->count &&
+		     ( ( ( readahead->lba + readahead->count ) <= lba ) ||
+		       ( readahead->lba >=
+			 ( lba + ( INT13_READAHEAD_WINDOWS *
+				   window_count ) ) ) ) ) {
+			int13_readahead_retire ( int13, readahead );
+		}
+	}
+
+	/* Find end of contiguous read-ahead coverage */
+	next = lba;
+	do {
+		extended = 0;
+		for ( i = 0 ; i < INT13_READAHEAD_WINDOWS ; i++ ) {
+			readahead = &int13->readahead[i];
+			if ( readahead->count && ( readahead->lba <= next ) &&
+			     ( next < ( readahead->lba +
+					readahead->count ) ) ) {
+				next = ( readahead->lba + readahead->count );
+				extended = 1;
+			}
+		}
+	} while ( extended );
+
+	/* Assign free windows beyond the end of coverage */
+	for ( i = 0 ; i < INT13_READAHEAD_WINDOWS ; i++ ) {
+		readahead = &int13->readahead[i];
+		if ( readahead->count )
+			continue;
+		if ( next >= int13->capacity.blocks )
+			break;
+		if ( readahead->buffer == UNULL ) {
+			readahead->buffer = umalloc ( window_count * blksize );
+			if ( readahead->buffer == UNULL )
+				break;
+		}
+		readahead->lba = next;
+		readahead->count = window_count;
+		if ( readahead->count > ( int13->capacity.blocks - next ) )
+			readahead->count = ( int13->capacity.blocks - next );
+		readahead->issued = 0;
+		DBGC2 ( int13, "INT13 drive %02x read-ahead %08llx+%x\n",
+			int13->drive, ( ( unsigned long long ) readahead->lba ),
+			readahead->count );
+		next += readahead->count;
+	}
+
+	/* Start issuing read-ahead commands */
+	int13_readahead_pump ( int13 );
+}
+
+/**
+ * Check whether INT 13 read-ahead block is available
+ *
+ * @v int13		Emulated drive
+ * @v readahead		Read-ahead window
+ * @v lba		Logical block address
+ * @ret available	Block has been read into the read-ahead window
+ */
+static int int13_readahead_available ( struct int13_drive *int13,
+				       struct int13_readahead *readahead,
+				       uint64_t lba ) {
+	struct int13_command *command;
+	unsigned int i;
+
+	/* Check that block has been requested */
+	if ( lba >= ( readahead->lba + readahead->issued ) )
+		return 0;
+
+	/* Check that no command covering this block is in progress */
+	for ( i = 0 ; i < INT13_MAX_COMMANDS ; i++ ) {
+		command = &int13_commands[i];
+		if ( ( command->int13 == int13 ) &&
+		     ( command->readahead == readahead ) &&
+		     ( command->lba <= lba ) &&
+		     ( lba < ( command->lba + command->count ) ) )
+			return 0;
+	}
+
+	return 1;
+}
+
+/**
+ * Satisfy INT 13 read from read-ahead windows
+ *
+ * @v int13		Emulated drive
+ * @v lba		Starting logical block address to update
+ * @v count		Number of blocks to update
+ * @v buffer		Data buffer to update
+ *
+ * Copies as many leading blocks as possible from the read-ahead
+ * windows, waiting for any read-ahead commands that are already in
+ * flight for those blocks.
+ */
+static void int13_readahead_read ( struct int13_drive *int13, uint64_t *lba,
+				   unsigned int *count, userptr_t *buffer ) {
+	struct int13_readahead *readahead;
+	size_t blksize = int13->capacity.blksize;
+	unsigned int frag_count;
+	unsigned int i;
+
+	while ( *count ) {
+
+		/* Find window containing this block */
+		for ( i = 0 ; i < INT13_READAHEAD_WINDOWS ; i++ ) {
+			readahead = &int13->readahead[i];
+			if ( readahead->count && ( readahead->lba <= *lba ) &&
+			     ( *lba < ( readahead->lba + readahead->count ) ) )
+				break;
+		}
+		if ( i == INT13_READAHEAD_WINDOWS )
+			return;
+
+		/* Wait for block to arrive (or for window to be discarded) */
+		while ( readahead->count &&
+			( ! int13_readahead_available ( int13, readahead,
+							*lba ) ) ) {
+			int13_readahead_pump ( int13 );
+			if ( ( *lba >= ( readahead->lba +
+					 readahead->issued ) ) &&
+			     ( int13_command_pending ( int13,
+						       readahead ) == 0 ) ) {
+				/* Cannot issue read-ahead; read directly */
+				return;
+			}
+			step();
+			int13_reap ( int13 );
+		}
+		if ( ! readahead->count )
+			return;
+
+		/* Copy available blocks */
+		frag_count = 0;
+		while ( ( frag_count < *count ) &&
+			int13_readahead_available ( int13, readahead,
+						    ( *lba + frag_count ) ) &&
+			( ( *lba + frag_count ) <
+			  ( readahead->lba + readahead->count ) ) ) {
+			frag_count++;
+		}
+		memcpy_user ( *buffer, 0, readahead->buffer,
+			      ( ( *lba - readahead->lba ) * blksize ),
+			      ( frag_count * blksize ) );
+		*lba += frag_count;
+		*count -= frag_count;
+		*buffer = userptr_add ( *buffer, ( frag_count * blksize ) );
+	}
+}
+
+/**
+ * Read from or write to INT 13 drive underlying block device
+ *
+ * @v int13		Emulated drive
+ * @v lba		Starting logical block address (in underlying blocks)
+ * @v count		Number of blocks (in underlying blocks)
+ * @v buffer		Data buffer
+ * @v block_rw		Block read/write method
+ * @ret rc		Return status code
+ *
+ * The transfer is split into fragments, as many of which are kept in
+ * flight concurrently as the underlying block device will accept.
+ */
+static int int13_rw_device ( struct int13_drive *int13, uint64_t lba,
+			     unsigned int count, userptr_t buffer,
+			     int ( * block_rw ) ( struct interface *control,
+						  struct interface *data,
+						  uint64_t lba,
+						  unsigned int count,
+						  userptr_t buffer,
+						  size_t len ) ) {
+	struct int13_command *command;
+	unsigned int frag_count;
+	size_t frag_len;
+	int reap_rc;
+	int rc = 0;
+
+	/* Use read-ahead data for reads, and discard it on writes */
+	if ( block_rw == block_read ) {
+		int13_readahead_read ( int13, &lba, &count, &buffer );
+	} else {
+		int13_readahead_discard ( int13 );
+	}
+
+	while ( ( count && ( rc == 0 ) ) ||
+		int13_command_pending ( int13, NULL ) ) {
+
+		/* Issue next fragment, if possible */
+		if ( count && ( rc == 0 ) ) {
+			if ( ! int13_command_pending ( int13, NULL ) ) {
+				if ( int13->block_rc != 0 )
+					int13_readahead_discard ( int13 );
+				if ( ( rc = int13_prepare ( int13 ) ) != 0 )
+					continue;
+			}
+			if ( xfer_window ( &int13->block ) &&
+			     ( command = int13_command_alloc() ) ) {
+
+				/* Determine fragment length */
+				frag_count = count;
+				if ( frag_count > int13->capacity.max_count )
+					frag_count = int13->capacity.max_count;
+				frag_len = ( int13->capacity.blksize *
+					     frag_count );
+
+				/* Issue command */
+				int13_command_start ( command, int13, lba,
+						      frag_count, NULL );
+				if ( ( rc = block_rw ( &int13->block,
+						       &command->block, lba,
+						       frag_count, buffer,
+						       frag_len ) ) != 0 ) {
+					int13_command_stop ( command );
+					continue;
+				}
+
+				/* Move to next fragment */
+				lba += frag_count;
+				count -= frag_count;
+				buffer = userptr_add ( buffer, frag_len );
+				continue;
+			}
+		}
+
+		/* Wait for completions */
+		step();
+		reap_rc = int13_reap ( int13 );
+		if ( rc == 0 )
+			rc = reap_rc;
+	}
+
+	return rc;
+}
 
 /**
  * Read from or write to INT 13 drive
@@ -388,6 +924,10 @@ static struct int13_command int13_command = {
  * @v buffer		Data buffer
  * @v block_rw		Block read/write method
  * @ret rc		Return status code
+ *
+ * Reads are satisfied from the block cache where possible.  Writes
+ * are passed through to the underlying device and update the block
+ * cache.  Sequential reads trigger read-ahead of subsequent blocks.
  */
 static int int13_rw ( struct int13_drive *int13, uint64_t lba,
 		      unsigned int count, userptr_t buffer,
@@ -395,39 +935,58 @@ static int int13_rw ( struct int13_drive *int13, uint64_t lba,
 					   struct interface *data,
 					   uint64_t lba, unsigned int count,
 					   userptr_t buffer, size_t len ) ) {
-	struct int13_command *command = &int13_command;
+	struct block_cache *cache = &int13->cache;
+	size_t blksize = int13->capacity.blksize;
 	unsigned int frag_count;
-	size_t frag_len;
+	uint64_t end;
+	int sequential;
 	int rc;
 
 	/* Translate to underlying blocksize */
 	lba <<= int13->blksize_shift;
 	count <<= int13->blksize_shift;
+	end = ( lba + count );
+	sequential = ( lba == int13->next_lba );
+	int13_reap ( int13 );
+
+	if ( block_rw == block_read ) {
+
+		/* Read alternating runs of cached and uncached blocks */
+		while ( count ) {
+			frag_count = block_cache_read ( cache, lba, count,
+							buffer );
+			if ( frag_count == 0 ) {
+				frag_count = block_cache_missing ( cache, lba,
+								   count );
+				if ( ( rc = int13_rw_device ( int13, lba,
+							      frag_count,
+							      buffer,
+							      block_rw ) ) != 0)
+					return rc;
+				block_cache_insert ( cache, lba, frag_count,
+						     buffer );
+			}
+			lba += frag_count;
+			count -= frag_count;
+			buffer = userptr_add ( buffer,
+					       ( frag_count * blksize ) );
+		}
 
-	while ( count ) {
+		/* Read ahead if access appears to be sequential */
+		if ( sequential )
+			int13_readahead_extend ( int13, end );
 
-		/* Determine fragment length */
-		frag_count = count;
-		if ( frag_count > int13->capacity.max_count )
-			frag_count = int13->capacity.max_count;
-		frag_len = ( int13->capacity.blksize * frag_count );
+	} else {
 
-		/* Issue command */
-		if ( ( ( rc = int13_command_start ( command, int13 ) ) != 0 ) ||
-		     ( ( rc = block_rw ( &int13->block, &command->block, lba,
-					 frag_count, buffer,
-					 frag_len ) ) != 0 ) ||
-		     ( ( rc = int13_command_wait ( command ) ) != 0 ) ) {
-			int13_command_stop ( command );
+		/* Write through to underlying device */
+		if ( ( rc = int13_rw_device ( int13, lba, count, buffer,
+					      block_rw ) ) != 0 ) {
+			block_cache_invalidate ( cache, lba, count );
 			return rc;
 		}
-		int13_command_stop ( command );
-
-		/* Move to next fragment */
-		lba += frag_count;
-		count -= frag_count;
-		buffer = userptr_add ( buffer, frag_len );
+		block_cache_write ( cache, lba, count, buffer );
 	}
+	int13->next_lba = end;
 
 	return 0;
 }
@@ -439,12 +998,20 @@ static int int13_rw ( struct int13_drive *int13, uint64_t lba,
  * @ret rc		Return status code
  */
 static int int13_read_capacity ( struct int13_drive *int13 ) {
-	struct int13_command *command = &int13_command;
+	struct int13_command *command;
 	int rc;
 
+	/* Allocate command */
+	int13_readahead_discard ( int13 );
+	command = int13_command_alloc();
+	if ( ! command )
+		return -ENOBUFS;
+
 	/* Issue command */
-	if ( ( ( rc = int13_command_start ( command, int13 ) ) != 0 ) ||
-	     ( ( rc = block_read_capacity ( &int13->block,
+	if ( ( rc = int13_prepare ( int13 ) ) != 0 )
+		return rc;
+	int13_command_start ( command, int13, 0, 0, NULL );
+	if ( ( ( rc = block_read_capacity ( &int13->block,
 					    &command->block ) ) != 0 ) ||
 	     ( ( rc = int13_command_wait ( command ) ) != 0 ) ) {
 		int13_command_stop ( command );
@@ -1455,6 +2022,28 @@ static __asmcall void int13 ( struct i386_all_regs *ix86 ) {
 	}
 }
 
+/**
+ * Determine block cache size
+ *
+ * @ret len		Maximum block cache size
+ */
+static size_t int13_cache_len ( void ) {
+	struct memory_map memmap;
+	uint64_t total = 0;
+	unsigned int i;
+
+	/* Use a fixed fraction of total system memory */
+	get_memmap ( &memmap );
+	for ( i = 0 ; i < memmap.count ; i++ ) {
+		total += ( memmap.regions[i].end -
+			   memmap.regions[i].start );
+	}
+	total /= INT13_CACHE_FRACTION;
+	if ( total > INT13_CACHE_MAX_LEN )
+		total = INT13_CACHE_MAX_LEN;
+	return total;
+}
+
 /**
  * Hook INT 13 handler
  *
@@ -1576,7 +2165,11 @@ static struct interface_descriptor int13_block_desc =
 static void int13_free ( struct refcnt *refcnt ) {
 	struct int13_drive *int13 =
 		container_of ( refcnt, struct int13_drive, refcnt );
+	unsigned int i;
 
+	for ( i = 0 ; i < INT13_READAHEAD_WINDOWS ; i++ )
+		ufree ( int13->readahead[i].buffer );
+	block_cache_fini ( &int13->cache );
 	uri_put ( int13->uri );
 	free ( int13 );
 }
@@ -1629,6 +2222,14 @@ static int int13_hook ( struct uri *uri, unsigned int drive ) {
 	if ( ( rc = int13_read_capacity ( int13 ) ) != 0 )
 		goto err_read_capacity;
 
+	/* Initialise block cache (failure is not fatal) */
+	if ( ( rc = block_cache_init ( &int13->cache,
+				       int13->capacity.blksize,
+				       int13_cache_len() ) ) != 0 ) {
+		DBGC ( int13, "INT13 drive %02x running without block "
+		       "cache: %s\n", drive, strerror ( rc ) );
+	}
+
 	/* Allocate scratch area */
 	scratch = malloc ( int13_blksize ( int13 ) );
 	if ( ! scratch )
@@ -1667,6 +2268,7 @@ static int int13_hook ( struct uri *uri, unsigned int drive ) {
  err_alloc_scratch:
  err_read_capacity:
  err_reopen_block:
+	int13_readahead_discard ( int13 );
 	intf_shutdown ( &int13->block, rc );
 	ref_put ( &int13->refcnt );
  err_zalloc:
@@ -1709,6 +2311,9 @@ static void int13_unhook ( unsigned int drive ) {
 		return;
 	}
 
+	/* Abandon any read-ahead */
+	int13_readahead_discard ( int13 );
+
 	/* Shut down interfaces */
 	intf_shutdown ( &int13->block, 0 );
 
@@ -1731,6 +2336,26 @@ static void int13_unhook ( unsigned int drive ) {
 	ref_put ( &int13->refcnt );
 }
 
+/**
+ * Get INT 13 emulated drive block cache statistics
+ *
+ * @v drive		Drive number
+ * @v stats		Block cache statistics to fill in
+ * @ret rc		Return status code
+ */
+static int int13_stats ( unsigned int drive,
+			 struct block_cache_stats *stats ) {
+	struct int13_drive *int13;
+
+	/* Find drive */
+	int13 = int13_find ( drive );
+	if ( ! int13 )
+		return -ENODEV;
+
+	memcpy ( stats, &int13->cache.stats, sizeof ( *stats ) );
+	return 0;
+}
+
 /**
  * Load and verify master boot record from INT 13 drive
  *
@@ -1985,3 +2610,4 @@ PROVIDE_SANBOOT ( pcbios, san_hook, int13_hook );
 PROVIDE_SANBOOT ( pcbios, san_unhook, int13_unhook );
 PROVIDE_SANBOOT ( pcbios, san_boot, int13_boot );
 PROVIDE_SANBOOT ( pcbios, san_describe, int13_describe );
+PROVIDE_SANBOOT ( pcbios, san_stats, int13_stats );
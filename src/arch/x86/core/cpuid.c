@@ -60,6 +60,8 @@ static int cpuid_is_supported ( void ) {
  * @v ebx		Output via %ebx
  * @v ecx		Output via %ecx
  * @v edx		Output via %edx
+ *
+ * The subfunction number (in %ecx) is always zero.
  */
 static inline __attribute__ (( always_inline )) void
 cpuid ( uint32_t operation, uint32_t *eax, uint32_t *ebx, uint32_t *ecx,
@@ -67,7 +69,7 @@ cpuid ( uint32_t operation, uint32_t *eax, uint32_t *ebx, uint32_t *ecx,
 
 	__asm__ ( "cpuid"
 		  : "=a" ( *eax ), "=b" ( *ebx ), "=c" ( *ecx ), "=d" ( *edx )
-		  : "0" ( operation ) );
+		  : "0" ( operation ), "2" ( 0 ) );
 }
 
 /**
@@ -97,6 +99,13 @@ static void x86_intel_features ( struct x86_features *features ) {
 	DBGC ( features, "CPUID Intel features: %%ecx=%08x, %%edx=%08x\n",
 	       features->intel.ecx, features->intel.edx );
 
+	/* Get structured extended features, if available */
+	if ( max_level < CPUID_EXT_FEATURES )
+		return;
+	cpuid ( CPUID_EXT_FEATURES, &discard_a, &features->ext.ebx,
+		&features->ext.ecx, &discard_d );
+	DBGC ( features, "CPUID extended features: %%ebx=%08x, %%ecx=%08x\n",
+	       features->ext.ebx, features->ext.ecx );
 }
 
 /**
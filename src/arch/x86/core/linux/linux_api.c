@@ -89,6 +89,10 @@ int linux_gettimeofday ( struct timeval *tv, struct timezone *tz ) {
 	return linux_syscall ( __NR_gettimeofday, tv, tz );
 }
 
+int linux_clock_gettime ( clockid_t clk_id, struct timespec *tp ) {
+	return linux_syscall ( __NR_clock_gettime, clk_id, tp );
+}
+
 void * linux_mmap ( void *addr, __kernel_size_t length, int prot, int flags,
 		    int fd, __kernel_off_t offset ) {
 	return ( void * ) linux_syscall ( __SYSCALL_mmap, addr, length, prot,
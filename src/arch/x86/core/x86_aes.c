@@ -0,0 +1,294 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+/** @file
+ *
+ * AES using the x86 AES instructions
+ *
+ * As with the SHA extensions, the AES instructions operate on the
+ * %xmm registers and so are used only in 64-bit builds.
+ *
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <byteswap.h>
+#include <ipxe/init.h>
+#include <ipxe/cpuid.h>
+#include <ipxe/aes.h>
+
+/** A vector of two qwords */
+typedef long long x86_v2di __attribute__ (( vector_size ( 16 ) ));
+
+/** A vector of two qwords, with no alignment requirement */
+typedef long long x86_v2di_u __attribute__ (( vector_size ( 16 ),
+					      aligned ( 1 ), may_alias ));
+
+/** Target attribute for functions using the AES instructions */
+#define X86_AES_TARGET __attribute__ (( target ( "aes,sse2" ) ))
+
+/**
+ * Load vector
+ *
+ * @v data		Data
+ * @ret v		Vector
+ */
+static inline __attribute__ (( always_inline )) X86_AES_TARGET x86_v2di
+x86_aes_load ( const void *data ) {
+	return *( ( const x86_v2di_u * ) data );
+}
+
+/**
+ * Store vector
+ *
+ * @v data		Data buffer
+ * @v v			Vector
+ */
+static inline __attribute__ (( always_inline )) X86_AES_TARGET void
+x86_aes_store ( void *data, x86_v2di v ) {
+	*( ( x86_v2di_u * ) data ) = v;
+}
+
+/**
+ * Prepare round keys
+ *
+ * @v ctx		AES context
+ */
+static X86_AES_TARGET void x86_aes_setkey ( struct aes_context *ctx ) {
+	struct aes_round_keys *keys = &ctx->keys;
+	unsigned int rounds = ctx->axtls_ctx.rounds;
+	uint32_t *key;
+	unsigned int i;
+
+	/* Convert AXTLS (host-endian) key schedule to byte order */
+	for ( i = 0 ; i <= rounds ; i++ ) {
+		key = ( ( void * ) keys->encrypt[i] );
+		key[0] = cpu_to_be32 ( ctx->axtls_ctx.ks[ 4 * i + 0 ] );
+		key[1] = cpu_to_be32 ( ctx->axtls_ctx.ks[ 4 * i + 1 ] );
+		key[2] = cpu_to_be32 ( ctx->axtls_ctx.ks[ 4 * i + 2 ] );
+		key[3] = cpu_to_be32 ( ctx->axtls_ctx.ks[ 4 * i + 3 ] );
+	}
+
+	/* Construct decryption key schedule for the equivalent
+	 * inverse cipher.
+	 */
+	memcpy ( keys->decrypt[0], keys->encrypt[rounds],
+		 sizeof ( keys->decrypt[0] ) );
+	for ( i = 1 ; i < rounds ; i++ ) {
+		x86_aes_store ( keys->decrypt[i], __builtin_ia32_aesimc128 (
+				x86_aes_load ( keys->encrypt[ rounds - i ] ) ) );
+	}
+	memcpy ( keys->decrypt[rounds], keys->encrypt[0],
+		 sizeof ( keys->decrypt[rounds] ) );
+}
+
+/**
+ * Encrypt block
+ *
+ * @v ctx		AES context
+ * @v block		Block
+ * @ret block		Encrypted block
+ */
+static inline __attribute__ (( always_inline )) X86_AES_TARGET x86_v2di
+x86_aes_encrypt_block ( struct aes_context *ctx, x86_v2di block ) {
+	uint8_t ( * key )[AES_BLOCKSIZE] = ctx->keys.encrypt;
+	unsigned int rounds = ctx->axtls_ctx.rounds;
+	unsigned int i;
+
+	block ^= x86_aes_load ( key[0] );
+	for ( i = 1 ; i < rounds ; i++ )
+		block = __builtin_ia32_aesenc128 ( block,
+						   x86_aes_load ( key[i] ) );
+	return __builtin_ia32_aesenclast128 ( block,
+					      x86_aes_load ( key[rounds] ) );
+}
+
+/**
+ * Encrypt single block
+ *
+ * @v ctx		AES context
+ * @v src		Data to encrypt
+ * @v dst		Buffer for encrypted data
+ */
+static X86_AES_TARGET void x86_aes_encrypt ( struct aes_context *ctx,
+					     const void *src, void *dst ) {
+
+	x86_aes_store ( dst, x86_aes_encrypt_block ( ctx,
+						     x86_aes_load ( src ) ) );
+}
+
+/**
+ * Decrypt block
+ *
+ * @v ctx		AES context
+ * @v block		Block
+ * @ret block		Decrypted block
+ */
+static inline __attribute__ (( always_inline )) X86_AES_TARGET x86_v2di
+x86_aes_decrypt_block ( struct aes_context *ctx, x86_v2di block ) {
+	uint8_t ( * key )[AES_BLOCKSIZE] = ctx->keys.decrypt;
+	unsigned int rounds = ctx->axtls_ctx.rounds;
+	unsigned int i;
+
+	block ^= x86_aes_load ( key[0] );
+	for ( i = 1 ; i < rounds ; i++ )
+		block = __builtin_ia32_aesdec128 ( block,
+						   x86_aes_load ( key[i] ) );
+	return __builtin_ia32_aesdeclast128 ( block,
+					      x86_aes_load ( key[rounds] ) );
+}
+
+/**
+ * Decrypt single block
+ *
+ * @v ctx		AES context
+ * @v src		Data to decrypt
+ * @v dst		Buffer for decrypted data
+ */
+static X86_AES_TARGET void x86_aes_decrypt ( struct aes_context *ctx,
+					     const void *src, void *dst ) {
+
+	x86_aes_store ( dst, x86_aes_decrypt_block ( ctx,
+						     x86_aes_load ( src ) ) );
+}
+
+/**
+ * Encrypt data in CBC mode
+ *
+ * @v ctx		AES context
+ * @v src		Data to encrypt
+ * @v dst		Buffer for encrypted data
+ * @v len		Length of data
+ * @v iv		Initialisation vector (updated on return)
+ */
+static X86_AES_TARGET void x86_aes_cbc_encrypt ( struct aes_context *ctx,
+						 const void *src, void *dst,
+						 size_t len, void *iv ) {
+	x86_v2di block = x86_aes_load ( iv );
+
+	for ( ; len ; len -= AES_BLOCKSIZE, src += AES_BLOCKSIZE,
+		      dst += AES_BLOCKSIZE ) {
+		block = x86_aes_encrypt_block ( ctx, ( block ^
+						       x86_aes_load ( src ) ) );
+		x86_aes_store ( dst, block );
+	}
+	x86_aes_store ( iv, block );
+}
+
+/**
+ * Decrypt data in CBC mode
+ *
+ * @v ctx		AES context
+ * @v src		Data to decrypt
+ * @v dst		Buffer for decrypted data
+ * @v len		Length of data
+ * @v iv		Initialisation vector (updated on return)
+ */
+static X86_AES_TARGET void x86_aes_cbc_decrypt ( struct aes_context *ctx,
+						 const void *src, void *dst,
+						 size_t len, void *iv ) {
+	uint8_t ( * key )[AES_BLOCKSIZE] = ctx->keys.decrypt;
+	unsigned int rounds = ctx->axtls_ctx.rounds;
+	x86_v2di chain = x86_aes_load ( iv );
+	x86_v2di c0, c1, c2, c3;
+	x86_v2di b0, b1, b2, b3;
+	x86_v2di round_key;
+	unsigned int i;
+
+	/* CBC decryption (unlike CBC encryption) has no dependency
+	 * between blocks, so decrypt four blocks at a time to hide
+	 * the latency of the AES instructions.  All four blocks are
+	 * loaded before any are stored, so decryption may be
+	 * performed in place.
+	 */
+	for ( ; len >= ( 4 * AES_BLOCKSIZE ) ; len -= ( 4 * AES_BLOCKSIZE ),
+		      src += ( 4 * AES_BLOCKSIZE ),
+		      dst += ( 4 * AES_BLOCKSIZE ) ) {
+		round_key = x86_aes_load ( key[0] );
+		c0 = x86_aes_load ( src + ( 0 * AES_BLOCKSIZE ) );
+		c1 = x86_aes_load ( src + ( 1 * AES_BLOCKSIZE ) );
+		c2 = x86_aes_load ( src + ( 2 * AES_BLOCKSIZE ) );
+		c3 = x86_aes_load ( src + ( 3 * AES_BLOCKSIZE ) );
+		b0 = ( c0 ^ round_key );
+		b1 = ( c1 ^ round_key );
+		b2 = ( c2 ^ round_key );
+		b3 = ( c3 ^ round_key );
+		for ( i = 1 ; i < rounds ; i++ ) {
+			round_key = x86_aes_load ( key[i] );
+			b0 = __builtin_ia32_aesdec128 ( b0, round_key );
+			b1 = __builtin_ia32_aesdec128 ( b1, round_key );
+			b2 = __builtin_ia32_aesdec128 ( b2, round_key );
+			b3 = __builtin_ia32_aesdec128 ( b3, round_key );
+		}
+		round_key = x86_aes_load ( key[rounds] );
+		b0 = __builtin_ia32_aesdeclast128 ( b0, round_key );
+		b1 = __builtin_ia32_aesdeclast128 ( b1, round_key );
+		b2 = __builtin_ia32_aesdeclast128 ( b2, round_key );
+		b3 = __builtin_ia32_aesdeclast128 ( b3, round_key );
+		x86_aes_store ( ( dst + ( 0 * AES_BLOCKSIZE ) ), ( b0 ^ chain ) );
+		x86_aes_store ( ( dst + ( 1 * AES_BLOCKSIZE ) ), ( b1 ^ c0 ) );
+		x86_aes_store ( ( dst + ( 2 * AES_BLOCKSIZE ) ), ( b2 ^ c1 ) );
+		x86_aes_store ( ( dst + ( 3 * AES_BLOCKSIZE ) ), ( b3 ^ c2 ) );
+		chain = c3;
+	}
+
+	/* Decrypt any remaining blocks individually */
+	for ( ; len ; len -= AES_BLOCKSIZE, src += AES_BLOCKSIZE,
+		      dst += AES_BLOCKSIZE ) {
+		c0 = x86_aes_load ( src );
+		x86_aes_store ( dst, ( x86_aes_decrypt_block ( ctx, c0 ) ^
+				       chain ) );
+		chain = c0;
+	}
+	x86_aes_store ( iv, chain );
+}
+
+/** AES using the x86 AES instructions */
+static struct aes_accelerator x86_aes_accelerator = {
+	.name = "aesni",
+	.setkey = x86_aes_setkey,
+	.cbc_encrypt = x86_aes_cbc_encrypt,
+	.cbc_decrypt = x86_aes_cbc_decrypt,
+	.encrypt = x86_aes_encrypt,
+	.decrypt = x86_aes_decrypt,
+};
+
+/**
+ * Select accelerated AES implementation
+ *
+ */
+static void x86_aes_init ( void ) {
+	struct x86_features features;
+
+	/* Check for AES instructions */
+	x86_features ( &features );
+	if ( ! ( features.intel.ecx & CPUID_FEATURES_INTEL_ECX_AES ) ) {
+		DBGC ( &features, "AES instructions not supported\n" );
+		return;
+	}
+
+	/* Use AES instructions */
+	DBGC ( &features, "AES using AES instructions\n" );
+	aes_accel = &x86_aes_accelerator;
+}
+
+/** Accelerated AES initialisation function */
+struct init_fn x86_aes_init_fn __init_fn ( INIT_NORMAL ) = {
+	.initialise = x86_aes_init,
+};
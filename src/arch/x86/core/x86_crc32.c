@@ -0,0 +1,199 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+/** @file
+ *
+ * CRC32 using the x86 carry-less multiplication instruction
+ *
+ * The data is folded 64 bytes at a time into four 128-bit
+ * accumulators using PCLMULQDQ, then reduced to 32 bits with a
+ * bit-reflected Barrett reduction, as described in Intel's "Fast CRC
+ * Computation for Generic Polynomials Using PCLMULQDQ Instruction".
+ *
+ * As with the SHA extensions, this is used only in 64-bit builds.
+ *
+ */
+
+#include <stdint.h>
+#include <ipxe/init.h>
+#include <ipxe/cpuid.h>
+#include <ipxe/crc32.h>
+
+/** A vector of two qwords */
+typedef long long x86_v2di __attribute__ (( vector_size ( 16 ) ));
+
+/** A vector of two qwords, with no alignment requirement */
+typedef long long x86_v2di_u __attribute__ (( vector_size ( 16 ),
+					      aligned ( 1 ), may_alias ));
+
+/** A vector of four dwords */
+typedef int x86_v4si __attribute__ (( vector_size ( 16 ) ));
+
+/** Target attribute for functions using carry-less multiplication */
+#define X86_CRC32_TARGET __attribute__ (( target ( "pclmul,sse2" ) ))
+
+/** Minimum length for which folding is worthwhile */
+#define X86_CRC32_MIN_LEN 64
+
+/** Folding constants x^(4*128+64) mod P and x^(4*128) mod P (shifted) */
+#define X86_CRC32_K1K2 { 0x0154442bd4LL, 0x01c6e41596LL }
+
+/** Folding constants x^(128+64) mod P and x^128 mod P (shifted) */
+#define X86_CRC32_K3K4 { 0x01751997d0LL, 0x00ccaa009eLL }
+
+/** Folding constant x^64 mod P (shifted) */
+#define X86_CRC32_K5 { 0x0163cd6124LL, 0 }
+
+/** Barrett reduction constants: P and floor(x^64 / P) (bit-reflected) */
+#define X86_CRC32_POLY_MU { 0x01db710641LL, 0x01f7011641LL }
+
+/**
+ * Load vector
+ *
+ * @v data		Data
+ * @ret v		Vector
+ */
+static inline __attribute__ (( always_inline )) X86_CRC32_TARGET x86_v2di
+x86_crc32_load ( const void *data ) {
+	return *( ( const x86_v2di_u * ) data );
+}
+
+/**
+ * Fold 128-bit accumulator
+ *
+ * @v acc		Accumulator
+ * @v k			Folding constants
+ * @v data		Data to fold in
+ * @ret acc		New accumulator
+ */
+static inline __attribute__ (( always_inline )) X86_CRC32_TARGET x86_v2di
+x86_crc32_fold ( x86_v2di acc, x86_v2di k, x86_v2di data ) {
+	return ( __builtin_ia32_pclmulqdq128 ( acc, k, 0x00 ) ^
+		 __builtin_ia32_pclmulqdq128 ( acc, k, 0x11 ) ^ data );
+}
+
+/**
+ * Calculate CRC32 over whole 16-byte blocks
+ *
+ * @v seed		Initial value
+ * @v data		Data to checksum
+ * @v len		Length of data (a multiple of 16, at least 64)
+ * @ret crc		CRC checksum
+ */
+static X86_CRC32_TARGET u32 x86_crc32_fold_blocks ( u32 seed,
+						    const void *data,
+						    size_t len ) {
+	const x86_v2di k1k2 = X86_CRC32_K1K2;
+	const x86_v2di k3k4 = X86_CRC32_K3K4;
+	const x86_v2di k5 = X86_CRC32_K5;
+	const x86_v2di poly_mu = X86_CRC32_POLY_MU;
+	const x86_v4si mask32 = { -1, 0, 0, 0 };
+	const x86_v4si zero = { 0, 0, 0, 0 };
+	x86_v2di x0, x1, x2, x3;
+	x86_v2di t;
+
+	/* Load first 64 bytes and mix in seed */
+	x0 = ( x86_crc32_load ( data + 0x00 ) ^
+	       ( x86_v2di ) ( x86_v4si ) { seed, 0, 0, 0 } );
+	x1 = x86_crc32_load ( data + 0x10 );
+	x2 = x86_crc32_load ( data + 0x20 );
+	x3 = x86_crc32_load ( data + 0x30 );
+	data += 0x40;
+	len -= 0x40;
+
+	/* Fold 64 bytes at a time */
+	for ( ; len >= 0x40 ; len -= 0x40, data += 0x40 ) {
+		x0 = x86_crc32_fold ( x0, k1k2, x86_crc32_load ( data + 0x00 ));
+		x1 = x86_crc32_fold ( x1, k1k2, x86_crc32_load ( data + 0x10 ));
+		x2 = x86_crc32_fold ( x2, k1k2, x86_crc32_load ( data + 0x20 ));
+		x3 = x86_crc32_fold ( x3, k1k2, x86_crc32_load ( data + 0x30 ));
+	}
+
+	/* Fold four accumulators into one */
+	x0 = x86_crc32_fold ( x0, k3k4, x1 );
+	x0 = x86_crc32_fold ( x0, k3k4, x2 );
+	x0 = x86_crc32_fold ( x0, k3k4, x3 );
+
+	/* Fold any remaining 16-byte blocks */
+	for ( ; len ; len -= 0x10, data += 0x10 )
+		x0 = x86_crc32_fold ( x0, k3k4, x86_crc32_load ( data ) );
+
+	/* Fold 128 bits to 64 bits (appending 32 zero bits) */
+	t = __builtin_ia32_pclmulqdq128 ( k3k4, x0, 0x01 );
+	x0 = ( ( x86_v2di ) { x0[1], 0 } ^ t );
+	t = ( x0 & ( x86_v2di ) mask32 );
+	x0 = ( x86_v2di ) __builtin_shuffle ( ( x86_v4si ) x0, zero,
+					      ( x86_v4si ) { 1, 2, 3, 4 } );
+	x0 ^= __builtin_ia32_pclmulqdq128 ( t, k5, 0x00 );
+
+	/* Barrett reduction from 64 bits to 32 bits */
+	t = ( x0 & ( x86_v2di ) mask32 );
+	t = __builtin_ia32_pclmulqdq128 ( t, poly_mu, 0x10 );
+	t &= ( x86_v2di ) mask32;
+	t = __builtin_ia32_pclmulqdq128 ( t, poly_mu, 0x00 );
+	x0 ^= t;
+
+	return ( ( x86_v4si ) x0 )[1];
+}
+
+/**
+ * Calculate 32-bit little-endian CRC checksum using PCLMULQDQ
+ *
+ * @v seed		Initial value
+ * @v data		Data to checksum
+ * @v len		Length of data
+ * @ret crc		CRC checksum
+ */
+static u32 x86_crc32_le ( u32 seed, const void *data, size_t len ) {
+	size_t fold_len;
+
+	/* Use generic code for short buffers */
+	if ( len < X86_CRC32_MIN_LEN )
+		return crc32_le_generic ( seed, data, len );
+
+	/* Fold whole 16-byte blocks, then finish with generic code */
+	fold_len = ( len & ~( ( size_t ) 0x0f ) );
+	seed = x86_crc32_fold_blocks ( seed, data, fold_len );
+	return crc32_le_generic ( seed, ( data + fold_len ),
+				  ( len - fold_len ) );
+}
+
+/**
+ * Select accelerated CRC32 implementation
+ *
+ */
+static void x86_crc32_init ( void ) {
+	struct x86_features features;
+
+	/* Check for carry-less multiplication instruction */
+	x86_features ( &features );
+	if ( ! ( features.intel.ecx & CPUID_FEATURES_INTEL_ECX_PCLMUL ) ) {
+		DBGC ( &features, "PCLMULQDQ not supported\n" );
+		return;
+	}
+
+	/* Use carry-less multiplication */
+	DBGC ( &features, "CRC32 using PCLMULQDQ\n" );
+	crc32_le_accel = x86_crc32_le;
+}
+
+/** Accelerated CRC32 initialisation function */
+struct init_fn x86_crc32_init_fn __init_fn ( INIT_NORMAL ) = {
+	.initialise = x86_crc32_init,
+};
@@ -0,0 +1,291 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+/** @file
+ *
+ * SHA-1 and SHA-256 using the x86 SHA extensions
+ *
+ * The SHA extensions operate on the 128-bit %xmm registers.  The
+ * state of these registers is guaranteed to be enabled only when
+ * running in 64-bit mode (which implies either UEFI or a hosted
+ * environment), so these implementations are selected only in
+ * 64-bit builds and only when the CPU reports support for the
+ * relevant instructions.
+ *
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <ipxe/init.h>
+#include <ipxe/cpuid.h>
+#include <ipxe/sha1.h>
+#include <ipxe/sha256.h>
+
+/** A vector of four dwords */
+typedef int x86_v4si __attribute__ (( vector_size ( 16 ) ));
+
+/** A vector of four dwords, with no alignment requirement */
+typedef int x86_v4si_u __attribute__ (( vector_size ( 16 ), aligned ( 1 ),
+					 may_alias ));
+
+/** A vector of sixteen bytes */
+typedef char x86_v16qi __attribute__ (( vector_size ( 16 ) ));
+
+/** Target attribute for functions using the SHA extensions */
+#define X86_SHA_TARGET __attribute__ (( target ( "sha,sse4.1" ) ))
+
+/**
+ * Load data block vector
+ *
+ * @v data		Data
+ * @v swap		Byte shuffle mask
+ * @ret v		Vector
+ */
+static inline __attribute__ (( always_inline )) X86_SHA_TARGET x86_v4si
+x86_sha_load ( const void *data, x86_v16qi swap ) {
+	x86_v4si v = *( ( const x86_v4si_u * ) data );
+
+	return ( ( x86_v4si ) __builtin_shuffle ( ( x86_v16qi ) v, swap ) );
+}
+
+/**
+ * Perform four SHA-1 steps
+ *
+ * @v i			Group number (0-19)
+ *
+ * Message schedule vectors are held in msg[0..3], and the
+ * partially-calculated e values alternate between e[0] and e[1].
+ */
+#define X86_SHA1_STEP4( i ) do {					\
+	x86_v4si *cur = &e[ (i) % 2 ];					\
+	x86_v4si w = msg[ (i) % 4 ];					\
+	if ( (i) == 0 ) {						\
+		*cur += w;						\
+	} else {							\
+		*cur = __builtin_ia32_sha1nexte ( *cur, w );		\
+	}								\
+	e[ ( (i) + 1 ) % 2 ] = abcd;					\
+	if ( ( (i) >= 3 ) && ( (i) <= 18 ) ) {				\
+		msg[ ( (i) + 1 ) % 4 ] =				\
+			__builtin_ia32_sha1msg2 ( msg[ ( (i) + 1 ) % 4 ], w );\
+	}								\
+	abcd = __builtin_ia32_sha1rnds4 ( abcd, *cur, ( (i) / 5 ) );	\
+	if ( ( (i) >= 1 ) && ( (i) <= 16 ) ) {				\
+		msg[ ( (i) + 3 ) % 4 ] =				\
+			__builtin_ia32_sha1msg1 ( msg[ ( (i) + 3 ) % 4 ], w );\
+	}								\
+	if ( ( (i) >= 2 ) && ( (i) <= 17 ) )				\
+		msg[ ( (i) + 2 ) % 4 ] ^= w;				\
+	} while ( 0 )
+
+/**
+ * Process SHA-1 data blocks using SHA extensions
+ *
+ * @v digest		Digest (in host-endian order)
+ * @v data		Data blocks
+ * @v count		Number of blocks
+ */
+static X86_SHA_TARGET void x86_sha1_blocks ( struct sha1_digest *digest,
+					     const void *data, size_t count ) {
+	const x86_v16qi swap = { 15, 14, 13, 12, 11, 10, 9, 8,
+				 7, 6, 5, 4, 3, 2, 1, 0 };
+	x86_v4si abcd;
+	x86_v4si abcd_save;
+	x86_v4si e_save;
+	x86_v4si e[2];
+	x86_v4si msg[4];
+	unsigned int i;
+
+	/* Load state, with a in the most significant dword */
+	abcd = ( x86_v4si ) { digest->h[3], digest->h[2],
+			      digest->h[1], digest->h[0] };
+	e[0] = ( x86_v4si ) { 0, 0, 0, digest->h[4] };
+
+	for ( ; count ; count--, data += sizeof ( union sha1_block ) ) {
+
+		/* Record state */
+		abcd_save = abcd;
+		e_save = e[0];
+
+		/* Load message, with w[0] in the most significant dword */
+		for ( i = 0 ; i < 4 ; i++ )
+			msg[i] = x86_sha_load ( ( data + ( 16 * i ) ), swap );
+
+		/* Main loop */
+		X86_SHA1_STEP4 ( 0 );
+		X86_SHA1_STEP4 ( 1 );
+		X86_SHA1_STEP4 ( 2 );
+		X86_SHA1_STEP4 ( 3 );
+		X86_SHA1_STEP4 ( 4 );
+		X86_SHA1_STEP4 ( 5 );
+		X86_SHA1_STEP4 ( 6 );
+		X86_SHA1_STEP4 ( 7 );
+		X86_SHA1_STEP4 ( 8 );
+		X86_SHA1_STEP4 ( 9 );
+		X86_SHA1_STEP4 ( 10 );
+		X86_SHA1_STEP4 ( 11 );
+		X86_SHA1_STEP4 ( 12 );
+		X86_SHA1_STEP4 ( 13 );
+		X86_SHA1_STEP4 ( 14 );
+		X86_SHA1_STEP4 ( 15 );
+		X86_SHA1_STEP4 ( 16 );
+		X86_SHA1_STEP4 ( 17 );
+		X86_SHA1_STEP4 ( 18 );
+		X86_SHA1_STEP4 ( 19 );
+
+		/* Add chunk to hash */
+		e[0] = __builtin_ia32_sha1nexte ( e[0], e_save );
+		abcd += abcd_save;
+	}
+
+	/* Store state */
+	digest->h[0] = abcd[3];
+	digest->h[1] = abcd[2];
+	digest->h[2] = abcd[1];
+	digest->h[3] = abcd[0];
+	digest->h[4] = e[0][3];
+}
+
+/**
+ * Perform four SHA-256 steps
+ *
+ * @v i			Group number (0-15)
+ *
+ * Message schedule vectors are held in msg[0..3].  The working
+ * variables are held as (a,b,e,f) and (c,d,g,h), with the roles of
+ * the two vectors alternating after each pair of steps.
+ */
+#define X86_SHA256_STEP4( i ) do {					\
+	x86_v4si w = msg[ (i) % 4 ];					\
+	x86_v4si wk = ( w + *( ( const x86_v4si_u * )			\
+			       &sha256_k[ 4 * (i) ] ) );		\
+	cdgh = __builtin_ia32_sha256rnds2 ( cdgh, abef, wk );		\
+	if ( ( (i) >= 3 ) && ( (i) <= 14 ) ) {				\
+		msg[ ( (i) + 1 ) % 4 ] +=				\
+			__builtin_shuffle ( msg[ ( (i) + 3 ) % 4 ], w,	\
+					    ( x86_v4si ) { 1, 2, 3, 4 } );\
+		msg[ ( (i) + 1 ) % 4 ] =				\
+			__builtin_ia32_sha256msg2 ( msg[ ( (i) + 1 ) % 4 ],\
+						    w );		\
+	}								\
+	wk = __builtin_shuffle ( wk, ( x86_v4si ) { 2, 3, 0, 1 } );	\
+	abef = __builtin_ia32_sha256rnds2 ( abef, cdgh, wk );		\
+	if ( ( (i) >= 1 ) && ( (i) <= 12 ) ) {				\
+		msg[ ( (i) + 3 ) % 4 ] =				\
+			__builtin_ia32_sha256msg1 ( msg[ ( (i) + 3 ) % 4 ],\
+						    w );		\
+	}								\
+	} while ( 0 )
+
+/**
+ * Process SHA-256 data blocks using SHA extensions
+ *
+ * @v digest		Digest (in host-endian order)
+ * @v data		Data blocks
+ * @v count		Number of blocks
+ */
+static X86_SHA_TARGET void x86_sha256_blocks ( struct sha256_digest *digest,
+					       const void *data,
+					       size_t count ) {
+	const x86_v16qi swap = { 3, 2, 1, 0, 7, 6, 5, 4,
+				 11, 10, 9, 8, 15, 14, 13, 12 };
+	x86_v4si abef;
+	x86_v4si cdgh;
+	x86_v4si abef_save;
+	x86_v4si cdgh_save;
+	x86_v4si msg[4];
+	unsigned int i;
+
+	/* Load state, with a and c in the most significant dwords */
+	abef = ( x86_v4si ) { digest->h[5], digest->h[4],
+			      digest->h[1], digest->h[0] };
+	cdgh = ( x86_v4si ) { digest->h[7], digest->h[6],
+			      digest->h[3], digest->h[2] };
+
+	for ( ; count ; count--, data += sizeof ( union sha256_block ) ) {
+
+		/* Record state */
+		abef_save = abef;
+		cdgh_save = cdgh;
+
+		/* Load message, with w[0] in the least significant dword */
+		for ( i = 0 ; i < 4 ; i++ )
+			msg[i] = x86_sha_load ( ( data + ( 16 * i ) ), swap );
+
+		/* Main loop */
+		X86_SHA256_STEP4 ( 0 );
+		X86_SHA256_STEP4 ( 1 );
+		X86_SHA256_STEP4 ( 2 );
+		X86_SHA256_STEP4 ( 3 );
+		X86_SHA256_STEP4 ( 4 );
+		X86_SHA256_STEP4 ( 5 );
+		X86_SHA256_STEP4 ( 6 );
+		X86_SHA256_STEP4 ( 7 );
+		X86_SHA256_STEP4 ( 8 );
+		X86_SHA256_STEP4 ( 9 );
+		X86_SHA256_STEP4 ( 10 );
+		X86_SHA256_STEP4 ( 11 );
+		X86_SHA256_STEP4 ( 12 );
+		X86_SHA256_STEP4 ( 13 );
+		X86_SHA256_STEP4 ( 14 );
+		X86_SHA256_STEP4 ( 15 );
+
+		/* Add chunk to hash */
+		abef += abef_save;
+		cdgh += cdgh_save;
+	}
+
+	/* Store state */
+	digest->h[0] = abef[3];
+	digest->h[1] = abef[2];
+	digest->h[2] = cdgh[3];
+	digest->h[3] = cdgh[2];
+	digest->h[4] = abef[1];
+	digest->h[5] = abef[0];
+	digest->h[6] = cdgh[1];
+	digest->h[7] = cdgh[0];
+}
+
+/**
+ * Select accelerated SHA implementations
+ *
+ */
+static void x86_sha_init ( void ) {
+	struct x86_features features;
+	uint32_t required = ( CPUID_FEATURES_INTEL_ECX_SSSE3 |
+			      CPUID_FEATURES_INTEL_ECX_SSE4_1 );
+
+	/* Check for SHA extensions */
+	x86_features ( &features );
+	if ( ( ( features.intel.ecx & required ) != required ) ||
+	     ! ( features.ext.ebx & CPUID_EXT_FEATURES_EBX_SHA ) ) {
+		DBGC ( &features, "SHA extensions not supported\n" );
+		return;
+	}
+
+	/* Use SHA extensions */
+	DBGC ( &features, "SHA using SHA extensions\n" );
+	sha1_blocks = x86_sha1_blocks;
+	sha256_blocks = x86_sha256_blocks;
+}
+
+/** Accelerated SHA initialisation function */
+struct init_fn x86_sha_init_fn __init_fn ( INIT_NORMAL ) = {
+	.initialise = x86_sha_init,
+};
@@ -19,10 +19,20 @@ struct x86_feature_registers {
 	uint32_t edx;
 };
 
+/** An x86 CPU structured extended feature register set */
+struct x86_extended_feature_registers {
+	/** Features returned via %ebx */
+	uint32_t ebx;
+	/** Features returned via %ecx */
+	uint32_t ecx;
+};
+
 /** x86 CPU features */
 struct x86_features {
 	/** Intel-defined features (%eax=0x00000001) */
 	struct x86_feature_registers intel;
+	/** Structured extended features (%eax=0x00000007, %ecx=0) */
+	struct x86_extended_feature_registers ext;
 	/** AMD-defined features (%eax=0x80000001) */
 	struct x86_feature_registers amd;
 };
@@ -36,6 +46,24 @@ struct x86_features {
 /** Get standard features */
 #define CPUID_FEATURES 0x00000001UL
 
+/** Carry-less multiplication instruction is supported */
+#define CPUID_FEATURES_INTEL_ECX_PCLMUL 0x00000002UL
+
+/** Supplemental SSE3 instructions are supported */
+#define CPUID_FEATURES_INTEL_ECX_SSSE3 0x00000200UL
+
+/** SSE4.1 instructions are supported */
+#define CPUID_FEATURES_INTEL_ECX_SSE4_1 0x00080000UL
+
+/** AES instructions are supported */
+#define CPUID_FEATURES_INTEL_ECX_AES 0x02000000UL
+
+/** Get structured extended features */
+#define CPUID_EXT_FEATURES 0x00000007UL
+
+/** SHA extensions are supported */
+#define CPUID_EXT_FEATURES_EBX_SHA 0x20000000UL
+
 /** Get largest extended function */
 #define CPUID_AMD_MAX_FN 0x80000000UL
 
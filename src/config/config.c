@@ -137,6 +137,9 @@ REQUIRE_OBJECT ( slam );
 #ifdef DOWNLOAD_PROTO_BITTORRENT
 REQUIRE_OBJECT ( bittorrent );
 #endif
+#ifdef DOWNLOAD_DECOMPRESS
+REQUIRE_OBJECT ( decompress );
+#endif
 
 /*
  * Drag in all requested SAN boot protocols
@@ -244,6 +247,9 @@ REQUIRE_OBJECT ( pxe_cmd );
 #ifdef LOTEST_CMD
 REQUIRE_OBJECT ( lotest_cmd );
 #endif
+#ifdef BENCHMARK_CMD
+REQUIRE_OBJECT ( benchmark_cmd );
+#endif
 #ifdef VLAN_CMD
 REQUIRE_OBJECT ( vlan_cmd );
 #endif
@@ -259,6 +265,9 @@ REQUIRE_OBJECT ( sync_cmd );
 #ifdef NSLOOKUP_CMD
 REQUIRE_OBJECT ( nslookup_cmd );
 #endif
+#ifdef PROCESS_CMD
+REQUIRE_OBJECT ( process_cmd );
+#endif
 
 /*
  * Drag in miscellaneous objects
@@ -277,6 +286,20 @@ REQUIRE_OBJECT ( gdbidt );
 REQUIRE_OBJECT ( gdbudp );
 REQUIRE_OBJECT ( gdbstub_cmd );
 #endif
+/* CPU-accelerated crypto uses SSE registers, which 32-bit builds
+ * cannot assume the firmware has enabled for us.
+ */
+#ifdef __x86_64__
+#ifdef CRYPTO_ACCEL_SHA
+REQUIRE_OBJECT ( x86_sha );
+#endif
+#ifdef CRYPTO_ACCEL_AES
+REQUIRE_OBJECT ( x86_aes );
+#endif
+#ifdef CRYPTO_ACCEL_CRC32
+REQUIRE_OBJECT ( x86_crc32 );
+#endif
+#endif
 
 /*
  * Drag in objects that are always required, but not dragged in via
@@ -23,4 +23,10 @@
 #define	IMAGE_EFI		/* EFI image support */
 #define	IMAGE_SCRIPT		/* iPXE script image support */
 
+#define	CRYPTO_ACCEL_SHA	/* CPU-accelerated SHA-1 and SHA-256 */
+#define	CRYPTO_ACCEL_AES	/* CPU-accelerated AES */
+#define	CRYPTO_ACCEL_CRC32	/* CPU-accelerated CRC32 */
+
+#define	DOWNLOAD_DECOMPRESS	/* gzip/zlib decompression of downloads */
+
 #endif /* CONFIG_DEFAULTS_EFI_H */
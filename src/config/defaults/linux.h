@@ -21,4 +21,12 @@
 
 #define IMAGE_SCRIPT
 
+#define CRYPTO_ACCEL_SHA
+#define CRYPTO_ACCEL_AES
+#define CRYPTO_ACCEL_CRC32
+
+#define DOWNLOAD_DECOMPRESS
+
+#define BENCHMARK_CMD
+
 #endif /* CONFIG_DEFAULTS_LINUX_H */
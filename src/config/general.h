@@ -126,10 +126,12 @@ FILE_LICENCE ( GPL2_OR_LATER );
 //#define TIME_CMD		/* Time commands */
 //#define DIGEST_CMD		/* Image crypto digest commands */
 //#define LOTEST_CMD		/* Loopback testing commands */
+//#define BENCHMARK_CMD		/* Download benchmarking commands */
 //#define VLAN_CMD		/* VLAN commands */
 //#define PXE_CMD		/* PXE commands */
 //#define REBOOT_CMD		/* Reboot command */
 //#define IMAGE_TRUST_CMD	/* Image trust management commands */
+//#define PROCESS_CMD		/* Process management commands */
 
 /*
  * ROM-specific options
@@ -151,6 +153,12 @@ FILE_LICENCE ( GPL2_OR_LATER );
  */
 
 #define	NETDEV_DISCARD_RATE 0	/* Drop every N packets (0=>no drop) */
+#define	NETDEV_RX_BUDGET 16	/* Default max packets processed per
+				 * device per network poll */
+#define	NETDEV_RX_DESC 64	/* Receive ring size, for drivers with
+				 * configurable rings */
+#define	NETDEV_TX_DESC 64	/* Transmit ring size, for drivers with
+				 * configurable rings */
 #undef	BUILD_SERIAL		/* Include an automatic build serial
 				 * number.  Add "bs" to the list of
 				 * make targets.  For example:
@@ -0,0 +1,358 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <ipxe/umalloc.h>
+#include <ipxe/blockcache.h>
+
+/** @file
+ *
+ * Block device cache
+ *
+ * Bootloaders and operating system loaders booting from a SAN device
+ * tend to read the same sectors (boot sectors, partition tables,
+ * filesystem metadata) many times over.  The block cache holds
+ * recently read blocks in memory so that such repeated reads need
+ * not go to the network.
+ *
+ * The cache is organised as lines of BLOCK_CACHE_LINE_BLOCKS
+ * consecutive blocks, located via a hash table and evicted in
+ * least-recently-used order.  Writes are passed through to the
+ * underlying device by the caller and update any cached copy.
+ *
+ */
+
+/** Minimum useful block cache size */
+#define BLOCK_CACHE_MIN_LEN ( 256 * 1024 )
+
+/**
+ * Calculate block cache line length
+ *
+ * @v cache		Block cache
+ * @ret len		Line length
+ */
+static inline size_t block_cache_line_len ( struct block_cache *cache ) {
+	return ( cache->blksize * BLOCK_CACHE_LINE_BLOCKS );
+}
+
+/**
+ * Calculate offset of block cache line data
+ *
+ * @v cache		Block cache
+ * @v line		Block cache line
+ * @v index		Block index within line
+ * @ret offset		Offset within cache data
+ */
+static inline size_t block_cache_offset ( struct block_cache *cache,
+					  struct block_cache_line *line,
+					  unsigned int index ) {
+	return ( ( ( line - cache->lines ) * block_cache_line_len ( cache ) )
+		 + ( index * cache->blksize ) );
+}
+
+/**
+ * Find block cache hash bucket
+ *
+ * @v cache		Block cache
+ * @v lba		Logical block address of first block in line
+ * @ret bucket		Hash bucket
+ */
+static inline struct list_head *
+block_cache_bucket ( struct block_cache *cache, uint64_t lba ) {
+	return &cache->buckets[ ( lba / BLOCK_CACHE_LINE_BLOCKS ) %
+				BLOCK_CACHE_BUCKETS ];
+}
+
+/**
+ * Initialise block cache
+ *
+ * @v cache		Block cache
+ * @v blksize		Block size
+ * @v max_len		Maximum cache size
+ * @ret rc		Return status code
+ *
+ * The cache will be as large as can be allocated, up to @c max_len.
+ * If the cache cannot be allocated, it is left empty; all operations
+ * remain valid but will never produce a hit.
+ */
+int block_cache_init ( struct block_cache *cache, size_t blksize,
+		       size_t max_len ) {
+	struct block_cache_line *line;
+	size_t line_len;
+	size_t len;
+	unsigned int i;
+
+	/* Initialise empty cache */
+	memset ( cache, 0, sizeof ( *cache ) );
+	cache->blksize = blksize;
+	INIT_LIST_HEAD ( &cache->lru );
+	for ( i = 0 ; i < BLOCK_CACHE_BUCKETS ; i++ )
+		INIT_LIST_HEAD ( &cache->buckets[i] );
+	line_len = block_cache_line_len ( cache );
+	if ( ! line_len )
+		return -EINVAL;
+
+	/* Allocate as large a data area as possible, up to the
+	 * maximum size.
+	 */
+	for ( len = max_len ; len >= BLOCK_CACHE_MIN_LEN ; len /= 2 ) {
+		cache->num_lines = ( len / line_len );
+		cache->data = umalloc ( cache->num_lines * line_len );
+		if ( cache->data )
+			break;
+	}
+	if ( ! cache->data ) {
+		cache->num_lines = 0;
+		return -ENOMEM;
+	}
+
+	/* Allocate lines */
+	cache->lines = zalloc ( cache->num_lines * sizeof ( cache->lines[0] ));
+	if ( ! cache->lines ) {
+		ufree ( cache->data );
+		cache->data = UNULL;
+		cache->num_lines = 0;
+		return -ENOMEM;
+	}
+	for ( i = 0 ; i < cache->num_lines ; i++ ) {
+		line = &cache->lines[i];
+		INIT_LIST_HEAD ( &line->hash );
+		list_add_tail ( &line->lru, &cache->lru );
+	}
+	cache->stats.size = ( cache->num_lines * line_len );
+
+	DBGC ( cache, "BLKCACHE %p using %zdkB for %zd-byte blocks\n",
+	       cache, ( cache->stats.size / 1024 ), blksize );
+	return 0;
+}
+
+/**
+ * Free block cache
+ *
+ * @v cache		Block cache
+ */
+void block_cache_fini ( struct block_cache *cache ) {
+
+	DBGC ( cache, "BLKCACHE %p %ld hits, %ld misses, %ld writes, "
+	       "%ld evictions\n", cache, cache->stats.hits,
+	       cache->stats.misses, cache->stats.writes,
+	       cache->stats.evictions );
+	ufree ( cache->data );
+	free ( cache->lines );
+	cache->data = UNULL;
+	cache->lines = NULL;
+	cache->num_lines = 0;
+}
+
+/**
+ * Find block cache line
+ *
+ * @v cache		Block cache
+ * @v lba		Logical block address
+ * @ret line		Block cache line, or NULL
+ */
+static struct block_cache_line * block_cache_find ( struct block_cache *cache,
+						    uint64_t lba ) {
+	struct block_cache_line *line;
+
+	if ( ! cache->num_lines )
+		return NULL;
+	lba -= ( lba % BLOCK_CACHE_LINE_BLOCKS );
+	list_for_each_entry ( line, block_cache_bucket ( cache, lba ), hash ) {
+		if ( line->lba == lba )
+			return line;
+	}
+	return NULL;
+}
+
+/**
+ * Mark block cache line as most recently used
+ *
+ * @v cache		Block cache
+ * @v line		Block cache line
+ */
+static void block_cache_touch ( struct block_cache *cache,
+				struct block_cache_line *line ) {
+	list_del ( &line->lru );
+	list_add ( &line->lru, &cache->lru );
+}
+
+/**
+ * Find or allocate block cache line
+ *
+ * @v cache		Block cache
+ * @v lba		Logical block address
+ * @ret line		Block cache line, or NULL
+ */
+static struct block_cache_line *
+block_cache_line ( struct block_cache *cache, uint64_t lba ) {
+	struct block_cache_line *line;
+
+	/* Use existing line, if present */
+	line = block_cache_find ( cache, lba );
+	if ( line || ( ! cache->num_lines ) )
+		return line;
+
+	/* Reuse least recently used line */
+	line = list_entry ( cache->lru.prev, struct block_cache_line, lru );
+	if ( line->valid )
+		cache->stats.evictions++;
+	list_del ( &line->hash );
+	line->lba = ( lba - ( lba % BLOCK_CACHE_LINE_BLOCKS ) );
+	line->valid = 0;
+	list_add ( &line->hash, block_cache_bucket ( cache, line->lba ) );
+	return line;
+}
+
+/**
+ * Read leading blocks from block cache
+ *
+ * @v cache		Block cache
+ * @v lba		Starting logical block address
+ * @v count		Number of blocks
+ * @v buffer		Data buffer
+ * @ret copied		Number of leading blocks copied from cache
+ */
+unsigned int block_cache_read ( struct block_cache *cache, uint64_t lba,
+				unsigned int count, userptr_t buffer ) {
+	struct block_cache_line *line;
+	unsigned int copied = 0;
+	unsigned int index;
+	unsigned int run;
+
+	while ( copied < count ) {
+
+		/* Find line containing this block */
+		line = block_cache_find ( cache, ( lba + copied ) );
+		if ( ! line )
+			break;
+		index = ( ( lba + copied ) % BLOCK_CACHE_LINE_BLOCKS );
+
+		/* Copy run of valid blocks within this line */
+		run = 0;
+		while ( ( ( index + run ) < BLOCK_CACHE_LINE_BLOCKS ) &&
+			( ( copied + run ) < count ) &&
+			( line->valid & ( 1 << ( index + run ) ) ) ) {
+			run++;
+		}
+		if ( ! run )
+			break;
+		memcpy_user ( buffer, ( copied * cache->blksize ), cache->data,
+			      block_cache_offset ( cache, line, index ),
+			      ( run * cache->blksize ) );
+		block_cache_touch ( cache, line );
+		copied += run;
+	}
+
+	cache->stats.hits += copied;
+	return copied;
+}
+
+/**
+ * Count leading blocks missing from block cache
+ *
+ * @v cache		Block cache
+ * @v lba		Starting logical block address
+ * @v count		Number of blocks
+ * @ret missing		Number of leading blocks not present in cache
+ */
+unsigned int block_cache_missing ( struct block_cache *cache, uint64_t lba,
+				   unsigned int count ) {
+	struct block_cache_line *line;
+	unsigned int missing;
+
+	for ( missing = 0 ; missing < count ; missing++ ) {
+		line = block_cache_find ( cache, ( lba + missing ) );
+		if ( line && ( line->valid &
+			       ( 1 << ( ( lba + missing ) %
+					BLOCK_CACHE_LINE_BLOCKS ) ) ) )
+			break;
+	}
+
+	cache->stats.misses += missing;
+	return missing;
+}
+
+/**
+ * Insert blocks into block cache
+ *
+ * @v cache		Block cache
+ * @v lba		Starting logical block address
+ * @v count		Number of blocks
+ * @v buffer		Data buffer
+ */
+void block_cache_insert ( struct block_cache *cache, uint64_t lba,
+			  unsigned int count, userptr_t buffer ) {
+	struct block_cache_line *line;
+	unsigned int index;
+	unsigned int i;
+
+	for ( i = 0 ; i < count ; i++ ) {
+		line = block_cache_line ( cache, ( lba + i ) );
+		if ( ! line )
+			return;
+		index = ( ( lba + i ) % BLOCK_CACHE_LINE_BLOCKS );
+		memcpy_user ( cache->data,
+			      block_cache_offset ( cache, line, index ),
+			      buffer, ( i * cache->blksize ), cache->blksize );
+		line->valid |= ( 1 << index );
+		block_cache_touch ( cache, line );
+	}
+}
+
+/**
+ * Record blocks written to underlying device
+ *
+ * @v cache		Block cache
+ * @v lba		Starting logical block address
+ * @v count		Number of blocks
+ * @v buffer		Data buffer
+ *
+ * The caller must already have written the data to the underlying
+ * device (i.e. the cache is write-through).
+ */
+void block_cache_write ( struct block_cache *cache, uint64_t lba,
+			 unsigned int count, userptr_t buffer ) {
+
+	cache->stats.writes += count;
+	block_cache_insert ( cache, lba, count, buffer );
+}
+
+/**
+ * Invalidate blocks in block cache
+ *
+ * @v cache		Block cache
+ * @v lba		Starting logical block address
+ * @v count		Number of blocks
+ */
+void block_cache_invalidate ( struct block_cache *cache, uint64_t lba,
+			      unsigned int count ) {
+	struct block_cache_line *line;
+	unsigned int i;
+
+	for ( i = 0 ; i < count ; i++ ) {
+		line = block_cache_find ( cache, ( lba + i ) );
+		if ( line ) {
+			line->valid &= ~( 1 << ( ( lba + i ) %
+						 BLOCK_CACHE_LINE_BLOCKS ) );
+		}
+	}
+}
@@ -0,0 +1,535 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+/** @file
+ *
+ * Streaming decompression
+ *
+ * The decompressor is a data transfer filter that sits between a
+ * data source (e.g. an HTTP or TFTP connection) and its consumer
+ * (e.g. an image downloader), decoding gzip or zlib data on the fly.
+ * Only the 32kB DEFLATE sliding window is held in memory; the
+ * decompressed data is passed to the consumer as it is produced.
+ *
+ * The compressed format is identified from the first bytes of the
+ * stream.  Data that turns out not to be compressed is passed through
+ * unmodified, so that a misconfigured server (or a file that has
+ * already been decompressed by an earlier filter) does no harm.
+ *
+ * Decompression is inherently sequential.  Data delivered ahead of
+ * the current position is held until the gap is filled, up to a
+ * fixed limit.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <ipxe/list.h>
+#include <ipxe/iobuf.h>
+#include <ipxe/xfer.h>
+#include <ipxe/interface.h>
+#include <ipxe/refcnt.h>
+#include <ipxe/inflate.h>
+#include <ipxe/decompress.h>
+
+/* Disambiguate the various error causes */
+#define EPIPE_TRUNCATED __einfo_error ( EINFO_EPIPE_TRUNCATED )
+#define EINFO_EPIPE_TRUNCATED \
+	__einfo_uniqify ( EINFO_EPIPE, 0x01, "Compressed data truncated" )
+
+/** Maximum length of data held awaiting earlier data */
+#define DECOMPRESS_MAX_HELD ( 256 * 1024 )
+
+/** Number of bytes required to identify the compressed format */
+#define DECOMPRESS_MAGIC_LEN 2
+
+/** Decompressor modes */
+enum decompress_mode {
+	/** Identifying compressed format */
+	DECOMPRESS_IDENTIFY = 0,
+	/** Decompressing */
+	DECOMPRESS_INFLATE,
+	/** Passing through uncompressed data */
+	DECOMPRESS_PASSTHROUGH,
+};
+
+/** A streaming decompressor */
+struct decompressor {
+	/** Reference count */
+	struct refcnt refcnt;
+	/** Decompressed data interface */
+	struct interface plain;
+	/** Compressed data interface */
+	struct interface compressed;
+
+	/** Current mode */
+	enum decompress_mode mode;
+	/** DEFLATE decompressor */
+	struct inflate inflate;
+
+	/** Current position within compressed data stream */
+	size_t pos;
+	/** Length of compressed data consumed */
+	size_t consumed;
+	/** Largest position indicated by a seek */
+	size_t hint;
+	/** Data held awaiting earlier data */
+	struct list_head held;
+	/** Length of data held awaiting earlier data */
+	size_t held_len;
+	/** Initial bytes used to identify the compressed format */
+	uint8_t magic[DECOMPRESS_MAGIC_LEN];
+};
+
+/** A block of compressed data held awaiting earlier data */
+struct decompress_hold {
+	/** List of held blocks */
+	struct list_head list;
+	/** Position within compressed data stream */
+	size_t pos;
+	/** Data */
+	struct io_buffer *iobuf;
+};
+
+/**
+ * Free decompressor
+ *
+ * @v refcnt		Reference counter
+ */
+static void decompress_free ( struct refcnt *refcnt ) {
+	struct decompressor *decompressor =
+		container_of ( refcnt, struct decompressor, refcnt );
+
+	inflate_free ( &decompressor->inflate );
+	free ( decompressor );
+}
+
+/**
+ * Discard all held data
+ *
+ * @v decompressor	Decompressor
+ */
+static void decompress_discard ( struct decompressor *decompressor ) {
+	struct decompress_hold *hold;
+	struct decompress_hold *tmp;
+
+	list_for_each_entry_safe ( hold, tmp, &decompressor->held, list ) {
+		list_del ( &hold->list );
+		free_iob ( hold->iobuf );
+		free ( hold );
+	}
+	decompressor->held_len = 0;
+}
+
+/**
+ * Terminate decompression
+ *
+ * @v decompressor	Decompressor
+ * @v rc		Reason for termination
+ */
+static void decompress_finished ( struct decompressor *decompressor,
+				  int rc ) {
+
+	/* Discard any held data */
+	decompress_discard ( decompressor );
+
+	/* Shut down interfaces */
+	intf_shutdown ( &decompressor->compressed, rc );
+	intf_shutdown ( &decompressor->plain, rc );
+}
+
+/**
+ * Deliver decompressed data
+ *
+ * @v inflate		DEFLATE decompressor
+ * @v data		Decompressed data
+ * @v len		Length of decompressed data
+ * @ret rc		Return status code
+ */
+static int decompress_inflate_deliver ( struct inflate *inflate,
+					const void *data, size_t len ) {
+	struct decompressor *decompressor =
+		container_of ( inflate, struct decompressor, inflate );
+
+	return xfer_deliver_raw ( &decompressor->plain, data, len );
+}
+
+/**
+ * Pass through uncompressed data
+ *
+ * @v decompressor	Decompressor
+ * @v data		Data
+ * @v len		Length of data
+ * @v pos		Position within data stream
+ * @ret rc		Return status code
+ */
+static int decompress_pass ( struct decompressor *decompressor,
+			     const void *data, size_t len, size_t pos ) {
+	struct xfer_metadata meta = {
+		.flags = XFER_FL_ABS_OFFSET,
+		.offset = pos,
+	};
+
+	return xfer_deliver_raw_meta ( &decompressor->plain, data, len,
+				       &meta );
+}
+
+/**
+ * Identify compressed format
+ *
+ * @v decompressor	Decompressor
+ * @ret rc		Return status code
+ */
+static int decompress_identify ( struct decompressor *decompressor ) {
+	const uint8_t *magic = decompressor->magic;
+	enum inflate_format format;
+	int rc;
+
+	/* Identify format */
+	if ( ( magic[0] == 0x1f ) && ( magic[1] == 0x8b ) ) {
+		format = INFLATE_GZIP;
+	} else if ( ( ( magic[0] & 0x0f ) == 8 ) && ( ( magic[0] >> 4 ) <= 7 )
+		    && ( ( ( ( magic[0] << 8 ) | magic[1] ) % 31 ) == 0 ) ) {
+		format = INFLATE_ZLIB;
+	} else {
+		/* Not compressed: pass through unmodified, including
+		 * any size indication received so far.
+		 */
+		DBGC ( decompressor, "DECOMPRESS %p data is not compressed\n",
+		       decompressor );
+		decompressor->mode = DECOMPRESS_PASSTHROUGH;
+		if ( decompressor->hint ) {
+			xfer_seek ( &decompressor->plain, decompressor->hint );
+			xfer_seek ( &decompressor->plain, 0 );
+		}
+		return decompress_pass ( decompressor, magic,
+					 sizeof ( decompressor->magic ), 0 );
+	}
+
+	/* Start decompressing */
+	DBGC ( decompressor, "DECOMPRESS %p decompressing %s data\n",
+	       decompressor, ( ( format == INFLATE_GZIP ) ? "gzip" : "zlib" ));
+	if ( ( rc = inflate_init ( &decompressor->inflate, format,
+				   decompress_inflate_deliver ) ) != 0 )
+		return rc;
+	decompressor->mode = DECOMPRESS_INFLATE;
+	return inflate_data ( &decompressor->inflate, magic,
+			      sizeof ( decompressor->magic ) );
+}
+
+/**
+ * Process in-order compressed data
+ *
+ * @v decompressor	Decompressor
+ * @v data		Data
+ * @v len		Length of data
+ * @ret rc		Return status code
+ */
+static int decompress_process ( struct decompressor *decompressor,
+				const void *data, size_t len ) {
+	size_t pos = decompressor->consumed;
+	size_t magic_len;
+	int rc;
+
+	decompressor->consumed += len;
+
+	/* Accumulate initial bytes to identify format */
+	if ( decompressor->mode == DECOMPRESS_IDENTIFY ) {
+		magic_len = ( sizeof ( decompressor->magic ) - pos );
+		if ( magic_len > len )
+			magic_len = len;
+		memcpy ( &decompressor->magic[pos], data, magic_len );
+		data += magic_len;
+		len -= magic_len;
+		pos += magic_len;
+		if ( pos < sizeof ( decompressor->magic ) )
+			return 0;
+		if ( ( rc = decompress_identify ( decompressor ) ) != 0 )
+			return rc;
+	}
+
+	/* Decompress or pass through remaining data */
+	if ( ! len )
+		return 0;
+	if ( decompressor->mode == DECOMPRESS_INFLATE ) {
+		return inflate_data ( &decompressor->inflate, data, len );
+	} else {
+		return decompress_pass ( decompressor, data, len, pos );
+	}
+}
+
+/**
+ * Process compressed data at a given position
+ *
+ * @v decompressor	Decompressor
+ * @v iobuf		I/O buffer
+ * @v pos		Position within compressed data stream
+ * @ret rc		Return status code
+ */
+static int decompress_rx ( struct decompressor *decompressor,
+			   struct io_buffer *iobuf, size_t pos ) {
+	struct decompress_hold *hold;
+	size_t len = iob_len ( iobuf );
+	int rc;
+
+	/* Discard any data we have already seen */
+	if ( ( pos + len ) <= decompressor->consumed ) {
+		free_iob ( iobuf );
+		return 0;
+	}
+
+	/* Hold any data that arrives ahead of the current position */
+	if ( pos > decompressor->consumed ) {
+		if ( ( decompressor->held_len + len ) > DECOMPRESS_MAX_HELD ) {
+			DBGC ( decompressor, "DECOMPRESS %p cannot hold "
+			       "[%zd,%zd) awaiting %zd\n", decompressor,
+			       pos, ( pos + len ), decompressor->consumed );
+			free_iob ( iobuf );
+			return -ENOBUFS;
+		}
+		hold = malloc ( sizeof ( *hold ) );
+		if ( ! hold ) {
+			free_iob ( iobuf );
+			return -ENOMEM;
+		}
+		hold->pos = pos;
+		hold->iobuf = iobuf;
+		list_add_tail ( &hold->list, &decompressor->held );
+		decompressor->held_len += len;
+		return 0;
+	}
+
+	/* Process new portion of data */
+	iob_pull ( iobuf, ( decompressor->consumed - pos ) );
+	rc = decompress_process ( decompressor, iobuf->data,
+				  iob_len ( iobuf ) );
+	free_iob ( iobuf );
+	return rc;
+}
+
+/**
+ * Process any held data that is now in order
+ *
+ * @v decompressor	Decompressor
+ * @ret rc		Return status code
+ */
+static int decompress_rx_held ( struct decompressor *decompressor ) {
+	struct decompress_hold *hold;
+	struct io_buffer *iobuf;
+	size_t pos;
+	int rc;
+
+ restart:
+	list_for_each_entry ( hold, &decompressor->held, list ) {
+		if ( hold->pos > decompressor->consumed )
+			continue;
+		list_del ( &hold->list );
+		iobuf = hold->iobuf;
+		pos = hold->pos;
+		decompressor->held_len -= iob_len ( iobuf );
+		free ( hold );
+		if ( ( rc = decompress_rx ( decompressor, iobuf, pos ) ) != 0 )
+			return rc;
+		goto restart;
+	}
+	return 0;
+}
+
+/**
+ * Receive compressed data
+ *
+ * @v decompressor	Decompressor
+ * @v iobuf		I/O buffer
+ * @v meta		Data transfer metadata
+ * @ret rc		Return status code
+ */
+static int decompress_deliver ( struct decompressor *decompressor,
+				struct io_buffer *iobuf,
+				struct xfer_metadata *meta ) {
+	struct xfer_metadata pass_meta;
+	size_t len = iob_len ( iobuf );
+	size_t pos;
+	int rc;
+
+	/* Calculate position within compressed data stream */
+	if ( meta->flags & XFER_FL_ABS_OFFSET )
+		decompressor->pos = 0;
+	decompressor->pos += meta->offset;
+	pos = decompressor->pos;
+	decompressor->pos += len;
+
+	/* Once all preceding data has been passed through, pass
+	 * through subsequent data (including seeks) unmodified.
+	 */
+	if ( ( decompressor->mode == DECOMPRESS_PASSTHROUGH ) &&
+	     list_empty ( &decompressor->held ) ) {
+		memcpy ( &pass_meta, meta, sizeof ( pass_meta ) );
+		pass_meta.flags |= XFER_FL_ABS_OFFSET;
+		pass_meta.offset = pos;
+		rc = xfer_deliver ( &decompressor->plain, iob_disown ( iobuf ),
+				    &pass_meta );
+		goto done;
+	}
+
+	/* A seek conveys only the expected length of the compressed
+	 * data, which is of no interest to the recipient unless the
+	 * data turns out not to be compressed.
+	 */
+	if ( ! len ) {
+		if ( decompressor->hint < pos )
+			decompressor->hint = pos;
+		free_iob ( iobuf );
+		return 0;
+	}
+
+	/* Process data and anything held that is now in order */
+	if ( ( rc = decompress_rx ( decompressor, iob_disown ( iobuf ),
+				    pos ) ) != 0 )
+		goto done;
+	if ( ( rc = decompress_rx_held ( decompressor ) ) != 0 )
+		goto done;
+
+ done:
+	if ( rc != 0 )
+		decompress_finished ( decompressor, rc );
+	return rc;
+}
+
+/**
+ * Check whether data must be delivered in order
+ *
+ * @v decompressor	Decompressor
+ * @ret sequential	Data must be delivered in order
+ */
+static int decompress_sequential ( struct decompressor *decompressor
+				   __unused ) {
+	return 1;
+}
+
+/**
+ * Check whether received data will be decompressed
+ *
+ * @v decompressor	Decompressor
+ * @ret decompressing	Received data will be decompressed
+ */
+static int decompress_decompressing ( struct decompressor *decompressor
+				      __unused ) {
+	return 1;
+}
+
+/**
+ * Handle end of compressed data
+ *
+ * @v decompressor	Decompressor
+ * @v rc		Reason for close
+ */
+static void decompress_close ( struct decompressor *decompressor, int rc ) {
+
+	/* Check that the compressed data is complete */
+	if ( rc == 0 ) {
+		if ( ! list_empty ( &decompressor->held ) ) {
+			DBGC ( decompressor, "DECOMPRESS %p missing data at "
+			       "%zd\n", decompressor, decompressor->consumed );
+			rc = -EPIPE_TRUNCATED;
+		} else if ( ( decompressor->mode == DECOMPRESS_IDENTIFY ) &&
+			    decompressor->consumed ) {
+			/* Too short to be compressed */
+			rc = decompress_pass ( decompressor,
+					       decompressor->magic,
+					       decompressor->consumed, 0 );
+		} else if ( ( decompressor->mode == DECOMPRESS_INFLATE ) &&
+			    ! inflate_finished ( &decompressor->inflate ) ) {
+			DBGC ( decompressor, "DECOMPRESS %p truncated after "
+			       "%zd bytes\n", decompressor,
+			       decompressor->consumed );
+			rc = -EPIPE_TRUNCATED;
+		}
+	}
+	if ( decompressor->inflate.trailing ) {
+		DBGC ( decompressor, "DECOMPRESS %p ignored %zd trailing "
+		       "bytes\n", decompressor,
+		       decompressor->inflate.trailing );
+	}
+
+	decompress_finished ( decompressor, rc );
+}
+
+/** Decompressor compressed data interface operations */
+static struct interface_operation decompress_compressed_op[] = {
+	INTF_OP ( xfer_deliver, struct decompressor *, decompress_deliver ),
+	INTF_OP ( xfer_sequential, struct decompressor *,
+		  decompress_sequential ),
+	INTF_OP ( xfer_decompressing, struct decompressor *,
+		  decompress_decompressing ),
+	INTF_OP ( intf_close, struct decompressor *, decompress_close ),
+};
+
+/** Decompressor compressed data interface descriptor */
+static struct interface_descriptor decompress_compressed_desc =
+	INTF_DESC_PASSTHRU ( struct decompressor, compressed,
+			     decompress_compressed_op, plain );
+
+/** Decompressor decompressed data interface operations */
+static struct interface_operation decompress_plain_op[] = {
+	INTF_OP ( intf_close, struct decompressor *, decompress_finished ),
+};
+
+/** Decompressor decompressed data interface descriptor */
+static struct interface_descriptor decompress_plain_desc =
+	INTF_DESC_PASSTHRU ( struct decompressor, plain,
+			     decompress_plain_op, compressed );
+
+/**
+ * Add gzip decoder
+ *
+ * @v xfer		Data transfer interface to receive decoded data
+ * @v next		Interface to receive encoded data
+ * @ret rc		Return status code
+ *
+ * Both gzip and zlib data are decoded.  Data that is not actually
+ * compressed is passed through unmodified.
+ */
+static int add_gzip ( struct interface *xfer, struct interface **next ) {
+	struct decompressor *decompressor;
+
+	/* Allocate and initialise structure */
+	decompressor = zalloc ( sizeof ( *decompressor ) );
+	if ( ! decompressor )
+		return -ENOMEM;
+	ref_init ( &decompressor->refcnt, decompress_free );
+	intf_init ( &decompressor->plain, &decompress_plain_desc,
+		    &decompressor->refcnt );
+	intf_init ( &decompressor->compressed, &decompress_compressed_desc,
+		    &decompressor->refcnt );
+	INIT_LIST_HEAD ( &decompressor->held );
+	DBGC ( decompressor, "DECOMPRESS %p created\n", decompressor );
+
+	/* Attach to parent interface, mortalise self, and return */
+	intf_plug_plug ( &decompressor->plain, xfer );
+	*next = &decompressor->compressed;
+	ref_put ( &decompressor->refcnt );
+	return 0;
+}
+
+/** gzip content encoding */
+struct content_encoding gzip_content_encoding __content_encoding = {
+	.name = "gzip",
+	.add = add_gzip,
+};
@@ -52,6 +52,27 @@ static void downloader_free ( struct refcnt *refcnt ) {
 	free ( downloader );
 }
 
+/**
+ * Release unused download buffer space
+ *
+ * @v downloader	Downloader
+ */
+static void downloader_trim ( struct downloader *downloader ) {
+	struct image *image = downloader->image;
+	userptr_t new_buffer;
+
+	/* Do nothing unless the buffer was grown beyond the image */
+	if ( downloader->capacity <= image->len )
+		return;
+
+	/* Shrink buffer (failure is harmless) */
+	new_buffer = urealloc ( image->data, image->len );
+	if ( new_buffer || ( ! image->len ) ) {
+		image->data = new_buffer;
+		downloader->capacity = image->len;
+	}
+}
+
 /**
  * Terminate download
  *
@@ -60,6 +81,9 @@ static void downloader_free ( struct refcnt *refcnt ) {
  */
 static void downloader_finished ( struct downloader *downloader, int rc ) {
 
+	/* Release any unused buffer space */
+	downloader_trim ( downloader );
+
 	/* Log download status */
 	if ( rc == 0 ) {
 		syslog ( LOG_NOTICE, "Downloaded \"%s\"\n",
@@ -84,22 +108,37 @@ static void downloader_finished ( struct downloader *downloader, int rc ) {
 static int downloader_ensure_size ( struct downloader *downloader,
 				    size_t len ) {
 	userptr_t new_buffer;
+	size_t capacity;
 
 	/* If buffer is already large enough, do nothing */
 	if ( len <= downloader->image->len )
 		return 0;
 
-	DBGC ( downloader, "Downloader %p extending to %zd bytes\n",
-	       downloader, len );
-
-	/* Extend buffer */
-	new_buffer = urealloc ( downloader->image->data, len );
-	if ( ! new_buffer ) {
-		DBGC ( downloader, "Downloader %p could not extend buffer to "
-		       "%zd bytes\n", downloader, len );
-		return -ENOSPC;
+	/* Extend buffer if necessary.  When the final size is not
+	 * known in advance (e.g. when data is being decompressed),
+	 * grow the buffer geometrically to avoid copying the data
+	 * collected so far for each new block received.
+	 */
+	if ( len > downloader->capacity ) {
+		capacity = ( 2 * downloader->capacity );
+		if ( capacity < len )
+			capacity = len;
+		DBGC ( downloader, "Downloader %p extending to %zd bytes\n",
+		       downloader, capacity );
+		new_buffer = urealloc ( downloader->image->data, capacity );
+		if ( ( ! new_buffer ) && ( capacity > len ) ) {
+			capacity = len;
+			new_buffer = urealloc ( downloader->image->data,
+						capacity );
+		}
+		if ( ! new_buffer ) {
+			DBGC ( downloader, "Downloader %p could not extend "
+			       "buffer to %zd bytes\n", downloader, len );
+			return -ENOSPC;
+		}
+		downloader->image->data = new_buffer;
+		downloader->capacity = capacity;
 	}
-	downloader->image->data = new_buffer;
 	downloader->image->len = len;
 
 	return 0;
@@ -211,6 +250,7 @@ static struct interface_descriptor downloader_job_desc =
  *
  * @v job		Job control interface
  * @v image		Image to fill with downloaded file
+ * @v filter		Filter to apply to downloaded data, or NULL
  * @v type		Location type to pass to xfer_open()
  * @v ...		Remaining arguments to pass to xfer_open()
  * @ret rc		Return status code
@@ -219,8 +259,11 @@ static struct interface_descriptor downloader_job_desc =
  * the specified image object.
  */
 int create_downloader ( struct interface *job, struct image *image,
+			int ( * filter ) ( struct interface *xfer,
+					   struct interface **next ),
 			int type, ... ) {
 	struct downloader *downloader;
+	struct interface *xfer;
 	va_list args;
 	int rc;
 
@@ -236,8 +279,13 @@ int create_downloader ( struct interface *job, struct image *image,
 	downloader->image = image_get ( image );
 	va_start ( args, type );
 
+	/* Apply filter, if applicable */
+	xfer = &downloader->xfer;
+	if ( filter && ( ( rc = filter ( xfer, &xfer ) ) != 0 ) )
+		goto err;
+
 	/* Instantiate child objects and attach to our interfaces */
-	if ( ( rc = xfer_vopen ( &downloader->xfer, type, args ) ) != 0 )
+	if ( ( rc = xfer_vopen ( xfer, type, args ) ) != 0 )
 		goto err;
 
 	/* Attach parent interface, mortalise self, and return */
@@ -0,0 +1,1271 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+/** @file
+ *
+ * DEFLATE decompression
+ *
+ * This is a streaming decompressor for DEFLATE data (RFC 1951),
+ * optionally wrapped in the zlib (RFC 1950) or gzip (RFC 1952)
+ * container formats.  Input may be supplied in arbitrarily sized
+ * pieces; the decompressor suspends whenever it runs out of input
+ * and resumes when more arrives.
+ *
+ * The only memory used beyond the decompressor structure itself is
+ * the 32kB sliding window.  Decompressed data is written into the
+ * window and handed to the consumer each time the window fills (and
+ * at the end of each block of input), so the consumer sees a
+ * continuous stream of output in window-sized pieces at most.
+ *
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <ipxe/crc32.h>
+#include <ipxe/inflate.h>
+
+/* Disambiguate the various error causes */
+#define EINVAL_HEADER __einfo_error ( EINFO_EINVAL_HEADER )
+#define EINFO_EINVAL_HEADER \
+	__einfo_uniqify ( EINFO_EINVAL, 0x01, "Invalid header" )
+#define EINVAL_BLOCK __einfo_error ( EINFO_EINVAL_BLOCK )
+#define EINFO_EINVAL_BLOCK \
+	__einfo_uniqify ( EINFO_EINVAL, 0x02, "Invalid block type" )
+#define EINVAL_STORED __einfo_error ( EINFO_EINVAL_STORED )
+#define EINFO_EINVAL_STORED \
+	__einfo_uniqify ( EINFO_EINVAL, 0x03, "Invalid stored block length" )
+#define EINVAL_CODE __einfo_error ( EINFO_EINVAL_CODE )
+#define EINFO_EINVAL_CODE \
+	__einfo_uniqify ( EINFO_EINVAL, 0x04, "Invalid Huffman code" )
+#define EINVAL_SYMBOL __einfo_error ( EINFO_EINVAL_SYMBOL )
+#define EINFO_EINVAL_SYMBOL \
+	__einfo_uniqify ( EINFO_EINVAL, 0x05, "Invalid symbol" )
+#define EINVAL_DISTANCE __einfo_error ( EINFO_EINVAL_DISTANCE )
+#define EINFO_EINVAL_DISTANCE \
+	__einfo_uniqify ( EINFO_EINVAL, 0x06, "Invalid distance" )
+#define EIO_CHECKSUM __einfo_error ( EINFO_EIO_CHECKSUM )
+#define EINFO_EIO_CHECKSUM \
+	__einfo_uniqify ( EINFO_EIO, 0x01, "Checksum mismatch" )
+#define EIO_LENGTH __einfo_error ( EINFO_EIO_LENGTH )
+#define EINFO_EIO_LENGTH \
+	__einfo_uniqify ( EINFO_EIO, 0x02, "Length mismatch" )
+#define ENOTSUP_HEADER __einfo_error ( EINFO_ENOTSUP_HEADER )
+#define EINFO_ENOTSUP_HEADER \
+	__einfo_uniqify ( EINFO_ENOTSUP, 0x01, "Unsupported header" )
+
+/** Decompressor states */
+enum inflate_state {
+	/** Reading zlib header */
+	INFLATE_ZLIB_HEADER = 0,
+	/** Reading gzip fixed header */
+	INFLATE_GZIP_HEADER,
+	/** Reading gzip optional header fields */
+	INFLATE_GZIP_OPTIONS,
+	/** Reading block header */
+	INFLATE_BLOCK_HEADER,
+	/** Reading stored block length */
+	INFLATE_STORED_LEN,
+	/** Copying stored block data */
+	INFLATE_STORED_DATA,
+	/** Reading dynamic block code counts */
+	INFLATE_DYNAMIC_COUNTS,
+	/** Reading dynamic block code length code lengths */
+	INFLATE_DYNAMIC_CLEN,
+	/** Reading dynamic block literal/length and distance lengths */
+	INFLATE_DYNAMIC_LENGTHS,
+	/** Decoding literal/length symbols */
+	INFLATE_LITLEN,
+	/** Decoding distance symbol */
+	INFLATE_DISTANCE,
+	/** Decoding distance extra bits */
+	INFLATE_DISTANCE_EXTRA,
+	/** Copying match */
+	INFLATE_COPY,
+	/** Reading trailer */
+	INFLATE_TRAILER,
+	/** Awaiting any further gzip member */
+	INFLATE_GZIP_MEMBER,
+	/** End of stream */
+	INFLATE_DONE,
+};
+
+/** Step requires more input data */
+#define INFLATE_STALL 1
+
+/** gzip header magic */
+#define INFLATE_GZIP_MAGIC 0x8b1f
+
+/** gzip "deflate" compression method */
+#define INFLATE_GZIP_DEFLATE 8
+
+/** gzip header flags */
+enum inflate_gzip_flags {
+	/** Header CRC is present */
+	INFLATE_GZIP_FHCRC = 0x02,
+	/** Extra field is present */
+	INFLATE_GZIP_FEXTRA = 0x04,
+	/** Original file name is present */
+	INFLATE_GZIP_FNAME = 0x08,
+	/** Comment is present */
+	INFLATE_GZIP_FCOMMENT = 0x10,
+	/** Reserved flags */
+	INFLATE_GZIP_RESERVED = 0xe0,
+};
+
+/** zlib "deflate" compression method */
+#define INFLATE_ZLIB_DEFLATE 8
+
+/** zlib preset dictionary flag */
+#define INFLATE_ZLIB_FDICT 0x20
+
+/** Adler-32 modulus */
+#define INFLATE_ADLER_MOD 65521
+
+/** Maximum number of bytes before Adler-32 sums must be reduced */
+#define INFLATE_ADLER_NMAX 5552
+
+/** End of block symbol */
+#define INFLATE_END_OF_BLOCK 256
+
+/** Length symbol base lengths */
+static const uint16_t inflate_length_base[] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258,
+};
+
+/** Length symbol extra bits */
+static const uint8_t inflate_length_extra[] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0,
+};
+
+/** Distance symbol base distances */
+static const uint16_t inflate_distance_base[] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+	8193, 12289, 16385, 24577,
+};
+
+/** Distance symbol extra bits */
+static const uint8_t inflate_distance_extra[] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13,
+};
+
+/** Order in which code length code lengths are transmitted */
+static const uint8_t inflate_clen_order[INFLATE_CLEN_SYMBOLS] = {
+	16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15,
+};
+
+/**
+ * Build canonical Huffman code
+ *
+ * @v huff		Huffman code to fill in
+ * @v lengths		Code lengths
+ * @v count		Number of symbols
+ * @ret rc		Return status code
+ *
+ * Incomplete codes are permitted (as they must be for e.g. a
+ * distance code with a single symbol); an attempt to decode an
+ * unused code will fail when it is encountered.
+ */
+static int inflate_huffman ( struct inflate_huffman *huff,
+			     const uint8_t *lengths, unsigned int count ) {
+	uint16_t offset[ INFLATE_MAX_BITS + 1 ];
+	unsigned int code;
+	unsigned int index;
+	unsigned int reversed;
+	unsigned int len;
+	unsigned int sym;
+	unsigned int i;
+	unsigned int j;
+	int left;
+
+	/* Count number of codes of each length */
+	memset ( huff->count, 0, sizeof ( huff->count ) );
+	for ( sym = 0 ; sym < count ; sym++ )
+		huff->count[ lengths[sym] ]++;
+	huff->count[0] = 0;
+
+	/* Reject over-subscribed codes */
+	left = 1;
+	for ( len = 1 ; len <= INFLATE_MAX_BITS ; len++ ) {
+		left <<= 1;
+		left -= huff->count[len];
+		if ( left < 0 )
+			return -EINVAL_CODE;
+	}
+
+	/* Sort symbols by code */
+	offset[1] = 0;
+	for ( len = 1 ; len < INFLATE_MAX_BITS ; len++ )
+		offset[ len + 1 ] = ( offset[len] + huff->count[len] );
+	for ( sym = 0 ; sym < count ; sym++ ) {
+		if ( lengths[sym] )
+			huff->symbol[ offset[ lengths[sym] ]++ ] = sym;
+	}
+
+	/* Construct fast lookup table.  DEFLATE transmits Huffman
+	 * codes starting from the most significant bit, so each
+	 * code is bit-reversed to form the table index.
+	 */
+	memset ( huff->fast, 0, sizeof ( huff->fast ) );
+	code = 0;
+	index = 0;
+	for ( len = 1 ; len <= INFLATE_FAST_BITS ; len++ ) {
+		for ( i = 0 ; i < huff->count[len] ; i++ ) {
+			reversed = 0;
+			for ( j = 0 ; j < len ; j++ ) {
+				if ( code & ( 1 << j ) )
+					reversed |= ( 1 << ( len - 1 - j ) );
+			}
+			for ( j = reversed ; j < ( 1 << INFLATE_FAST_BITS ) ;
+			      j += ( 1 << len ) ) {
+				huff->fast[j] = ( huff->symbol[index] |
+						  ( len <<
+						    INFLATE_FAST_LEN_SHIFT ) );
+			}
+			code++;
+			index++;
+		}
+		code <<= 1;
+	}
+
+	return 0;
+}
+
+/**
+ * Decode Huffman symbol
+ *
+ * @v huff		Huffman code
+ * @v bits		Bit accumulator
+ * @v bits_len		Number of valid bits in accumulator
+ * @v len		Code length to fill in (or zero if more input needed)
+ * @ret sym		Symbol, or negative error
+ *
+ * The symbol is not consumed from the bit accumulator.
+ */
+static int inflate_decode ( struct inflate_huffman *huff, uint32_t bits,
+			    unsigned int bits_len, unsigned int *len ) {
+	unsigned int entry;
+	unsigned int code;
+	unsigned int first;
+	unsigned int index;
+	unsigned int count;
+	unsigned int i;
+
+	/* Try fast lookup table */
+	entry = huff->fast[ bits & ( ( 1 << INFLATE_FAST_BITS ) - 1 ) ];
+	if ( entry ) {
+		i = ( entry >> INFLATE_FAST_LEN_SHIFT );
+		*len = ( ( i <= bits_len ) ? i : 0 );
+		return ( entry & ( ( 1 << INFLATE_FAST_LEN_SHIFT ) - 1 ) );
+	}
+
+	/* Fall back to decoding one bit at a time */
+	code = first = index = 0;
+	for ( i = 1 ; i <= INFLATE_MAX_BITS ; i++ ) {
+		if ( i > bits_len ) {
+			*len = 0;
+			return 0;
+		}
+		code |= ( ( bits >> ( i - 1 ) ) & 1 );
+		count = huff->count[i];
+		if ( ( code - first ) < count ) {
+			*len = i;
+			return huff->symbol[ index + ( code - first ) ];
+		}
+		index += count;
+		first += count;
+		first <<= 1;
+		code <<= 1;
+	}
+	return -EINVAL_SYMBOL;
+}
+
+/**
+ * Refill bit accumulator
+ *
+ * @v inflate		Decompressor
+ */
+static inline void inflate_fill ( struct inflate *inflate ) {
+
+	while ( ( inflate->bits_len <= 24 ) && inflate->in_len ) {
+		inflate->bits |= ( ( ( uint32_t ) *(inflate->in++) ) <<
+				   inflate->bits_len );
+		inflate->bits_len += 8;
+		inflate->in_len--;
+	}
+}
+
+/**
+ * Peek at bits
+ *
+ * @v inflate		Decompressor
+ * @v len		Number of bits (at most 16)
+ * @ret bits		Bits
+ */
+static inline unsigned int inflate_peek ( struct inflate *inflate,
+					  unsigned int len ) {
+	return ( inflate->bits & ( ( 1 << len ) - 1 ) );
+}
+
+/**
+ * Consume bits
+ *
+ * @v inflate		Decompressor
+ * @v len		Number of bits
+ */
+static inline void inflate_drop ( struct inflate *inflate,
+				  unsigned int len ) {
+	inflate->bits >>= len;
+	inflate->bits_len -= len;
+}
+
+/**
+ * Discard bits up to the next byte boundary
+ *
+ * @v inflate		Decompressor
+ */
+static inline void inflate_align ( struct inflate *inflate ) {
+	inflate_drop ( inflate, ( inflate->bits_len & 7 ) );
+}
+
+/**
+ * Read byte
+ *
+ * @v inflate		Decompressor
+ * @v byte		Byte to fill in
+ * @ret ok		A byte was available
+ *
+ * Must be called only when the bit accumulator is byte-aligned.
+ */
+static int inflate_byte ( struct inflate *inflate, uint8_t *byte ) {
+
+	if ( inflate->bits_len ) {
+		*byte = inflate_peek ( inflate, 8 );
+		inflate_drop ( inflate, 8 );
+	} else if ( inflate->in_len ) {
+		*byte = *(inflate->in++);
+		inflate->in_len--;
+	} else {
+		return 0;
+	}
+	return 1;
+}
+
+/**
+ * Calculate contiguous space remaining in sliding window
+ *
+ * @v inflate		Decompressor
+ * @ret len		Contiguous space
+ */
+static inline size_t inflate_space ( struct inflate *inflate ) {
+	return ( INFLATE_WINDOW_LEN -
+		 ( inflate->out_len % INFLATE_WINDOW_LEN ) );
+}
+
+/**
+ * Update Adler-32 checksum
+ *
+ * @v adler		Running checksum
+ * @v data		Data
+ * @v len		Length of data
+ * @ret adler		Updated checksum
+ */
+static uint32_t inflate_adler32 ( uint32_t adler, const uint8_t *data,
+				  size_t len ) {
+	uint32_t a = ( adler & 0xffff );
+	uint32_t b = ( adler >> 16 );
+	size_t frag_len;
+
+	while ( len ) {
+		frag_len = len;
+		if ( frag_len > INFLATE_ADLER_NMAX )
+			frag_len = INFLATE_ADLER_NMAX;
+		len -= frag_len;
+		while ( frag_len-- ) {
+			a += *(data++);
+			b += a;
+		}
+		a %= INFLATE_ADLER_MOD;
+		b %= INFLATE_ADLER_MOD;
+	}
+	return ( ( b << 16 ) | a );
+}
+
+/**
+ * Deliver pending decompressed data
+ *
+ * @v inflate		Decompressor
+ * @ret rc		Return status code
+ */
+static int inflate_flush ( struct inflate *inflate ) {
+	const uint8_t *data;
+	size_t len;
+
+	/* Do nothing if there is no pending data */
+	len = ( inflate->out_len - inflate->flushed );
+	if ( ! len )
+		return 0;
+
+	/* Pending data is always contiguous, since we flush whenever
+	 * the window wraps.
+	 */
+	data = ( inflate->window + ( inflate->flushed % INFLATE_WINDOW_LEN ) );
+	inflate->flushed = inflate->out_len;
+
+	/* Update checksum */
+	if ( inflate->format == INFLATE_GZIP ) {
+		inflate->checksum = crc32_le ( inflate->checksum, data, len );
+	} else if ( inflate->format == INFLATE_ZLIB ) {
+		inflate->checksum = inflate_adler32 ( inflate->checksum,
+						      data, len );
+	}
+
+	/* Hand off to consumer */
+	return inflate->deliver ( inflate, data, len );
+}
+
+/**
+ * Move to next block
+ *
+ * @v inflate		Decompressor
+ */
+static void inflate_next_block ( struct inflate *inflate ) {
+
+	inflate->state = ( inflate->final ? INFLATE_TRAILER :
+			   INFLATE_BLOCK_HEADER );
+}
+
+/**
+ * Read zlib header
+ *
+ * @v inflate		Decompressor
+ * @ret rc		Return status code, or INFLATE_STALL
+ */
+static int inflate_zlib_header ( struct inflate *inflate ) {
+	unsigned int header;
+
+	/* Read header bytes */
+	while ( inflate->header_len < 2 ) {
+		if ( ! inflate_byte ( inflate,
+				      &inflate->header[inflate->header_len] ) )
+			return INFLATE_STALL;
+		inflate->header_len++;
+	}
+	inflate->header_len = 0;
+
+	/* Check header */
+	header = ( ( inflate->header[0] << 8 ) | inflate->header[1] );
+	if ( ( ( inflate->header[0] & 0x0f ) != INFLATE_ZLIB_DEFLATE ) ||
+	     ( ( inflate->header[0] >> 4 ) > 7 ) || ( header % 31 ) ) {
+		DBGC ( inflate, "INFLATE %p invalid zlib header %04x\n",
+		       inflate, header );
+		return -EINVAL_HEADER;
+	}
+	if ( inflate->header[1] & INFLATE_ZLIB_FDICT ) {
+		DBGC ( inflate, "INFLATE %p unsupported preset dictionary\n",
+		       inflate );
+		return -ENOTSUP_HEADER;
+	}
+
+	inflate->state = INFLATE_BLOCK_HEADER;
+	return 0;
+}
+
+/**
+ * Read gzip fixed header
+ *
+ * @v inflate		Decompressor
+ * @ret rc		Return status code, or INFLATE_STALL
+ */
+static int inflate_gzip_header ( struct inflate *inflate ) {
+	unsigned int magic;
+	unsigned int flags;
+
+	/* Read header bytes */
+	while ( inflate->header_len < 10 ) {
+		if ( ! inflate_byte ( inflate,
+				      &inflate->header[inflate->header_len] ) )
+			return INFLATE_STALL;
+		inflate->header_len++;
+	}
+	inflate->header_len = 0;
+
+	/* Check header */
+	magic = ( inflate->header[0] | ( inflate->header[1] << 8 ) );
+	flags = inflate->header[3];
+	if ( ( magic != INFLATE_GZIP_MAGIC ) ||
+	     ( inflate->header[2] != INFLATE_GZIP_DEFLATE ) ) {
+		DBGC ( inflate, "INFLATE %p invalid gzip header\n", inflate );
+		return -EINVAL_HEADER;
+	}
+	if ( flags & INFLATE_GZIP_RESERVED ) {
+		DBGC ( inflate, "INFLATE %p unsupported gzip flags %02x\n",
+		       inflate, flags );
+		return -ENOTSUP_HEADER;
+	}
+
+	inflate->header_flags = flags;
+	inflate->state = INFLATE_GZIP_OPTIONS;
+	return 0;
+}
+
+/**
+ * Read gzip optional header fields
+ *
+ * @v inflate		Decompressor
+ * @ret rc		Return status code, or INFLATE_STALL
+ */
+static int inflate_gzip_options ( struct inflate *inflate ) {
+	uint8_t byte;
+
+	/* Skip extra field */
+	if ( inflate->header_flags & INFLATE_GZIP_FEXTRA ) {
+		while ( inflate->header_len < 2 ) {
+			if ( ! inflate_byte ( inflate, &inflate->header
+					      [inflate->header_len] ) )
+				return INFLATE_STALL;
+			inflate->header_len++;
+			inflate->extra_len = ( inflate->header[0] |
+					       ( inflate->header[1] << 8 ) );
+		}
+		while ( inflate->extra_len ) {
+			if ( ! inflate_byte ( inflate, &byte ) )
+				return INFLATE_STALL;
+			inflate->extra_len--;
+		}
+		inflate->header_len = 0;
+		inflate->header_flags &= ~INFLATE_GZIP_FEXTRA;
+	}
+
+	/* Skip file name */
+	while ( inflate->header_flags & INFLATE_GZIP_FNAME ) {
+		if ( ! inflate_byte ( inflate, &byte ) )
+			return INFLATE_STALL;
+		if ( ! byte )
+			inflate->header_flags &= ~INFLATE_GZIP_FNAME;
+	}
+
+	/* Skip comment */
+	while ( inflate->header_flags & INFLATE_GZIP_FCOMMENT ) {
+		if ( ! inflate_byte ( inflate, &byte ) )
+			return INFLATE_STALL;
+		if ( ! byte )
+			inflate->header_flags &= ~INFLATE_GZIP_FCOMMENT;
+	}
+
+	/* Skip header CRC */
+	if ( inflate->header_flags & INFLATE_GZIP_FHCRC ) {
+		while ( inflate->header_len < 2 ) {
+			if ( ! inflate_byte ( inflate, &byte ) )
+				return INFLATE_STALL;
+			inflate->header_len++;
+		}
+		inflate->header_len = 0;
+		inflate->header_flags &= ~INFLATE_GZIP_FHCRC;
+	}
+
+	inflate->state = INFLATE_BLOCK_HEADER;
+	return 0;
+}
+
+/**
+ * Read block header
+ *
+ * @v inflate		Decompressor
+ * @ret rc		Return status code, or INFLATE_STALL
+ */
+static int inflate_block_header ( struct inflate *inflate ) {
+	uint8_t *lengths = inflate->lengths;
+	unsigned int type;
+	unsigned int i;
+	int rc;
+
+	/* Read block header */
+	inflate_fill ( inflate );
+	if ( inflate->bits_len < 3 )
+		return INFLATE_STALL;
+	inflate->final = inflate_peek ( inflate, 1 );
+	type = ( inflate_peek ( inflate, 3 ) >> 1 );
+	inflate_drop ( inflate, 3 );
+
+	switch ( type ) {
+	case 0:
+		/* Stored block */
+		inflate->state = INFLATE_STORED_LEN;
+		return 0;
+	case 1:
+		/* Fixed Huffman codes (constructed on first use) */
+		if ( ! inflate->fixed ) {
+			for ( i = 0 ; i < INFLATE_LITLEN_SYMBOLS ; i++ ) {
+				lengths[i] = ( ( i < 144 ) ? 8 :
+					       ( i < 256 ) ? 9 :
+					       ( i < 280 ) ? 7 : 8 );
+			}
+			if ( ( rc = inflate_huffman ( &inflate->litlen, lengths,
+						      INFLATE_LITLEN_SYMBOLS ) ) != 0 )
+				return rc;
+			memset ( lengths, 5, INFLATE_DIST_SYMBOLS );
+			if ( ( rc = inflate_huffman ( &inflate->dist, lengths,
+						      INFLATE_DIST_SYMBOLS ) ) != 0 )
+				return rc;
+			inflate->fixed = 1;
+		}
+		inflate->state = INFLATE_LITLEN;
+		return 0;
+	case 2:
+		/* Dynamic Huffman codes */
+		inflate->state = INFLATE_DYNAMIC_COUNTS;
+		return 0;
+	default:
+		DBGC ( inflate, "INFLATE %p invalid block type\n", inflate );
+		return -EINVAL_BLOCK;
+	}
+}
+
+/**
+ * Read stored block length
+ *
+ * @v inflate		Decompressor
+ * @ret rc		Return status code, or INFLATE_STALL
+ */
+static int inflate_stored_len ( struct inflate *inflate ) {
+	unsigned int len;
+	unsigned int nlen;
+
+	/* Stored block lengths start on a byte boundary */
+	inflate_align ( inflate );
+	inflate_fill ( inflate );
+	if ( inflate->bits_len < 32 )
+		return INFLATE_STALL;
+	len = inflate_peek ( inflate, 16 );
+	inflate_drop ( inflate, 16 );
+	nlen = inflate_peek ( inflate, 16 );
+	inflate_drop ( inflate, 16 );
+	if ( len != ( nlen ^ 0xffff ) ) {
+		DBGC ( inflate, "INFLATE %p invalid stored length %04x/%04x\n",
+		       inflate, len, nlen );
+		return -EINVAL_STORED;
+	}
+
+	inflate->remaining = len;
+	if ( len ) {
+		inflate->state = INFLATE_STORED_DATA;
+	} else {
+		inflate_next_block ( inflate );
+	}
+	return 0;
+}
+
+/**
+ * Copy stored block data
+ *
+ * @v inflate		Decompressor
+ * @ret rc		Return status code, or INFLATE_STALL
+ */
+static int inflate_stored_data ( struct inflate *inflate ) {
+	uint8_t *out = ( inflate->window +
+			 ( inflate->out_len % INFLATE_WINDOW_LEN ) );
+	size_t len = inflate_space ( inflate );
+
+	/* Limit to remaining length of block */
+	if ( len > inflate->remaining )
+		len = inflate->remaining;
+
+	/* Use any whole bytes still held in the bit accumulator */
+	if ( inflate->bits_len ) {
+		*out = inflate_peek ( inflate, 8 );
+		inflate_drop ( inflate, 8 );
+		len = 1;
+	} else {
+		/* Copy directly from input */
+		if ( ! inflate->in_len )
+			return INFLATE_STALL;
+		if ( len > inflate->in_len )
+			len = inflate->in_len;
+		memcpy ( out, inflate->in, len );
+		inflate->in += len;
+		inflate->in_len -= len;
+	}
+	inflate->out_len += len;
+	inflate->remaining -= len;
+
+	if ( ! inflate->remaining )
+		inflate_next_block ( inflate );
+	return 0;
+}
+
+/**
+ * Read dynamic block code counts
+ *
+ * @v inflate		Decompressor
+ * @ret rc		Return status code, or INFLATE_STALL
+ */
+static int inflate_dynamic_counts ( struct inflate *inflate ) {
+
+	inflate_fill ( inflate );
+	if ( inflate->bits_len < 14 )
+		return INFLATE_STALL;
+	inflate->hlit = ( inflate_peek ( inflate, 5 ) + 257 );
+	inflate_drop ( inflate, 5 );
+	inflate->hdist = ( inflate_peek ( inflate, 5 ) + 1 );
+	inflate_drop ( inflate, 5 );
+	inflate->hclen = ( inflate_peek ( inflate, 4 ) + 4 );
+	inflate_drop ( inflate, 4 );
+	if ( ( inflate->hlit > 286 ) || ( inflate->hdist > 30 ) ) {
+		DBGC ( inflate, "INFLATE %p invalid code counts %d/%d\n",
+		       inflate, inflate->hlit, inflate->hdist );
+		return -EINVAL_CODE;
+	}
+
+	memset ( inflate->lengths, 0, sizeof ( inflate->lengths ) );
+	inflate->count = 0;
+	inflate->state = INFLATE_DYNAMIC_CLEN;
+	return 0;
+}
+
+/**
+ * Read dynamic block code length code lengths
+ *
+ * @v inflate		Decompressor
+ * @ret rc		Return status code, or INFLATE_STALL
+ */
+static int inflate_dynamic_clen ( struct inflate *inflate ) {
+	int rc;
+
+	/* Read code length code lengths */
+	while ( inflate->count < inflate->hclen ) {
+		inflate_fill ( inflate );
+		if ( inflate->bits_len < 3 )
+			return INFLATE_STALL;
+		inflate->lengths[ inflate_clen_order[ inflate->count++ ] ] =
+			inflate_peek ( inflate, 3 );
+		inflate_drop ( inflate, 3 );
+	}
+
+	/* Build code length code (using the distance code storage) */
+	inflate->fixed = 0;
+	if ( ( rc = inflate_huffman ( &inflate->dist, inflate->lengths,
+				      INFLATE_CLEN_SYMBOLS ) ) != 0 ) {
+		DBGC ( inflate, "INFLATE %p invalid code length code\n",
+		       inflate );
+		return rc;
+	}
+
+	memset ( inflate->lengths, 0, sizeof ( inflate->lengths ) );
+	inflate->count = 0;
+	inflate->state = INFLATE_DYNAMIC_LENGTHS;
+	return 0;
+}
+
+/**
+ * Read dynamic block literal/length and distance code lengths
+ *
+ * @v inflate		Decompressor
+ * @ret rc		Return status code, or INFLATE_STALL
+ */
+static int inflate_dynamic_lengths ( struct inflate *inflate ) {
+	unsigned int total = ( inflate->hlit + inflate->hdist );
+	unsigned int extra;
+	unsigned int repeat;
+	unsigned int value;
+	unsigned int len;
+	int sym;
+	int rc;
+
+	while ( inflate->count < total ) {
+
+		/* Decode symbol and any extra bits as a unit */
+		inflate_fill ( inflate );
+		sym = inflate_decode ( &inflate->dist, inflate->bits,
+				       inflate->bits_len, &len );
+		if ( sym < 0 )
+			return sym;
+		if ( ! len )
+			return INFLATE_STALL;
+		extra = ( ( sym == 16 ) ? 2 : ( sym == 17 ) ? 3 :
+			  ( sym == 18 ) ? 7 : 0 );
+		if ( inflate->bits_len < ( len + extra ) )
+			return INFLATE_STALL;
+		inflate_drop ( inflate, len );
+
+		/* Literal code length */
+		if ( sym < 16 ) {
+			inflate->lengths[ inflate->count++ ] = sym;
+			continue;
+		}
+
+		/* Repeated code length */
+		repeat = inflate_peek ( inflate, extra );
+		inflate_drop ( inflate, extra );
+		if ( sym == 16 ) {
+			if ( ! inflate->count ) {
+				DBGC ( inflate, "INFLATE %p repeat with no "
+				       "previous length\n", inflate );
+				return -EINVAL_CODE;
+			}
+			value = inflate->lengths[ inflate->count - 1 ];
+			repeat += 3;
+		} else {
+			value = 0;
+			repeat += ( ( sym == 17 ) ? 3 : 11 );
+		}
+		if ( ( inflate->count + repeat ) > total ) {
+			DBGC ( inflate, "INFLATE %p too many code lengths\n",
+			       inflate );
+			return -EINVAL_CODE;
+		}
+		memset ( &inflate->lengths[inflate->count], value, repeat );
+		inflate->count += repeat;
+	}
+
+	/* A block with no end-of-block code can never terminate */
+	if ( ! inflate->lengths[INFLATE_END_OF_BLOCK] ) {
+		DBGC ( inflate, "INFLATE %p missing end-of-block code\n",
+		       inflate );
+		return -EINVAL_CODE;
+	}
+
+	/* Build literal/length and distance codes */
+	if ( ( rc = inflate_huffman ( &inflate->litlen, inflate->lengths,
+				      inflate->hlit ) ) != 0 ) {
+		DBGC ( inflate, "INFLATE %p invalid literal/length code\n",
+		       inflate );
+		return rc;
+	}
+	if ( ( rc = inflate_huffman ( &inflate->dist,
+				      &inflate->lengths[inflate->hlit],
+				      inflate->hdist ) ) != 0 ) {
+		DBGC ( inflate, "INFLATE %p invalid distance code\n",
+		       inflate );
+		return rc;
+	}
+
+	inflate->state = INFLATE_LITLEN;
+	return 0;
+}
+
+/**
+ * Decode literal/length symbols
+ *
+ * @v inflate		Decompressor
+ * @ret rc		Return status code, or INFLATE_STALL
+ */
+static int inflate_litlen ( struct inflate *inflate ) {
+	uint8_t *out = ( inflate->window +
+			 ( inflate->out_len % INFLATE_WINDOW_LEN ) );
+	size_t space = inflate_space ( inflate );
+	unsigned int extra;
+	unsigned int len;
+	int sym;
+
+	/* Decode literals until the window fills or a match is found */
+	while ( 1 ) {
+
+		/* Decode symbol and any extra bits as a unit */
+		inflate_fill ( inflate );
+		sym = inflate_decode ( &inflate->litlen, inflate->bits,
+				       inflate->bits_len, &len );
+		if ( sym < 0 )
+			return sym;
+		if ( ! len )
+			return INFLATE_STALL;
+
+		/* Literal */
+		if ( sym < INFLATE_END_OF_BLOCK ) {
+			inflate_drop ( inflate, len );
+			*(out++) = sym;
+			inflate->out_len++;
+			if ( ! --space )
+				return 0;
+			continue;
+		}
+
+		/* End of block */
+		if ( sym == INFLATE_END_OF_BLOCK ) {
+			inflate_drop ( inflate, len );
+			inflate_next_block ( inflate );
+			return 0;
+		}
+
+		/* Length */
+		sym -= ( INFLATE_END_OF_BLOCK + 1 );
+		if ( sym >= ( int ) ( sizeof ( inflate_length_base ) /
+				      sizeof ( inflate_length_base[0] ) ) ) {
+			DBGC ( inflate, "INFLATE %p invalid length symbol\n",
+			       inflate );
+			return -EINVAL_SYMBOL;
+		}
+		extra = inflate_length_extra[sym];
+		if ( inflate->bits_len < ( len + extra ) )
+			return INFLATE_STALL;
+		inflate_drop ( inflate, len );
+		inflate->remaining = ( inflate_length_base[sym] +
+				       inflate_peek ( inflate, extra ) );
+		inflate_drop ( inflate, extra );
+		inflate->state = INFLATE_DISTANCE;
+		return 0;
+	}
+}
+
+/**
+ * Decode distance symbol
+ *
+ * @v inflate		Decompressor
+ * @ret rc		Return status code, or INFLATE_STALL
+ */
+static int inflate_distance ( struct inflate *inflate ) {
+	unsigned int len;
+	int sym;
+
+	inflate_fill ( inflate );
+	sym = inflate_decode ( &inflate->dist, inflate->bits,
+			       inflate->bits_len, &len );
+	if ( sym < 0 )
+		return sym;
+	if ( ! len )
+		return INFLATE_STALL;
+	if ( sym >= ( int ) ( sizeof ( inflate_distance_base ) /
+			      sizeof ( inflate_distance_base[0] ) ) ) {
+		DBGC ( inflate, "INFLATE %p invalid distance symbol\n",
+		       inflate );
+		return -EINVAL_SYMBOL;
+	}
+	inflate_drop ( inflate, len );
+
+	inflate->distance = sym;
+	inflate->state = INFLATE_DISTANCE_EXTRA;
+	return 0;
+}
+
+/**
+ * Decode distance extra bits
+ *
+ * @v inflate		Decompressor
+ * @ret rc		Return status code, or INFLATE_STALL
+ */
+static int inflate_distance_extra_bits ( struct inflate *inflate ) {
+	unsigned int sym = inflate->distance;
+	unsigned int extra = inflate_distance_extra[sym];
+
+	inflate_fill ( inflate );
+	if ( inflate->bits_len < extra )
+		return INFLATE_STALL;
+	inflate->distance = ( inflate_distance_base[sym] +
+			      inflate_peek ( inflate, extra ) );
+	inflate_drop ( inflate, extra );
+	if ( inflate->distance > inflate->out_len ) {
+		DBGC ( inflate, "INFLATE %p distance %zd exceeds output length "
+		       "%zd\n", inflate, inflate->distance, inflate->out_len );
+		return -EINVAL_DISTANCE;
+	}
+
+	inflate->state = INFLATE_COPY;
+	return 0;
+}
+
+/**
+ * Copy match
+ *
+ * @v inflate		Decompressor
+ * @ret rc		Return status code, or INFLATE_STALL
+ */
+static int inflate_copy ( struct inflate *inflate ) {
+	size_t pos = ( inflate->out_len % INFLATE_WINDOW_LEN );
+	size_t from = ( ( pos + INFLATE_WINDOW_LEN - inflate->distance ) %
+			INFLATE_WINDOW_LEN );
+	uint8_t *window = inflate->window;
+	size_t len = inflate_space ( inflate );
+	size_t i;
+
+	/* Limit to remaining length of match */
+	if ( len > inflate->remaining )
+		len = inflate->remaining;
+
+	/* Copy byte by byte, since the source may overlap the
+	 * destination (and may wrap around the window).
+	 */
+	for ( i = 0 ; i < len ; i++ ) {
+		window[ pos++ ] = window[ from++ ];
+		if ( from == INFLATE_WINDOW_LEN )
+			from = 0;
+	}
+	inflate->out_len += len;
+	inflate->remaining -= len;
+
+	if ( ! inflate->remaining )
+		inflate->state = INFLATE_LITLEN;
+	return 0;
+}
+
+/**
+ * Read trailer
+ *
+ * @v inflate		Decompressor
+ * @ret rc		Return status code, or INFLATE_STALL
+ */
+static int inflate_trailer ( struct inflate *inflate ) {
+	uint8_t *trailer = inflate->header;
+	unsigned int trailer_len;
+	uint32_t checksum;
+	uint32_t len;
+	int rc;
+
+	/* Raw DEFLATE data has no trailer */
+	if ( inflate->format == INFLATE_RAW ) {
+		inflate->state = INFLATE_DONE;
+		return 0;
+	}
+
+	/* Read trailer bytes */
+	inflate_align ( inflate );
+	trailer_len = ( ( inflate->format == INFLATE_GZIP ) ? 8 : 4 );
+	while ( inflate->header_len < trailer_len ) {
+		if ( ! inflate_byte ( inflate,
+				      &trailer[inflate->header_len] ) )
+			return INFLATE_STALL;
+		inflate->header_len++;
+	}
+
+	/* Ensure checksum covers all output */
+	if ( ( rc = inflate_flush ( inflate ) ) != 0 )
+		return rc;
+
+	/* Verify checksum and length */
+	if ( inflate->format == INFLATE_GZIP ) {
+		checksum = ( trailer[0] | ( trailer[1] << 8 ) |
+			     ( trailer[2] << 16 ) |
+			     ( ( ( uint32_t ) trailer[3] ) << 24 ) );
+		len = ( trailer[4] | ( trailer[5] << 8 ) | ( trailer[6] << 16 ) |
+			( ( ( uint32_t ) trailer[7] ) << 24 ) );
+		if ( checksum != ( ( uint32_t ) ~inflate->checksum ) ) {
+			DBGC ( inflate, "INFLATE %p CRC mismatch\n", inflate );
+			return -EIO_CHECKSUM;
+		}
+		if ( len != ( ( uint32_t ) ( inflate->out_len -
+					     inflate->member ) ) ) {
+			DBGC ( inflate, "INFLATE %p length mismatch\n",
+			       inflate );
+			return -EIO_LENGTH;
+		}
+	} else {
+		checksum = ( ( ( ( uint32_t ) trailer[0] ) << 24 ) |
+			     ( trailer[1] << 16 ) |
+			     ( trailer[2] << 8 ) | trailer[3] );
+		if ( checksum != inflate->checksum ) {
+			DBGC ( inflate, "INFLATE %p Adler-32 mismatch\n",
+			       inflate );
+			return -EIO_CHECKSUM;
+		}
+	}
+
+	/* A gzip file may consist of several concatenated members */
+	inflate->header_len = 0;
+	inflate->state = ( ( inflate->format == INFLATE_GZIP ) ?
+			   INFLATE_GZIP_MEMBER : INFLATE_DONE );
+	return 0;
+}
+
+/**
+ * Start any further gzip member
+ *
+ * @v inflate		Decompressor
+ * @ret rc		Return status code, or INFLATE_STALL
+ *
+ * Any data following a complete gzip member must be another gzip
+ * member; anything else will be rejected as an invalid header.
+ */
+static int inflate_gzip_member ( struct inflate *inflate ) {
+
+	/* Wait for start of next member */
+	if ( ! inflate_byte ( inflate, &inflate->header[0] ) )
+		return INFLATE_STALL;
+	if ( inflate->header[0] != ( INFLATE_GZIP_MAGIC & 0xff ) ) {
+		DBGC ( inflate, "INFLATE %p invalid data after gzip member\n",
+		       inflate );
+		return -EINVAL_HEADER;
+	}
+	DBGC ( inflate, "INFLATE %p starting new gzip member at output "
+	       "offset %zd\n", inflate, inflate->out_len );
+
+	/* Restart checksum and length */
+	inflate->header_len = 1;
+	inflate->checksum = 0xffffffffUL;
+	inflate->member = inflate->out_len;
+	inflate->state = INFLATE_GZIP_HEADER;
+	return 0;
+}
+
+/**
+ * Perform a single decompression step
+ *
+ * @v inflate		Decompressor
+ * @ret rc		Return status code, or INFLATE_STALL
+ */
+static int inflate_step ( struct inflate *inflate ) {
+
+	switch ( inflate->state ) {
+	case INFLATE_ZLIB_HEADER:
+		return inflate_zlib_header ( inflate );
+	case INFLATE_GZIP_HEADER:
+		return inflate_gzip_header ( inflate );
+	case INFLATE_GZIP_OPTIONS:
+		return inflate_gzip_options ( inflate );
+	case INFLATE_BLOCK_HEADER:
+		return inflate_block_header ( inflate );
+	case INFLATE_STORED_LEN:
+		return inflate_stored_len ( inflate );
+	case INFLATE_STORED_DATA:
+		return inflate_stored_data ( inflate );
+	case INFLATE_DYNAMIC_COUNTS:
+		return inflate_dynamic_counts ( inflate );
+	case INFLATE_DYNAMIC_CLEN:
+		return inflate_dynamic_clen ( inflate );
+	case INFLATE_DYNAMIC_LENGTHS:
+		return inflate_dynamic_lengths ( inflate );
+	case INFLATE_LITLEN:
+		return inflate_litlen ( inflate );
+	case INFLATE_DISTANCE:
+		return inflate_distance ( inflate );
+	case INFLATE_DISTANCE_EXTRA:
+		return inflate_distance_extra_bits ( inflate );
+	case INFLATE_COPY:
+		return inflate_copy ( inflate );
+	case INFLATE_TRAILER:
+		return inflate_trailer ( inflate );
+	case INFLATE_GZIP_MEMBER:
+		return inflate_gzip_member ( inflate );
+	default:
+		return INFLATE_STALL;
+	}
+}
+
+/**
+ * Initialise decompressor
+ *
+ * @v inflate		Decompressor
+ * @v format		Data format
+ * @v deliver		Method for delivering decompressed data
+ * @ret rc		Return status code
+ */
+int inflate_init ( struct inflate *inflate, enum inflate_format format,
+		   int ( * deliver ) ( struct inflate *inflate,
+				       const void *data, size_t len ) ) {
+
+	memset ( inflate, 0, sizeof ( *inflate ) );
+	inflate->window = malloc ( INFLATE_WINDOW_LEN );
+	if ( ! inflate->window )
+		return -ENOMEM;
+	inflate->format = format;
+	inflate->deliver = deliver;
+	switch ( format ) {
+	case INFLATE_ZLIB:
+		inflate->state = INFLATE_ZLIB_HEADER;
+		inflate->checksum = 1;
+		break;
+	case INFLATE_GZIP:
+		inflate->state = INFLATE_GZIP_HEADER;
+		inflate->checksum = 0xffffffffUL;
+		break;
+	default:
+		inflate->state = INFLATE_BLOCK_HEADER;
+		break;
+	}
+	return 0;
+}
+
+/**
+ * Free decompressor
+ *
+ * @v inflate		Decompressor
+ */
+void inflate_free ( struct inflate *inflate ) {
+
+	free ( inflate->window );
+	inflate->window = NULL;
+}
+
+/**
+ * Decompress data
+ *
+ * @v inflate		Decompressor
+ * @v data		Compressed data
+ * @v len		Length of compressed data
+ * @ret rc		Return status code
+ *
+ * All decompressed data that can be produced from the input is
+ * delivered before returning.  Concatenated gzip members are
+ * decompressed in turn.  Any data following the end of a zlib or raw
+ * DEFLATE stream is ignored.
+ */
+int inflate_data ( struct inflate *inflate, const void *data, size_t len ) {
+	int rc;
+
+	inflate->in = data;
+	inflate->in_len = len;
+
+	/* Decompress until we run out of input */
+	while ( inflate->state != INFLATE_DONE ) {
+
+		/* Deliver data whenever the window wraps */
+		if ( ( inflate->out_len != inflate->flushed ) &&
+		     ( ( inflate->out_len % INFLATE_WINDOW_LEN ) == 0 ) ) {
+			if ( ( rc = inflate_flush ( inflate ) ) != 0 )
+				return rc;
+		}
+
+		/* Perform next step */
+		rc = inflate_step ( inflate );
+		if ( rc < 0 ) {
+			DBGC ( inflate, "INFLATE %p failed at offset %zd: "
+			       "%s\n", inflate, inflate->out_len,
+			       strerror ( rc ) );
+			return rc;
+		}
+		if ( rc == INFLATE_STALL )
+			break;
+	}
+
+	/* Ignore anything following the end of the stream */
+	if ( inflate->state == INFLATE_DONE ) {
+		inflate->trailing += ( inflate->in_len +
+				       ( inflate->bits_len / 8 ) );
+		inflate->in_len = 0;
+		inflate->bits = 0;
+		inflate->bits_len = 0;
+	}
+
+	/* Deliver any remaining data */
+	return inflate_flush ( inflate );
+}
+
+/**
+ * Check for end of compressed stream
+ *
+ * @v inflate		Decompressor
+ * @ret finished	End of compressed stream has been reached
+ */
+int inflate_finished ( struct inflate *inflate ) {
+	return ( ( inflate->state == INFLATE_DONE ) ||
+		 ( inflate->state == INFLATE_GZIP_MEMBER ) );
+}
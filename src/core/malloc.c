@@ -89,6 +89,9 @@ static LIST_HEAD ( free_blocks );
 /** Total amount of free memory */
 size_t freemem;
 
+/** Allocator statistics */
+struct malloc_stats malloc_stats;
+
 /**
  * Heap size
  *
@@ -290,6 +293,7 @@ void * alloc_memblock ( size_t size, size_t align, size_t offset ) {
 					list_del ( &pre->list );
 				/* Update total free memory */
 				freemem -= size;
+				malloc_stats.allocs++;
 				/* Return allocated block */
 				DBG ( "Allocated [%p,%p)\n", block,
 				      ( ( ( void * ) block ) + size ) );
@@ -303,6 +307,7 @@ void * alloc_memblock ( size_t size, size_t align, size_t offset ) {
 			/* Nothing available to discard */
 			DBG ( "Failed to allocate %#zx (aligned %#zx)\n",
 			      size, align );
+			malloc_stats.failures++;
 			ptr = NULL;
 			goto done;
 		}
@@ -382,6 +387,7 @@ void free_memblock ( void *ptr, size_t size ) {
 
 	/* Update free memory counter */
 	freemem += size;
+	malloc_stats.frees++;
 
 	valgrind_make_blocks_noaccess();
 }
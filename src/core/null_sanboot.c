@@ -39,8 +39,14 @@ static int null_san_describe ( unsigned int drive __unused ) {
 	return -EOPNOTSUPP;
 }
 
+static int null_san_stats ( unsigned int drive __unused,
+			    struct block_cache_stats *stats __unused ) {
+	return -EOPNOTSUPP;
+}
+
 PROVIDE_SANBOOT_INLINE ( null, san_default_drive );
 PROVIDE_SANBOOT ( null, san_hook, null_san_hook );
 PROVIDE_SANBOOT ( null, san_unhook, null_san_unhook );
 PROVIDE_SANBOOT ( null, san_boot, null_san_boot );
 PROVIDE_SANBOOT ( null, san_describe, null_san_describe );
+PROVIDE_SANBOOT ( null, san_stats, null_san_stats );
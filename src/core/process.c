@@ -21,7 +21,9 @@ FILE_LICENCE ( GPL2_OR_LATER );
 
 #include <ipxe/list.h>
 #include <ipxe/init.h>
+#include <ipxe/timer.h>
 #include <ipxe/process.h>
+#include <ipxe/profile.h>
 
 /** @file
  *
@@ -29,10 +31,53 @@ FILE_LICENCE ( GPL2_OR_LATER );
  *
  * We implement a trivial form of cooperative multitasking, in which
  * all processes share a single stack and address space.
+ *
+ * Runnable processes are held on one run queue per scheduling
+ * priority.  The queues are serviced using weighted round-robin, so
+ * that higher-priority processes (such as network device polling)
+ * are stepped more often than lower-priority processes, without ever
+ * starving the latter.  A process with nothing to do may put itself
+ * to sleep, in which case it will not be stepped at all until it is
+ * woken up by an event or by the expiry of its sleep timeout.
+ */
+
+/** Process run queues (one per priority) */
+struct list_head process_run_queues[PROC_NUM_PRIORITIES] = {
+	LIST_HEAD_INIT ( process_run_queues[PROC_PRIO_HIGH] ),
+	LIST_HEAD_INIT ( process_run_queues[PROC_PRIO_NORMAL] ),
+	LIST_HEAD_INIT ( process_run_queues[PROC_PRIO_LOW] ),
+};
+
+/** Process sleep queue
+ *
+ * Processes sleeping with a timeout are kept in order of wakeup
+ * time, ahead of any processes sleeping without a timeout.
+ */
+LIST_HEAD ( process_sleep_queue );
+
+/** Number of consecutive steps allowed for each priority */
+static const unsigned int process_weights[PROC_NUM_PRIORITIES] = {
+	[PROC_PRIO_HIGH] = 4,
+	[PROC_PRIO_NORMAL] = 2,
+	[PROC_PRIO_LOW] = 1,
+};
+
+/** Remaining steps in current scheduling round for each priority */
+static unsigned int process_credits[PROC_NUM_PRIORITIES];
+
+/**
+ * Get run queue for process
+ *
+ * @v process		Process
+ * @ret queue		Run queue
  */
+static inline struct list_head * process_run_queue ( struct process *process ){
+	unsigned int priority = process->desc->priority;
 
-/** Process run queue */
-static LIST_HEAD ( run_queue );
+	if ( priority >= PROC_NUM_PRIORITIES )
+		priority = PROC_PRIO_LOW;
+	return &process_run_queues[priority];
+}
 
 /**
  * Get pointer to object containing process
@@ -57,7 +102,10 @@ void process_add ( struct process *process ) {
 		DBGC ( PROC_COL ( process ), "PROCESS " PROC_FMT
 		       " starting\n", PROC_DBG ( process ) );
 		ref_get ( process->refcnt );
-		list_add_tail ( &process->list, &run_queue );
+		process->sleeping = 0;
+		list_add_tail ( &process->list, process_run_queue ( process ) );
+	} else if ( process_sleeping ( process ) ) {
+		process_wake ( process );
 	} else {
 		DBGC ( PROC_COL ( process ), "PROCESS " PROC_FMT
 		       " already started\n", PROC_DBG ( process ) );
@@ -78,6 +126,7 @@ void process_del ( struct process *process ) {
 		       " stopping\n", PROC_DBG ( process ) );
 		list_del ( &process->list );
 		INIT_LIST_HEAD ( &process->list );
+		process->sleeping = 0;
 		ref_put ( process->refcnt );
 	} else {
 		DBGC ( PROC_COL ( process ), "PROCESS " PROC_FMT
@@ -85,35 +134,177 @@ void process_del ( struct process *process ) {
 	}
 }
 
+/**
+ * Put process to sleep until woken up
+ *
+ * @v process		Process
+ *
+ * The process remains running, but will not be stepped until
+ * process_wake() is called.  Calling process_sleep() on a process
+ * that is not running has no effect.
+ */
+void process_sleep ( struct process *process ) {
+
+	/* Do nothing unless process is running */
+	if ( ! process_running ( process ) )
+		return;
+
+	DBGC2 ( PROC_COL ( process ), "PROCESS " PROC_FMT " sleeping\n",
+		PROC_DBG ( process ) );
+	list_del ( &process->list );
+	list_add_tail ( &process->list, &process_sleep_queue );
+	process->sleeping = PROC_SLEEP_FOREVER;
+}
+
+/**
+ * Put process to sleep until woken up or timeout expires
+ *
+ * @v process		Process
+ * @v timeout		Timeout (in ticks)
+ *
+ * Calling process_sleep_timeout() on a process that is not running
+ * has no effect.
+ */
+void process_sleep_timeout ( struct process *process,
+			     unsigned long timeout ) {
+	struct process *tmp;
+	unsigned long wake = ( currticks() + timeout );
+
+	/* Do nothing unless process is running */
+	if ( ! process_running ( process ) )
+		return;
+
+	DBGC2 ( PROC_COL ( process ), "PROCESS " PROC_FMT " sleeping for "
+		"%ld ticks\n", PROC_DBG ( process ), timeout );
+	list_del ( &process->list );
+	process->sleeping = PROC_SLEEP_TIMED;
+	process->wake = wake;
+
+	/* Insert ahead of first process due to wake up later */
+	list_for_each_entry ( tmp, &process_sleep_queue, list ) {
+		if ( ( tmp->sleeping != PROC_SLEEP_TIMED ) ||
+		     ( ( ( signed long ) ( tmp->wake - wake ) ) > 0 ) )
+			break;
+	}
+	list_add_tail ( &process->list, &tmp->list );
+}
+
+/**
+ * Wake up sleeping process
+ *
+ * @v process		Process
+ *
+ * It is safe to call process_wake() on a process that is not
+ * sleeping (or not running); such calls will have no effect.
+ */
+void process_wake ( struct process *process ) {
+
+	/* Do nothing unless process is sleeping */
+	if ( ! process_sleeping ( process ) )
+		return;
+
+	DBGC2 ( PROC_COL ( process ), "PROCESS " PROC_FMT " waking\n",
+		PROC_DBG ( process ) );
+	list_del ( &process->list );
+	list_add_tail ( &process->list, process_run_queue ( process ) );
+	process->sleeping = 0;
+}
+
+/**
+ * Wake up any processes whose sleep timeout has expired
+ *
+ * @v now		Current time
+ */
+static void process_wake_expired ( unsigned long now ) {
+	struct process *process;
+
+	while ( ( process = list_first_entry ( &process_sleep_queue,
+					       struct process, list ) ) &&
+		( process->sleeping == PROC_SLEEP_TIMED ) &&
+		( ( ( signed long ) ( now - process->wake ) ) >= 0 ) ) {
+		process_wake ( process );
+	}
+}
+
+/**
+ * Select run queue from which to step the next process
+ *
+ * @ret queue		Run queue, or NULL if no processes are runnable
+ */
+static struct list_head * process_select ( void ) {
+	unsigned int priority;
+	int refilled = 0;
+
+	while ( 1 ) {
+
+		/* Use highest-priority non-empty queue with credit */
+		for ( priority = 0 ; priority < PROC_NUM_PRIORITIES ;
+		      priority++ ) {
+			if ( list_empty ( &process_run_queues[priority] ) )
+				continue;
+			if ( process_credits[priority] ) {
+				process_credits[priority]--;
+				return &process_run_queues[priority];
+			}
+		}
+
+		/* Nothing runnable if we have already refilled */
+		if ( refilled )
+			return NULL;
+
+		/* Start a new scheduling round */
+		for ( priority = 0 ; priority < PROC_NUM_PRIORITIES ;
+		      priority++ ) {
+			process_credits[priority] = process_weights[priority];
+		}
+		refilled = 1;
+	}
+}
+
 /**
  * Single-step a single process
  *
- * This executes a single step of the first process in the run queue,
- * and moves the process to the end of the run queue.
+ * This executes a single step of the first process in the selected
+ * run queue, and moves the process to the end of that run queue.
  */
 void step ( void ) {
+	struct list_head *queue;
 	struct process *process;
 	struct process_descriptor *desc;
+	union profiler profiler;
 	void *object;
 
-	if ( ( process = list_first_entry ( &run_queue, struct process,
-					    list ) ) ) {
-		ref_get ( process->refcnt ); /* Inhibit destruction mid-step */
-		desc = process->desc;
-		object = process_object ( process );
-		if ( desc->reschedule ) {
-			list_del ( &process->list );
-			list_add_tail ( &process->list, &run_queue );
-		} else {
-			process_del ( process );
-		}
-		DBGC2 ( PROC_COL ( process ), "PROCESS " PROC_FMT
-			" executing\n", PROC_DBG ( process ) );
-		desc->step ( object );
-		DBGC2 ( PROC_COL ( process ), "PROCESS " PROC_FMT
-			" finished executing\n", PROC_DBG ( process ) );
-		ref_put ( process->refcnt ); /* Allow destruction */
+	/* Wake up any processes whose sleep timeout has expired.
+	 * Avoid reading the timer unless there are sleepers, since
+	 * currticks() may be expensive (e.g. a real-mode transition
+	 * under BIOS).
+	 */
+	if ( ! list_empty ( &process_sleep_queue ) )
+		process_wake_expired ( currticks() );
+
+	/* Select process to step */
+	if ( ! ( queue = process_select() ) )
+		return;
+	process = list_first_entry ( queue, struct process, list );
+
+	ref_get ( process->refcnt ); /* Inhibit destruction mid-step */
+	desc = process->desc;
+	object = process_object ( process );
+	if ( desc->reschedule ) {
+		list_del ( &process->list );
+		list_add_tail ( &process->list, queue );
+	} else {
+		process_del ( process );
 	}
+	DBGC2 ( PROC_COL ( process ), "PROCESS " PROC_FMT
+		" executing\n", PROC_DBG ( process ) );
+	profile ( &profiler );
+	desc->step ( object );
+	process->time += profile ( &profiler );
+	DBGC2 ( PROC_COL ( process ), "PROCESS " PROC_FMT
+		" finished executing\n", PROC_DBG ( process ) );
+	process->steps++;
+	ref_put ( process->refcnt ); /* Allow destruction */
 }
 
 /**
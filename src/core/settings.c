@@ -237,6 +237,59 @@ struct generic_settings generic_settings_root = {
 /** Root settings block */
 #define settings_root generic_settings_root.settings
 
+/** Settings tree generation
+ *
+ * This is incremented whenever any setting is stored or cleared, and
+ * whenever any settings block is registered or unregistered.  It is
+ * never zero.
+ */
+static unsigned int settings_generation = 1;
+
+/**
+ * Record a change to the settings tree
+ *
+ */
+static void settings_changed ( void ) {
+
+	/* Invalidate all cached lookups, skipping the invalid value zero */
+	if ( ! ++settings_generation )
+		settings_generation++;
+}
+
+/** Number of entries in settings fetch cache (must be a power of two) */
+#define SETTINGS_CACHE_SIZE 32
+
+/** A settings fetch cache entry */
+struct settings_cache_entry {
+	/** Settings tree generation, or zero if entry is invalid */
+	unsigned int generation;
+	/** Settings block from which lookup started */
+	struct settings *settings;
+	/** Setting tag */
+	unsigned int tag;
+	/** Setting name */
+	char name[24];
+	/** Origin of setting, or NULL if setting does not exist */
+	struct settings *origin;
+};
+
+/** Settings fetch cache */
+static struct settings_cache_entry settings_cache[SETTINGS_CACHE_SIZE];
+
+/**
+ * Calculate setting name hash
+ *
+ * @v name		Name
+ * @ret hash		Hash value
+ */
+static unsigned int setting_name_hash ( const char *name ) {
+	unsigned int hash = 0;
+
+	while ( *name )
+		hash = ( ( hash * 31 ) + *( name++ ) );
+	return hash;
+}
+
 /** Autovivified settings block */
 struct autovivified_settings {
 	/** Reference count */
@@ -475,6 +528,7 @@ int register_settings ( struct settings *settings, struct settings *parent,
 	ref_get ( parent->refcnt );
 	settings->parent = parent;
 	list_add_tail ( &settings->siblings, &parent->children );
+	settings_changed();
 	DBGC ( settings, "Settings %p (\"%s\") registered\n",
 	       settings, settings_name ( settings ) );
 
@@ -508,6 +562,7 @@ void unregister_settings ( struct settings *settings ) {
 	ref_put ( settings->parent->refcnt );
 	settings->parent = NULL;
 	list_del ( &settings->siblings );
+	settings_changed();
 	ref_put ( settings->refcnt );
 
 	/* Apply potentially-updated settings */
@@ -560,8 +615,9 @@ int store_setting ( struct settings *settings, struct setting *setting,
 		return -ENOTSUP;
 
 	/* Store setting */
-	if ( ( rc = settings->op->store ( settings, setting,
-					  data, len ) ) != 0 )
+	rc = settings->op->store ( settings, setting, data, len );
+	settings_changed();
+	if ( rc != 0 )
 		return rc;
 
 	/* Reprioritise settings if necessary */
@@ -583,33 +639,25 @@ int store_setting ( struct settings *settings, struct setting *setting,
 }
 
 /**
- * Fetch value and origin of setting
+ * Search settings tree for value and origin of setting
  *
- * @v settings		Settings block, or NULL to search all blocks
+ * @v settings		Settings block
  * @v setting		Setting to fetch
  * @v origin		Origin of setting to fill in
  * @v data		Buffer to fill with setting data
  * @v len		Length of buffer
  * @ret len		Length of setting data, or negative error
- *
- * The actual length of the setting will be returned even if
- * the buffer was too small.
  */
-static int fetch_setting_and_origin ( struct settings *settings,
-				      struct setting *setting,
-				      struct settings **origin,
-				      void *data, size_t len ) {
+static int fetch_setting_in_tree ( struct settings *settings,
+				   struct setting *setting,
+				   struct settings **origin,
+				   void *data, size_t len ) {
 	struct settings *child;
 	int ret;
 
 	/* Avoid returning uninitialised data on error */
 	memset ( data, 0, len );
-	if ( origin )
-		*origin = NULL;
-
-	/* NULL settings implies starting at the global settings root */
-	if ( ! settings )
-		settings = &settings_root;
+	*origin = NULL;
 
 	/* Sanity check */
 	if ( ! settings->op->fetch )
@@ -619,25 +667,140 @@ static int fetch_setting_and_origin ( struct settings *settings,
 	if ( setting_applies ( settings, setting ) &&
 	     ( ( ret = settings->op->fetch ( settings, setting,
 					     data, len ) ) >= 0 ) ) {
-		/* Record origin, if applicable */
-		if ( origin )
-			*origin = settings;
-		/* Default to string setting type, if not yet specified */
-		if ( ! setting->type )
-			setting->type = &setting_type_string;
+		/* Record origin */
+		*origin = settings;
 		return ret;
 	}
 
 	/* Recurse into each child block in turn */
 	list_for_each_entry ( child, &settings->children, siblings ) {
-		if ( ( ret = fetch_setting_and_origin ( child, setting, origin,
-							data, len ) ) >= 0 )
+		if ( ( ret = fetch_setting_in_tree ( child, setting, origin,
+						     data, len ) ) >= 0 )
 			return ret;
 	}
 
 	return -ENOENT;
 }
 
+/**
+ * Find settings fetch cache entry
+ *
+ * @v settings		Settings block
+ * @v setting		Setting to fetch
+ * @ret entry		Cache entry, or NULL if lookup cannot be cached
+ *
+ * Only lookups starting from a registered settings block are cached,
+ * since an unregistered block may be freed (and its address reused)
+ * without any change to the settings tree.
+ */
+static struct settings_cache_entry *
+settings_cache_entry ( struct settings *settings, struct setting *setting ) {
+	const char *name = ( setting->name ? setting->name : "" );
+	unsigned int hash;
+
+	/* Check that lookup can be cached */
+	if ( ( settings != &settings_root ) && ( ! settings->parent ) )
+		return NULL;
+	if ( strlen ( name ) >= sizeof ( settings_cache[0].name ) )
+		return NULL;
+
+	/* Identify cache entry */
+	hash = ( setting->tag ? setting->tag : setting_name_hash ( name ) );
+	hash ^= ( ( ( intptr_t ) settings ) >> 4 );
+	hash ^= ( hash >> 16 );
+	hash ^= ( hash >> 8 );
+	return &settings_cache[ hash % SETTINGS_CACHE_SIZE ];
+}
+
+/**
+ * Check for settings fetch cache hit
+ *
+ * @v entry		Cache entry
+ * @v settings		Settings block
+ * @v setting		Setting to fetch
+ * @ret hit		Cache entry matches lookup
+ */
+static int settings_cache_hit ( struct settings_cache_entry *entry,
+				struct settings *settings,
+				struct setting *setting ) {
+	const char *name = ( setting->name ? setting->name : "" );
+
+	return ( ( entry->generation == settings_generation ) &&
+		 ( entry->settings == settings ) &&
+		 ( entry->tag == setting->tag ) &&
+		 ( strcmp ( entry->name, name ) == 0 ) );
+}
+
+/**
+ * Fetch value and origin of setting
+ *
+ * @v settings		Settings block, or NULL to search all blocks
+ * @v setting		Setting to fetch
+ * @v origin		Origin of setting to fill in
+ * @v data		Buffer to fill with setting data
+ * @v len		Length of buffer
+ * @ret len		Length of setting data, or negative error
+ *
+ * The actual length of the setting will be returned even if
+ * the buffer was too small.
+ *
+ * The origin of each setting (or its absence) is cached until the
+ * settings tree next changes, so that repeated lookups need not
+ * search the whole tree.  The value itself is always fetched from
+ * the origin, since some settings blocks (such as the built-in
+ * settings) generate values dynamically.
+ */
+static int fetch_setting_and_origin ( struct settings *settings,
+				      struct setting *setting,
+				      struct settings **origin,
+				      void *data, size_t len ) {
+	struct settings_cache_entry *entry;
+	struct settings *found = NULL;
+	int ret;
+
+	/* NULL settings implies starting at the global settings root */
+	if ( ! settings )
+		settings = &settings_root;
+
+	/* Use cached origin, if available */
+	entry = settings_cache_entry ( settings, setting );
+	if ( entry && settings_cache_hit ( entry, settings, setting ) ) {
+		found = entry->origin;
+		if ( ! found ) {
+			memset ( data, 0, len );
+			ret = -ENOENT;
+			goto done;
+		}
+		memset ( data, 0, len );
+		if ( ( ret = found->op->fetch ( found, setting,
+						data, len ) ) >= 0 )
+			goto done;
+	}
+
+	/* Otherwise, search the settings tree */
+	ret = fetch_setting_in_tree ( settings, setting, &found, data, len );
+
+	/* Cache origin, if applicable */
+	if ( entry && ( ( ret >= 0 ) || ( ret == -ENOENT ) ) ) {
+		entry->generation = settings_generation;
+		entry->settings = settings;
+		entry->tag = setting->tag;
+		strcpy ( entry->name, ( setting->name ? setting->name : "" ) );
+		entry->origin = found;
+	}
+
+ done:
+	/* Record origin, if applicable */
+	if ( origin )
+		*origin = found;
+
+	/* Default to string setting type, if not yet specified */
+	if ( ( ret >= 0 ) && ( ! setting->type ) )
+		setting->type = &setting_type_string;
+
+	return ret;
+}
+
 /**
  * Fetch value of setting
  *
@@ -971,6 +1134,7 @@ int fetch_uuid_setting ( struct settings *settings, struct setting *setting,
 void clear_settings ( struct settings *settings ) {
 	if ( settings->op->clear )
 		settings->op->clear ( settings );
+	settings_changed();
 }
 
 /**
@@ -1080,6 +1244,52 @@ int storef_setting ( struct settings *settings, struct setting *setting,
  ******************************************************************************
  */
 
+/** Index of named settings, by name hash */
+static struct setting **settings_index;
+
+/** Size of named settings index (a power of two) */
+static unsigned int settings_index_size;
+
+/**
+ * Construct index of named settings
+ *
+ * @ret rc		Return status code
+ *
+ * The index is an open-addressed hash table containing each entry in
+ * the settings table.  Where several entries share a name, only the
+ * first (i.e. the one that a linear search would find) is indexed.
+ */
+static int index_settings ( void ) {
+	struct setting *setting;
+	struct setting *existing;
+	unsigned int size = 1;
+	unsigned int i;
+
+	/* Allocate index with a load factor of at most one half */
+	while ( size < ( 2 * table_num_entries ( SETTINGS ) ) )
+		size <<= 1;
+	settings_index = zalloc ( size * sizeof ( settings_index[0] ) );
+	if ( ! settings_index )
+		return -ENOMEM;
+	settings_index_size = size;
+
+	/* Add each named setting */
+	for_each_table_entry ( setting, SETTINGS ) {
+		if ( ! setting->name )
+			continue;
+		i = setting_name_hash ( setting->name );
+		while ( ( existing = settings_index[ i & ( size - 1 ) ] ) ) {
+			if ( strcmp ( existing->name, setting->name ) == 0 )
+				break;
+			i++;
+		}
+		if ( ! existing )
+			settings_index[ i & ( size - 1 ) ] = setting;
+	}
+
+	return 0;
+}
+
 /**
  * Find named setting
  *
@@ -1088,7 +1298,21 @@ int storef_setting ( struct settings *settings, struct setting *setting,
  */
 struct setting * find_setting ( const char *name ) {
 	struct setting *setting;
+	unsigned int i;
+
+	/* Use index, if available */
+	if ( settings_index || ( index_settings() == 0 ) ) {
+		i = setting_name_hash ( name );
+		while ( ( setting = settings_index[ i & ( settings_index_size
+							  - 1 ) ] ) ) {
+			if ( strcmp ( name, setting->name ) == 0 )
+				return setting;
+			i++;
+		}
+		return NULL;
+	}
 
+	/* Otherwise, fall back to a linear search */
 	for_each_table_entry ( setting, SETTINGS ) {
 		if ( strcmp ( name, setting->name ) == 0 )
 			return setting;
@@ -20,6 +20,7 @@
 FILE_LICENCE ( GPL2_OR_LATER );
 
 #include <unistd.h>
+#include <ipxe/timer.h>
 
 /**
  * Delay for a fixed number of milliseconds
@@ -41,3 +42,15 @@ unsigned int sleep ( unsigned int secs ) {
 		mdelay ( 1000 );
 	return 0;
 }
+
+/**
+ * Get CPU time consumed
+ *
+ * @ret usecs		CPU time consumed, in microseconds, or zero if unknown
+ *
+ * Platforms able to distinguish CPU time from elapsed time (such as
+ * Linux userspace) may override this.
+ */
+__weak unsigned long cpu_usecs ( void ) {
+	return 0;
+}
@@ -148,6 +148,64 @@ void xfer_window_changed ( struct interface *intf ) {
 	intf_put ( dest );
 }
 
+/**
+ * Check whether recipient requires data in order
+ *
+ * @v intf		Data transfer interface
+ * @ret sequential	Recipient requires data to be delivered in order
+ *
+ * A recipient that processes data as a stream (e.g. a decompressor)
+ * cannot make use of data delivered ahead of the current position.
+ * Senders that are able to fetch data out of order (e.g. by opening
+ * multiple connections) should use this to avoid doing so.
+ */
+int xfer_sequential ( struct interface *intf ) {
+	struct interface *dest;
+	xfer_sequential_TYPE ( void * ) *op =
+		intf_get_dest_op ( intf, xfer_sequential, &dest );
+	void *object = intf_object ( dest );
+	int sequential;
+
+	if ( op ) {
+		sequential = op ( object );
+	} else {
+		/* Default is to accept data in any order */
+		sequential = 0;
+	}
+
+	intf_put ( dest );
+	return sequential;
+}
+
+/**
+ * Check whether recipient will decompress received data
+ *
+ * @v intf		Data transfer interface
+ * @ret decompressing	Recipient will decompress received data
+ *
+ * Compressed data is decoded only when the consumer has explicitly
+ * asked for decompression (e.g. via "imgfetch --decompress"), by
+ * placing a decompressor in front of itself.  Senders may use this
+ * to determine whether or not to request compressed content.
+ */
+int xfer_decompressing ( struct interface *intf ) {
+	struct interface *dest;
+	xfer_decompressing_TYPE ( void * ) *op =
+		intf_get_dest_op ( intf, xfer_decompressing, &dest );
+	void *object = intf_object ( dest );
+	int decompressing;
+
+	if ( op ) {
+		decompressing = op ( object );
+	} else {
+		/* Default is to leave data as received */
+		decompressing = 0;
+	}
+
+	intf_put ( dest );
+	return decompressing;
+}
+
 /**
  * Allocate I/O buffer
  *
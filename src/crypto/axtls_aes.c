@@ -34,6 +34,13 @@ FILE_LICENCE ( GPL2_OR_LATER );
  *
  */
 
+/** Accelerated AES implementation (if any)
+ *
+ * This may be set at startup by an implementation using CPU-specific
+ * instructions.
+ */
+struct aes_accelerator *aes_accel;
+
 /**
  * Set key
  *
@@ -67,6 +74,11 @@ static int aes_setkey ( void *ctx, const void *key, size_t keylen ) {
 
 	aes_ctx->decrypting = 0;
 
+	/* Prepare accelerated implementation, if available */
+	aes_ctx->accel = aes_accel;
+	if ( aes_ctx->accel )
+		aes_ctx->accel->setkey ( aes_ctx );
+
 	return 0;
 }
 
@@ -119,6 +131,10 @@ static void aes_encrypt ( void *ctx, const void *src, void *dst,
 	struct aes_context *aes_ctx = ctx;
 
 	assert ( len == AES_BLOCKSIZE );
+	if ( aes_ctx->accel ) {
+		aes_ctx->accel->encrypt ( aes_ctx, src, dst );
+		return;
+	}
 	if ( aes_ctx->decrypting )
 		assert ( 0 );
 	aes_call_axtls ( &aes_ctx->axtls_ctx, src, dst, axtls_aes_encrypt );
@@ -137,6 +153,10 @@ static void aes_decrypt ( void *ctx, const void *src, void *dst,
 	struct aes_context *aes_ctx = ctx;
 
 	assert ( len == AES_BLOCKSIZE );
+	if ( aes_ctx->accel ) {
+		aes_ctx->accel->decrypt ( aes_ctx, src, dst );
+		return;
+	}
 	if ( ! aes_ctx->decrypting ) {
 		AES_convert_key ( &aes_ctx->axtls_ctx );
 		aes_ctx->decrypting = 1;
@@ -155,6 +175,99 @@ struct cipher_algorithm aes_algorithm = {
 	.decrypt = aes_decrypt,
 };
 
-/* AES with cipher-block chaining */
-CBC_CIPHER ( aes_cbc, aes_cbc_algorithm,
-	     aes_algorithm, struct aes_context, AES_BLOCKSIZE );
+/** AES-CBC context */
+struct aes_cbc_context {
+	/** AES context */
+	struct aes_context raw_ctx;
+	/** CBC context */
+	uint8_t cbc_ctx[AES_BLOCKSIZE];
+};
+
+/**
+ * Set AES-CBC key
+ *
+ * @v ctx		Context
+ * @v key		Key
+ * @v keylen		Key length
+ * @ret rc		Return status code
+ */
+static int aes_cbc_setkey ( void *ctx, const void *key, size_t keylen ) {
+	struct aes_cbc_context *aes_cbc_ctx = ctx;
+
+	return cbc_setkey ( &aes_cbc_ctx->raw_ctx, key, keylen,
+			    &aes_algorithm, aes_cbc_ctx->cbc_ctx );
+}
+
+/**
+ * Set AES-CBC initialisation vector
+ *
+ * @v ctx		Context
+ * @v iv		Initialisation vector
+ */
+static void aes_cbc_setiv ( void *ctx, const void *iv ) {
+	struct aes_cbc_context *aes_cbc_ctx = ctx;
+
+	cbc_setiv ( &aes_cbc_ctx->raw_ctx, iv, &aes_algorithm,
+		    aes_cbc_ctx->cbc_ctx );
+}
+
+/**
+ * Encrypt AES-CBC data
+ *
+ * @v ctx		Context
+ * @v src		Data to encrypt
+ * @v dst		Buffer for encrypted data
+ * @v len		Length of data
+ */
+static void aes_cbc_encrypt ( void *ctx, const void *src, void *dst,
+			      size_t len ) {
+	struct aes_cbc_context *aes_cbc_ctx = ctx;
+	struct aes_context *aes_ctx = &aes_cbc_ctx->raw_ctx;
+
+	/* Use accelerated implementation, if available */
+	if ( aes_ctx->accel ) {
+		assert ( ( len % AES_BLOCKSIZE ) == 0 );
+		aes_ctx->accel->cbc_encrypt ( aes_ctx, src, dst, len,
+					      aes_cbc_ctx->cbc_ctx );
+		return;
+	}
+
+	cbc_encrypt ( aes_ctx, src, dst, len, &aes_algorithm,
+		      aes_cbc_ctx->cbc_ctx );
+}
+
+/**
+ * Decrypt AES-CBC data
+ *
+ * @v ctx		Context
+ * @v src		Data to decrypt
+ * @v dst		Buffer for decrypted data
+ * @v len		Length of data
+ */
+static void aes_cbc_decrypt ( void *ctx, const void *src, void *dst,
+			      size_t len ) {
+	struct aes_cbc_context *aes_cbc_ctx = ctx;
+	struct aes_context *aes_ctx = &aes_cbc_ctx->raw_ctx;
+
+	/* Use accelerated implementation, if available */
+	if ( aes_ctx->accel ) {
+		assert ( ( len % AES_BLOCKSIZE ) == 0 );
+		aes_ctx->accel->cbc_decrypt ( aes_ctx, src, dst, len,
+					      aes_cbc_ctx->cbc_ctx );
+		return;
+	}
+
+	cbc_decrypt ( aes_ctx, src, dst, len, &aes_algorithm,
+		      aes_cbc_ctx->cbc_ctx );
+}
+
+/** AES with cipher-block chaining */
+struct cipher_algorithm aes_cbc_algorithm = {
+	.name		= "aes_cbc",
+	.ctxsize	= sizeof ( struct aes_cbc_context ),
+	.blocksize	= AES_BLOCKSIZE,
+	.setkey		= aes_cbc_setkey,
+	.setiv		= aes_cbc_setiv,
+	.encrypt	= aes_cbc_encrypt,
+	.decrypt	= aes_cbc_decrypt,
+};
@@ -21,10 +21,98 @@
 
 FILE_LICENCE ( GPL2_OR_LATER );
 
+#include <string.h>
+#include <byteswap.h>
 #include <ipxe/crc32.h>
 
 #define CRCPOLY		0xedb88320
 
+/**
+ * CRC32 lookup tables
+ *
+ * Table @c n holds the CRC of each byte value followed by @c n zero
+ * bytes, allowing eight bytes to be processed at a time
+ * ("slicing-by-8").  The tables are generated on first use rather
+ * than being stored in the binary.
+ */
+static u32 crc32_table[8][256];
+
+/**
+ * Generate CRC32 lookup tables
+ *
+ */
+static void crc32_init_tables ( void ) {
+	u32 crc;
+	unsigned int i;
+	unsigned int j;
+
+	for ( i = 0 ; i < 256 ; i++ ) {
+		crc = i;
+		for ( j = 0 ; j < 8 ; j++ )
+			crc = ( ( crc >> 1 ) ^ ( ( crc & 1 ) ? CRCPOLY : 0 ) );
+		crc32_table[0][i] = crc;
+	}
+	for ( i = 0 ; i < 256 ; i++ ) {
+		crc = crc32_table[0][i];
+		for ( j = 1 ; j < 8 ; j++ ) {
+			crc = ( ( crc >> 8 ) ^ crc32_table[0][ crc & 0xff ] );
+			crc32_table[j][i] = crc;
+		}
+	}
+}
+
+/**
+ * Calculate 32-bit little-endian CRC checksum using generic code
+ *
+ * @v seed	Initial value
+ * @v data	Data to checksum
+ * @v len	Length of data
+ * @ret crc	CRC checksum
+ */
+u32 crc32_le_generic ( u32 seed, const void *data, size_t len ) {
+	u32 crc = seed;
+	const u8 *src = data;
+	u32 lo;
+	u32 hi;
+
+	/* Generate tables on first use (crc32_table[0][0] is
+	 * always zero, but crc32_table[0][1] is not).
+	 */
+	if ( ! crc32_table[0][1] )
+		crc32_init_tables();
+
+	/* Process eight bytes at a time */
+	for ( ; len >= 8 ; len -= 8, src += 8 ) {
+		memcpy ( &lo, src, sizeof ( lo ) );
+		memcpy ( &hi, ( src + sizeof ( lo ) ), sizeof ( hi ) );
+		lo = ( crc ^ le32_to_cpu ( lo ) );
+		hi = le32_to_cpu ( hi );
+		crc = ( crc32_table[7][ lo & 0xff ] ^
+			crc32_table[6][ ( lo >> 8 ) & 0xff ] ^
+			crc32_table[5][ ( lo >> 16 ) & 0xff ] ^
+			crc32_table[4][ lo >> 24 ] ^
+			crc32_table[3][ hi & 0xff ] ^
+			crc32_table[2][ ( hi >> 8 ) & 0xff ] ^
+			crc32_table[1][ ( hi >> 16 ) & 0xff ] ^
+			crc32_table[0][ hi >> 24 ] );
+	}
+
+	/* Process any remaining bytes individually */
+	for ( ; len ; len-- ) {
+		crc = ( ( crc >> 8 ) ^
+			crc32_table[0][ ( crc ^ *(src++) ) & 0xff ] );
+	}
+
+	return crc;
+}
+
+/** Accelerated CRC32 implementation (if any)
+ *
+ * This may be set at startup by an implementation using CPU-specific
+ * instructions.
+ */
+crc32_le_t *crc32_le_accel;
+
 /**
  * Calculate 32-bit little-endian CRC checksum
  *
@@ -38,18 +126,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
  */
 u32 crc32_le ( u32 seed, const void *data, size_t len )
 {
-	u32 crc = seed;
-	const u8 *src = data;
-	u32 mult;
-	int i;
-
-	while ( len-- ) {
-		crc ^= *src++;
-		for ( i = 0; i < 8; i++ ) {
-			mult = ( crc & 1 ) ? CRCPOLY : 0;
-			crc = ( crc >> 1 ) ^ mult;
-		}
-	}
-
-	return crc;
+	if ( crc32_le_accel )
+		return crc32_le_accel ( seed, data, len );
+	return crc32_le_generic ( seed, data, len );
 }
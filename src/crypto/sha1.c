@@ -34,165 +34,147 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/asn1.h>
 #include <ipxe/sha1.h>
 
-/** SHA-1 variables */
-struct sha1_variables {
-	/* This layout matches that of struct sha1_digest_data,
-	 * allowing for efficient endianness-conversion,
-	 */
-	uint32_t a;
-	uint32_t b;
-	uint32_t c;
-	uint32_t d;
-	uint32_t e;
-	uint32_t w[80];
-} __attribute__ (( packed ));
-
 /**
- * f(a,b,c,d) for steps 0 to 19
+ * f(b,c,d) for steps 0 to 19
  *
- * @v v		SHA-1 variables
- * @ret f	f(a,b,c,d)
+ * This is equivalent to ( ( b & c ) | ( (~b) & d ) ).
  */
-static uint32_t sha1_f_0_19 ( struct sha1_variables *v ) {
-	return ( ( v->b & v->c ) | ( (~v->b) & v->d ) );
-}
+#define SHA1_F_0_19( b, c, d ) ( (d) ^ ( (b) & ( (c) ^ (d) ) ) )
 
-/**
- * f(a,b,c,d) for steps 20 to 39 and 60 to 79
- *
- * @v v		SHA-1 variables
- * @ret f	f(a,b,c,d)
- */
-static uint32_t sha1_f_20_39_60_79 ( struct sha1_variables *v ) {
-	return ( v->b ^ v->c ^ v->d );
-}
+/** f(b,c,d) for steps 20 to 39 and 60 to 79 */
+#define SHA1_F_20_39_60_79( b, c, d ) ( (b) ^ (c) ^ (d) )
 
 /**
- * f(a,b,c,d) for steps 40 to 59
+ * f(b,c,d) for steps 40 to 59
  *
- * @v v		SHA-1 variables
- * @ret f	f(a,b,c,d)
+ * This is equivalent to ( ( b & c ) | ( b & d ) | ( c & d ) ).
  */
-static uint32_t sha1_f_40_59 ( struct sha1_variables *v ) {
-	return ( ( v->b & v->c ) | ( v->b & v->d ) | ( v->c & v->d ) );
-}
+#define SHA1_F_40_59( b, c, d ) ( ( (b) & (c) ) | ( (d) & ( (b) | (c) ) ) )
 
-/** An SHA-1 step function */
-struct sha1_step {
-	/**
-	 * Calculate f(a,b,c,d)
-	 *
-	 * @v v		SHA-1 variables
-	 * @ret f	f(a,b,c,d)
-	 */
-	uint32_t ( * f ) ( struct sha1_variables *v );
-	/** Constant k */
-	uint32_t k;
-};
+/** Constant k for steps 0 to 19 */
+#define SHA1_K_0_19 0x5a827999
 
-/** SHA-1 steps */
-static struct sha1_step sha1_steps[4] = {
-	/** 0 to 19 */
-	{ .f = sha1_f_0_19,		.k = 0x5a827999 },
-	/** 20 to 39 */
-	{ .f = sha1_f_20_39_60_79,	.k = 0x6ed9eba1 },
-	/** 40 to 59 */
-	{ .f = sha1_f_40_59,		.k = 0x8f1bbcdc },
-	/** 60 to 79 */
-	{ .f = sha1_f_20_39_60_79,	.k = 0xca62c1d6 },
-};
+/** Constant k for steps 20 to 39 */
+#define SHA1_K_20_39 0x6ed9eba1
+
+/** Constant k for steps 40 to 59 */
+#define SHA1_K_40_59 0x8f1bbcdc
+
+/** Constant k for steps 60 to 79 */
+#define SHA1_K_60_79 0xca62c1d6
 
 /**
- * Initialise SHA-1 algorithm
+ * Perform SHA-1 step
  *
- * @v ctx		SHA-1 context
+ * @v a, b, c, d, e	SHA-1 variables
+ * @v f			f(b,c,d) function
+ * @v k			Constant k
+ * @v w			Message schedule word
+ *
+ * Rather than moving each variable along by one position, the new
+ * value of a is accumulated into e and the caller rotates the
+ * variable names.
  */
-static void sha1_init ( void *ctx ) {
-	struct sha1_context *context = ctx;
+#define SHA1_STEP( a, b, c, d, e, f, k, w ) do {			\
+	(e) += ( rol32 ( (a), 5 ) + f ( (b), (c), (d) ) + (k) + (w) );	\
+	(b) = rol32 ( (b), 30 );					\
+	} while ( 0 )
 
-	context->ddd.dd.digest.h[0] = cpu_to_be32 ( 0x67452301 );
-	context->ddd.dd.digest.h[1] = cpu_to_be32 ( 0xefcdab89 );
-	context->ddd.dd.digest.h[2] = cpu_to_be32 ( 0x98badcfe );
-	context->ddd.dd.digest.h[3] = cpu_to_be32 ( 0x10325476 );
-	context->ddd.dd.digest.h[4] = cpu_to_be32 ( 0xc3d2e1f0 );
-	context->len = 0;
-}
+/**
+ * Perform five SHA-1 steps
+ *
+ * @v f			f(b,c,d) function
+ * @v k			Constant k
+ * @v w			Message schedule words
+ *
+ * After five steps, each variable name is once again in its
+ * original position.
+ */
+#define SHA1_STEP5( f, k, w ) do {					\
+	SHA1_STEP ( a, b, c, d, e, f, k, (w)[0] );			\
+	SHA1_STEP ( e, a, b, c, d, f, k, (w)[1] );			\
+	SHA1_STEP ( d, e, a, b, c, f, k, (w)[2] );			\
+	SHA1_STEP ( c, d, e, a, b, f, k, (w)[3] );			\
+	SHA1_STEP ( b, c, d, e, a, f, k, (w)[4] );			\
+	} while ( 0 )
 
 /**
- * Calculate SHA-1 digest of accumulated data
+ * Process SHA-1 data blocks using generic code
  *
- * @v context		SHA-1 context
+ * @v digest		Digest (in host-endian order)
+ * @v data		Data blocks
+ * @v count		Number of blocks
  */
-static void sha1_digest ( struct sha1_context *context ) {
-        union {
-		union sha1_digest_data_dwords ddd;
-		struct sha1_variables v;
-	} u;
-	uint32_t *a = &u.v.a;
-	uint32_t *b = &u.v.b;
-	uint32_t *c = &u.v.c;
-	uint32_t *d = &u.v.d;
-	uint32_t *e = &u.v.e;
-	uint32_t *w = u.v.w;
-	uint32_t f;
-	uint32_t k;
-	uint32_t temp;
-	struct sha1_step *step;
+void sha1_blocks_generic ( struct sha1_digest *digest, const void *data,
+			   size_t count ) {
+	uint32_t w[80];
+	uint32_t a;
+	uint32_t b;
+	uint32_t c;
+	uint32_t d;
+	uint32_t e;
 	unsigned int i;
 
-	/* Sanity checks */
-	assert ( ( context->len % sizeof ( context->ddd.dd.data ) ) == 0 );
-	linker_assert ( &u.ddd.dd.digest.h[0] == a, sha1_bad_layout );
-	linker_assert ( &u.ddd.dd.digest.h[1] == b, sha1_bad_layout );
-	linker_assert ( &u.ddd.dd.digest.h[2] == c, sha1_bad_layout );
-	linker_assert ( &u.ddd.dd.digest.h[3] == d, sha1_bad_layout );
-	linker_assert ( &u.ddd.dd.digest.h[4] == e, sha1_bad_layout );
-	linker_assert ( &u.ddd.dd.data.dword[0] == w, sha1_bad_layout );
-
-	DBGC ( context, "SHA1 digesting:\n" );
-	DBGC_HDA ( context, 0, &context->ddd.dd.digest,
-		   sizeof ( context->ddd.dd.digest ) );
-	DBGC_HDA ( context, context->len, &context->ddd.dd.data,
-		   sizeof ( context->ddd.dd.data ) );
-
-	/* Convert h[0..4] to host-endian, and initialise a, b, c, d,
-	 * e, and w[0..15]
-	 */
-	for ( i = 0 ; i < ( sizeof ( u.ddd.dword ) /
-			    sizeof ( u.ddd.dword[0] ) ) ; i++ ) {
-		be32_to_cpus ( &context->ddd.dword[i] );
-		u.ddd.dword[i] = context->ddd.dword[i];
-	}
+	for ( ; count ; count--, data += sizeof ( union sha1_block ) ) {
 
-	/* Initialise w[16..79] */
-	for ( i = 16 ; i < 80 ; i++ )
-		w[i] = rol32 ( ( w[i-3] ^ w[i-8] ^ w[i-14] ^ w[i-16] ), 1 );
-
-	/* Main loop */
-	for ( i = 0 ; i < 80 ; i++ ) {
-		step = &sha1_steps[ i / 20 ];
-		f = step->f ( &u.v );
-		k = step->k;
-		temp = ( rol32 ( *a, 5 ) + f + *e + k + w[i] );
-		*e = *d;
-		*d = *c;
-		*c = rol32 ( *b, 30 );
-		*b = *a;
-		*a = temp;
-		DBGC2 ( context, "%2d : %08x %08x %08x %08x %08x\n",
-			i, *a, *b, *c, *d, *e );
-	}
+		/* Initialise w[0..15] */
+		memcpy ( w, data, sizeof ( union sha1_block ) );
+		for ( i = 0 ; i < 16 ; i++ )
+			be32_to_cpus ( &w[i] );
 
-	/* Add chunk to hash and convert back to big-endian */
-	for ( i = 0 ; i < 5 ; i++ ) {
-		context->ddd.dd.digest.h[i] =
-			cpu_to_be32 ( context->ddd.dd.digest.h[i] +
-				      u.ddd.dd.digest.h[i] );
+		/* Initialise w[16..79] */
+		for ( i = 16 ; i < 80 ; i++ ) {
+			w[i] = rol32 ( ( w[i-3] ^ w[i-8] ^ w[i-14] ^
+					 w[i-16] ), 1 );
+		}
+
+		/* Initialise a, b, c, d, e */
+		a = digest->h[0];
+		b = digest->h[1];
+		c = digest->h[2];
+		d = digest->h[3];
+		e = digest->h[4];
+
+		/* Main loop */
+		for ( i = 0 ; i < 20 ; i += 5 )
+			SHA1_STEP5 ( SHA1_F_0_19, SHA1_K_0_19, &w[i] );
+		for ( ; i < 40 ; i += 5 )
+			SHA1_STEP5 ( SHA1_F_20_39_60_79, SHA1_K_20_39, &w[i] );
+		for ( ; i < 60 ; i += 5 )
+			SHA1_STEP5 ( SHA1_F_40_59, SHA1_K_40_59, &w[i] );
+		for ( ; i < 80 ; i += 5 )
+			SHA1_STEP5 ( SHA1_F_20_39_60_79, SHA1_K_60_79, &w[i] );
+
+		/* Add chunk to hash */
+		digest->h[0] += a;
+		digest->h[1] += b;
+		digest->h[2] += c;
+		digest->h[3] += d;
+		digest->h[4] += e;
 	}
+}
+
+/** SHA-1 block processing function
+ *
+ * This may be replaced at startup by an implementation using
+ * CPU-specific instructions.
+ */
+sha1_blocks_t *sha1_blocks = sha1_blocks_generic;
 
-	DBGC ( context, "SHA1 digested:\n" );
-	DBGC_HDA ( context, 0, &context->ddd.dd.digest,
-		   sizeof ( context->ddd.dd.digest ) );
+/**
+ * Initialise SHA-1 algorithm
+ *
+ * @v ctx		SHA-1 context
+ */
+static void sha1_init ( void *ctx ) {
+	struct sha1_context *context = ctx;
+
+	context->ddd.dd.digest.h[0] = 0x67452301;
+	context->ddd.dd.digest.h[1] = 0xefcdab89;
+	context->ddd.dd.digest.h[2] = 0x98badcfe;
+	context->ddd.dd.digest.h[3] = 0x10325476;
+	context->ddd.dd.digest.h[4] = 0xc3d2e1f0;
+	context->len = 0;
 }
 
 /**
@@ -204,19 +186,40 @@ static void sha1_digest ( struct sha1_context *context ) {
  */
 static void sha1_update ( void *ctx, const void *data, size_t len ) {
 	struct sha1_context *context = ctx;
-	const uint8_t *byte = data;
+	void *digest = &context->ddd.dd.digest;
+	void *block = &context->ddd.dd.data;
 	size_t offset;
+	size_t frag_len;
+	size_t count;
+
+	/* Complete any partially accumulated block */
+	offset = ( context->len % sizeof ( context->ddd.dd.data ) );
+	if ( offset ) {
+		frag_len = ( sizeof ( context->ddd.dd.data ) - offset );
+		if ( frag_len > len )
+			frag_len = len;
+		memcpy ( ( block + offset ), data, frag_len );
+		context->len += frag_len;
+		data += frag_len;
+		len -= frag_len;
+		if ( ( offset + frag_len ) < sizeof ( context->ddd.dd.data ) )
+			return;
+		sha1_blocks ( digest, block, 1 );
+	}
 
-	/* Accumulate data a byte at a time, performing the digest
-	 * whenever we fill the data buffer
-	 */
-	while ( len-- ) {
-		offset = ( context->len % sizeof ( context->ddd.dd.data ) );
-		context->ddd.dd.data.byte[offset] = *(byte++);
-		context->len++;
-		if ( ( context->len % sizeof ( context->ddd.dd.data ) ) == 0 )
-			sha1_digest ( context );
+	/* Process whole blocks directly from the data buffer */
+	count = ( len / sizeof ( context->ddd.dd.data ) );
+	if ( count ) {
+		frag_len = ( count * sizeof ( context->ddd.dd.data ) );
+		sha1_blocks ( digest, data, count );
+		context->len += frag_len;
+		data += frag_len;
+		len -= frag_len;
 	}
+
+	/* Accumulate any remaining data */
+	memcpy ( block, data, len );
+	context->len += len;
 }
 
 /**
@@ -229,6 +232,7 @@ static void sha1_final ( void *ctx, void *out ) {
 	struct sha1_context *context = ctx;
 	uint64_t len_bits;
 	uint8_t pad;
+	unsigned int i;
 
 	/* Record length before pre-processing */
 	len_bits = cpu_to_be64 ( ( ( uint64_t ) context->len ) * 8 );
@@ -245,7 +249,12 @@ static void sha1_final ( void *ctx, void *out ) {
 	sha1_update ( ctx, &len_bits, sizeof ( len_bits ) );
 	assert ( ( context->len % sizeof ( context->ddd.dd.data ) ) == 0 );
 
-	/* Copy out final digest */
+	/* Convert digest to big-endian and copy out */
+	for ( i = 0 ; i < ( sizeof ( context->ddd.dd.digest.h ) /
+			    sizeof ( context->ddd.dd.digest.h[0] ) ) ; i++ ) {
+		context->ddd.dd.digest.h[i] =
+			cpu_to_be32 ( context->ddd.dd.digest.h[i] );
+	}
 	memcpy ( out, &context->ddd.dd.digest,
 		 sizeof ( context->ddd.dd.digest ) );
 }
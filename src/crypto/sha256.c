@@ -34,24 +34,8 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/asn1.h>
 #include <ipxe/sha256.h>
 
-/** SHA-256 variables */
-struct sha256_variables {
-	/* This layout matches that of struct sha256_digest_data,
-	 * allowing for efficient endianness-conversion,
-	 */
-	uint32_t a;
-	uint32_t b;
-	uint32_t c;
-	uint32_t d;
-	uint32_t e;
-	uint32_t f;
-	uint32_t g;
-	uint32_t h;
-	uint32_t w[64];
-} __attribute__ (( packed ));
-
 /** SHA-256 constants */
-static const uint32_t k[64] = {
+const uint32_t sha256_k[64] = {
 	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
 	0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
 	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
@@ -65,118 +49,153 @@ static const uint32_t k[64] = {
 	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
 };
 
+/** Sigma0(a) */
+#define SHA256_S0( a ) \
+	( ror32 ( (a), 2 ) ^ ror32 ( (a), 13 ) ^ ror32 ( (a), 22 ) )
+
+/** Sigma1(e) */
+#define SHA256_S1( e ) \
+	( ror32 ( (e), 6 ) ^ ror32 ( (e), 11 ) ^ ror32 ( (e), 25 ) )
+
 /**
- * Initialise SHA-256 algorithm
+ * Ch(e,f,g)
  *
- * @v ctx		SHA-256 context
+ * This is equivalent to ( ( e & f ) ^ ( (~e) & g ) ).
  */
-static void sha256_init ( void *ctx ) {
-	struct sha256_context *context = ctx;
+#define SHA256_CH( e, f, g ) ( (g) ^ ( (e) & ( (f) ^ (g) ) ) )
 
-	context->ddd.dd.digest.h[0] = cpu_to_be32 ( 0x6a09e667 );
-	context->ddd.dd.digest.h[1] = cpu_to_be32 ( 0xbb67ae85 );
-	context->ddd.dd.digest.h[2] = cpu_to_be32 ( 0x3c6ef372 );
-	context->ddd.dd.digest.h[3] = cpu_to_be32 ( 0xa54ff53a );
-	context->ddd.dd.digest.h[4] = cpu_to_be32 ( 0x510e527f );
-	context->ddd.dd.digest.h[5] = cpu_to_be32 ( 0x9b05688c );
-	context->ddd.dd.digest.h[6] = cpu_to_be32 ( 0x1f83d9ab );
-	context->ddd.dd.digest.h[7] = cpu_to_be32 ( 0x5be0cd19 );
-	context->len = 0;
-}
+/**
+ * Maj(a,b,c)
+ *
+ * This is equivalent to ( ( a & b ) ^ ( a & c ) ^ ( b & c ) ).
+ */
+#define SHA256_MAJ( a, b, c ) ( ( (a) & (b) ) | ( (c) & ( (a) | (b) ) ) )
+
+/**
+ * Perform SHA-256 step
+ *
+ * @v a, b, c, d, e, f, g, h	SHA-256 variables
+ * @v i			Step number
+ *
+ * Rather than moving each variable along by one position, the new
+ * values of a and e are accumulated into h and d, and the caller
+ * rotates the variable names.
+ */
+#define SHA256_STEP( a, b, c, d, e, f, g, h, i ) do {			\
+	t1 = ( (h) + SHA256_S1 ( e ) + SHA256_CH ( (e), (f), (g) ) +	\
+	       sha256_k[i] + w[i] );					\
+	(d) += t1;							\
+	(h) = ( t1 + SHA256_S0 ( a ) + SHA256_MAJ ( (a), (b), (c) ) );	\
+	} while ( 0 )
+
+/**
+ * Perform eight SHA-256 steps
+ *
+ * @v i			First step number
+ *
+ * After eight steps, each variable name is once again in its
+ * original position.
+ */
+#define SHA256_STEP8( i ) do {						\
+	SHA256_STEP ( a, b, c, d, e, f, g, h, ( (i) + 0 ) );		\
+	SHA256_STEP ( h, a, b, c, d, e, f, g, ( (i) + 1 ) );		\
+	SHA256_STEP ( g, h, a, b, c, d, e, f, ( (i) + 2 ) );		\
+	SHA256_STEP ( f, g, h, a, b, c, d, e, ( (i) + 3 ) );		\
+	SHA256_STEP ( e, f, g, h, a, b, c, d, ( (i) + 4 ) );		\
+	SHA256_STEP ( d, e, f, g, h, a, b, c, ( (i) + 5 ) );		\
+	SHA256_STEP ( c, d, e, f, g, h, a, b, ( (i) + 6 ) );		\
+	SHA256_STEP ( b, c, d, e, f, g, h, a, ( (i) + 7 ) );		\
+	} while ( 0 )
 
 /**
- * Calculate SHA-256 digest of accumulated data
+ * Process SHA-256 data blocks using generic code
  *
- * @v context		SHA-256 context
+ * @v digest		Digest (in host-endian order)
+ * @v data		Data blocks
+ * @v count		Number of blocks
  */
-static void sha256_digest ( struct sha256_context *context ) {
-        union {
-		union sha256_digest_data_dwords ddd;
-		struct sha256_variables v;
-	} u;
-	uint32_t *a = &u.v.a;
-	uint32_t *b = &u.v.b;
-	uint32_t *c = &u.v.c;
-	uint32_t *d = &u.v.d;
-	uint32_t *e = &u.v.e;
-	uint32_t *f = &u.v.f;
-	uint32_t *g = &u.v.g;
-	uint32_t *h = &u.v.h;
-	uint32_t *w = u.v.w;
+void sha256_blocks_generic ( struct sha256_digest *digest, const void *data,
+			     size_t count ) {
+	uint32_t w[64];
+	uint32_t a;
+	uint32_t b;
+	uint32_t c;
+	uint32_t d;
+	uint32_t e;
+	uint32_t f;
+	uint32_t g;
+	uint32_t h;
 	uint32_t s0;
 	uint32_t s1;
-	uint32_t maj;
 	uint32_t t1;
-	uint32_t t2;
-	uint32_t ch;
 	unsigned int i;
 
-	/* Sanity checks */
-	assert ( ( context->len % sizeof ( context->ddd.dd.data ) ) == 0 );
-	linker_assert ( &u.ddd.dd.digest.h[0] == a, sha256_bad_layout );
-	linker_assert ( &u.ddd.dd.digest.h[1] == b, sha256_bad_layout );
-	linker_assert ( &u.ddd.dd.digest.h[2] == c, sha256_bad_layout );
-	linker_assert ( &u.ddd.dd.digest.h[3] == d, sha256_bad_layout );
-	linker_assert ( &u.ddd.dd.digest.h[4] == e, sha256_bad_layout );
-	linker_assert ( &u.ddd.dd.digest.h[5] == f, sha256_bad_layout );
-	linker_assert ( &u.ddd.dd.digest.h[6] == g, sha256_bad_layout );
-	linker_assert ( &u.ddd.dd.digest.h[7] == h, sha256_bad_layout );
-	linker_assert ( &u.ddd.dd.data.dword[0] == w, sha256_bad_layout );
-
-	DBGC ( context, "SHA256 digesting:\n" );
-	DBGC_HDA ( context, 0, &context->ddd.dd.digest,
-		   sizeof ( context->ddd.dd.digest ) );
-	DBGC_HDA ( context, context->len, &context->ddd.dd.data,
-		   sizeof ( context->ddd.dd.data ) );
-
-	/* Convert h[0..7] to host-endian, and initialise a, b, c, d,
-	 * e, f, g, h, and w[0..15]
-	 */
-	for ( i = 0 ; i < ( sizeof ( u.ddd.dword ) /
-			    sizeof ( u.ddd.dword[0] ) ) ; i++ ) {
-		be32_to_cpus ( &context->ddd.dword[i] );
-		u.ddd.dword[i] = context->ddd.dword[i];
-	}
+	for ( ; count ; count--, data += sizeof ( union sha256_block ) ) {
 
-	/* Initialise w[16..63] */
-	for ( i = 16 ; i < 64 ; i++ ) {
-		s0 = ( ror32 ( w[i-15], 7 ) ^ ror32 ( w[i-15], 18 ) ^
-		       ( w[i-15] >> 3 ) );
-		s1 = ( ror32 ( w[i-2], 17 ) ^ ror32 ( w[i-2], 19 ) ^
-		       ( w[i-2] >> 10 ) );
-		w[i] = ( w[i-16] + s0 + w[i-7] + s1 );
-	}
+		/* Initialise w[0..15] */
+		memcpy ( w, data, sizeof ( union sha256_block ) );
+		for ( i = 0 ; i < 16 ; i++ )
+			be32_to_cpus ( &w[i] );
 
-	/* Main loop */
-	for ( i = 0 ; i < 64 ; i++ ) {
-		s0 = ( ror32 ( *a, 2 ) ^ ror32 ( *a, 13 ) ^ ror32 ( *a, 22 ) );
-		maj = ( ( *a & *b ) ^ ( *a & *c ) ^ ( *b & *c ) );
-		t2 = ( s0 + maj );
-		s1 = ( ror32 ( *e, 6 ) ^ ror32 ( *e, 11 ) ^ ror32 ( *e, 25 ) );
-		ch = ( ( *e & *f ) ^ ( (~*e) & *g ) );
-		t1 = ( *h + s1 + ch + k[i] + w[i] );
-		*h = *g;
-		*g = *f;
-		*f = *e;
-		*e = ( *d + t1 );
-		*d = *c;
-		*c = *b;
-		*b = *a;
-		*a = ( t1 + t2 );
-		DBGC2 ( context, "%2d : %08x %08x %08x %08x %08x %08x %08x "
-			"%08x\n", i, *a, *b, *c, *d, *e, *f, *g, *h );
-	}
+		/* Initialise w[16..63] */
+		for ( i = 16 ; i < 64 ; i++ ) {
+			s0 = ( ror32 ( w[i-15], 7 ) ^ ror32 ( w[i-15], 18 ) ^
+			       ( w[i-15] >> 3 ) );
+			s1 = ( ror32 ( w[i-2], 17 ) ^ ror32 ( w[i-2], 19 ) ^
+			       ( w[i-2] >> 10 ) );
+			w[i] = ( w[i-16] + s0 + w[i-7] + s1 );
+		}
 
-	/* Add chunk to hash and convert back to big-endian */
-	for ( i = 0 ; i < 8 ; i++ ) {
-		context->ddd.dd.digest.h[i] =
-			cpu_to_be32 ( context->ddd.dd.digest.h[i] +
-				      u.ddd.dd.digest.h[i] );
+		/* Initialise a, b, c, d, e, f, g, h */
+		a = digest->h[0];
+		b = digest->h[1];
+		c = digest->h[2];
+		d = digest->h[3];
+		e = digest->h[4];
+		f = digest->h[5];
+		g = digest->h[6];
+		h = digest->h[7];
+
+		/* Main loop */
+		for ( i = 0 ; i < 64 ; i += 8 )
+			SHA256_STEP8 ( i );
+
+		/* Add chunk to hash */
+		digest->h[0] += a;
+		digest->h[1] += b;
+		digest->h[2] += c;
+		digest->h[3] += d;
+		digest->h[4] += e;
+		digest->h[5] += f;
+		digest->h[6] += g;
+		digest->h[7] += h;
 	}
+}
 
-	DBGC ( context, "SHA256 digested:\n" );
-	DBGC_HDA ( context, 0, &context->ddd.dd.digest,
-		   sizeof ( context->ddd.dd.digest ) );
+/** SHA-256 block processing function
+ *
+ * This may be replaced at startup by an implementation using
+ * CPU-specific instructions.
+ */
+sha256_blocks_t *sha256_blocks = sha256_blocks_generic;
+
+/**
+ * Initialise SHA-256 algorithm
+ *
+ * @v ctx		SHA-256 context
+ */
+static void sha256_init ( void *ctx ) {
+	struct sha256_context *context = ctx;
+
+	context->ddd.dd.digest.h[0] = 0x6a09e667;
+	context->ddd.dd.digest.h[1] = 0xbb67ae85;
+	context->ddd.dd.digest.h[2] = 0x3c6ef372;
+	context->ddd.dd.digest.h[3] = 0xa54ff53a;
+	context->ddd.dd.digest.h[4] = 0x510e527f;
+	context->ddd.dd.digest.h[5] = 0x9b05688c;
+	context->ddd.dd.digest.h[6] = 0x1f83d9ab;
+	context->ddd.dd.digest.h[7] = 0x5be0cd19;
+	context->len = 0;
 }
 
 /**
@@ -188,19 +207,40 @@ static void sha256_digest ( struct sha256_context *context ) {
  */
 static void sha256_update ( void *ctx, const void *data, size_t len ) {
 	struct sha256_context *context = ctx;
-	const uint8_t *byte = data;
+	void *digest = &context->ddd.dd.digest;
+	void *block = &context->ddd.dd.data;
 	size_t offset;
+	size_t frag_len;
+	size_t count;
+
+	/* Complete any partially accumulated block */
+	offset = ( context->len % sizeof ( context->ddd.dd.data ) );
+	if ( offset ) {
+		frag_len = ( sizeof ( context->ddd.dd.data ) - offset );
+		if ( frag_len > len )
+			frag_len = len;
+		memcpy ( ( block + offset ), data, frag_len );
+		context->len += frag_len;
+		data += frag_len;
+		len -= frag_len;
+		if ( ( offset + frag_len ) < sizeof ( context->ddd.dd.data ) )
+			return;
+		sha256_blocks ( digest, block, 1 );
+	}
 
-	/* Accumulate data a byte at a time, performing the digest
-	 * whenever we fill the data buffer
-	 */
-	while ( len-- ) {
-		offset = ( context->len % sizeof ( context->ddd.dd.data ) );
-		context->ddd.dd.data.byte[offset] = *(byte++);
-		context->len++;
-		if ( ( context->len % sizeof ( context->ddd.dd.data ) ) == 0 )
-			sha256_digest ( context );
+	/* Process whole blocks directly from the data buffer */
+	count = ( len / sizeof ( context->ddd.dd.data ) );
+	if ( count ) {
+		frag_len = ( count * sizeof ( context->ddd.dd.data ) );
+		sha256_blocks ( digest, data, count );
+		context->len += frag_len;
+		data += frag_len;
+		len -= frag_len;
 	}
+
+	/* Accumulate any remaining data */
+	memcpy ( block, data, len );
+	context->len += len;
 }
 
 /**
@@ -213,6 +253,7 @@ static void sha256_final ( void *ctx, void *out ) {
 	struct sha256_context *context = ctx;
 	uint64_t len_bits;
 	uint8_t pad;
+	unsigned int i;
 
 	/* Record length before pre-processing */
 	len_bits = cpu_to_be64 ( ( ( uint64_t ) context->len ) * 8 );
@@ -229,7 +270,12 @@ static void sha256_final ( void *ctx, void *out ) {
 	sha256_update ( ctx, &len_bits, sizeof ( len_bits ) );
 	assert ( ( context->len % sizeof ( context->ddd.dd.data ) ) == 0 );
 
-	/* Copy out final digest */
+	/* Convert digest to big-endian and copy out */
+	for ( i = 0 ; i < ( sizeof ( context->ddd.dd.digest.h ) /
+			    sizeof ( context->ddd.dd.digest.h[0] ) ) ; i++ ) {
+		context->ddd.dd.digest.h[i] =
+			cpu_to_be32 ( context->ddd.dd.digest.h[i] );
+	}
 	memcpy ( out, &context->ddd.dd.digest,
 		 sizeof ( context->ddd.dd.digest ) );
 }
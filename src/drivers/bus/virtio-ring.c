@@ -80,6 +80,10 @@ void *vring_get_buf(struct vring_virtqueue *vq, unsigned int *len)
 
    vq->last_used_idx++;
 
+   /* keep requesting interrupts, if enabled */
+   if (vq->event_idx && !(vr->avail->flags & VRING_AVAIL_F_NO_INTERRUPT))
+           vring_used_event(vr) = vq->last_used_idx;
+
    return opaque;
 }
 
@@ -125,12 +129,20 @@ void vring_add_buf(struct vring_virtqueue *vq,
 void vring_kick(unsigned int ioaddr, struct vring_virtqueue *vq, int num_added)
 {
    struct vring *vr = &vq->vring;
+   u16 old, new;
 
    wmb();
-   vr->avail->idx += num_added;
+   old = vr->avail->idx;
+   new = old + num_added;
+   vr->avail->idx = new;
 
    mb();
-   if (!(vr->used->flags & VRING_USED_F_NO_NOTIFY))
+   if (vq->event_idx) {
+           /* notify only if the host asked for this index */
+           if (vring_need_event(vring_avail_event(vr), new, old))
+                   vp_notify(ioaddr, vq->queue_index);
+   } else if (!(vr->used->flags & VRING_USED_F_NO_NOTIFY)) {
            vp_notify(ioaddr, vq->queue_index);
+   }
 }
 
@@ -126,6 +126,7 @@ static void tap_poll(struct net_device *netdev)
 	struct tap_nic * nic = netdev->priv;
 	struct pollfd pfd;
 	struct io_buffer * iobuf;
+	unsigned int budget = netdev->rx_budget;
 	int r;
 
 	pfd.fd = nic->fd;
@@ -137,24 +138,25 @@ static void tap_poll(struct net_device *netdev)
 	if ((pfd.revents & POLLIN) == 0)
 		return;
 
-	/* At this point we know there is at least one new packet to be read */
-
-	iobuf = alloc_iob(RX_BUF_SIZE);
-	if (! iobuf)
-		goto allocfail;
+	/* At this point we know there is at least one new packet to be
+	 * read.  Leave any packets beyond the budget for the next poll.
+	 */
+	while (budget) {
+		iobuf = alloc_iob(RX_BUF_SIZE);
+		if (! iobuf)
+			goto allocfail;
 
-	while ((r = linux_read(nic->fd, iobuf->data, RX_BUF_SIZE)) > 0) {
+		r = linux_read(nic->fd, iobuf->data, RX_BUF_SIZE);
+		if (r <= 0) {
+			free_iob(iobuf);
+			return;
+		}
 		DBGC2(nic, "tap %p read %d bytes\n", nic, r);
 
 		iob_put(iobuf, r);
 		netdev_rx(netdev, iobuf);
-
-		iobuf = alloc_iob(RX_BUF_SIZE);
-		if (! iobuf)
-			goto allocfail;
+		budget--;
 	}
-
-	free_iob(iobuf);
 	return;
 
 allocfail:
@@ -30,6 +30,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/iobuf.h>
 #include <ipxe/malloc.h>
 #include <ipxe/pci.h>
+#include <config/general.h>
 #include "intel.h"
 
 /** @file
@@ -38,6 +39,11 @@ FILE_LICENCE ( GPL2_OR_LATER );
  *
  */
 
+/* Disambiguate the various error causes */
+#define ENOBUFS_RXO __einfo_error ( EINFO_ENOBUFS_RXO )
+#define EINFO_ENOBUFS_RXO \
+	__einfo_uniqify ( EINFO_ENOBUFS, 0x01, "Receive overrun" )
+
 /******************************************************************************
  *
  * EEPROM interface
@@ -353,6 +359,26 @@ static void intel_check_link ( struct net_device *netdev ) {
  ******************************************************************************
  */
 
+/**
+ * Calculate descriptor ring size
+ *
+ * @v count		Requested number of descriptors
+ * @v min		Minimum number of descriptors
+ * @ret count		Number of descriptors
+ *
+ * The number of descriptors is rounded up to a power of two, so that
+ * ring indices remain valid when the producer and consumer counters
+ * wrap.
+ */
+static unsigned int intel_ring_count ( unsigned int count,
+				       unsigned int min ) {
+	unsigned int actual = min;
+
+	while ( ( actual < count ) && ( actual < INTEL_MAX_DESC ) )
+		actual <<= 1;
+	return actual;
+}
+
 /**
  * Create descriptor ring
  *
@@ -441,7 +467,7 @@ static void intel_refill_rx ( struct intel_nic *intel ) {
 	unsigned int rx_tail;
 	physaddr_t address;
 
-	while ( ( intel->rx.prod - intel->rx.cons ) < INTEL_RX_FILL ) {
+	while ( ( intel->rx.prod - intel->rx.cons ) < intel->rx_fill ) {
 
 		/* Allocate I/O buffer */
 		iobuf = alloc_iob ( INTEL_RX_MAX_LEN );
@@ -451,8 +477,8 @@ static void intel_refill_rx ( struct intel_nic *intel ) {
 		}
 
 		/* Get next receive descriptor */
-		rx_idx = ( intel->rx.prod++ % INTEL_NUM_RX_DESC );
-		rx_tail = ( intel->rx.prod % INTEL_NUM_RX_DESC );
+		rx_idx = ( intel->rx.prod++ % intel->rx.count );
+		rx_tail = ( intel->rx.prod % intel->rx.count );
 		rx = &intel->rx.desc[rx_idx];
 
 		/* Populate receive descriptor */
@@ -489,6 +515,14 @@ static int intel_open ( struct net_device *netdev ) {
 	uint32_t rctl;
 	int rc;
 
+	/* Allocate receive I/O buffer list */
+	intel->rx_iobuf = zalloc ( intel->rx.count *
+				   sizeof ( intel->rx_iobuf[0] ) );
+	if ( ! intel->rx_iobuf ) {
+		rc = -ENOMEM;
+		goto err_alloc_rx_iobuf;
+	}
+
 	/* Create transmit descriptor ring */
 	if ( ( rc = intel_create_ring ( intel, &intel->tx ) ) != 0 )
 		goto err_create_tx;
@@ -530,6 +564,9 @@ static int intel_open ( struct net_device *netdev ) {
  err_create_rx:
 	intel_destroy_ring ( intel, &intel->tx );
  err_create_tx:
+	free ( intel->rx_iobuf );
+	intel->rx_iobuf = NULL;
+ err_alloc_rx_iobuf:
 	return rc;
 }
 
@@ -552,11 +589,10 @@ static void intel_close ( struct net_device *netdev ) {
 	intel_destroy_ring ( intel, &intel->rx );
 
 	/* Discard any unused receive buffers */
-	for ( i = 0 ; i < INTEL_NUM_RX_DESC ; i++ ) {
-		if ( intel->rx_iobuf[i] )
-			free_iob ( intel->rx_iobuf[i] );
-		intel->rx_iobuf[i] = NULL;
-	}
+	for ( i = 0 ; i < intel->rx.count ; i++ )
+		free_iob ( intel->rx_iobuf[i] );
+	free ( intel->rx_iobuf );
+	intel->rx_iobuf = NULL;
 
 	/* Destroy transmit descriptor ring */
 	intel_destroy_ring ( intel, &intel->tx );
@@ -581,12 +617,12 @@ static int intel_transmit ( struct net_device *netdev,
 	physaddr_t address;
 
 	/* Get next transmit descriptor */
-	if ( ( intel->tx.prod - intel->tx.cons ) >= INTEL_NUM_TX_DESC ) {
+	if ( ( intel->tx.prod - intel->tx.cons ) >= intel->tx.count ) {
 		DBGC ( intel, "INTEL %p out of transmit descriptors\n", intel );
 		return -ENOBUFS;
 	}
-	tx_idx = ( intel->tx.prod++ % INTEL_NUM_TX_DESC );
-	tx_tail = ( intel->tx.prod % INTEL_NUM_TX_DESC );
+	tx_idx = ( intel->tx.prod++ % intel->tx.count );
+	tx_tail = ( intel->tx.prod % intel->tx.count );
 	tx = &intel->tx.desc[tx_idx];
 
 	/* Populate transmit descriptor */
@@ -622,7 +658,7 @@ static void intel_poll_tx ( struct net_device *netdev ) {
 	while ( intel->tx.cons != intel->tx.prod ) {
 
 		/* Get next transmit descriptor */
-		tx_idx = ( intel->tx.cons % INTEL_NUM_TX_DESC );
+		tx_idx = ( intel->tx.cons % intel->tx.count );
 		tx = &intel->tx.desc[tx_idx];
 
 		/* Stop if descriptor is still in use */
@@ -653,7 +689,7 @@ static void intel_poll_rx ( struct net_device *netdev ) {
 	while ( intel->rx.cons != intel->rx.prod ) {
 
 		/* Get next receive descriptor */
-		rx_idx = ( intel->rx.cons % INTEL_NUM_RX_DESC );
+		rx_idx = ( intel->rx.cons % intel->rx.count );
 		rx = &intel->rx.desc[rx_idx];
 
 		/* Stop if descriptor is still in use */
@@ -689,6 +725,7 @@ static void intel_poll_rx ( struct net_device *netdev ) {
 static void intel_poll ( struct net_device *netdev ) {
 	struct intel_nic *intel = netdev->priv;
 	uint32_t icr;
+	uint32_t missed;
 
 	/* Check for and acknowledge interrupts */
 	icr = readl ( intel->regs + INTEL_ICR );
@@ -703,9 +740,15 @@ static void intel_poll ( struct net_device *netdev ) {
 	if ( icr & ( INTEL_IRQ_RXT0 | INTEL_IRQ_RXO ) )
 		intel_poll_rx ( netdev );
 
-	/* Report receive overruns */
-	if ( icr & INTEL_IRQ_RXO )
-		netdev_rx_err ( netdev, NULL, -ENOBUFS );
+	/* Report receive overruns, counting each missed packet */
+	if ( icr & INTEL_IRQ_RXO ) {
+		missed = readl ( intel->regs + INTEL_MPC );
+		DBGC ( intel, "INTEL %p RX overrun (%d packets missed)\n",
+		       intel, missed );
+		do {
+			netdev_rx_err ( netdev, NULL, -ENOBUFS_RXO );
+		} while ( missed-- > 1 );
+	}
 
 	/* Check link state, if applicable */
 	if ( icr & INTEL_IRQ_LSC )
@@ -772,8 +815,15 @@ static int intel_probe ( struct pci_device *pci ) {
 	netdev->dev = &pci->dev;
 	memset ( intel, 0, sizeof ( *intel ) );
 	intel->port = PCI_FUNC ( pci->busdevfn );
-	intel_init_ring ( &intel->tx, INTEL_NUM_TX_DESC, INTEL_TD );
-	intel_init_ring ( &intel->rx, INTEL_NUM_RX_DESC, INTEL_RD );
+	intel_init_ring ( &intel->tx,
+			  intel_ring_count ( NETDEV_TX_DESC, INTEL_MIN_TX_DESC ),
+			  INTEL_TD );
+	intel_init_ring ( &intel->rx,
+			  intel_ring_count ( NETDEV_RX_DESC, INTEL_MIN_RX_DESC ),
+			  INTEL_RD );
+	intel->rx_fill = ( intel->rx.count / 2 );
+	DBGC ( intel, "INTEL %p using %d TX and %d RX descriptors\n",
+	       intel, intel->tx.count, intel->rx.count );
 
 	/* Fix up PCI device */
 	adjust_pci_device ( pci );
@@ -133,15 +133,13 @@ enum intel_descriptor_status {
 /** Receive Descriptor register block */
 #define INTEL_RD 0x02800UL
 
-/** Number of receive descriptors
+/** Minimum number of receive descriptors
  *
  * Minimum value is 8, since the descriptor ring length must be a
- * multiple of 128.
+ * multiple of 128.  The actual number of descriptors is taken from
+ * NETDEV_RX_DESC.
  */
-#define INTEL_NUM_RX_DESC 8
-
-/** Receive descriptor ring fill level */
-#define INTEL_RX_FILL 4
+#define INTEL_MIN_RX_DESC 8
 
 /** Receive buffer length */
 #define INTEL_RX_MAX_LEN 2048
@@ -149,12 +147,16 @@ enum intel_descriptor_status {
 /** Transmit Descriptor register block */
 #define INTEL_TD 0x03800UL
 
-/** Number of transmit descriptors
+/** Minimum number of transmit descriptors
  *
  * Descriptor ring length must be a multiple of 16.  ICH8/9/10
- * requires a minimum of 16 TX descriptors.
+ * requires a minimum of 16 TX descriptors.  The actual number of
+ * descriptors is taken from NETDEV_TX_DESC.
  */
-#define INTEL_NUM_TX_DESC 16
+#define INTEL_MIN_TX_DESC 16
+
+/** Maximum number of descriptors in a ring */
+#define INTEL_MAX_DESC 4096
 
 /** Receive/Transmit Descriptor Base Address Low (offset) */
 #define INTEL_xDBAL 0x00
@@ -187,6 +189,9 @@ enum intel_descriptor_status {
 /** Transmit Descriptor Tail */
 #define INTEL_TDT ( INTEL_TD + INTEL_xDT )
 
+/** Missed Packets Count */
+#define INTEL_MPC 0x04010UL
+
 /** Receive Address Low */
 #define INTEL_RAL0 0x05400UL
 
@@ -212,6 +217,8 @@ struct intel_ring {
 	/** Consumer index */
 	unsigned int cons;
 
+	/** Number of descriptors */
+	unsigned int count;
 	/** Register block */
 	unsigned int reg;
 	/** Length (in bytes) */
@@ -228,6 +235,7 @@ struct intel_ring {
 static inline __attribute__ (( always_inline)) void
 intel_init_ring ( struct intel_ring *ring, unsigned int count,
 		  unsigned int reg ) {
+	ring->count = count;
 	ring->len = ( count * sizeof ( ring->desc[0] ) );
 	ring->reg = reg;
 }
@@ -251,7 +259,9 @@ struct intel_nic {
 	/** Receive descriptor ring */
 	struct intel_ring rx;
 	/** Receive I/O buffers */
-	struct io_buffer *rx_iobuf[INTEL_NUM_RX_DESC];
+	struct io_buffer **rx_iobuf;
+	/** Receive descriptor ring fill level */
+	unsigned int rx_fill;
 };
 
 #endif /* _INTEL_H */
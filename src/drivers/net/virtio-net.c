@@ -24,6 +24,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 
 #include <errno.h>
 #include <stdlib.h>
+#include <string.h>
 #include <ipxe/list.h>
 #include <ipxe/iobuf.h>
 #include <ipxe/netdevice.h>
@@ -32,8 +33,14 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/ethernet.h>
 #include <ipxe/virtio-ring.h>
 #include <ipxe/virtio-pci.h>
+#include <config/general.h>
 #include "virtio-net.h"
 
+/* Disambiguate the various error causes */
+#define ENOBUFS_RX_RING __einfo_error ( EINFO_ENOBUFS_RX_RING )
+#define EINFO_ENOBUFS_RX_RING \
+	__einfo_uniqify ( EINFO_ENOBUFS, 0x01, "Receive ring exhausted" )
+
 /*
  * Virtio network device driver
  *
@@ -77,9 +84,6 @@ enum {
 };
 
 enum {
-	/** Max number of pending rx packets */
-	NUM_RX_BUF = 8,
-
 	/** Max Ethernet frame length, including FCS and VLAN tag */
 	RX_BUF_SIZE = 1522,
 };
@@ -97,8 +101,32 @@ struct virtnet_nic {
 	/** Pending rx packet count */
 	unsigned int rx_num_iobufs;
 
+	/** Max number of pending rx packets */
+	unsigned int rx_max;
+
+	/** Pending tx packet count */
+	unsigned int tx_num_iobufs;
+
+	/** Max number of pending tx packets */
+	unsigned int tx_max;
+
+	/** Buffers added to each virtqueue but not yet notified */
+	unsigned int num_added[QUEUE_NB];
+
+	/** Mergeable rx buffers (VIRTIO_NET_F_MRG_RXBUF) negotiated */
+	int mergeable;
+
+	/** Length of virtio net packet header */
+	size_t hdr_len;
+
+	/** Partially received packet spanning merged rx buffers */
+	struct io_buffer *rx_merge;
+
+	/** Number of merged rx buffers still to be received */
+	unsigned int rx_merge_remaining;
+
 	/** Virtio net packet header, we only need one */
-	struct virtio_net_hdr empty_header;
+	struct virtio_net_hdr_mrg_rxbuf empty_header;
 };
 
 /** Add an iobuf to a virtqueue
@@ -107,7 +135,8 @@ struct virtnet_nic {
  * @v vq_idx		Virtqueue index (RX_INDEX or TX_INDEX)
  * @v iobuf		I/O buffer
  *
- * The virtqueue is kicked after the iobuf has been added.
+ * The virtqueue is not kicked; call virtnet_kick() once a batch of
+ * iobufs has been added.
  */
 static void virtnet_enqueue_iob ( struct net_device *netdev,
 				  int vq_idx, struct io_buffer *iobuf ) {
@@ -123,7 +152,7 @@ static void virtnet_enqueue_iob ( struct net_device *netdev,
 			 * header fields get used.
 			 */
 			.addr = ( char* ) &virtnet->empty_header,
-			.length = sizeof ( virtnet->empty_header ),
+			.length = virtnet->hdr_len,
 		},
 		{
 			.addr = ( char* ) iobuf->data,
@@ -134,8 +163,41 @@ static void virtnet_enqueue_iob ( struct net_device *netdev,
 	DBGC ( virtnet, "VIRTIO-NET %p enqueuing iobuf %p on vq %d\n",
 	       virtnet, iobuf, vq_idx );
 
-	vring_add_buf ( vq, list, out, in, iobuf, 0 );
-	vring_kick ( virtnet->ioaddr, vq, 1 );
+	/* Mergeable rx buffers carry their own header */
+	if ( ( vq_idx == RX_INDEX ) && virtnet->mergeable ) {
+		vring_add_buf ( vq, &list[1], 0, 1, iobuf,
+				virtnet->num_added[vq_idx]++ );
+		return;
+	}
+
+	vring_add_buf ( vq, list, out, in, iobuf,
+			virtnet->num_added[vq_idx]++ );
+}
+
+/** Notify device of iobufs added to a virtqueue
+ *
+ * @v netdev		Network device
+ * @v vq_idx		Virtqueue index (RX_INDEX or TX_INDEX)
+ */
+static void virtnet_kick ( struct net_device *netdev, int vq_idx ) {
+	struct virtnet_nic *virtnet = netdev->priv;
+	struct vring_virtqueue *vq = &virtnet->virtqueue[vq_idx];
+
+	if ( virtnet->num_added[vq_idx] ) {
+		vring_kick ( virtnet->ioaddr, vq, virtnet->num_added[vq_idx] );
+		virtnet->num_added[vq_idx] = 0;
+	}
+}
+
+/** Calculate rx buffer size
+ *
+ * @v virtnet		Virtio-net device
+ * @ret len		Length of rx buffer
+ */
+static size_t virtnet_rx_buf_size ( struct virtnet_nic *virtnet ) {
+
+	/* Mergeable rx buffers also hold the packet header */
+	return ( RX_BUF_SIZE + ( virtnet->mergeable ? virtnet->hdr_len : 0 ) );
 }
 
 /** Try to keep rx virtqueue filled with iobufs
@@ -145,11 +207,13 @@ static void virtnet_enqueue_iob ( struct net_device *netdev,
 static void virtnet_refill_rx_virtqueue ( struct net_device *netdev ) {
 	struct virtnet_nic *virtnet = netdev->priv;
 
-	while ( virtnet->rx_num_iobufs < NUM_RX_BUF ) {
+	size_t len = virtnet_rx_buf_size ( virtnet );
+
+	while ( virtnet->rx_num_iobufs < virtnet->rx_max ) {
 		struct io_buffer *iobuf;
 
 		/* Try to allocate a buffer, stop for now if out of memory */
-		iobuf = alloc_iob ( RX_BUF_SIZE );
+		iobuf = alloc_iob ( len );
 		if ( ! iobuf )
 			break;
 
@@ -157,11 +221,30 @@ static void virtnet_refill_rx_virtqueue ( struct net_device *netdev ) {
 		list_add ( &iobuf->list, &virtnet->rx_iobufs );
 
 		/* Mark packet length until we know the actual size */
-		iob_put ( iobuf, RX_BUF_SIZE );
+		iob_put ( iobuf, len );
 
 		virtnet_enqueue_iob ( netdev, RX_INDEX, iobuf );
 		virtnet->rx_num_iobufs++;
 	}
+
+	virtnet_kick ( netdev, RX_INDEX );
+}
+
+/** Calculate maximum number of packets pending on a virtqueue
+ *
+ * @v vq		Virtqueue
+ * @v count		Requested number of packets
+ * @v descs		Number of descriptors used by each packet
+ * @ret count		Number of packets
+ *
+ * The virtqueue size is dictated by the device.
+ */
+static unsigned int virtnet_queue_max ( struct vring_virtqueue *vq,
+					unsigned int count,
+					unsigned int descs ) {
+	unsigned int max = ( vq->vring.num / descs );
+
+	return ( ( count < max ) ? count : max );
 }
 
 /** Open network device
@@ -178,6 +261,19 @@ static int virtnet_open ( struct net_device *netdev ) {
 	/* Reset for sanity */
 	vp_reset ( ioaddr );
 
+	/* Negotiate features */
+	features = vp_get_features ( ioaddr );
+	features &= ( ( 1 << VIRTIO_NET_F_MAC ) |
+		      ( 1 << VIRTIO_NET_F_MRG_RXBUF ) |
+		      ( 1 << VIRTIO_RING_F_EVENT_IDX ) );
+	vp_set_features ( ioaddr, features );
+	virtnet->mergeable = ( ( features & ( 1 << VIRTIO_NET_F_MRG_RXBUF ) )
+			       ? 1 : 0 );
+	virtnet->hdr_len = ( virtnet->mergeable ?
+			     sizeof ( struct virtio_net_hdr_mrg_rxbuf ) :
+			     sizeof ( struct virtio_net_hdr ) );
+	DBGC ( virtnet, "VIRTIO-NET %p features %#08x\n", virtnet, features );
+
 	/* Allocate virtqueues */
 	virtnet->virtqueue = zalloc ( QUEUE_NB *
 				      sizeof ( *virtnet->virtqueue ) );
@@ -193,19 +289,33 @@ static int virtnet_open ( struct net_device *netdev ) {
 			virtnet->virtqueue = NULL;
 			return -ENOENT;
 		}
+		if ( features & ( 1 << VIRTIO_RING_F_EVENT_IDX ) )
+			virtnet->virtqueue[i].event_idx = 1;
 	}
 
+	/* Size rx and tx queues.  Each packet uses two descriptors (the
+	 * shared header and the packet data), except for mergeable rx
+	 * buffers which carry their own header.
+	 */
+	virtnet->rx_max = virtnet_queue_max ( &virtnet->virtqueue[RX_INDEX],
+					      NETDEV_RX_DESC,
+					      ( virtnet->mergeable ? 1 : 2 ) );
+	virtnet->tx_max = virtnet_queue_max ( &virtnet->virtqueue[TX_INDEX],
+					      NETDEV_TX_DESC, 2 );
+	DBGC ( virtnet, "VIRTIO-NET %p using %d tx and %d rx buffers\n",
+	       virtnet, virtnet->tx_max, virtnet->rx_max );
+
 	/* Initialize rx packets */
 	INIT_LIST_HEAD ( &virtnet->rx_iobufs );
 	virtnet->rx_num_iobufs = 0;
+	virtnet->tx_num_iobufs = 0;
+	memset ( virtnet->num_added, 0, sizeof ( virtnet->num_added ) );
 	virtnet_refill_rx_virtqueue ( netdev );
 
 	/* Disable interrupts before starting */
 	netdev_irq ( netdev, 0 );
 
 	/* Driver is ready */
-	features = vp_get_features ( ioaddr );
-	vp_set_features ( ioaddr, features & ( 1 << VIRTIO_NET_F_MAC ) );
 	vp_set_status ( ioaddr, VIRTIO_CONFIG_S_DRIVER | VIRTIO_CONFIG_S_DRIVER_OK );
 	return 0;
 }
@@ -231,6 +341,12 @@ static void virtnet_close ( struct net_device *netdev ) {
 	}
 	INIT_LIST_HEAD ( &virtnet->rx_iobufs );
 	virtnet->rx_num_iobufs = 0;
+	virtnet->tx_num_iobufs = 0;
+
+	/* Discard any partially received packet */
+	free_iob ( virtnet->rx_merge );
+	virtnet->rx_merge = NULL;
+	virtnet->rx_merge_remaining = 0;
 }
 
 /** Transmit packet
@@ -241,7 +357,19 @@ static void virtnet_close ( struct net_device *netdev ) {
  */
 static int virtnet_transmit ( struct net_device *netdev,
 			      struct io_buffer *iobuf ) {
+	struct virtnet_nic *virtnet = netdev->priv;
+
+	/* Do not overfill the tx virtqueue */
+	if ( virtnet->tx_num_iobufs >= virtnet->tx_max ) {
+		DBGC ( virtnet, "VIRTIO-NET %p out of tx buffers\n", virtnet );
+		return -ENOBUFS;
+	}
+
+	/* The device is notified once per poll, rather than once per
+	 * packet, to minimise the number of notifications.
+	 */
 	virtnet_enqueue_iob ( netdev, TX_INDEX, iobuf );
+	virtnet->tx_num_iobufs++;
 	return 0;
 }
 
@@ -258,11 +386,79 @@ static void virtnet_process_tx_packets ( struct net_device *netdev ) {
 
 		DBGC ( virtnet, "VIRTIO-NET %p tx complete iobuf %p\n",
 		       virtnet, iobuf );
+		virtnet->tx_num_iobufs--;
 
 		netdev_tx_complete ( netdev, iobuf );
 	}
 }
 
+/** Reassemble packet from mergeable rx buffers
+ *
+ * @v netdev	Network device
+ * @v iobuf	Received rx buffer
+ * @ret iobuf	Completed packet, or NULL if packet is incomplete
+ *
+ * Only the first rx buffer of a packet carries a header, which
+ * records the number of rx buffers used by the packet.
+ */
+static struct io_buffer * virtnet_rx_merge ( struct net_device *netdev,
+					     struct io_buffer *iobuf ) {
+	struct virtnet_nic *virtnet = netdev->priv;
+	struct virtio_net_hdr_mrg_rxbuf *hdr;
+	struct io_buffer *merge;
+	unsigned int num_buffers;
+
+	/* Append continuation buffer to partially received packet */
+	if ( virtnet->rx_merge_remaining ) {
+		merge = virtnet->rx_merge;
+		if ( merge && ( iob_tailroom ( merge ) < iob_len ( iobuf ) ) ) {
+			DBGC ( virtnet, "VIRTIO-NET %p rx packet overlength\n",
+			       virtnet );
+			netdev_rx_err ( netdev, merge, -EINVAL );
+			virtnet->rx_merge = merge = NULL;
+		}
+		if ( merge ) {
+			memcpy ( iob_put ( merge, iob_len ( iobuf ) ),
+				 iobuf->data, iob_len ( iobuf ) );
+		}
+		free_iob ( iobuf );
+		if ( --virtnet->rx_merge_remaining )
+			return NULL;
+		virtnet->rx_merge = NULL;
+		return merge;
+	}
+
+	/* Strip header */
+	if ( iob_len ( iobuf ) < virtnet->hdr_len ) {
+		netdev_rx_err ( netdev, iobuf, -EINVAL );
+		return NULL;
+	}
+	hdr = iobuf->data;
+	num_buffers = hdr->num_buffers;
+	iob_pull ( iobuf, virtnet->hdr_len );
+
+	/* Use buffer directly unless packet spans multiple buffers */
+	if ( num_buffers <= 1 )
+		return iobuf;
+
+	/* Start reassembling packet.  If no memory is available,
+	 * discard the remaining buffers for this packet.
+	 */
+	DBGC ( virtnet, "VIRTIO-NET %p rx packet spans %d buffers\n",
+	       virtnet, num_buffers );
+	merge = alloc_iob ( num_buffers * virtnet_rx_buf_size ( virtnet ) );
+	if ( merge ) {
+		memcpy ( iob_put ( merge, iob_len ( iobuf ) ),
+			 iobuf->data, iob_len ( iobuf ) );
+		free_iob ( iobuf );
+	} else {
+		netdev_rx_err ( netdev, iobuf, -ENOMEM );
+	}
+	virtnet->rx_merge = merge;
+	virtnet->rx_merge_remaining = ( num_buffers - 1 );
+	return NULL;
+}
+
 /** Complete packet reception
  *
  * @v netdev	Network device
@@ -270,6 +466,7 @@ static void virtnet_process_tx_packets ( struct net_device *netdev ) {
 static void virtnet_process_rx_packets ( struct net_device *netdev ) {
 	struct virtnet_nic *virtnet = netdev->priv;
 	struct vring_virtqueue *rx_vq = &virtnet->virtqueue[RX_INDEX];
+	int received = 0;
 
 	while ( vring_more_used ( rx_vq ) ) {
 		unsigned int len;
@@ -278,18 +475,36 @@ static void virtnet_process_rx_packets ( struct net_device *netdev ) {
 		/* Release ownership of iobuf */
 		list_del ( &iobuf->list );
 		virtnet->rx_num_iobufs--;
+		received = 1;
 
 		/* Update iobuf length */
-		iob_unput ( iobuf, RX_BUF_SIZE );
-		iob_put ( iobuf, len - sizeof ( struct virtio_net_hdr ) );
+		iob_unput ( iobuf, virtnet_rx_buf_size ( virtnet ) );
+		if ( virtnet->mergeable ) {
+			iob_put ( iobuf, len );
+		} else {
+			iob_put ( iobuf, len - virtnet->hdr_len );
+		}
 
 		DBGC ( virtnet, "VIRTIO-NET %p rx complete iobuf %p len %zd\n",
 		       virtnet, iobuf, iob_len ( iobuf ) );
 
+		/* Reassemble packets spanning merged rx buffers */
+		if ( virtnet->mergeable ) {
+			iobuf = virtnet_rx_merge ( netdev, iobuf );
+			if ( ! iobuf )
+				continue;
+		}
+
 		/* Pass completed packet to the network stack */
 		netdev_rx ( netdev, iobuf );
 	}
 
+	/* If every pending rx packet has been filled, the device may
+	 * have had to drop packets for lack of buffers.
+	 */
+	if ( received && ( virtnet->rx_num_iobufs == 0 ) )
+		netdev_rx_err ( netdev, NULL, -ENOBUFS_RX_RING );
+
 	virtnet_refill_rx_virtqueue ( netdev );
 }
 
@@ -307,6 +522,9 @@ static void virtnet_poll ( struct net_device *netdev ) {
 	 */
 	vp_get_isr ( virtnet->ioaddr );
 
+	/* Notify device of all packets transmitted since the last poll */
+	virtnet_kick ( netdev, TX_INDEX );
+
 	virtnet_process_tx_packets ( netdev );
 	virtnet_process_rx_packets ( netdev );
 }
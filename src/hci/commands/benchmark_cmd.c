@@ -0,0 +1,99 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <ipxe/uri.h>
+#include <ipxe/command.h>
+#include <ipxe/parseopt.h>
+#include <usr/benchmark.h>
+
+/** @file
+ *
+ * Download benchmarking commands
+ *
+ */
+
+/** "benchmark" options */
+struct benchmark_options {
+	/** Number of runs */
+	unsigned int count;
+};
+
+/** "benchmark" option list */
+static struct option_descriptor benchmark_opts[] = {
+	OPTION_DESC ( "count", 'c', required_argument,
+		      struct benchmark_options, count, parse_integer ),
+};
+
+/** "benchmark" command descriptor */
+static struct command_descriptor benchmark_cmd =
+	COMMAND_DESC ( struct benchmark_options, benchmark_opts, 1, 1,
+		       "[--count <count>] <uri>" );
+
+/**
+ * "benchmark" command
+ *
+ * @v argc		Argument count
+ * @v argv		Argument list
+ * @ret rc		Return status code
+ */
+static int benchmark_exec ( int argc, char **argv ) {
+	struct benchmark_options opts;
+	struct uri *uri;
+	unsigned int run;
+	int rc;
+
+	/* Parse options */
+	if ( ( rc = parse_options ( argc, argv, &benchmark_cmd, &opts ) ) != 0 )
+		goto err_parse_options;
+
+	/* Parse URI */
+	uri = parse_uri ( argv[optind] );
+	if ( ! uri ) {
+		rc = -ENOMEM;
+		goto err_parse_uri;
+	}
+
+	/* Use a single run if no count specified */
+	if ( ! opts.count )
+		opts.count = 1;
+
+	/* Perform benchmark runs */
+	for ( run = 1 ; run <= opts.count ; run++ ) {
+		if ( ( rc = benchmark ( uri, run ) ) != 0 ) {
+			printf ( "Benchmark failed: %s\n", strerror ( rc ) );
+			goto err_benchmark;
+		}
+	}
+
+ err_benchmark:
+	uri_put ( uri );
+ err_parse_uri:
+ err_parse_options:
+	return rc;
+}
+
+/** Download benchmarking commands */
+struct command benchmark_command __command = {
+	.name = "benchmark",
+	.exec = benchmark_exec,
+};
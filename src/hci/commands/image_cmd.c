@@ -44,6 +44,8 @@ struct imgsingle_options {
 	int replace;
 	/** Free image after execution */
 	int autofree;
+	/** Decompress downloaded image */
+	int decompress;
 };
 
 /** "img{single}" option list */
@@ -54,13 +56,15 @@ static struct option_descriptor imgsingle_opts[] = {
 		      struct imgsingle_options, replace, parse_flag ),
 	OPTION_DESC ( "autofree", 'a', no_argument,
 		      struct imgsingle_options, autofree, parse_flag ),
+	OPTION_DESC ( "decompress", 'd', no_argument,
+		      struct imgsingle_options, decompress, parse_flag ),
 };
 
 /** "img{single}" command descriptor */
 static struct command_descriptor imgsingle_cmd =
 	COMMAND_DESC ( struct imgsingle_options, imgsingle_opts,
 		       1, MAX_ARGUMENTS,
-		       "[--name <name>] [--autofree] "
+		       "[--name <name>] [--autofree] [--decompress] "
 		       "<uri|image> [<arguments>...]" );
 
 /** An "img{single}" family command descriptor */
@@ -68,7 +72,8 @@ struct imgsingle_descriptor {
 	/** Command descriptor */
 	struct command_descriptor *cmd;
 	/** Function to use to acquire the image */
-	int ( * acquire ) ( const char *name, struct image **image );
+	int ( * acquire ) ( const char *name, int decompress,
+			    struct image **image );
 	/** Pre-action to take upon image, or NULL */
 	void ( * preaction ) ( struct image *image );
 	/** Action to take upon image, or NULL */
@@ -114,7 +119,8 @@ static int imgsingle_exec ( int argc, char **argv,
 
 	/* Acquire the image */
 	if ( name_uri ) {
-		if ( ( rc = desc->acquire ( name_uri, &image ) ) != 0 )
+		if ( ( rc = desc->acquire ( name_uri, opts.decompress,
+					    &image ) ) != 0 )
 			goto err_acquire;
 	} else {
 		image = image_find_selected();
@@ -176,7 +182,8 @@ static int imgsingle_exec ( int argc, char **argv,
 static struct command_descriptor imgfetch_cmd =
 	COMMAND_DESC ( struct imgsingle_options, imgsingle_opts,
 		       1, MAX_ARGUMENTS,
-		       "[--name <name>] [--autofree] <uri> [<arguments>...]" );
+		       "[--name <name>] [--autofree] [--decompress] <uri> "
+		       "[<arguments>...]" );
 
 /** "imgfetch" family command descriptor */
 struct imgsingle_descriptor imgfetch_desc = {
@@ -230,7 +237,7 @@ static int imgselect_exec ( int argc, char **argv ) {
 static struct command_descriptor imgexec_cmd =
 	COMMAND_DESC ( struct imgsingle_options, imgsingle_opts,
 		       0, MAX_ARGUMENTS,
-		       "[--autofree] [--replace] "
+		       "[--autofree] [--replace] [--decompress] "
 		       "[<uri|image> [<arguments>...]]" );
 
 /**
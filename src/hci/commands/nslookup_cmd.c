@@ -23,6 +23,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <getopt.h>
 #include <ipxe/command.h>
 #include <ipxe/parseopt.h>
+#include <ipxe/dns.h>
 #include <usr/nslookup.h>
 
 /** @file
@@ -32,15 +33,21 @@ FILE_LICENCE ( GPL2_OR_LATER );
  */
 
 /** "nslookup" options */
-struct nslookup_options {};
+struct nslookup_options {
+	/** Bypass DNS cache */
+	int no_cache;
+};
 
 /** "nslookup" option list */
-static struct option_descriptor nslookup_opts[] = {};
+static struct option_descriptor nslookup_opts[] = {
+	OPTION_DESC ( "no-cache", 'n', no_argument,
+		      struct nslookup_options, no_cache, parse_flag ),
+};
 
 /** "nslookup" command descriptor */
 static struct command_descriptor nslookup_cmd =
 	COMMAND_DESC ( struct nslookup_options, nslookup_opts, 2, 2,
-		       "<setting> <name>" );
+		       "[--no-cache] <setting> <name>" );
 
 /**
  * The "nslookup" command
@@ -65,6 +72,10 @@ static int nslookup_exec ( int argc, char **argv ) {
 	/* Parse name to be resolved */
 	name = argv[ optind + 1 ];
 
+	/* Discard any cached answer, if applicable */
+	if ( opts.no_cache )
+		dns_cache_invalidate ( name );
+
 	/* Look up name */
 	if ( ( rc = nslookup ( name, setting_name ) ) != 0 )
 		return rc;
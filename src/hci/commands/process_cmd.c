@@ -0,0 +1,68 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdio.h>
+#include <getopt.h>
+#include <ipxe/command.h>
+#include <ipxe/parseopt.h>
+#include <usr/procmgmt.h>
+
+/** @file
+ *
+ * Process management commands
+ *
+ */
+
+/** "ps" options */
+struct ps_options {};
+
+/** "ps" option list */
+static struct option_descriptor ps_opts[] = {};
+
+/** "ps" command descriptor */
+static struct command_descriptor ps_cmd =
+	COMMAND_DESC ( struct ps_options, ps_opts, 0, 0, "" );
+
+/**
+ * The "ps" command
+ *
+ * @v argc		Argument count
+ * @v argv		Argument list
+ * @ret rc		Return status code
+ */
+static int ps_exec ( int argc, char **argv ) {
+	struct ps_options opts;
+	int rc;
+
+	/* Parse options */
+	if ( ( rc = parse_options ( argc, argv, &ps_cmd, &opts ) ) != 0 )
+		return rc;
+
+	pstat();
+
+	return 0;
+}
+
+/** Process management commands */
+struct command process_commands[] __command = {
+	{
+		.name = "ps",
+		.exec = ps_exec,
+	},
+};
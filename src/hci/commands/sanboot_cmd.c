@@ -25,6 +25,7 @@
 #include <ipxe/parseopt.h>
 #include <ipxe/uri.h>
 #include <ipxe/sanboot.h>
+#include <ipxe/blockcache.h>
 #include <usr/autoboot.h>
 
 FILE_LICENCE ( GPL2_OR_LATER );
@@ -71,6 +72,11 @@ static struct command_descriptor sanunhook_cmd =
 	COMMAND_DESC ( struct sanboot_options, sanboot_opts, 0, 0,
 		       "[--drive <drive>]" );
 
+/** "sanstat" command descriptor */
+static struct command_descriptor sanstat_cmd =
+	COMMAND_DESC ( struct sanboot_options, sanboot_opts, 0, 0,
+		       "[--drive <drive>]" );
+
 /**
  * The "sanboot", "sanhook" and "sanunhook" commands
  *
@@ -168,6 +174,45 @@ static int sanunhook_exec ( int argc, char **argv ) {
 				     URIBOOT_NO_SAN_BOOT ), 0 );
 }
 
+/**
+ * The "sanstat" command
+ *
+ * @v argc		Argument count
+ * @v argv		Argument list
+ * @ret rc		Return status code
+ */
+static int sanstat_exec ( int argc, char **argv ) {
+	struct sanboot_options opts;
+	struct block_cache_stats stats;
+	unsigned long total;
+	int rc;
+
+	/* Initialise options */
+	memset ( &opts, 0, sizeof ( opts ) );
+	opts.drive = san_default_drive();
+
+	/* Parse options */
+	if ( ( rc = reparse_options ( argc, argv, &sanstat_cmd, &opts ) ) != 0 )
+		return rc;
+
+	/* Get statistics */
+	if ( ( rc = san_stats ( opts.drive, &stats ) ) != 0 ) {
+		printf ( "Could not get statistics for drive %#02x: %s\n",
+			 opts.drive, strerror ( rc ) );
+		return rc;
+	}
+
+	/* Display statistics */
+	total = ( stats.hits + stats.misses );
+	printf ( "Drive %#02x cache %zdkB: %ld hits, %ld misses (%ld%%), "
+		 "%ld writes, %ld evictions\n", opts.drive,
+		 ( stats.size / 1024 ), stats.hits, stats.misses,
+		 ( total ? ( ( stats.hits * 100 ) / total ) : 0 ),
+		 stats.writes, stats.evictions );
+
+	return 0;
+}
+
 /** SAN commands */
 struct command sanboot_commands[] __command = {
 	{
@@ -182,4 +227,8 @@ struct command sanboot_commands[] __command = {
 		.name = "sanunhook",
 		.exec = sanunhook_exec,
 	},
+	{
+		.name = "sanstat",
+		.exec = sanstat_exec,
+	},
 };
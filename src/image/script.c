@@ -39,59 +39,227 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <usr/prompt.h>
 #include <ipxe/script.h>
 
-/** Offset within current script
+/** A parsed script */
+struct script {
+	/** Script text, with each line terminated by a NUL */
+	char *text;
+	/** Start of each line */
+	char **lines;
+	/** Number of lines */
+	unsigned int count;
+	/** Index of next line to be processed */
+	unsigned int next;
+	/** Label hash table
+	 *
+	 * Each non-empty entry holds the index of a label line plus
+	 * one.  Where a label is defined more than once, only the
+	 * first definition is recorded.
+	 */
+	unsigned int *labels;
+	/** Size of label hash table (zero or a power of two) */
+	unsigned int labels_size;
+};
+
+/** Currently executing script
  *
- * This is a global in order to allow goto_exec() to update the
- * offset.
+ * This is a global in order to allow goto_exec() to update the index
+ * of the next line to be processed.
  */
-static size_t script_offset;
+static struct script *current_script;
 
 /**
- * Process script lines
+ * Calculate hash of label name
+ *
+ * @v label		Label name
+ * @v len		Length of label name
+ * @ret hash		Hash value
+ */
+static unsigned int script_label_hash ( const char *label, size_t len ) {
+	unsigned int hash = 0;
+
+	while ( len-- )
+		hash = ( ( hash * 31 ) + *(label++) );
+	return hash;
+}
+
+/**
+ * Get length of name of label defined by a label line
+ *
+ * @v line		Label line
+ * @ret len		Length of label name
+ */
+static size_t script_label_len ( const char *line ) {
+	size_t len = 0;
+
+	while ( line[ 1 + len ] && ! isspace ( line[ 1 + len ] ) )
+		len++;
+	return len;
+}
+
+/**
+ * Find label within script
+ *
+ * @v script		Script
+ * @v label		Label name
+ * @v len		Length of label name
+ * @ret index		Index of label line, or negative error
+ */
+static int script_find_label ( struct script *script, const char *label,
+			       size_t len ) {
+	unsigned int mask = ( script->labels_size - 1 );
+	unsigned int hash;
+	unsigned int entry;
+	const char *line;
+
+	/* Check for absence of any labels */
+	if ( ! script->labels_size )
+		return -ENOENT;
+
+	/* Probe hash table */
+	for ( hash = script_label_hash ( label, len ) ; ; hash++ ) {
+		entry = script->labels[ hash & mask ];
+		if ( ! entry )
+			return -ENOENT;
+		line = script->lines[ entry - 1 ];
+		if ( ( script_label_len ( line ) == len ) &&
+		     ( memcmp ( &line[1], label, len ) == 0 ) )
+			return ( entry - 1 );
+	}
+}
+
+/**
+ * Free parsed script
+ *
+ * @v script		Script
+ */
+static void script_free ( struct script *script ) {
+
+	free ( script->labels );
+	free ( script->lines );
+	free ( script->text );
+	free ( script );
+}
+
+/**
+ * Parse script
  *
  * @v image		Script
+ * @ret script		Parsed script, or NULL on error
+ *
+ * The script is copied out of the image once and split into lines,
+ * and an index of all labels is constructed, so that neither line
+ * processing nor "goto" needs to rescan the image.
+ */
+static struct script * script_parse ( struct image *image ) {
+	struct script *script;
+	unsigned int num_labels = 0;
+	unsigned int mask;
+	unsigned int hash;
+	unsigned int i;
+	size_t offset;
+	size_t len;
+	char *line;
+	char *eol;
+
+	/* Allocate script */
+	script = zalloc ( sizeof ( *script ) );
+	if ( ! script )
+		goto err;
+
+	/* Copy script text */
+	script->text = malloc ( image->len + 1 /* NUL */ );
+	if ( ! script->text )
+		goto err;
+	copy_from_user ( script->text, image->data, 0, image->len );
+	script->text[image->len] = '\0';
+
+	/* Count lines */
+	offset = 0;
+	do {
+		eol = memchr ( &script->text[offset], '\n',
+			       ( image->len - offset ) );
+		offset = ( eol ? ( ( size_t ) ( eol + 1 - script->text ) ) :
+			   image->len );
+		script->count++;
+	} while ( offset < image->len );
+
+	/* Split into lines, excluding any terminating '\n' */
+	script->lines = malloc ( script->count * sizeof ( script->lines[0] ) );
+	if ( ! script->lines )
+		goto err;
+	for ( offset = 0, i = 0 ; i < script->count ; i++ ) {
+		line = &script->text[offset];
+		eol = memchr ( line, '\n', ( image->len - offset ) );
+		if ( eol )
+			*eol = '\0';
+		offset = ( eol ? ( ( size_t ) ( eol + 1 - script->text ) ) :
+			   image->len );
+		script->lines[i] = line;
+		if ( line[0] == ':' )
+			num_labels++;
+	}
+
+	/* Construct label hash table, keeping it at most half full */
+	if ( num_labels ) {
+		script->labels_size = 1;
+		while ( script->labels_size < ( 2 * num_labels ) )
+			script->labels_size <<= 1;
+		script->labels = zalloc ( script->labels_size *
+					  sizeof ( script->labels[0] ) );
+		if ( ! script->labels )
+			goto err;
+		mask = ( script->labels_size - 1 );
+		for ( i = 0 ; i < script->count ; i++ ) {
+			line = script->lines[i];
+			if ( line[0] != ':' )
+				continue;
+			len = script_label_len ( line );
+			if ( script_find_label ( script, &line[1], len ) >= 0 )
+				continue;
+			hash = script_label_hash ( &line[1], len );
+			while ( script->labels[ hash & mask ] )
+				hash++;
+			script->labels[ hash & mask ] = ( i + 1 );
+		}
+	}
+
+	DBGC ( image, "SCRIPT %s has %d lines and %d labels\n",
+	       image->name, script->count, num_labels );
+	return script;
+
+ err:
+	if ( script )
+		script_free ( script );
+	return NULL;
+}
+
+/**
+ * Process script lines
+ *
+ * @v script		Script
  * @v process_line	Line processor
  * @v terminate		Termination check
  * @ret rc		Return status code
  */
-static int process_script ( struct image *image,
+static int process_script ( struct script *script,
 			    int ( * process_line ) ( const char *line ),
 			    int ( * terminate ) ( int rc ) ) {
-	off_t eol;
-	size_t len;
-	char *line;
-	int rc;
+	const char *line;
+	int rc = 0;
 
-	script_offset = 0;
+	script->next = 0;
 
-	do {
-	
-		/* Find length of next line, excluding any terminating '\n' */
-		eol = memchr_user ( image->data, script_offset, '\n',
-				    ( image->len - script_offset ) );
-		if ( eol < 0 )
-			eol = image->len;
-		len = ( eol - script_offset );
-
-		/* Allocate buffer for line */
-		line = zalloc ( len + 1 /* NUL */ );
-		if ( ! line )
-			return -ENOMEM;
-
-		/* Copy line */
-		copy_from_user ( line, image->data, script_offset, len );
-		DBG ( "$ %s\n", line );
+	while ( script->next < script->count ) {
 
 		/* Move to next line */
-		script_offset += ( len + 1 );
+		line = script->lines[ script->next++ ];
+		DBG ( "$ %s\n", line );
 
-		/* Process and free line */
+		/* Process line */
 		rc = process_line ( line );
-		free ( line );
 		if ( terminate ( rc ) )
 			return rc;
-
-	} while ( script_offset < image->len );
+	}
 
 	return rc;
 }
@@ -135,23 +303,31 @@ static int script_exec_line ( const char *line ) {
  * @ret rc		Return status code
  */
 static int script_exec ( struct image *image ) {
-	size_t saved_offset;
+	struct script *saved_script;
+	struct script *script;
 	int rc;
 
+	/* Parse script */
+	script = script_parse ( image );
+	if ( ! script )
+		return -ENOMEM;
+
 	/* Temporarily de-register image, so that a "boot" command
 	 * doesn't throw us into an execution loop.
 	 */
 	unregister_image ( image );
 
 	/* Preserve state of any currently-running script */
-	saved_offset = script_offset;
+	saved_script = current_script;
+	current_script = script;
 
 	/* Process script */
-	rc = process_script ( image, script_exec_line,
+	rc = process_script ( script, script_exec_line,
 			      terminate_on_exit_or_failure );
 
 	/* Restore saved state */
-	script_offset = saved_offset;
+	current_script = saved_script;
+	script_free ( script );
 
 	/* Re-register image (unless we have been replaced) */
 	if ( ! image->replacement )
@@ -209,44 +385,6 @@ static struct option_descriptor goto_opts[] = {};
 static struct command_descriptor goto_cmd =
 	COMMAND_DESC ( struct goto_options, goto_opts, 1, 1, "<label>" );
 
-/**
- * Current "goto" label
- *
- * Valid only during goto_exec().  Consider this part of a closure.
- */
-static const char *goto_label;
-
-/**
- * Check for presence of label
- *
- * @v line		Script line
- * @ret rc		Return status code
- */
-static int goto_find_label ( const char *line ) {
-	size_t len = strlen ( goto_label );
-
-	if ( line[0] != ':' )
-		return -ENOENT;
-
-	if ( strncmp ( goto_label, &line[1], len ) != 0 )
-		return -ENOENT;
-
-	if ( line[ 1 + len ] && ! isspace ( line[ 1 + len ] ) )
-		return -ENOENT;
-
-	return 0;
-}
-
-/**
- * Terminate script processing when label is found
- *
- * @v rc		Line processing status
- * @ret terminate	Terminate script processing
- */
-static int terminate_on_label_found ( int rc ) {
-	return ( rc == 0 );
-}
-
 /**
  * "goto" command
  *
@@ -256,7 +394,8 @@ static int terminate_on_label_found ( int rc ) {
  */
 static int goto_exec ( int argc, char **argv ) {
 	struct goto_options opts;
-	size_t saved_offset;
+	const char *label;
+	int index;
 	int rc;
 
 	/* Parse options */
@@ -264,22 +403,22 @@ static int goto_exec ( int argc, char **argv ) {
 		return rc;
 
 	/* Sanity check */
-	if ( ! current_image ) {
+	if ( ! current_script ) {
 		rc = -ENOTTY;
 		printf ( "Not in a script: %s\n", strerror ( rc ) );
 		return rc;
 	}
 
 	/* Parse label */
-	goto_label = argv[optind];
+	label = argv[optind];
 
 	/* Find label */
-	saved_offset = script_offset;
-	if ( ( rc = process_script ( current_image, goto_find_label,
-				     terminate_on_label_found ) ) != 0 ) {
-		script_offset = saved_offset;
-		return rc;
-	}
+	index = script_find_label ( current_script, label, strlen ( label ) );
+	if ( index < 0 )
+		return index;
+
+	/* Continue processing from the line following the label */
+	current_script->next = ( index + 1 );
 
 	/* Terminate processing of current command */
 	shell_stop ( SHELL_STOP_COMMAND );
@@ -10,12 +10,79 @@ struct cipher_algorithm;
 
 #include "crypto/axtls/crypto.h"
 
+/** AES round keys, in the byte order used by FIPS-197 */
+struct aes_round_keys {
+	/** Encryption round keys */
+	uint8_t encrypt[ AES_MAXROUNDS + 1 ][AES_BLOCKSIZE];
+	/** Decryption round keys (for the equivalent inverse cipher) */
+	uint8_t decrypt[ AES_MAXROUNDS + 1 ][AES_BLOCKSIZE];
+};
+
 /** AES context */
 struct aes_context {
 	/** AES context for AXTLS */
 	AES_CTX axtls_ctx;
 	/** Cipher is being used for decrypting */
 	int decrypting;
+	/** Accelerated implementation, or NULL to use AXTLS */
+	struct aes_accelerator *accel;
+	/** Round keys for accelerated implementation */
+	struct aes_round_keys keys;
+};
+
+/** An accelerated AES implementation */
+struct aes_accelerator {
+	/** Name */
+	const char *name;
+	/**
+	 * Prepare round keys
+	 *
+	 * @v ctx		AES context
+	 *
+	 * The AXTLS encryption key schedule has already been
+	 * generated.
+	 */
+	void ( * setkey ) ( struct aes_context *ctx );
+	/**
+	 * Encrypt data in CBC mode
+	 *
+	 * @v ctx		AES context
+	 * @v src		Data to encrypt
+	 * @v dst		Buffer for encrypted data
+	 * @v len		Length of data (a multiple of the block size)
+	 * @v iv		Initialisation vector (updated on return)
+	 */
+	void ( * cbc_encrypt ) ( struct aes_context *ctx, const void *src,
+				 void *dst, size_t len, void *iv );
+	/**
+	 * Decrypt data in CBC mode
+	 *
+	 * @v ctx		AES context
+	 * @v src		Data to decrypt
+	 * @v dst		Buffer for decrypted data
+	 * @v len		Length of data (a multiple of the block size)
+	 * @v iv		Initialisation vector (updated on return)
+	 */
+	void ( * cbc_decrypt ) ( struct aes_context *ctx, const void *src,
+				 void *dst, size_t len, void *iv );
+	/**
+	 * Encrypt single block
+	 *
+	 * @v ctx		AES context
+	 * @v src		Data to encrypt
+	 * @v dst		Buffer for encrypted data
+	 */
+	void ( * encrypt ) ( struct aes_context *ctx, const void *src,
+			     void *dst );
+	/**
+	 * Decrypt single block
+	 *
+	 * @v ctx		AES context
+	 * @v src		Data to decrypt
+	 * @v dst		Buffer for decrypted data
+	 */
+	void ( * decrypt ) ( struct aes_context *ctx, const void *src,
+			     void *dst );
 };
 
 /** AES context size */
@@ -25,6 +92,8 @@ struct aes_context {
 extern void axtls_aes_encrypt ( const AES_CTX *ctx, uint32_t *data );
 extern void axtls_aes_decrypt ( const AES_CTX *ctx, uint32_t *data );
 
+extern struct aes_accelerator *aes_accel;
+
 extern struct cipher_algorithm aes_algorithm;
 extern struct cipher_algorithm aes_cbc_algorithm;
 
@@ -106,8 +106,30 @@ struct aoehdr {
 /** AoE tag magic marker */
 #define AOE_TAG_MAGIC 0x18ae0000
 
-/** Maximum number of sectors per packet */
-#define AOE_MAX_COUNT 2
+/** Maximum number of sectors per ATA command
+ *
+ * Commands larger than a single frame are split into multiple
+ * frames.
+ */
+#define AOE_MAX_COUNT 128
+
+/** Maximum number of sectors per frame */
+#define AOE_MAX_FRAME_COUNT 255
+
+/** Default maximum number of outstanding frames per target */
+#define AOE_DEFAULT_WINDOW 16
+
+/** Number of AoE tag hash buckets */
+#define AOE_TAG_BUCKETS 64
+
+/** Minimum retransmission timeout (in milliseconds) */
+#define AOE_MIN_TIMEOUT_MS 20
+
+/** Maximum (and initial) retransmission timeout (in milliseconds)
+ *
+ * Retransmissions back off exponentially from this value.
+ */
+#define AOE_MAX_TIMEOUT_MS 250
 
 /** AoE boot firmware table signature */
 #define ABFT_SIG ACPI_SIGNATURE ( 'a', 'B', 'F', 'T' )
@@ -0,0 +1,83 @@
+#ifndef _IPXE_BLOCKCACHE_H
+#define _IPXE_BLOCKCACHE_H
+
+/** @file
+ *
+ * Block device cache
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <ipxe/list.h>
+#include <ipxe/uaccess.h>
+
+/** Number of blocks per block cache line
+ *
+ * Must be at most the number of bits in the line's validity bitmap.
+ */
+#define BLOCK_CACHE_LINE_BLOCKS 8
+
+/** Number of block cache hash buckets */
+#define BLOCK_CACHE_BUCKETS 256
+
+/** A block cache line */
+struct block_cache_line {
+	/** Hash bucket list */
+	struct list_head hash;
+	/** Least-recently-used list */
+	struct list_head lru;
+	/** Logical block address of first block in line */
+	uint64_t lba;
+	/** Bitmap of valid blocks within line */
+	uint8_t valid;
+};
+
+/** Block cache statistics */
+struct block_cache_stats {
+	/** Cache size (in bytes) */
+	size_t size;
+	/** Number of blocks read from the cache */
+	unsigned long hits;
+	/** Number of blocks that had to be read from the device */
+	unsigned long misses;
+	/** Number of blocks written through the cache */
+	unsigned long writes;
+	/** Number of lines evicted to make room for new data */
+	unsigned long evictions;
+};
+
+/** A block cache */
+struct block_cache {
+	/** Block size */
+	size_t blksize;
+	/** Number of lines */
+	unsigned int num_lines;
+	/** Lines */
+	struct block_cache_line *lines;
+	/** Line data */
+	userptr_t data;
+	/** Hash buckets */
+	struct list_head buckets[BLOCK_CACHE_BUCKETS];
+	/** Lines, most recently used first */
+	struct list_head lru;
+	/** Statistics */
+	struct block_cache_stats stats;
+};
+
+extern int block_cache_init ( struct block_cache *cache, size_t blksize,
+			      size_t max_len );
+extern void block_cache_fini ( struct block_cache *cache );
+extern unsigned int block_cache_read ( struct block_cache *cache, uint64_t lba,
+				       unsigned int count, userptr_t buffer );
+extern unsigned int block_cache_missing ( struct block_cache *cache,
+					  uint64_t lba, unsigned int count );
+extern void block_cache_insert ( struct block_cache *cache, uint64_t lba,
+				 unsigned int count, userptr_t buffer );
+extern void block_cache_write ( struct block_cache *cache, uint64_t lba,
+				unsigned int count, userptr_t buffer );
+extern void block_cache_invalidate ( struct block_cache *cache, uint64_t lba,
+				     unsigned int count );
+
+#endif /* _IPXE_BLOCKCACHE_H */
@@ -5,6 +5,19 @@ FILE_LICENCE ( GPL2_OR_LATER );
 
 #include <stdint.h>
 
+/**
+ * Calculate 32-bit little-endian CRC checksum
+ *
+ * @v seed	Initial value
+ * @v data	Data to checksum
+ * @v len	Length of data
+ * @ret crc	CRC checksum
+ */
+typedef u32 ( crc32_le_t ) ( u32 seed, const void *data, size_t len );
+
+extern crc32_le_t *crc32_le_accel;
+
+u32 crc32_le_generic ( u32 seed, const void *data, size_t len );
 u32 crc32_le ( u32 seed, const void *data, size_t len );
 
 #endif
@@ -0,0 +1,54 @@
+#ifndef _IPXE_DECOMPRESS_H
+#define _IPXE_DECOMPRESS_H
+
+/** @file
+ *
+ * Streaming decompression
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <strings.h>
+#include <ipxe/tables.h>
+
+struct interface;
+
+/** A content encoding */
+struct content_encoding {
+	/** Name (e.g. "gzip") */
+	const char *name;
+	/** Add decoding filter
+	 *
+	 * @v xfer		Data transfer interface to receive decoded data
+	 * @v next		Interface to receive encoded data
+	 * @ret rc		Return status code
+	 */
+	int ( * add ) ( struct interface *xfer, struct interface **next );
+};
+
+/** Content encoding table */
+#define CONTENT_ENCODINGS \
+	__table ( struct content_encoding, "content_encodings" )
+
+/** Declare a content encoding */
+#define __content_encoding __table_entry ( CONTENT_ENCODINGS, 01 )
+
+/**
+ * Find content encoding
+ *
+ * @v name		Name
+ * @ret encoding	Content encoding, or NULL if not supported
+ */
+static inline struct content_encoding *
+find_content_encoding ( const char *name ) {
+	struct content_encoding *encoding;
+
+	for_each_table_entry ( encoding, CONTENT_ENCODINGS ) {
+		if ( strcasecmp ( name, encoding->name ) == 0 )
+			return encoding;
+	}
+	return NULL;
+}
+
+#endif /* _IPXE_DECOMPRESS_H */
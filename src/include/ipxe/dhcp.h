@@ -238,6 +238,14 @@ struct dhcp_client_id {
 /** User class identifier */
 #define DHCP_USER_CLASS_ID 77
 
+/** Rapid commit
+ *
+ * This zero-length option (defined in RFC 4039) indicates that the
+ * client is prepared to accept a DHCPACK in response to its
+ * DHCPDISCOVER, omitting the DHCPOFFER/DHCPREQUEST exchange.
+ */
+#define DHCP_RAPID_COMMIT 80
+
 /** Client system architecture */
 #define DHCP_CLIENT_ARCHITECTURE 93
 
@@ -367,6 +375,43 @@ struct dhcp_client_uuid {
 /** Cross-signed certificate source */
 #define DHCP_EB_CROSS_CERT DHCP_ENCAP_OPT ( DHCP_EB_ENCAP, 0x5d )
 
+/** Number of parallel HTTP download connections */
+#define DHCP_EB_HTTP_CONNECTIONS DHCP_ENCAP_OPT ( DHCP_EB_ENCAP, 0x60 )
+
+/** Maximum number of outstanding AoE frames per target */
+#define DHCP_EB_AOE_WINDOW DHCP_ENCAP_OPT ( DHCP_EB_ENCAP, 0x61 )
+
+/** Maximum number of pipelined HTTP block device range requests */
+#define DHCP_EB_HTTP_PIPELINE DHCP_ENCAP_OPT ( DHCP_EB_ENCAP, 0x62 )
+
+/** Time to wait for ProxyDHCP offers (in milliseconds)
+ *
+ * If set to zero, iPXE will accept the first DHCPOFFER immediately,
+ * while continuing to listen for ProxyDHCP offers during the
+ * DHCPREQUEST phase.
+ */
+#define DHCP_EB_DHCP_PROXY_WAIT DHCP_ENCAP_OPT ( DHCP_EB_ENCAP, 0x63 )
+
+/** Request rapid commit (RFC 4039) when sending DHCPDISCOVER */
+#define DHCP_EB_DHCP_RAPID_COMMIT DHCP_ENCAP_OPT ( DHCP_EB_ENCAP, 0x64 )
+
+/** Time spent in DHCP discovery (in milliseconds) */
+#define DHCP_EB_DHCP_DISCOVER_TIME DHCP_ENCAP_OPT ( DHCP_EB_ENCAP, 0x65 )
+
+/** Time spent in DHCP request (in milliseconds) */
+#define DHCP_EB_DHCP_REQUEST_TIME DHCP_ENCAP_OPT ( DHCP_EB_ENCAP, 0x66 )
+
+/** Time spent in ProxyDHCP request (in milliseconds) */
+#define DHCP_EB_DHCP_PROXY_TIME DHCP_ENCAP_OPT ( DHCP_EB_ENCAP, 0x67 )
+
+/** Configure all network devices in parallel when autobooting
+ *
+ * If set to a non-zero value, autoboot will perform DHCP on all
+ * network devices concurrently and boot from the first device to be
+ * configured.
+ */
+#define DHCP_EB_DHCP_PARALLEL DHCP_ENCAP_OPT ( DHCP_EB_ENCAP, 0x68 )
+
 /** Skip PXE DHCP protocol extensions such as ProxyDHCP
  *
  * If set to a non-zero value, iPXE will not wait for ProxyDHCP offers
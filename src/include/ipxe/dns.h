@@ -43,6 +43,15 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #define	DNS_MAX_RETRIES		3
 #define	DNS_MAX_CNAME_RECURSION	0x30
 
+/** Maximum number of DNS cache entries */
+#define DNS_CACHE_MAX_ENTRIES	16
+
+/** Maximum time (in seconds) for which a DNS answer is cached */
+#define DNS_CACHE_MAX_TTL	3600
+
+/** Time (in seconds) for which a nonexistent name is cached */
+#define DNS_CACHE_NEGATIVE_TTL	10
+
 /*
  * DNS protocol structures
  *
@@ -89,4 +98,6 @@ union dns_rr_info {
 	struct dns_rr_info_cname cname;
 };
 
+extern void dns_cache_invalidate ( const char *name );
+
 #endif /* _IPXE_DNS_H */
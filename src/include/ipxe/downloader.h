@@ -30,9 +30,13 @@ struct downloader {
 	struct image *image;
 	/** Current position within image buffer */
 	size_t pos;
+	/** Allocated length of image buffer */
+	size_t capacity;
 };
 
 extern int create_downloader ( struct interface *job, struct image *image,
+			       int ( * filter ) ( struct interface *xfer,
+						  struct interface **next ),
 			       int type, ... );
 
 #endif /* _IPXE_DOWNLOADER_H */
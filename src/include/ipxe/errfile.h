@@ -63,6 +63,9 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #define ERRFILE_test		       ( ERRFILE_CORE | 0x00170000 )
 #define ERRFILE_xferbuf		       ( ERRFILE_CORE | 0x00180000 )
 #define ERRFILE_pending		       ( ERRFILE_CORE | 0x00190000 )
+#define ERRFILE_blockcache	       ( ERRFILE_CORE | 0x001a0000 )
+#define ERRFILE_inflate		       ( ERRFILE_CORE | 0x001b0000 )
+#define ERRFILE_decompress	       ( ERRFILE_CORE | 0x001c0000 )
 
 #define ERRFILE_eisa		     ( ERRFILE_DRIVER | 0x00000000 )
 #define ERRFILE_isa		     ( ERRFILE_DRIVER | 0x00010000 )
@@ -207,6 +210,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #define ERRFILE_fcns			( ERRFILE_NET | 0x002f0000 )
 #define ERRFILE_vlan			( ERRFILE_NET | 0x00300000 )
 #define ERRFILE_bittorrent		( ERRFILE_NET | 0x00310000 )
+#define ERRFILE_httpconn		( ERRFILE_NET | 0x00320000 )
 
 #define ERRFILE_image		      ( ERRFILE_IMAGE | 0x00000000 )
 #define ERRFILE_elf		      ( ERRFILE_IMAGE | 0x00010000 )
@@ -266,6 +270,8 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #define ERRFILE_nslookup	      ( ERRFILE_OTHER | 0x00300000 )
 #define ERRFILE_efi_snp_hii	      ( ERRFILE_OTHER | 0x00310000 )
 #define ERRFILE_readline	      ( ERRFILE_OTHER | 0x00320000 )
+#define ERRFILE_benchmark	      ( ERRFILE_OTHER | 0x00330000 )
+#define ERRFILE_benchmark_cmd	      ( ERRFILE_OTHER | 0x00340000 )
 
 /** @} */
 
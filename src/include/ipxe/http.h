@@ -15,10 +15,34 @@ FILE_LICENCE ( GPL2_OR_LATER );
 /** HTTPS default port */
 #define HTTPS_PORT 443
 
+/** Maximum number of idle connections kept for reuse */
+#define HTTP_POOL_MAX 8
+
+/** Maximum number of idle connections kept for reuse per origin */
+#define HTTP_POOL_MAX_PER_ORIGIN 4
+
+/** Idle connection timeout
+ *
+ * Most servers close idle keep-alive connections after a few
+ * seconds; give up on them slightly earlier to avoid racing against
+ * the server's own close.
+ */
+#define HTTP_POOL_TIMEOUT ( 4 * TICKS_PER_SEC )
+
 extern int http_open_filter ( struct interface *xfer, struct uri *uri,
 			      unsigned int default_port,
 			      int ( * filter ) ( struct interface *,
 						 const char *,
 						 struct interface ** ) );
+extern void http_connection_put ( struct interface *socket, struct uri *uri,
+				  unsigned int default_port,
+				  int ( * filter ) ( struct interface *,
+						     const char *,
+						     struct interface ** ) );
+extern int http_connection_get ( struct interface *socket, struct uri *uri,
+				 unsigned int default_port,
+				 int ( * filter ) ( struct interface *,
+						    const char *,
+						    struct interface ** ) );
 
 #endif /* _IPXE_HTTP_H */
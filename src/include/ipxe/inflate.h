@@ -0,0 +1,146 @@
+#ifndef _IPXE_INFLATE_H
+#define _IPXE_INFLATE_H
+
+/** @file
+ *
+ * DEFLATE decompression
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** Compressed data formats */
+enum inflate_format {
+	/** Raw DEFLATE data (RFC 1951) */
+	INFLATE_RAW = 0,
+	/** zlib format (RFC 1950) */
+	INFLATE_ZLIB,
+	/** gzip format (RFC 1952) */
+	INFLATE_GZIP,
+};
+
+/** Sliding window length (the maximum DEFLATE match distance) */
+#define INFLATE_WINDOW_LEN 32768
+
+/** Number of bits decoded by a single Huffman fast table lookup */
+#define INFLATE_FAST_BITS 9
+
+/** Maximum Huffman code length */
+#define INFLATE_MAX_BITS 15
+
+/** Number of literal/length symbols */
+#define INFLATE_LITLEN_SYMBOLS 288
+
+/** Number of distance symbols */
+#define INFLATE_DIST_SYMBOLS 32
+
+/** Number of code length symbols */
+#define INFLATE_CLEN_SYMBOLS 19
+
+/** A canonical Huffman code */
+struct inflate_huffman {
+	/** Fast lookup table
+	 *
+	 * Indexed by the next INFLATE_FAST_BITS bits of input.  Each
+	 * entry holds the symbol in the low bits and the code length
+	 * in the high bits, or zero if the code is longer than
+	 * INFLATE_FAST_BITS.
+	 */
+	uint16_t fast[ 1 << INFLATE_FAST_BITS ];
+	/** Number of codes of each length */
+	uint16_t count[ INFLATE_MAX_BITS + 1 ];
+	/** Symbols, ordered by code */
+	uint16_t symbol[INFLATE_LITLEN_SYMBOLS];
+};
+
+/** Shift applied to code length within a fast lookup table entry */
+#define INFLATE_FAST_LEN_SHIFT 9
+
+/** A DEFLATE decompressor */
+struct inflate {
+	/** Data format */
+	enum inflate_format format;
+	/** Current state */
+	unsigned int state;
+
+	/** Remaining input data */
+	const uint8_t *in;
+	/** Length of remaining input data */
+	size_t in_len;
+	/** Bit accumulator */
+	uint32_t bits;
+	/** Number of valid bits in accumulator */
+	unsigned int bits_len;
+
+	/** Sliding window (and output buffer) */
+	uint8_t *window;
+	/** Total length of output produced */
+	size_t out_len;
+	/** Total length of output delivered */
+	size_t flushed;
+	/** Total length of output produced by previous gzip members */
+	size_t member;
+
+	/** Current block is the final block */
+	int final;
+	/** Remaining length of stored block, or of pending match */
+	size_t remaining;
+	/** Distance of pending match */
+	size_t distance;
+	/** Literal/length and distance codes are the fixed codes */
+	int fixed;
+	/** Literal/length code */
+	struct inflate_huffman litlen;
+	/** Distance code (also used for the code length code) */
+	struct inflate_huffman dist;
+
+	/** Number of literal/length codes in dynamic block */
+	unsigned int hlit;
+	/** Number of distance codes in dynamic block */
+	unsigned int hdist;
+	/** Number of code length codes in dynamic block */
+	unsigned int hclen;
+	/** Number of code lengths read so far */
+	unsigned int count;
+	/** Code lengths for dynamic block */
+	uint8_t lengths[ INFLATE_LITLEN_SYMBOLS + INFLATE_DIST_SYMBOLS ];
+
+	/** Header or trailer bytes read so far */
+	uint8_t header[10];
+	/** Number of header or trailer bytes read so far */
+	unsigned int header_len;
+	/** Outstanding gzip header flags */
+	unsigned int header_flags;
+	/** Remaining length of gzip extra field */
+	size_t extra_len;
+	/** Running checksum (CRC32 for gzip, Adler-32 for zlib) */
+	uint32_t checksum;
+	/** Length of trailing data ignored after end of stream */
+	size_t trailing;
+
+	/**
+	 * Deliver decompressed data
+	 *
+	 * @v inflate		Decompressor
+	 * @v data		Decompressed data
+	 * @v len		Length of decompressed data
+	 * @ret rc		Return status code
+	 */
+	int ( * deliver ) ( struct inflate *inflate, const void *data,
+			    size_t len );
+};
+
+extern int inflate_init ( struct inflate *inflate,
+			  enum inflate_format format,
+			  int ( * deliver ) ( struct inflate *inflate,
+					      const void *data,
+					      size_t len ) );
+extern void inflate_free ( struct inflate *inflate );
+extern int inflate_data ( struct inflate *inflate, const void *data,
+			  size_t len );
+extern int inflate_finished ( struct inflate *inflate );
+
+#endif /* _IPXE_INFLATE_H */
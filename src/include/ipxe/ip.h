@@ -70,22 +70,67 @@ struct ipv4_miniroute {
 	struct in_addr gateway;
 };
 
+/** A hole in an IPv4 fragment reassembly buffer */
+struct ipv4_fragment_hole {
+	/** List of holes */
+	struct list_head list;
+	/** Offset of first missing byte */
+	size_t first;
+	/** Offset following last missing byte */
+	size_t last;
+};
+
 /* IPv4 fragment reassembly buffer */
 struct ipv4_fragment {
 	/* List of fragment reassembly buffers */
 	struct list_head list;
-	/** Reassembled packet */
+	/** Reassembled packet
+	 *
+	 * The payload is placed directly at its final offset from
+	 * the I/O buffer's data pointer.  Sufficient headroom is
+	 * reserved for the largest possible IPv4 header.
+	 */
 	struct io_buffer *iobuf;
-	/** Current offset */
-	size_t offset;
+	/** Allocated payload length */
+	size_t capacity;
+	/** Total payload length, or zero if not yet known */
+	size_t len;
+	/** Highest payload offset received so far */
+	size_t extent;
+	/** Length of IPv4 header from first fragment, or zero */
+	size_t hdrlen;
+	/** List of holes */
+	struct list_head holes;
+	/** Source address */
+	struct in_addr src;
+	/** Destination address */
+	struct in_addr dest;
+	/** Identification */
+	uint16_t ident;
+	/** Protocol */
+	uint8_t protocol;
 	/** Reassembly timer */
 	struct retry_timer timer;
 };
 
+/** IPv4 fragment reassembly statistics */
+struct ipv4_fragment_stats {
+	/** Number of datagrams successfully reassembled */
+	unsigned int reassembled;
+	/** Number of fragments dropped */
+	unsigned int dropped;
+	/** Number of datagrams abandoned due to timeout */
+	unsigned int timeouts;
+	/** Number of datagrams evicted to free memory */
+	unsigned int evicted;
+};
+
 extern struct list_head ipv4_miniroutes;
 
 extern struct net_protocol ipv4_protocol __net_protocol;
 
+extern struct ipv4_fragment_stats ipv4_fragment_stats;
+
 extern int ipv4_has_any_addr ( struct net_device *netdev );
 
 #endif /* _IPXE_IP_H */
@@ -14,6 +14,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/scsi.h>
 #include <ipxe/chap.h>
 #include <ipxe/refcnt.h>
+#include <ipxe/list.h>
 #include <ipxe/xfer.h>
 #include <ipxe/process.h>
 
@@ -119,8 +120,10 @@ struct iscsi_bhs_common_response {
 	uint32_t statsn;
 	/** Expected command sequence number */
 	uint32_t expcmdsn;
+	/** Maximum command sequence number */
+	uint32_t maxcmdsn;
 	/** Fields specific to the PDU type */
-	uint8_t other_d[16];
+	uint8_t other_d[12];
 };
 
 /**
@@ -529,6 +532,71 @@ enum iscsi_rx_state {
 	ISCSI_RX_DATA_PADDING,
 };
 
+/** Maximum number of outstanding iSCSI tasks per session */
+#define ISCSI_MAX_TASKS 16
+
+/** An iSCSI task
+ *
+ * A task represents a single outstanding SCSI command.
+ */
+struct iscsi_task {
+	/** Reference counter */
+	struct refcnt refcnt;
+	/** iSCSI session */
+	struct iscsi_session *iscsi;
+	/** List of outstanding tasks within session */
+	struct list_head list;
+	/** SCSI command interface */
+	struct interface data;
+
+	/** SCSI command */
+	struct scsi_cmd command;
+	/** Initiator task tag */
+	uint32_t itt;
+	/** Command sequence number */
+	uint32_t cmdsn;
+	/** Task flags
+	 *
+	 * This is the bitwise-OR of zero or more ISCSI_TASK_XXX
+	 * constants.
+	 */
+	unsigned int flags;
+
+	/** Target transfer tag
+	 *
+	 * This is the tag attached to a sequence of data-out PDUs in
+	 * response to an R2T.
+	 */
+	uint32_t ttt;
+	/** Transfer offset
+	 *
+	 * This is the offset for an in-progress sequence of data-out
+	 * PDUs in response to an R2T.
+	 */
+	uint32_t transfer_offset;
+	/** Transfer length
+	 *
+	 * This is the length for an in-progress sequence of data-out
+	 * PDUs in response to an R2T.
+	 */
+	uint32_t transfer_len;
+	/** Data sequence number of next data-out PDU within transfer */
+	unsigned int datasn;
+};
+
+/** iSCSI task needs to send the SCSI command PDU */
+#define ISCSI_TASK_TX_COMMAND 0x0001
+
+/** iSCSI task needs to send data-out PDUs */
+#define ISCSI_TASK_TX_DATA_OUT 0x0002
+
+/** iSCSI task has been abandoned by the SCSI layer
+ *
+ * The task's responses will still be consumed, but any received data
+ * will be discarded.
+ */
+#define ISCSI_TASK_ORPHAN 0x0004
+
 /** An iSCSI session */
 struct iscsi_session {
 	/** Reference counter */
@@ -536,8 +604,6 @@ struct iscsi_session {
 
 	/** SCSI command-issuing interface */
 	struct interface control;
-	/** SCSI command interface */
-	struct interface data;
 	/** Transport-layer socket */
 	struct interface socket;
 
@@ -583,36 +649,26 @@ struct iscsi_session {
 	uint16_t isid_iana_qual;
 	/** Initiator task tag
 	 *
-	 * This is the tag of the current command.  It is incremented
-	 * whenever a new command is started.
+	 * This is the tag used for login requests.  It is reassigned
+	 * whenever a new connection is opened.
 	 */
 	uint32_t itt;
-	/** Target transfer tag
-	 *
-	 * This is the tag attached to a sequence of data-out PDUs in
-	 * response to an R2T.
-	 */
-	uint32_t ttt;
-	/** Transfer offset
-	 *
-	 * This is the offset for an in-progress sequence of data-out
-	 * PDUs in response to an R2T.
-	 */
-	uint32_t transfer_offset;
-	/** Transfer length
-	 *
-	 * This is the length for an in-progress sequence of data-out
-	 * PDUs in response to an R2T.
-	 */
-	uint32_t transfer_len;
 	/** Command sequence number
 	 *
-	 * This is the sequence number of the current command, used to
-	 * fill out the CmdSN field in iSCSI request PDUs.  It is
-	 * updated with the value of the ExpCmdSN field whenever we
-	 * receive an iSCSI response PDU containing such a field.
+	 * This is the sequence number to be assigned to the next
+	 * command, used to fill out the CmdSN field in iSCSI request
+	 * PDUs.  It is updated with the value of the ExpCmdSN field
+	 * whenever we receive a login response, and incremented
+	 * whenever a new SCSI command is issued.
 	 */
 	uint32_t cmdsn;
+	/** Maximum command sequence number
+	 *
+	 * This is the most recent valid MaxCmdSN received from the
+	 * target.  Commands with a CmdSN beyond this value may not be
+	 * sent.
+	 */
+	uint32_t maxcmdsn;
 	/** Status sequence number
 	 *
 	 * This is the most recent status sequence number present in
@@ -640,8 +696,12 @@ struct iscsi_session {
 	/** Buffer for received data (not always used) */
 	void *rx_buffer;
 
-	/** Current SCSI command, if any */
-	struct scsi_cmd *command;
+	/** Outstanding tasks, in order of issue */
+	struct list_head tasks;
+	/** Number of outstanding tasks */
+	unsigned int num_tasks;
+	/** Task owning the current TX PDU, if any */
+	struct iscsi_task *tx_task;
 
 	/** Target socket address (for boot firmware table) */
 	struct sockaddr target_sockaddr;
@@ -21,7 +21,18 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/tables.h>
 #include <valgrind/memcheck.h>
 
+/** Allocator statistics */
+struct malloc_stats {
+	/** Number of successful allocations */
+	unsigned long allocs;
+	/** Number of frees */
+	unsigned long frees;
+	/** Number of failed allocations */
+	unsigned long failures;
+};
+
 extern size_t freemem;
+extern struct malloc_stats malloc_stats;
 
 extern void * __malloc alloc_memblock ( size_t size, size_t align,
 					size_t offset );
@@ -91,6 +91,17 @@ struct net_protocol {
 	 * allocated.
 	 */
 	const char * ( *ntoa ) ( const void * net_addr );
+	/**
+	 * Complete a batch of received packets (optional)
+	 *
+	 * @v netdev		Network device
+	 *
+	 * This method is called after each batch of packets received
+	 * from a network device has been handed to the network layer,
+	 * allowing per-packet work (such as address lookups) to be
+	 * cached for the duration of the batch.
+	 */
+	void ( * rx_batch_end ) ( struct net_device *netdev );
 	/** Network-layer protocol
 	 *
 	 * This is an ETH_P_XXX constant, in network-byte order
@@ -283,6 +294,16 @@ struct net_device_stats {
 	struct net_device_error errors[NETDEV_MAX_UNIQUE_ERRORS];
 };
 
+/** Network device receive batch statistics */
+struct net_device_batch_stats {
+	/** Count of receive batches */
+	unsigned int batches;
+	/** Count of packets processed in receive batches */
+	unsigned int packets;
+	/** Count of batches terminated by exhaustion of receive budget */
+	unsigned int exhausted;
+};
+
 /**
  * A network device
  *
@@ -352,6 +373,18 @@ struct net_device {
 	struct net_device_stats tx_stats;
 	/** RX statistics */
 	struct net_device_stats rx_stats;
+	/** RX batch statistics */
+	struct net_device_batch_stats rx_batch_stats;
+	/** Maximum number of received packets to process per poll
+	 *
+	 * Packets beyond this budget are left on the RX queue until
+	 * the next poll, to avoid starving other processes (such as
+	 * TCP transmission) during large bursts of received traffic.
+	 * The device is not polled while a full budget's worth of
+	 * packets remains queued.  This may be changed at runtime via
+	 * the "rxbudget" setting.
+	 */
+	unsigned int rx_budget;
 
 	/** Configuration settings applicable to this device */
 	struct generic_settings settings;
@@ -441,6 +474,9 @@ struct net_driver {
 /** Bus ID setting tag */
 #define NETDEV_SETTING_TAG_BUS_ID NETDEV_SETTING_TAG ( 0x02 )
 
+/** Network device receive budget setting tag */
+#define NETDEV_SETTING_TAG_RX_BUDGET NETDEV_SETTING_TAG ( 0x03 )
+
 extern struct list_head net_devices;
 extern struct net_device_operations null_netdev_operations;
 extern struct settings_operations netdev_settings_operations;
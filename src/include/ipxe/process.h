@@ -9,6 +9,7 @@
 
 FILE_LICENCE ( GPL2_OR_LATER );
 
+#include <stdint.h>
 #include <ipxe/list.h>
 #include <ipxe/refcnt.h>
 #include <ipxe/tables.h>
@@ -25,8 +26,35 @@ struct process {
 	 * this field may be NULL.
 	 */
 	struct refcnt *refcnt;
+	/** Sleep state (PROC_SLEEP_XXX), or zero if runnable */
+	int sleeping;
+	/** Wakeup time (in ticks), if sleeping with a timeout */
+	unsigned long wake;
+	/** Number of steps executed */
+	unsigned long steps;
+	/** Total execution time (in CPU-specific profiling ticks) */
+	uint64_t time;
 };
 
+/** Process scheduling priorities */
+enum process_priority {
+	/** High priority (e.g. network device polling) */
+	PROC_PRIO_HIGH = 0,
+	/** Normal priority */
+	PROC_PRIO_NORMAL,
+	/** Low priority */
+	PROC_PRIO_LOW,
+};
+
+/** Number of process scheduling priorities */
+#define PROC_NUM_PRIORITIES 3
+
+/** Process is sleeping with no timeout */
+#define PROC_SLEEP_FOREVER 1
+
+/** Process is sleeping with a timeout */
+#define PROC_SLEEP_TIMED 2
+
 /** A process descriptor */
 struct process_descriptor {
 	/** Offset of process within containing object */
@@ -41,6 +69,8 @@ struct process_descriptor {
 	void ( * step ) ( void *object );
 	/** Automatically reschedule the process */
 	int reschedule;
+	/** Scheduling priority */
+	enum process_priority priority;
 };
 
 /**
@@ -81,6 +111,23 @@ struct process_descriptor {
 		.offset = process_offset ( object_type, process ),	      \
 		.step = PROC_STEP ( object_type, _step ),		      \
 		.reschedule = 1,					      \
+		.priority = PROC_PRIO_NORMAL,				      \
+	}
+
+/**
+ * Define a process descriptor with a specified priority
+ *
+ * @v object_type	Containing object data type
+ * @v process		Process name (i.e. field within object data type)
+ * @v step		Process' step() method
+ * @v _priority		Scheduling priority
+ * @ret desc		Object interface descriptor
+ */
+#define PROC_DESC_PRIO( object_type, process, _step, _priority ) {	      \
+		.offset = process_offset ( object_type, process ),	      \
+		.step = PROC_STEP ( object_type, _step ),		      \
+		.reschedule = 1,					      \
+		.priority = _priority,					      \
 	}
 
 /**
@@ -95,6 +142,7 @@ struct process_descriptor {
 		.offset = process_offset ( object_type, process ),	      \
 		.step = PROC_STEP ( object_type, _step ),		      \
 		.reschedule = 0,					      \
+		.priority = PROC_PRIO_NORMAL,				      \
 	}
 
 /**
@@ -105,18 +153,36 @@ struct process_descriptor {
  * @v step		Process' step() method
  * @ret desc		Object interface descriptor
  */
-#define PROC_DESC_PURE( _step ) {					      \
+#define PROC_DESC_PURE( _step ) \
+	PROC_DESC_PURE_PRIO ( _step, PROC_PRIO_NORMAL )
+
+/**
+ * Define a process descriptor for a pure process with a specified priority
+ *
+ * @v step		Process' step() method
+ * @v _priority		Scheduling priority
+ * @ret desc		Object interface descriptor
+ */
+#define PROC_DESC_PURE_PRIO( _step, _priority ) {			      \
 		.offset = 0,						      \
 		.step = PROC_STEP ( struct process, _step ),		      \
 		.reschedule = 1,					      \
+		.priority = _priority,					      \
 	}
 
 extern void * __attribute__ (( pure ))
 process_object ( struct process *process );
 extern void process_add ( struct process *process );
 extern void process_del ( struct process *process );
+extern void process_sleep ( struct process *process );
+extern void process_sleep_timeout ( struct process *process,
+				    unsigned long timeout );
+extern void process_wake ( struct process *process );
 extern void step ( void );
 
+extern struct list_head process_run_queues[PROC_NUM_PRIORITIES];
+extern struct list_head process_sleep_queue;
+
 /**
  * Initialise process without adding to process list
  *
@@ -131,6 +197,9 @@ process_init_stopped ( struct process *process,
 	INIT_LIST_HEAD ( &process->list );
 	process->desc = desc;
 	process->refcnt = refcnt;
+	process->sleeping = 0;
+	process->steps = 0;
+	process->time = 0;
 }
 
 /**
@@ -159,6 +228,21 @@ process_running ( struct process *process ) {
 	return ( ! list_empty ( &process->list ) );
 }
 
+/**
+ * Check if process is sleeping
+ *
+ * @v process		Process
+ * @ret sleeping	Process is sleeping
+ *
+ * A sleeping process is still running (i.e. is still on the process
+ * list), but will not be scheduled until it is woken up via
+ * process_wake() or its sleep timeout expires.
+ */
+static inline __attribute__ (( always_inline )) int
+process_sleeping ( struct process *process ) {
+	return process->sleeping;
+}
+
 /** Permanent process table */
 #define PERMANENT_PROCESSES __table ( struct process, "processes" )
 
@@ -174,7 +258,14 @@ process_running ( struct process *process ) {
  *
  */
 #define PERMANENT_PROCESS( name, step )					      \
-struct process_descriptor name ## _desc = PROC_DESC_PURE ( step );	      \
+	PERMANENT_PROCESS_PRIO ( name, step, PROC_PRIO_NORMAL )
+
+/** Define a permanent process with a specified priority
+ *
+ */
+#define PERMANENT_PROCESS_PRIO( name, step, priority )			      \
+struct process_descriptor name ## _desc =				      \
+	PROC_DESC_PURE_PRIO ( step, priority );				      \
 struct process name __permanent_process = {				      \
 	.list = LIST_HEAD_INIT ( name.list ),				      \
 	.desc = & name ## _desc,					      \
@@ -17,6 +17,14 @@ FILE_LICENCE ( GPL2_OR_LATER );
 /** Limit after which the timeout will be deemed permanent */
 #define DEFAULT_MAX_TIMEOUT ( 10 * TICKS_PER_SEC )
 
+/** Absolute minimum timeout value (in ticks)
+ *
+ * The theoretical minimum that the algorithm in stop_timer() can
+ * adjust the timeout back down to is seven ticks, so set the minimum
+ * timeout to at least that value for the sake of consistency.
+ */
+#define MIN_TIMEOUT 7
+
 /** A retry timer */
 struct retry_timer {
 	/** List of active timers */
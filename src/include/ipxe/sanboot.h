@@ -22,6 +22,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <config/sanboot.h>
 
 struct uri;
+struct block_cache_stats;
 
 /**
  * Calculate static inline sanboot API function name
@@ -97,4 +98,13 @@ int san_boot ( unsigned int drive );
  */
 int san_describe ( unsigned int drive );
 
+/**
+ * Get SAN device block cache statistics
+ *
+ * @v drive		Drive number
+ * @v stats		Block cache statistics to fill in
+ * @ret rc		Return status code
+ */
+int san_stats ( unsigned int drive, struct block_cache_stats *stats );
+
 #endif /* _IPXE_SANBOOT_H */
@@ -68,6 +68,19 @@ struct sha1_context {
 /** SHA-1 digest size */
 #define SHA1_DIGEST_SIZE sizeof ( struct sha1_digest )
 
+/**
+ * Process SHA-1 data blocks
+ *
+ * @v digest		Digest (in host-endian order)
+ * @v data		Data blocks
+ * @v count		Number of blocks
+ */
+typedef void ( sha1_blocks_t ) ( struct sha1_digest *digest, const void *data,
+				 size_t count );
+
+extern sha1_blocks_t sha1_blocks_generic;
+extern sha1_blocks_t *sha1_blocks;
+
 extern struct digest_algorithm sha1_algorithm;
 
 extern void prf_sha1 ( const void *key, size_t key_len, const char *label,
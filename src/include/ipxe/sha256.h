@@ -68,6 +68,20 @@ struct sha256_context {
 /** SHA-256 digest size */
 #define SHA256_DIGEST_SIZE sizeof ( struct sha256_digest )
 
+/**
+ * Process SHA-256 data blocks
+ *
+ * @v digest		Digest (in host-endian order)
+ * @v data		Data blocks
+ * @v count		Number of blocks
+ */
+typedef void ( sha256_blocks_t ) ( struct sha256_digest *digest,
+				   const void *data, size_t count );
+
+extern const uint32_t sha256_k[64];
+extern sha256_blocks_t sha256_blocks_generic;
+extern sha256_blocks_t *sha256_blocks;
+
 extern struct digest_algorithm sha256_algorithm;
 
 #endif /* _IPXE_SHA256_H */
@@ -377,6 +377,14 @@ static inline int tcp_in_window ( uint32_t seq, uint32_t start,
 	return ( ( seq - start ) < len );
 }
 
+/** TCP statistics */
+struct tcp_stats {
+	/** Number of retransmission timer expiries */
+	unsigned long retransmits;
+};
+
 extern struct tcpip_protocol tcp_protocol __tcpip_protocol;
 
+extern struct tcp_stats tcp_stats;
+
 #endif /* _IPXE_TCP_H */
@@ -42,4 +42,27 @@ extern void test_ok ( int success, const char *file, unsigned int line );
 	test_ok ( (success), __FILE__, __LINE__ );	\
 	} while ( 0 )
 
+/**
+ * Run self-tests against generic and accelerated implementations
+ *
+ * @v impl		Implementation selector (e.g. a function pointer)
+ * @v generic		Value of selector for the generic implementation
+ * @v exec		Test function, called with the implementation name
+ *
+ * Runs the tests first with the generic implementation selected and
+ * then, if an accelerated implementation was selected at startup,
+ * again with that implementation.  The original selection is
+ * restored afterwards.
+ */
+#define accel_test( impl, generic, exec ) do {				\
+	typeof ( impl ) accel_test_original = (impl);			\
+	(impl) = (generic);						\
+	exec ( "generic" );						\
+	if ( accel_test_original != (generic) ) {			\
+		(impl) = accel_test_original;				\
+		exec ( "accelerated" );					\
+	}								\
+	(impl) = accel_test_original;					\
+	} while ( 0 )
+
 #endif /* _IPXE_TEST_H */
@@ -14,6 +14,9 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #define TFTP_PORT	       69 /**< Default TFTP server port */
 #define	TFTP_DEFAULT_BLKSIZE  512 /**< Default TFTP data block size */
 #define	TFTP_MAX_BLKSIZE     1432
+#define	TFTP_DEFAULT_WINDOWSIZE 1 /**< Default TFTP window size */
+#define	TFTP_INITIAL_WINDOWSIZE 8 /**< Initially requested window size */
+#define	TFTP_MAX_WINDOWSIZE    64 /**< Maximum requested window size */
 
 #define TFTP_RRQ		1 /**< Read request opcode */
 #define TFTP_WRQ		2 /**< Write request opcode */
@@ -80,6 +83,38 @@ union tftp_any {
 	struct tftp_oack	oack;
 };
 
+/** TFTP statistics */
+struct tftp_stats {
+	/** Number of retransmission timer expiries */
+	unsigned long retransmits;
+	/** Number of windows in which loss was detected */
+	unsigned long losses;
+};
+
+extern struct tftp_stats tftp_stats;
+
+/**
+ * Calculate block index from received DATA block number
+ *
+ * @v next		Index of first block not yet received
+ * @v number		Block number from DATA packet
+ * @ret block		Block index, or negative if invalid
+ *
+ * Block numbers on the wire are 16 bits wide, start from 1 and wrap
+ * for files of more than 65535 blocks.  With a window in use, blocks
+ * may legitimately arrive some way ahead of (or, as duplicates,
+ * behind) the first missing block, so the block index is derived
+ * from the signed 16-bit distance to the expected block number.
+ */
+static inline __attribute__ (( always_inline )) long
+tftp_block ( unsigned long next, uint16_t number ) {
+	unsigned long expected = ( next + 1 );
+	int16_t delta = ( ( uint16_t ) ( number - expected ) );
+
+	return ( ( ( long ) expected ) + delta - 1 );
+}
+
 extern void tftp_set_request_blksize ( unsigned int blksize );
+extern void tftp_set_request_windowsize ( unsigned int windowsize );
 
 #endif /* _IPXE_TFTP_H */
@@ -74,4 +74,6 @@ unsigned long ticks_per_sec ( void );
 /** Number of ticks per second */
 #define TICKS_PER_SEC ( ticks_per_sec() )
 
+extern unsigned long cpu_usecs ( void );
+
 #endif /* _IPXE_TIMER_H */
@@ -16,6 +16,12 @@
 
 #define MAX_QUEUE_NUM      (256)
 
+/* The guest publishes the used index for which it expects an interrupt
+ * at the end of the avail ring, and the host publishes the avail index
+ * for which it expects a kick at the end of the used ring.
+ */
+#define VIRTIO_RING_F_EVENT_IDX    29
+
 #define VRING_DESC_F_NEXT  1
 #define VRING_DESC_F_WRITE 2
 
@@ -60,9 +66,13 @@ struct vring {
 
 #define vring_size(num) \
    (((((sizeof(struct vring_desc) * num) + \
-      (sizeof(struct vring_avail) + sizeof(u16) * num)) \
+      (sizeof(struct vring_avail) + sizeof(u16) * (num + 1))) \
          + PAGE_MASK) & ~PAGE_MASK) + \
-         (sizeof(struct vring_used) + sizeof(struct vring_used_elem) * num))
+         (sizeof(struct vring_used) + sizeof(struct vring_used_elem) * num) + \
+         sizeof(u16))
+
+/* Event index location (if VIRTIO_RING_F_EVENT_IDX is negotiated) */
+#define vring_used_event(vr) ((vr)->avail->ring[(vr)->num])
 
 typedef unsigned char virtio_queue_t[PAGE_MASK + vring_size(MAX_QUEUE_NUM)];
 
@@ -74,6 +84,8 @@ struct vring_virtqueue {
    void *vdata[MAX_QUEUE_NUM];
    /* PCI */
    int queue_index;
+   /* VIRTIO_RING_F_EVENT_IDX negotiated */
+   int event_idx;
 };
 
 struct vring_list {
@@ -99,7 +111,7 @@ static inline void vring_init(struct vring *vr,
 
    /* physical address of used must be page aligned */
 
-   pa = virt_to_phys(&vr->avail->ring[num]);
+   pa = virt_to_phys(&vr->avail->ring[num + 1]);
    pa = (pa + PAGE_MASK) & ~PAGE_MASK;
         vr->used = phys_to_virt(pa);
 
@@ -108,14 +120,38 @@ static inline void vring_init(struct vring *vr,
    vr->desc[i].next = 0;
 }
 
+static inline u16 vring_avail_event(struct vring *vr)
+{
+   u16 *event = (void *)&vr->used->ring[vr->num];
+
+   return *event;
+}
+
 static inline void vring_enable_cb(struct vring_virtqueue *vq)
 {
    vq->vring.avail->flags &= ~VRING_AVAIL_F_NO_INTERRUPT;
+   /* Interrupt as soon as the next buffer is used */
+   vring_used_event(&vq->vring) = vq->last_used_idx;
 }
 
 static inline void vring_disable_cb(struct vring_virtqueue *vq)
 {
    vq->vring.avail->flags |= VRING_AVAIL_F_NO_INTERRUPT;
+   /* Place the interrupt point as far away as possible */
+   vring_used_event(&vq->vring) = vq->last_used_idx - 1;
+}
+
+/*
+ * vring_need_event
+ *
+ * has the other side's event index been crossed by moving from
+ * old to new_idx ?
+ *
+ */
+
+static inline int vring_need_event(u16 event_idx, u16 new_idx, u16 old)
+{
+   return (u16)(new_idx - event_idx - 1) < (u16)(new_idx - old);
 }
 
 
@@ -77,6 +77,14 @@ extern void xfer_window_changed ( struct interface *intf );
 #define xfer_window_changed_TYPE( object_type ) \
 	typeof ( void ( object_type ) )
 
+extern int xfer_sequential ( struct interface *intf );
+#define xfer_sequential_TYPE( object_type ) \
+	typeof ( int ( object_type ) )
+
+extern int xfer_decompressing ( struct interface *intf );
+#define xfer_decompressing_TYPE( object_type ) \
+	typeof ( int ( object_type ) )
+
 extern struct io_buffer * xfer_alloc_iob ( struct interface *intf,
 					   size_t len );
 #define xfer_alloc_iob_TYPE( object_type ) \
@@ -39,6 +39,7 @@ FILE_LICENCE(GPL2_OR_LATER);
 typedef __kernel_pid_t pid_t;
 typedef __kernel_suseconds_t suseconds_t;
 typedef __kernel_loff_t loff_t;
+typedef __kernel_clockid_t clockid_t;
 #include <linux/time.h>
 #include <linux/mman.h>
 #include <linux/fcntl.h>
@@ -61,6 +62,7 @@ extern int linux_poll ( struct pollfd *fds, nfds_t nfds, int timeout );
 extern int linux_nanosleep ( const struct timespec *req, struct timespec *rem );
 extern int linux_usleep ( useconds_t usec );
 extern int linux_gettimeofday ( struct timeval *tv, struct timezone *tz );
+extern int linux_clock_gettime ( clockid_t clk_id, struct timespec *tp );
 extern void * linux_mmap ( void *addr, __kernel_size_t length, int prot,
 			   int flags, int fd, off_t offset );
 extern void * linux_mremap ( void *old_address, __kernel_size_t old_size,
@@ -0,0 +1,16 @@
+#ifndef _USR_BENCHMARK_H
+#define _USR_BENCHMARK_H
+
+/** @file
+ *
+ * Download benchmarking
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+struct uri;
+
+extern int benchmark ( struct uri *uri, unsigned int run );
+
+#endif /* _USR_BENCHMARK_H */
@@ -0,0 +1,14 @@
+#ifndef _USR_PROCMGMT_H
+#define _USR_PROCMGMT_H
+
+/** @file
+ *
+ * Process management
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+extern void pstat ( void );
+
+#endif /* _USR_PROCMGMT_H */
@@ -75,6 +75,21 @@ static unsigned long linux_currticks(void)
 	return ticks;
 }
 
+/**
+ * Get CPU time consumed
+ *
+ * @ret usecs		CPU time consumed by this process, in microseconds
+ */
+unsigned long cpu_usecs(void)
+{
+	struct timespec now;
+
+	if (linux_clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now) != 0)
+		return 0;
+
+	return ((now.tv_sec * 1000000UL) + (now.tv_nsec / 1000));
+}
+
 PROVIDE_TIMER(linux, udelay, linux_udelay);
 PROVIDE_TIMER(linux, currticks, linux_currticks);
 PROVIDE_TIMER(linux, ticks_per_sec, linux_ticks_per_sec);
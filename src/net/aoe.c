@@ -38,6 +38,11 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/open.h>
 #include <ipxe/ata.h>
 #include <ipxe/device.h>
+#include <ipxe/timer.h>
+#include <ipxe/retry.h>
+#include <ipxe/settings.h>
+#include <ipxe/dhcp.h>
+#include <ipxe/init.h>
 #include <ipxe/aoe.h>
 
 /** @file
@@ -50,6 +55,14 @@ FEATURE ( FEATURE_PROTOCOL, "AoE", DHCP_EB_FEATURE_AOE, 1 );
 
 struct net_protocol aoe_protocol __net_protocol;
 
+/** AoE window setting */
+struct setting aoe_window_setting __setting ( SETTING_SANBOOT_EXTRA ) = {
+	.name = "aoe-window",
+	.description = "AoE outstanding frames",
+	.tag = DHCP_EB_AOE_WINDOW,
+	.type = &setting_type_uint8,
+};
+
 /******************************************************************************
  *
  * AoE devices and commands
@@ -60,8 +73,8 @@ struct net_protocol aoe_protocol __net_protocol;
 /** List of all AoE devices */
 static LIST_HEAD ( aoe_devices );
 
-/** List of active AoE commands */
-static LIST_HEAD ( aoe_commands );
+/** Active AoE frames, hashed by tag */
+static struct list_head aoe_tags[AOE_TAG_BUCKETS];
 
 /** An AoE device */
 struct aoe_device {
@@ -80,8 +93,21 @@ struct aoe_device {
 	/** Target MAC address */
 	uint8_t target[MAX_LL_ADDR_LEN];
 
-	/** Saved timeout value */
-	unsigned long timeout;
+	/** Active commands */
+	struct list_head commands;
+	/** Frames awaiting transmission */
+	struct list_head queue;
+	/** Maximum number of outstanding frames */
+	unsigned int window;
+	/** Number of outstanding frames */
+	unsigned int outstanding;
+	/** Maximum number of sectors per frame */
+	unsigned int frame_count;
+
+	/** Smoothed round-trip time (in ticks, scaled by 8) */
+	unsigned long srtt;
+	/** Round-trip time variation (in ticks, scaled by 4) */
+	unsigned long rttvar;
 
 	/** Configuration command interface */
 	struct interface config;
@@ -89,6 +115,43 @@ struct aoe_device {
 	int configured;
 };
 
+/** An AoE frame
+ *
+ * A frame is a single request/response exchange with the target.
+ * Large ATA commands are split into several frames, which may be
+ * outstanding concurrently.
+ */
+struct aoe_frame {
+	/** AoE command */
+	struct aoe_command *aoecmd;
+	/** List of frames within tag hash bucket */
+	struct list_head hash;
+	/** List of frames awaiting transmission */
+	struct list_head queue;
+	/** Tag */
+	uint32_t tag;
+
+	/** Starting logical block address */
+	uint64_t lba;
+	/** Number of sectors */
+	unsigned int count;
+	/** Offset within data buffer */
+	size_t offset;
+	/** Length of data */
+	size_t len;
+
+	/** Retransmission timer */
+	struct retry_timer timer;
+	/** Time of first transmission */
+	unsigned long sent;
+	/** Frame has been retransmitted */
+	int retransmitted;
+	/** Frame is counted as outstanding */
+	int outstanding;
+	/** Frame has completed */
+	int done;
+};
+
 /** An AoE command */
 struct aoe_command {
 	/** Reference count */
@@ -105,11 +168,15 @@ struct aoe_command {
 	struct ata_cmd command;
 	/** Command type */
 	struct aoe_command_type *type;
-	/** Command tag */
+	/** Command tag (i.e. tag of first frame) */
 	uint32_t tag;
 
-	/** Retransmission timer */
-	struct retry_timer timer;
+	/** Number of frames */
+	unsigned int num_frames;
+	/** Number of frames awaiting a response */
+	unsigned int remaining;
+	/** Frames */
+	struct aoe_frame frames[0];
 };
 
 /** An AoE command type */
@@ -117,28 +184,28 @@ struct aoe_command_type {
 	/**
 	 * Calculate length of AoE command IU
 	 *
-	 * @v aoecmd		AoE command
+	 * @v frame		AoE frame
 	 * @ret len		Length of command IU
 	 */
-	size_t ( * cmd_len ) ( struct aoe_command *aoecmd );
+	size_t ( * cmd_len ) ( struct aoe_frame *frame );
 	/**
 	 * Build AoE command IU
 	 *
-	 * @v aoecmd		AoE command
+	 * @v frame		AoE frame
 	 * @v data		Command IU
 	 * @v len		Length of command IU
 	 */
-	void ( * cmd ) ( struct aoe_command *aoecmd, void *data, size_t len );
+	void ( * cmd ) ( struct aoe_frame *frame, void *data, size_t len );
 	/**
 	 * Handle AoE response IU
 	 *
-	 * @v aoecmd		AoE command
+	 * @v frame		AoE frame
 	 * @v data		Response IU
 	 * @v len		Length of response IU
 	 * @v ll_source		Link-layer source address
 	 * @ret rc		Return status code
 	 */
-	int ( * rsp ) ( struct aoe_command *aoecmd, const void *data,
+	int ( * rsp ) ( struct aoe_frame *frame, const void *data,
 			size_t len, const void *ll_source );
 };
 
@@ -200,6 +267,114 @@ static const char * aoedev_name ( struct aoe_device *aoedev ) {
 	return buf;
 }
 
+/**
+ * Get AoE tag hash bucket
+ *
+ * @v tag		Tag
+ * @ret bucket		Hash bucket
+ */
+static inline struct list_head * aoe_tag_bucket ( uint32_t tag ) {
+	return &aoe_tags[ tag % AOE_TAG_BUCKETS ];
+}
+
+/**
+ * Identify AoE frame by tag
+ *
+ * @v tag		Tag
+ * @ret frame		AoE frame, or NULL
+ */
+static struct aoe_frame * aoe_find_tag ( uint32_t tag ) {
+	struct aoe_frame *frame;
+
+	list_for_each_entry ( frame, aoe_tag_bucket ( tag ), hash ) {
+		if ( frame->tag == tag )
+			return frame;
+	}
+	return NULL;
+}
+
+/**
+ * Choose an AoE tag
+ *
+ * @ret tag		New tag, or negative error
+ */
+static int aoe_new_tag ( void ) {
+	static uint16_t tag_idx;
+	unsigned int i;
+
+	for ( i = 0 ; i < 65536 ; i++ ) {
+		tag_idx++;
+		if ( aoe_find_tag ( AOE_TAG_MAGIC | tag_idx ) == NULL )
+			return ( AOE_TAG_MAGIC | tag_idx );
+	}
+	return -EADDRINUSE;
+}
+
+/**
+ * Calculate AoE device retransmission timeout
+ *
+ * @v aoedev		AoE device
+ * @ret timeout		Retransmission timeout (in ticks)
+ */
+static unsigned long aoedev_rto ( struct aoe_device *aoedev ) {
+	unsigned long min_timeout =
+		( ( AOE_MIN_TIMEOUT_MS * TICKS_PER_SEC ) / 1000 );
+	unsigned long max_timeout =
+		( ( AOE_MAX_TIMEOUT_MS * TICKS_PER_SEC ) / 1000 );
+	unsigned long timeout;
+
+	/* With a coarse timer (e.g. 18Hz under BIOS) the millisecond
+	 * bounds may round down to zero ticks.  A one-tick timeout
+	 * may expire almost immediately if started just before a tick
+	 * boundary, so never use less than two ticks.  Retransmissions
+	 * are subject to the retry timer's own minimum, so keep the
+	 * maximum at least that large.
+	 */
+	if ( min_timeout < 2 )
+		min_timeout = 2;
+	if ( max_timeout < MIN_TIMEOUT )
+		max_timeout = MIN_TIMEOUT;
+
+	/* Use the maximum initial timeout until we have an RTT sample */
+	if ( ! aoedev->srtt )
+		return max_timeout;
+
+	/* RTO = SRTT + 4 * RTTVAR, as per RFC 6298 */
+	timeout = ( ( aoedev->srtt >> 3 ) + aoedev->rttvar );
+	if ( timeout < min_timeout )
+		timeout = min_timeout;
+	if ( timeout > max_timeout )
+		timeout = max_timeout;
+	return timeout;
+}
+
+/**
+ * Update AoE device round-trip time estimate
+ *
+ * @v aoedev		AoE device
+ * @v rtt		Round-trip time sample (in ticks)
+ */
+static void aoedev_rtt ( struct aoe_device *aoedev, unsigned long rtt ) {
+	long delta;
+
+	if ( ! aoedev->srtt ) {
+		/* SRTT = R, RTTVAR = R / 2 */
+		aoedev->srtt = ( ( rtt << 3 ) | 1 );
+		aoedev->rttvar = ( rtt << 1 );
+	} else {
+		/* SRTT += ( R - SRTT ) / 8
+		 * RTTVAR += ( | R - SRTT | - RTTVAR ) / 4
+		 */
+		delta = ( rtt - ( aoedev->srtt >> 3 ) );
+		aoedev->srtt += delta;
+		if ( ! aoedev->srtt )
+			aoedev->srtt = 1;
+		if ( delta < 0 )
+			delta = -delta;
+		aoedev->rttvar += ( delta - ( aoedev->rttvar >> 2 ) );
+	}
+}
+
 /**
  * Free AoE command
  *
@@ -208,14 +383,44 @@ static const char * aoedev_name ( struct aoe_device *aoedev ) {
 static void aoecmd_free ( struct refcnt *refcnt ) {
 	struct aoe_command *aoecmd =
 		container_of ( refcnt, struct aoe_command, refcnt );
+	unsigned int i;
 
-	assert ( ! timer_running ( &aoecmd->timer ) );
+	for ( i = 0 ; i < aoecmd->num_frames ; i++ ) {
+		assert ( ! timer_running ( &aoecmd->frames[i].timer ) );
+		assert ( list_empty ( &aoecmd->frames[i].hash ) );
+	}
 	assert ( list_empty ( &aoecmd->list ) );
 
 	aoedev_put ( aoecmd->aoedev );
 	free ( aoecmd );
 }
 
+/**
+ * Retire AoE frame
+ *
+ * @v frame		AoE frame
+ *
+ * The frame is removed from the tag hash and transmission queue, and
+ * no longer counts against the device's window.
+ */
+static void aoe_frame_retire ( struct aoe_frame *frame ) {
+	struct aoe_device *aoedev = frame->aoecmd->aoedev;
+
+	stop_timer ( &frame->timer );
+	list_del ( &frame->hash );
+	INIT_LIST_HEAD ( &frame->hash );
+	list_del ( &frame->queue );
+	INIT_LIST_HEAD ( &frame->queue );
+	if ( frame->outstanding ) {
+		frame->outstanding = 0;
+		aoedev->outstanding--;
+	}
+	frame->done = 1;
+}
+
+static void aoedev_tx_queued ( struct aoe_device *aoedev );
+static size_t aoedev_window ( struct aoe_device *aoedev );
+
 /**
  * Close AoE command
  *
@@ -224,12 +429,11 @@ static void aoecmd_free ( struct refcnt *refcnt ) {
  */
 static void aoecmd_close ( struct aoe_command *aoecmd, int rc ) {
 	struct aoe_device *aoedev = aoecmd->aoedev;
+	unsigned int i;
 
-	/* Stop timer */
-	stop_timer ( &aoecmd->timer );
-
-	/* Preserve the timeout value for subsequent commands */
-	aoedev->timeout = aoecmd->timer.timeout;
+	/* Retire all frames */
+	for ( i = 0 ; i < aoecmd->num_frames ; i++ )
+		aoe_frame_retire ( &aoecmd->frames[i] );
 
 	/* Remove from list of commands */
 	if ( ! list_empty ( &aoecmd->list ) ) {
@@ -240,15 +444,21 @@ static void aoecmd_close ( struct aoe_command *aoecmd, int rc ) {
 
 	/* Shut down interfaces */
 	intf_shutdown ( &aoecmd->ata, rc );
+
+	/* Use any window space released by this command */
+	aoedev_tx_queued ( aoedev );
+	if ( aoedev_window ( aoedev ) )
+		xfer_window_changed ( &aoedev->ata );
 }
 
 /**
- * Transmit AoE command request
+ * Transmit AoE frame
  *
- * @v aoecmd		AoE command
+ * @v frame		AoE frame
  * @ret rc		Return status code
  */
-static int aoecmd_tx ( struct aoe_command *aoecmd ) {
+static int aoe_frame_tx ( struct aoe_frame *frame ) {
+	struct aoe_command *aoecmd = frame->aoecmd;
 	struct aoe_device *aoedev = aoecmd->aoedev;
 	struct net_device *netdev = aoedev->netdev;
 	struct io_buffer *iobuf;
@@ -262,12 +472,18 @@ static int aoecmd_tx ( struct aoe_command *aoecmd ) {
 	/* If we are transmitting anything that requires a response,
          * start the retransmission timer.  Do this before attempting
          * to allocate the I/O buffer, in case allocation itself
-         * fails.
+         * fails.  The first transmission uses the device's current
+         * timeout estimate; retransmissions use the backed-off value.
          */
-	start_timer ( &aoecmd->timer );
+	if ( frame->retransmitted ) {
+		start_timer ( &frame->timer );
+	} else {
+		start_timer_fixed ( &frame->timer, aoedev_rto ( aoedev ) );
+		frame->sent = currticks();
+	}
 
 	/* Create outgoing I/O buffer */
-	cmd_len = aoecmd->type->cmd_len ( aoecmd );
+	cmd_len = aoecmd->type->cmd_len ( frame );
 	iobuf = alloc_iob ( MAX_LL_HEADER_LEN + cmd_len );
 	if ( ! iobuf )
 		return -ENOMEM;
@@ -279,15 +495,14 @@ static int aoecmd_tx ( struct aoe_command *aoecmd ) {
 	aoehdr->ver_flags = AOE_VERSION;
 	aoehdr->major = htons ( aoedev->major );
 	aoehdr->minor = aoedev->minor;
-	aoehdr->tag = htonl ( aoecmd->tag );
-	aoecmd->type->cmd ( aoecmd, iobuf->data, iob_len ( iobuf ) );
+	aoehdr->tag = htonl ( frame->tag );
+	aoecmd->type->cmd ( frame, iobuf->data, iob_len ( iobuf ) );
 
 	/* Send packet */
 	if ( ( rc = net_tx ( iobuf, netdev, &aoe_protocol, aoedev->target,
 			     netdev->ll_addr ) ) != 0 ) {
 		DBGC ( aoedev, "AoE %s/%08x could not transmit: %s\n",
-		       aoedev_name ( aoedev ), aoecmd->tag,
-		       strerror ( rc ) );
+		       aoedev_name ( aoedev ), frame->tag, strerror ( rc ) );
 		return rc;
 	}
 
@@ -295,15 +510,58 @@ static int aoecmd_tx ( struct aoe_command *aoecmd ) {
 }
 
 /**
- * Receive AoE command response
+ * Start AoE frame
  *
- * @v aoecmd		AoE command
+ * @v frame		AoE frame
+ *
+ * The frame is transmitted immediately if the device's window
+ * permits, otherwise it is queued.  Transmission failures are
+ * handled by the retry timer.
+ */
+static void aoe_frame_start ( struct aoe_frame *frame ) {
+	struct aoe_device *aoedev = frame->aoecmd->aoedev;
+
+	if ( ( aoedev->outstanding < aoedev->window ) &&
+	     list_empty ( &aoedev->queue ) ) {
+		frame->outstanding = 1;
+		aoedev->outstanding++;
+		aoe_frame_tx ( frame );
+	} else {
+		list_add_tail ( &frame->queue, &aoedev->queue );
+	}
+}
+
+/**
+ * Transmit queued AoE frames
+ *
+ * @v aoedev		AoE device
+ */
+static void aoedev_tx_queued ( struct aoe_device *aoedev ) {
+	struct aoe_frame *frame;
+
+	while ( ( aoedev->outstanding < aoedev->window ) &&
+		( ( frame = list_first_entry ( &aoedev->queue,
+					       struct aoe_frame,
+					       queue ) ) != NULL ) ) {
+		list_del ( &frame->queue );
+		INIT_LIST_HEAD ( &frame->queue );
+		frame->outstanding = 1;
+		aoedev->outstanding++;
+		aoe_frame_tx ( frame );
+	}
+}
+
+/**
+ * Receive AoE frame response
+ *
+ * @v frame		AoE frame
  * @v iobuf		I/O buffer
  * @v ll_source		Link-layer source address
  * @ret rc		Return status code
  */
-static int aoecmd_rx ( struct aoe_command *aoecmd, struct io_buffer *iobuf,
-		       const void *ll_source ) {
+static int aoe_frame_rx ( struct aoe_frame *frame, struct io_buffer *iobuf,
+			  const void *ll_source ) {
+	struct aoe_command *aoecmd = frame->aoecmd;
 	struct aoe_device *aoedev = aoecmd->aoedev;
 	struct aoehdr *aoehdr = iobuf->data;
 	int rc;
@@ -312,14 +570,14 @@ static int aoecmd_rx ( struct aoe_command *aoecmd, struct io_buffer *iobuf,
 	if ( iob_len ( iobuf ) < sizeof ( *aoehdr ) ) {
 		DBGC ( aoedev, "AoE %s/%08x received underlength response "
 		       "(%zd bytes)\n", aoedev_name ( aoedev ),
-		       aoecmd->tag, iob_len ( iobuf ) );
+		       frame->tag, iob_len ( iobuf ) );
 		rc = -EINVAL;
 		goto done;
 	}
 	if ( ( ntohs ( aoehdr->major ) != aoedev->major ) ||
 	     ( aoehdr->minor != aoedev->minor ) ) {
 		DBGC ( aoedev, "AoE %s/%08x received response for incorrect "
-		       "device e%d.%d\n", aoedev_name ( aoedev ), aoecmd->tag,
+		       "device e%d.%d\n", aoedev_name ( aoedev ), frame->tag,
 		       ntohs ( aoehdr->major ), aoehdr->minor );
 		rc = -EINVAL;
 		goto done;
@@ -328,23 +586,37 @@ static int aoecmd_rx ( struct aoe_command *aoecmd, struct io_buffer *iobuf,
 	/* Catch command failures */
 	if ( aoehdr->ver_flags & AOE_FL_ERROR ) {
 		DBGC ( aoedev, "AoE %s/%08x terminated in error\n",
-		       aoedev_name ( aoedev ), aoecmd->tag );
-		aoecmd_close ( aoecmd, -EIO );
+		       aoedev_name ( aoedev ), frame->tag );
 		rc = -EIO;
 		goto done;
 	}
 
+	/* Update round-trip time estimate.  Responses to
+	 * retransmitted frames are ambiguous and so are ignored.
+	 */
+	if ( ! frame->retransmitted )
+		aoedev_rtt ( aoedev, ( currticks() - frame->sent ) );
+
 	/* Hand off to command completion handler */
-	if ( ( rc = aoecmd->type->rsp ( aoecmd, iobuf->data, iob_len ( iobuf ),
+	if ( ( rc = aoecmd->type->rsp ( frame, iobuf->data, iob_len ( iobuf ),
 					ll_source ) ) != 0 )
 		goto done;
 
+	/* Retire frame */
+	aoe_frame_retire ( frame );
+	assert ( aoecmd->remaining > 0 );
+	aoecmd->remaining--;
+
  done:
 	/* Free I/O buffer */
 	free_iob ( iobuf );
 
-	/* Terminate command */
-	aoecmd_close ( aoecmd, rc );
+	/* Terminate command on error or when all frames are complete */
+	if ( ( rc != 0 ) || ( aoecmd->remaining == 0 ) ) {
+		aoecmd_close ( aoecmd, rc );
+	} else {
+		aoedev_tx_queued ( aoedev );
+	}
 
 	return rc;
 }
@@ -355,125 +627,130 @@ static int aoecmd_rx ( struct aoe_command *aoecmd, struct io_buffer *iobuf,
  * @v timer		AoE retry timer
  * @v fail		Failure indicator
  */
-static void aoecmd_expired ( struct retry_timer *timer, int fail ) {
-	struct aoe_command *aoecmd =
-		container_of ( timer, struct aoe_command, timer );
+static void aoe_frame_expired ( struct retry_timer *timer, int fail ) {
+	struct aoe_frame *frame =
+		container_of ( timer, struct aoe_frame, timer );
 
 	if ( fail ) {
-		aoecmd_close ( aoecmd, -ETIMEDOUT );
+		aoecmd_close ( frame->aoecmd, -ETIMEDOUT );
 	} else {
-		aoecmd_tx ( aoecmd );
+		frame->retransmitted = 1;
+		aoe_frame_tx ( frame );
 	}
 }
 
 /**
  * Calculate length of AoE ATA command IU
  *
- * @v aoecmd		AoE command
+ * @v frame		AoE frame
  * @ret len		Length of command IU
  */
-static size_t aoecmd_ata_cmd_len ( struct aoe_command *aoecmd ) {
-	struct ata_cmd *command = &aoecmd->command;
+static size_t aoecmd_ata_cmd_len ( struct aoe_frame *frame ) {
+	struct ata_cmd *command = &frame->aoecmd->command;
 
 	return ( sizeof ( struct aoehdr ) + sizeof ( struct aoeata ) +
-		 command->data_out_len );
+		 ( command->data_out_len ? frame->len : 0 ) );
 }
 
 /**
  * Build AoE ATA command IU
  *
- * @v aoecmd		AoE command
+ * @v frame		AoE frame
  * @v data		Command IU
  * @v len		Length of command IU
  */
-static void aoecmd_ata_cmd ( struct aoe_command *aoecmd,
+static void aoecmd_ata_cmd ( struct aoe_frame *frame,
 			     void *data, size_t len ) {
+	struct aoe_command *aoecmd = frame->aoecmd;
 	struct aoe_device *aoedev = aoecmd->aoedev;
 	struct ata_cmd *command = &aoecmd->command;
 	struct aoehdr *aoehdr = data;
 	struct aoeata *aoeata = &aoehdr->payload[0].ata;
+	size_t data_out_len = ( command->data_out_len ? frame->len : 0 );
 
 	/* Sanity check */
 	linker_assert ( AOE_FL_DEV_HEAD	== ATA_DEV_SLAVE, __fix_ata_h__ );
 	assert ( len == ( sizeof ( *aoehdr ) + sizeof ( *aoeata ) +
-			  command->data_out_len ) );
+			  data_out_len ) );
 
 	/* Build IU */
 	aoehdr->command = AOE_CMD_ATA;
 	memset ( aoeata, 0, sizeof ( *aoeata ) );
 	aoeata->aflags = ( ( command->cb.lba48 ? AOE_FL_EXTENDED : 0 ) |
 			   ( command->cb.device & ATA_DEV_SLAVE ) |
-			   ( command->data_out_len ? AOE_FL_WRITE : 0 ) );
+			   ( data_out_len ? AOE_FL_WRITE : 0 ) );
 	aoeata->err_feat = command->cb.err_feat.bytes.cur;
-	aoeata->count = command->cb.count.native;
+	aoeata->count = frame->count;
 	aoeata->cmd_stat = command->cb.cmd_stat;
-	aoeata->lba.u64 = cpu_to_le64 ( command->cb.lba.native );
+	aoeata->lba.u64 = cpu_to_le64 ( frame->lba );
 	if ( ! command->cb.lba48 )
 		aoeata->lba.bytes[3] |=
 			( command->cb.device & ATA_DEV_MASK );
-	copy_from_user ( aoeata->data, command->data_out, 0,
-			 command->data_out_len );
+	copy_from_user ( aoeata->data, command->data_out, frame->offset,
+			 data_out_len );
 
 	DBGC2 ( aoedev, "AoE %s/%08x ATA cmd %02x:%02x:%02x:%02x:%08llx",
-		aoedev_name ( aoedev ), aoecmd->tag, aoeata->aflags,
+		aoedev_name ( aoedev ), frame->tag, aoeata->aflags,
 		aoeata->err_feat, aoeata->count, aoeata->cmd_stat,
 		aoeata->lba.u64 );
 	if ( command->data_out_len )
-		DBGC2 ( aoedev, " out %04zx", command->data_out_len );
+		DBGC2 ( aoedev, " out %04zx", frame->len );
 	if ( command->data_in_len )
-		DBGC2 ( aoedev, " in %04zx", command->data_in_len );
+		DBGC2 ( aoedev, " in %04zx", frame->len );
 	DBGC2 ( aoedev, "\n" );
 }
 
 /**
  * Handle AoE ATA response IU
  *
- * @v aoecmd		AoE command
+ * @v frame		AoE frame
  * @v data		Response IU
  * @v len		Length of response IU
  * @v ll_source		Link-layer source address
  * @ret rc		Return status code
  */
-static int aoecmd_ata_rsp ( struct aoe_command *aoecmd, const void *data,
+static int aoecmd_ata_rsp ( struct aoe_frame *frame, const void *data,
 			    size_t len, const void *ll_source __unused ) {
+	struct aoe_command *aoecmd = frame->aoecmd;
 	struct aoe_device *aoedev = aoecmd->aoedev;
 	struct ata_cmd *command = &aoecmd->command;
 	const struct aoehdr *aoehdr = data;
 	const struct aoeata *aoeata = &aoehdr->payload[0].ata;
+	size_t data_in_len = ( command->data_in_len ? frame->len : 0 );
 	size_t data_len;
 
 	/* Sanity check */
 	if ( len < ( sizeof ( *aoehdr ) + sizeof ( *aoeata ) ) ) {
 		DBGC ( aoedev, "AoE %s/%08x received underlength ATA response "
 		       "(%zd bytes)\n", aoedev_name ( aoedev ),
-		       aoecmd->tag, len );
+		       frame->tag, len );
 		return -EINVAL;
 	}
 	data_len = ( len - ( sizeof ( *aoehdr ) + sizeof ( *aoeata ) ) );
 	DBGC2 ( aoedev, "AoE %s/%08x ATA rsp %02x in %04zx\n",
-		aoedev_name ( aoedev ), aoecmd->tag, aoeata->cmd_stat,
+		aoedev_name ( aoedev ), frame->tag, aoeata->cmd_stat,
 		data_len );
 
 	/* Check for command failure */
 	if ( aoeata->cmd_stat & ATA_STAT_ERR ) {
 		DBGC ( aoedev, "AoE %s/%08x status %02x\n",
-		       aoedev_name ( aoedev ), aoecmd->tag, aoeata->cmd_stat );
+		       aoedev_name ( aoedev ), frame->tag, aoeata->cmd_stat );
 		return -EIO;
 	}
 
 	/* Check data-in length is sufficient.  (There may be trailing
 	 * garbage due to Ethernet minimum-frame-size padding.)
 	 */
-	if ( data_len < command->data_in_len ) {
+	if ( data_len < data_in_len ) {
 		DBGC ( aoedev, "AoE %s/%08x data-in underrun (received %zd, "
-		       "expected %zd)\n", aoedev_name ( aoedev ), aoecmd->tag,
-		       data_len, command->data_in_len );
+		       "expected %zd)\n", aoedev_name ( aoedev ), frame->tag,
+		       data_len, data_in_len );
 		return -ERANGE;
 	}
 
 	/* Copy out data payload */
-	copy_to_user ( command->data_in, 0, aoeata->data,
-		       command->data_in_len );
+	copy_to_user ( command->data_in, frame->offset, aoeata->data,
+		       data_in_len );
 
 	return 0;
 }
@@ -488,23 +765,23 @@ static struct aoe_command_type aoecmd_ata = {
 /**
  * Calculate length of AoE configuration command IU
  *
- * @v aoecmd		AoE command
+ * @v frame		AoE frame
  * @ret len		Length of command IU
  */
-static size_t aoecmd_cfg_cmd_len ( struct aoe_command *aoecmd __unused ) {
+static size_t aoecmd_cfg_cmd_len ( struct aoe_frame *frame __unused ) {
 	return ( sizeof ( struct aoehdr ) + sizeof ( struct aoecfg ) );
 }
 
 /**
  * Build AoE configuration command IU
  *
- * @v aoecmd		AoE command
+ * @v frame		AoE frame
  * @v data		Command IU
  * @v len		Length of command IU
  */
-static void aoecmd_cfg_cmd ( struct aoe_command *aoecmd,
+static void aoecmd_cfg_cmd ( struct aoe_frame *frame,
 			     void *data, size_t len ) {
-	struct aoe_device *aoedev = aoecmd->aoedev;
+	struct aoe_device *aoedev = frame->aoecmd->aoedev;
 	struct aoehdr *aoehdr = data;
 	struct aoecfg *aoecfg = &aoehdr->payload[0].cfg;
 
@@ -516,34 +793,35 @@ static void aoecmd_cfg_cmd ( struct aoe_command *aoecmd,
 	memset ( aoecfg, 0, sizeof ( *aoecfg ) );
 
 	DBGC ( aoedev, "AoE %s/%08x CONFIG cmd\n",
-	       aoedev_name ( aoedev ), aoecmd->tag );
+	       aoedev_name ( aoedev ), frame->tag );
 }
 
 /**
  * Handle AoE configuration response IU
  *
- * @v aoecmd		AoE command
+ * @v frame		AoE frame
  * @v data		Response IU
  * @v len		Length of response IU
  * @v ll_source		Link-layer source address
  * @ret rc		Return status code
  */
-static int aoecmd_cfg_rsp ( struct aoe_command *aoecmd, const void *data,
+static int aoecmd_cfg_rsp ( struct aoe_frame *frame, const void *data,
 			    size_t len, const void *ll_source ) {
-	struct aoe_device *aoedev = aoecmd->aoedev;
+	struct aoe_device *aoedev = frame->aoecmd->aoedev;
 	struct ll_protocol *ll_protocol = aoedev->netdev->ll_protocol;
 	const struct aoehdr *aoehdr = data;
 	const struct aoecfg *aoecfg = &aoehdr->payload[0].cfg;
+	unsigned int bufcnt;
 
 	/* Sanity check */
 	if ( len < ( sizeof ( *aoehdr ) + sizeof ( *aoecfg ) ) ) {
 		DBGC ( aoedev, "AoE %s/%08x received underlength "
 		       "configuration response (%zd bytes)\n",
-		       aoedev_name ( aoedev ), aoecmd->tag, len );
+		       aoedev_name ( aoedev ), frame->tag, len );
 		return -EINVAL;
 	}
 	DBGC ( aoedev, "AoE %s/%08x CONFIG rsp buf %04x fw %04x scnt %02x\n",
-	       aoedev_name ( aoedev ), aoecmd->tag, ntohs ( aoecfg->bufcnt ),
+	       aoedev_name ( aoedev ), frame->tag, ntohs ( aoecfg->bufcnt ),
 	       aoecfg->fwver, aoecfg->scnt );
 
 	/* Record target MAC address */
@@ -551,6 +829,17 @@ static int aoecmd_cfg_rsp ( struct aoe_command *aoecmd, const void *data,
 	DBGC ( aoedev, "AoE %s has MAC address %s\n",
 	       aoedev_name ( aoedev ), ll_protocol->ntoa ( aoedev->target ) );
 
+	/* Limit window to target's queue depth and frame size to
+	 * target's maximum sector count, if specified.
+	 */
+	bufcnt = ntohs ( aoecfg->bufcnt );
+	if ( bufcnt && ( aoedev->window > bufcnt ) )
+		aoedev->window = bufcnt;
+	if ( aoecfg->scnt && ( aoedev->frame_count > aoecfg->scnt ) )
+		aoedev->frame_count = aoecfg->scnt;
+	DBGC ( aoedev, "AoE %s using window %d, %d sectors per frame\n",
+	       aoedev_name ( aoedev ), aoedev->window, aoedev->frame_count );
+
 	return 0;
 }
 
@@ -570,75 +859,82 @@ static struct interface_operation aoecmd_ata_op[] = {
 static struct interface_descriptor aoecmd_ata_desc =
 	INTF_DESC ( struct aoe_command, ata, aoecmd_ata_op );
 
-/**
- * Identify AoE command by tag
- *
- * @v tag		Command tag
- * @ret aoecmd		AoE command, or NULL
- */
-static struct aoe_command * aoecmd_find_tag ( uint32_t tag ) {
-	struct aoe_command *aoecmd;
-
-	list_for_each_entry ( aoecmd, &aoe_commands, list ) {
-		if ( aoecmd->tag == tag )
-			return aoecmd;
-	}
-	return NULL;
-}
-
-/**
- * Choose an AoE command tag
- *
- * @ret tag		New tag, or negative error
- */
-static int aoecmd_new_tag ( void ) {
-	static uint16_t tag_idx;
-	unsigned int i;
-
-	for ( i = 0 ; i < 65536 ; i++ ) {
-		tag_idx++;
-		if ( aoecmd_find_tag ( tag_idx ) == NULL )
-			return ( AOE_TAG_MAGIC | tag_idx );
-	}
-	return -EADDRINUSE;
-}
-
 /**
  * Create AoE command
  *
  * @v aoedev		AoE device
  * @v type		AoE command type
+ * @v num_frames	Number of frames
  * @ret aoecmd		AoE command
+ *
+ * Each frame is allocated a tag, but is otherwise left for the
+ * caller to fill in.
  */
 static struct aoe_command * aoecmd_create ( struct aoe_device *aoedev,
-					    struct aoe_command_type *type ) {
+					    struct aoe_command_type *type,
+					    unsigned int num_frames ) {
 	struct aoe_command *aoecmd;
+	struct aoe_frame *frame;
+	unsigned int i;
 	int tag;
 
-	/* Allocate command tag */
-	tag = aoecmd_new_tag();
-	if ( tag < 0 )
-		return NULL;
-
 	/* Allocate and initialise structure */
-	aoecmd = zalloc ( sizeof ( *aoecmd ) );
+	aoecmd = zalloc ( sizeof ( *aoecmd ) +
+			  ( num_frames * sizeof ( aoecmd->frames[0] ) ) );
 	if ( ! aoecmd )
 		return NULL;
 	ref_init ( &aoecmd->refcnt, aoecmd_free );
-	list_add ( &aoecmd->list, &aoe_commands );
+	list_add ( &aoecmd->list, &aoedev->commands );
 	intf_init ( &aoecmd->ata, &aoecmd_ata_desc, &aoecmd->refcnt );
-	timer_init ( &aoecmd->timer, aoecmd_expired, &aoecmd->refcnt );
 	aoecmd->aoedev = aoedev_get ( aoedev );
 	aoecmd->type = type;
-	aoecmd->tag = tag;
-
-	/* Preserve timeout from last completed command */
-	aoecmd->timer.timeout = aoedev->timeout;
+	aoecmd->num_frames = num_frames;
+	aoecmd->remaining = num_frames;
+
+	/* Initialise frames and allocate tags */
+	for ( i = 0 ; i < num_frames ; i++ ) {
+		frame = &aoecmd->frames[i];
+		frame->aoecmd = aoecmd;
+		INIT_LIST_HEAD ( &frame->hash );
+		INIT_LIST_HEAD ( &frame->queue );
+		timer_init ( &frame->timer, aoe_frame_expired,
+			     &aoecmd->refcnt );
+	}
+	for ( i = 0 ; i < num_frames ; i++ ) {
+		frame = &aoecmd->frames[i];
+		tag = aoe_new_tag();
+		if ( tag < 0 ) {
+			aoecmd_close ( aoecmd, tag );
+			return NULL;
+		}
+		frame->tag = tag;
+		list_add ( &frame->hash, aoe_tag_bucket ( frame->tag ) );
+	}
+	aoecmd->tag = aoecmd->frames[0].tag;
 
 	/* Return already mortalised.  (Reference is held by command list.) */
 	return aoecmd;
 }
 
+/**
+ * Check if ATA command may be split across multiple frames
+ *
+ * @v command		ATA command
+ * @ret splittable	ATA command may be split
+ */
+static int aoecmd_ata_splittable ( struct ata_cmd *command ) {
+
+	switch ( command->cb.cmd_stat ) {
+	case ATA_CMD_READ:
+	case ATA_CMD_READ_EXT:
+	case ATA_CMD_WRITE:
+	case ATA_CMD_WRITE_EXT:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
 /**
  * Issue AoE ATA command
  *
@@ -646,12 +942,25 @@ static struct aoe_command * aoecmd_create ( struct aoe_device *aoedev,
  * @v parent		Parent interface
  * @v command		ATA command
  * @ret tag		Command tag, or negative error
+ *
+ * Read and write commands spanning more sectors than will fit in a
+ * single frame are split into multiple frames, which are issued
+ * concurrently subject to the device's window.
  */
 static int aoedev_ata_command ( struct aoe_device *aoedev,
 				struct interface *parent,
 				struct ata_cmd *command ) {
 	struct net_device *netdev = aoedev->netdev;
 	struct aoe_command *aoecmd;
+	struct aoe_frame *frame;
+	unsigned int frame_count;
+	unsigned int num_frames;
+	unsigned int count;
+	unsigned int i;
+	uint64_t lba;
+	size_t offset;
+	size_t len;
+	int tag;
 
 	/* Fail immediately if net device is closed */
 	if ( ! netdev_is_open ( netdev ) ) {
@@ -660,22 +969,61 @@ static int aoedev_ata_command ( struct aoe_device *aoedev,
 		return -EWOULDBLOCK;
 	}
 
+	/* Determine frame layout */
+	count = command->cb.count.native;
+	len = ( command->data_in_len | command->data_out_len );
+	if ( aoecmd_ata_splittable ( command ) &&
+	     ( len == ( count * ATA_SECTOR_SIZE ) ) ) {
+		frame_count = aoedev->frame_count;
+		num_frames = ( ( count + frame_count - 1 ) / frame_count );
+	} else {
+		frame_count = count;
+		num_frames = 1;
+	}
+	if ( ! num_frames )
+		num_frames = 1;
+
 	/* Create command */
-	aoecmd = aoecmd_create ( aoedev, &aoecmd_ata );
+	aoecmd = aoecmd_create ( aoedev, &aoecmd_ata, num_frames );
 	if ( ! aoecmd )
 		return -ENOMEM;
 	memcpy ( &aoecmd->command, command, sizeof ( aoecmd->command ) );
 
-	/* Attempt to send command.  Allow failures to be handled by
-	 * the retry timer.
-	 */
-	aoecmd_tx ( aoecmd );
+	/* Describe frames */
+	lba = command->cb.lba.native;
+	offset = 0;
+	for ( i = 0 ; i < num_frames ; i++ ) {
+		frame = &aoecmd->frames[i];
+		frame->lba = lba;
+		frame->offset = offset;
+		if ( num_frames == 1 ) {
+			frame->count = count;
+			frame->len = len;
+		} else {
+			frame->count = ( ( count < frame_count ) ?
+					 count : frame_count );
+			frame->len = ( frame->count * ATA_SECTOR_SIZE );
+		}
+		lba += frame->count;
+		count -= frame->count;
+		offset += frame->len;
+	}
 
-	/* Attach to parent interface, leave reference with command
-	 * list, and return.
+	/* Attach to parent interface (leaving reference with command
+	 * list) before starting frames, since a frame may complete
+	 * immediately.
 	 */
 	intf_plug_plug ( &aoecmd->ata, parent );
-	return aoecmd->tag;
+	tag = aoecmd->tag;
+	aoecmd_get ( aoecmd );
+	for ( i = 0 ; i < num_frames ; i++ ) {
+		if ( aoecmd->frames[i].done )
+			break;
+		aoe_frame_start ( &aoecmd->frames[i] );
+	}
+	aoecmd_put ( aoecmd );
+
+	return tag;
 }
 
 /**
@@ -690,14 +1038,14 @@ static int aoedev_cfg_command ( struct aoe_device *aoedev,
 	struct aoe_command *aoecmd;
 
 	/* Create command */
-	aoecmd = aoecmd_create ( aoedev, &aoecmd_cfg );
+	aoecmd = aoecmd_create ( aoedev, &aoecmd_cfg, 1 );
 	if ( ! aoecmd )
 		return -ENOMEM;
 
 	/* Attempt to send command.  Allow failures to be handled by
 	 * the retry timer.
 	 */
-	aoecmd_tx ( aoecmd );
+	aoe_frame_start ( &aoecmd->frames[0] );
 
 	/* Attach to parent interface, leave reference with command
 	 * list, and return.
@@ -727,16 +1075,18 @@ static void aoedev_free ( struct refcnt *refcnt ) {
  */
 static void aoedev_close ( struct aoe_device *aoedev, int rc ) {
 	struct aoe_command *aoecmd;
-	struct aoe_command *tmp;
 
 	/* Shut down interfaces */
 	intf_shutdown ( &aoedev->ata, rc );
 	intf_shutdown ( &aoedev->config, rc );
 
-	/* Shut down any active commands */
-	list_for_each_entry_safe ( aoecmd, tmp, &aoe_commands, list ) {
-		if ( aoecmd->aoedev != aoedev )
-			continue;
+	/* Shut down any active commands.  (Closing one command may
+	 * cause others to be closed, so restart from the head of the
+	 * list each time.)
+	 */
+	while ( ( aoecmd = list_first_entry ( &aoedev->commands,
+					      struct aoe_command,
+					      list ) ) != NULL ) {
 		aoecmd_get ( aoecmd );
 		aoecmd_close ( aoecmd, rc );
 		aoecmd_put ( aoecmd );
@@ -748,9 +1098,17 @@ static void aoedev_close ( struct aoe_device *aoedev, int rc ) {
  *
  * @v aoedev		AoE device
  * @ret len		Length of window
+ *
+ * Further commands are refused while any frames are awaiting
+ * transmission, so that the transmit queue remains bounded.
  */
 static size_t aoedev_window ( struct aoe_device *aoedev ) {
-	return ( aoedev->configured ? ~( ( size_t ) 0 ) : 0 );
+
+	if ( ! aoedev->configured )
+		return 0;
+	if ( ! list_empty ( &aoedev->queue ) )
+		return 0;
+	return ( aoedev->window - aoedev->outstanding );
 }
 
 /**
@@ -849,6 +1207,7 @@ static struct interface_descriptor aoedev_config_desc =
 static int aoedev_open ( struct interface *parent, struct net_device *netdev,
 			 unsigned int major, unsigned int minor ) {
 	struct aoe_device *aoedev;
+	size_t max_len;
 	int rc;
 
 	/* Allocate and initialise structure */
@@ -865,6 +1224,26 @@ static int aoedev_open ( struct interface *parent, struct net_device *netdev,
 	aoedev->minor = minor;
 	memcpy ( aoedev->target, netdev->ll_broadcast,
 		 netdev->ll_protocol->ll_addr_len );
+	INIT_LIST_HEAD ( &aoedev->commands );
+	INIT_LIST_HEAD ( &aoedev->queue );
+
+	/* Determine window size.  (This will be further limited by
+	 * the target's queue depth once configuration is complete.)
+	 */
+	aoedev->window = fetch_uintz_setting ( NULL, &aoe_window_setting );
+	if ( ! aoedev->window )
+		aoedev->window = AOE_DEFAULT_WINDOW;
+
+	/* Determine maximum number of sectors per frame from the
+	 * link MTU.
+	 */
+	max_len = ( netdev->max_pkt_len - netdev->ll_protocol->ll_header_len -
+		    sizeof ( struct aoehdr ) - sizeof ( struct aoeata ) );
+	aoedev->frame_count = ( max_len / ATA_SECTOR_SIZE );
+	if ( aoedev->frame_count > AOE_MAX_FRAME_COUNT )
+		aoedev->frame_count = AOE_MAX_FRAME_COUNT;
+	if ( ! aoedev->frame_count )
+		aoedev->frame_count = 1;
 
 	/* Initiate configuration */
 	if ( ( rc = aoedev_cfg_command ( aoedev, &aoedev->config ) ) < 0 ) {
@@ -916,6 +1295,7 @@ static int aoe_rx ( struct io_buffer *iobuf,
 		    const void *ll_source,
 		    unsigned int flags __unused ) {
 	struct aoehdr *aoehdr = iobuf->data;
+	struct aoe_frame *frame;
 	struct aoe_command *aoecmd;
 	int rc;
 
@@ -938,9 +1318,9 @@ static int aoe_rx ( struct io_buffer *iobuf,
 		goto err_sanity;
 	}
 
-	/* Demultiplex amongst active AoE commands */
-	aoecmd = aoecmd_find_tag ( ntohl ( aoehdr->tag ) );
-	if ( ! aoecmd ) {
+	/* Demultiplex amongst active AoE frames */
+	frame = aoe_find_tag ( ntohl ( aoehdr->tag ) );
+	if ( ! frame ) {
 		DBG ( "AoE received packet for unused tag %08x\n",
 		      ntohl ( aoehdr->tag ) );
 		rc = -ENOENT;
@@ -948,9 +1328,9 @@ static int aoe_rx ( struct io_buffer *iobuf,
 	}
 
 	/* Pass received frame to command */
-	aoecmd_get ( aoecmd );
-	if ( ( rc = aoecmd_rx ( aoecmd, iob_disown ( iobuf ),
-				ll_source ) ) != 0 )
+	aoecmd = aoecmd_get ( frame->aoecmd );
+	if ( ( rc = aoe_frame_rx ( frame, iob_disown ( iobuf ),
+				   ll_source ) ) != 0 )
 		goto err_rx;
 
  err_rx:
@@ -968,6 +1348,22 @@ struct net_protocol aoe_protocol __net_protocol = {
 	.rx = aoe_rx,
 };
 
+/**
+ * Initialise AoE tag hash
+ *
+ */
+static void aoe_init ( void ) {
+	unsigned int i;
+
+	for ( i = 0 ; i < AOE_TAG_BUCKETS ; i++ )
+		INIT_LIST_HEAD ( &aoe_tags[i] );
+}
+
+/** AoE initialisation function */
+struct init_fn aoe_init_fn __init_fn ( INIT_NORMAL ) = {
+	.initialise = aoe_init,
+};
+
 /******************************************************************************
  *
  * AoE URIs
@@ -36,6 +36,67 @@ static LIST_HEAD ( ipv4_fragments );
 /** Fragment reassembly timeout */
 #define IP_FRAG_TIMEOUT ( TICKS_PER_SEC / 2 )
 
+/** Maximum reassembled payload length */
+#define IP_FRAG_MAX_LEN ( 0xffff - sizeof ( struct iphdr ) )
+
+/** Headroom reserved for the IPv4 header in a reassembly buffer */
+#define IP_FRAG_HEADROOM ( IP_MASK_HLEN * 4 )
+
+/** Maximum total payload space used by all reassembly buffers */
+#define IP_FRAG_MAX_MEM ( 256 * 1024 )
+
+/** Total payload space used by all reassembly buffers */
+static size_t ipv4_fragment_mem;
+
+/** Fragment reassembly statistics */
+struct ipv4_fragment_stats ipv4_fragment_stats;
+
+/** Network device of most recently accepted unicast destination
+ *
+ * This caches the result of the local address check for the
+ * duration of a batch of received packets.
+ */
+static struct net_device *ipv4_rx_netdev;
+
+/** Most recently accepted unicast destination */
+static struct in_addr ipv4_rx_dest;
+
+/** Number of entries in IPv4 routing cache (must be a power of two) */
+#define IPV4_ROUTE_CACHE_SIZE 16
+
+/** An IPv4 routing cache entry */
+struct ipv4_route_cache_entry {
+	/** Routing table generation for which this entry is valid */
+	unsigned int generation;
+	/** Final destination address */
+	struct in_addr dest;
+	/** Next hop destination address */
+	struct in_addr next_hop;
+	/** Routing table entry */
+	struct ipv4_miniroute *miniroute;
+};
+
+/** IPv4 routing cache */
+static struct ipv4_route_cache_entry ipv4_route_cache[IPV4_ROUTE_CACHE_SIZE];
+
+/** IPv4 routing table generation
+ *
+ * This is incremented whenever the routing table, or the state of
+ * any network device, changes.  Routing cache entries from an
+ * earlier generation are ignored.
+ */
+static unsigned int ipv4_route_generation = 1;
+
+/**
+ * Invalidate IPv4 routing cache
+ *
+ */
+static void ipv4_route_invalidate ( void ) {
+
+	ipv4_route_generation++;
+	ipv4_rx_netdev = NULL;
+}
+
 /**
  * Add IPv4 minirouting table entry
  *
@@ -49,6 +110,7 @@ static struct ipv4_miniroute * __malloc
 add_ipv4_miniroute ( struct net_device *netdev, struct in_addr address,
 		     struct in_addr netmask, struct in_addr gateway ) {
 	struct ipv4_miniroute *miniroute;
+	struct ipv4_miniroute *tmp;
 
 	DBGC ( netdev, "IPv4 add %s", inet_ntoa ( address ) );
 	DBGC ( netdev, "/%s ", inet_ntoa ( netmask ) );
@@ -68,15 +130,23 @@ add_ipv4_miniroute ( struct net_device *netdev, struct in_addr address,
 	miniroute->address = address;
 	miniroute->netmask = netmask;
 	miniroute->gateway = gateway;
-		
-	/* Add to end of list if we have a gateway, otherwise
-	 * to start of list.
+
+	/* Invalidate cached routes and receive destination */
+	ipv4_route_invalidate();
+
+	/* Keep the list sorted by descending prefix length, so that
+	 * the first matching local route is the longest prefix
+	 * match.  Within the same prefix length, routes without a
+	 * gateway precede routes with a gateway.
 	 */
-	if ( gateway.s_addr ) {
-		list_add_tail ( &miniroute->list, &ipv4_miniroutes );
-	} else {
-		list_add ( &miniroute->list, &ipv4_miniroutes );
+	list_for_each_entry ( tmp, &ipv4_miniroutes, list ) {
+		if ( ntohl ( tmp->netmask.s_addr ) < ntohl ( netmask.s_addr ) )
+			break;
+		if ( ( tmp->netmask.s_addr == netmask.s_addr ) &&
+		     tmp->gateway.s_addr && ! gateway.s_addr )
+			break;
 	}
+	list_add_tail ( &miniroute->list, &tmp->list );
 
 	return miniroute;
 }
@@ -95,41 +165,105 @@ static void del_ipv4_miniroute ( struct ipv4_miniroute *miniroute ) {
 		DBGC ( netdev, "gw %s ", inet_ntoa ( miniroute->gateway ) );
 	DBGC ( netdev, "via %s\n", miniroute->netdev->name );
 
+	ipv4_route_invalidate();
 	netdev_put ( miniroute->netdev );
 	list_del ( &miniroute->list );
 	free ( miniroute );
 }
 
 /**
- * Perform IPv4 routing
+ * Look up IPv4 routing table
  *
  * @v dest		Final destination address
- * @ret dest		Next hop destination address
+ * @ret next_hop	Next hop destination address
  * @ret miniroute	Routing table entry to use, or NULL if no route
  *
- * If the route requires use of a gateway, the next hop destination
- * address will be overwritten with the gateway address.
+ * The routing table is sorted by descending prefix length, so the
+ * first usable local route is the longest prefix match.  If there is
+ * no local route, the first usable route with a gateway is used.
  */
-static struct ipv4_miniroute * ipv4_route ( struct in_addr *dest ) {
+static struct ipv4_miniroute * ipv4_route_lookup ( struct in_addr dest,
+						   struct in_addr *next_hop ) {
 	struct ipv4_miniroute *miniroute;
-	int local;
-	int has_gw;
+	struct ipv4_miniroute *gateway = NULL;
 
-	/* Find first usable route in routing table */
 	list_for_each_entry ( miniroute, &ipv4_miniroutes, list ) {
 		if ( ! netdev_is_open ( miniroute->netdev ) )
 			continue;
-		local = ( ( ( dest->s_addr ^ miniroute->address.s_addr )
-			    & miniroute->netmask.s_addr ) == 0 );
-		has_gw = ( miniroute->gateway.s_addr );
-		if ( local || has_gw ) {
-			if ( ! local )
-				*dest = miniroute->gateway;
+		if ( ( ( dest.s_addr ^ miniroute->address.s_addr )
+		       & miniroute->netmask.s_addr ) == 0 ) {
+			*next_hop = dest;
 			return miniroute;
 		}
+		if ( miniroute->gateway.s_addr && ( ! gateway ) )
+			gateway = miniroute;
 	}
 
-	return NULL;
+	if ( gateway )
+		*next_hop = gateway->gateway;
+	return gateway;
+}
+
+/**
+ * Perform IPv4 routing
+ *
+ * @v dest		Final destination address
+ * @ret dest		Next hop destination address
+ * @ret miniroute	Routing table entry to use, or NULL if no route
+ *
+ * If the route requires use of a gateway, the next hop destination
+ * address will be overwritten with the gateway address.
+ */
+static struct ipv4_miniroute * ipv4_route ( struct in_addr *dest ) {
+	struct ipv4_route_cache_entry *cache;
+	struct ipv4_miniroute *miniroute;
+	struct in_addr next_hop;
+	uint32_t hash;
+
+	/* Check routing cache */
+	hash = ntohl ( dest->s_addr );
+	hash ^= ( hash >> 16 );
+	hash ^= ( hash >> 8 );
+	cache = &ipv4_route_cache[ hash & ( IPV4_ROUTE_CACHE_SIZE - 1 ) ];
+	if ( ( cache->generation == ipv4_route_generation ) &&
+	     ( cache->dest.s_addr == dest->s_addr ) ) {
+		*dest = cache->next_hop;
+		return cache->miniroute;
+	}
+
+	/* Look up routing table */
+	miniroute = ipv4_route_lookup ( *dest, &next_hop );
+	if ( ! miniroute )
+		return NULL;
+
+	/* Update routing cache */
+	cache->generation = ipv4_route_generation;
+	cache->dest = *dest;
+	cache->next_hop = next_hop;
+	cache->miniroute = miniroute;
+
+	*dest = next_hop;
+	return miniroute;
+}
+
+/**
+ * Free fragment reassembly buffer
+ *
+ * @v frag		Fragment reassembly buffer
+ */
+static void ipv4_fragment_free ( struct ipv4_fragment *frag ) {
+	struct ipv4_fragment_hole *hole;
+	struct ipv4_fragment_hole *tmp;
+
+	stop_timer ( &frag->timer );
+	list_for_each_entry_safe ( hole, tmp, &frag->holes, list ) {
+		list_del ( &hole->list );
+		free ( hole );
+	}
+	ipv4_fragment_mem -= frag->capacity;
+	free_iob ( frag->iobuf );
+	list_del ( &frag->list );
+	free ( frag );
 }
 
 /**
@@ -142,13 +276,11 @@ static void ipv4_fragment_expired ( struct retry_timer *timer,
 				    int fail __unused ) {
 	struct ipv4_fragment *frag =
 		container_of ( timer, struct ipv4_fragment, timer );
-	struct iphdr *iphdr = frag->iobuf->data;
 
-	DBGC ( iphdr->src, "IPv4 fragment %04x expired\n",
-	       ntohs ( iphdr->ident ) );
-	free_iob ( frag->iobuf );
-	list_del ( &frag->list );
-	free ( frag );
+	DBGC ( frag->src, "IPv4 fragment %04x expired\n",
+	       ntohs ( frag->ident ) );
+	ipv4_fragment_stats.timeouts++;
+	ipv4_fragment_free ( frag );
 }
 
 /**
@@ -159,13 +291,12 @@ static void ipv4_fragment_expired ( struct retry_timer *timer,
  */
 static struct ipv4_fragment * ipv4_fragment ( struct iphdr *iphdr ) {
 	struct ipv4_fragment *frag;
-	struct iphdr *frag_iphdr;
 
 	list_for_each_entry ( frag, &ipv4_fragments, list ) {
-		frag_iphdr = frag->iobuf->data;
-
-		if ( ( iphdr->src.s_addr == frag_iphdr->src.s_addr ) &&
-		     ( iphdr->ident == frag_iphdr->ident ) ) {
+		if ( ( iphdr->src.s_addr == frag->src.s_addr ) &&
+		     ( iphdr->dest.s_addr == frag->dest.s_addr ) &&
+		     ( iphdr->ident == frag->ident ) &&
+		     ( iphdr->protocol == frag->protocol ) ) {
 			return frag;
 		}
 	}
@@ -173,6 +304,163 @@ static struct ipv4_fragment * ipv4_fragment ( struct iphdr *iphdr ) {
 	return NULL;
 }
 
+/**
+ * Create fragment reassembly buffer
+ *
+ * @v iphdr		IPv4 header
+ * @ret frag		Fragment reassembly buffer, or NULL
+ *
+ * The new buffer has no payload space allocated, and a single hole
+ * covering all possible offsets.
+ */
+static struct ipv4_fragment * ipv4_fragment_create ( struct iphdr *iphdr ) {
+	struct ipv4_fragment *frag;
+	struct ipv4_fragment_hole *hole;
+
+	/* Allocate and initialise structure */
+	frag = zalloc ( sizeof ( *frag ) );
+	if ( ! frag )
+		return NULL;
+	INIT_LIST_HEAD ( &frag->holes );
+	frag->src = iphdr->src;
+	frag->dest = iphdr->dest;
+	frag->ident = iphdr->ident;
+	frag->protocol = iphdr->protocol;
+	timer_init ( &frag->timer, ipv4_fragment_expired, NULL );
+
+	/* Create initial hole */
+	hole = zalloc ( sizeof ( *hole ) );
+	if ( ! hole ) {
+		free ( frag );
+		return NULL;
+	}
+	hole->last = ~( ( size_t ) 0 );
+	list_add ( &hole->list, &frag->holes );
+
+	/* Add to start of list (i.e. as most recently created) */
+	list_add ( &frag->list, &ipv4_fragments );
+
+	return frag;
+}
+
+/**
+ * Ensure fragment reassembly buffer has sufficient payload space
+ *
+ * @v frag		Fragment reassembly buffer
+ * @v end		Required payload length
+ * @v total		Total payload length, or zero if not yet known
+ * @ret rc		Return status code
+ *
+ * Payload space is allocated to the exact length once the final
+ * fragment has been seen, and otherwise grows geometrically so that
+ * the total amount of copying remains linear in the datagram length.
+ * Older reassembly buffers are discarded if necessary to remain
+ * within the overall memory limit.
+ */
+static int ipv4_fragment_reserve ( struct ipv4_fragment *frag, size_t end,
+				   size_t total ) {
+	struct ipv4_fragment *oldest;
+	struct io_buffer *iobuf;
+	size_t capacity;
+
+	/* Do nothing if buffer is already large enough */
+	if ( end <= frag->capacity )
+		return 0;
+
+	/* Calculate new payload length */
+	if ( total ) {
+		capacity = total;
+	} else {
+		capacity = ( 2 * frag->capacity );
+		if ( capacity < ( 2 * end ) )
+			capacity = ( 2 * end );
+		if ( capacity > IP_FRAG_MAX_LEN )
+			capacity = IP_FRAG_MAX_LEN;
+	}
+
+	/* Discard oldest reassembly buffers to free up memory */
+	while ( ( ipv4_fragment_mem + capacity - frag->capacity ) >
+		IP_FRAG_MAX_MEM ) {
+		oldest = list_last_entry ( &ipv4_fragments,
+					   struct ipv4_fragment, list );
+		if ( oldest == frag )
+			return -ENOBUFS;
+		DBGC ( oldest->src, "IPv4 fragment %04x evicted\n",
+		       ntohs ( oldest->ident ) );
+		ipv4_fragment_stats.evicted++;
+		ipv4_fragment_free ( oldest );
+	}
+
+	/* Allocate new buffer */
+	iobuf = alloc_iob ( IP_FRAG_HEADROOM + capacity );
+	if ( ! iobuf )
+		return -ENOMEM;
+	iob_reserve ( iobuf, IP_FRAG_HEADROOM );
+
+	/* Copy any existing header and payload */
+	if ( frag->iobuf ) {
+		memcpy ( ( iobuf->data - IP_FRAG_HEADROOM ),
+			 ( frag->iobuf->data - IP_FRAG_HEADROOM ),
+			 ( IP_FRAG_HEADROOM + frag->extent ) );
+		free_iob ( frag->iobuf );
+	}
+	frag->iobuf = iobuf;
+	ipv4_fragment_mem += ( capacity - frag->capacity );
+	frag->capacity = capacity;
+
+	return 0;
+}
+
+/**
+ * Fill holes in fragment reassembly buffer
+ *
+ * @v frag		Fragment reassembly buffer
+ * @v first		Offset of first received byte
+ * @v last		Offset following last received byte
+ * @ret rc		Return status code
+ *
+ * This is the hole descriptor algorithm from RFC 815.  Fragments
+ * may arrive in any order and may overlap.
+ */
+static int ipv4_fragment_fill ( struct ipv4_fragment *frag, size_t first,
+				size_t last ) {
+	struct ipv4_fragment_hole *hole;
+	struct ipv4_fragment_hole *tmp;
+	struct ipv4_fragment_hole *split;
+
+	list_for_each_entry_safe ( hole, tmp, &frag->holes, list ) {
+
+		/* Skip holes not overlapping this fragment */
+		if ( ( first >= hole->last ) || ( last <= hole->first ) )
+			continue;
+
+		if ( ( first > hole->first ) && ( last < hole->last ) ) {
+			/* Fragment lies strictly within this hole (and
+			 * so overlaps no other hole): split the hole.
+			 */
+			split = malloc ( sizeof ( *split ) );
+			if ( ! split )
+				return -ENOMEM;
+			split->first = last;
+			split->last = hole->last;
+			list_add ( &split->list, &hole->list );
+			hole->last = first;
+		} else if ( first > hole->first ) {
+			/* Fragment fills end of hole */
+			hole->last = first;
+		} else if ( last < hole->last ) {
+			/* Fragment fills start of hole */
+			hole->first = last;
+		} else {
+			/* Fragment fills entire hole */
+			list_del ( &hole->list );
+			free ( hole );
+		}
+	}
+
+	return 0;
+}
+
 /**
  * Fragment reassembler
  *
@@ -184,68 +472,93 @@ static struct io_buffer * ipv4_reassemble ( struct io_buffer *iobuf ) {
 	size_t offset = ( ( ntohs ( iphdr->frags ) & IP_MASK_OFFSET ) << 3 );
 	unsigned int more_frags = ( iphdr->frags & htons ( IP_MASK_MOREFRAGS ));
 	size_t hdrlen = ( ( iphdr->verhdrlen & IP_MASK_HLEN ) * 4 );
+	size_t len = ( iob_len ( iobuf ) - hdrlen );
+	size_t end = ( offset + len );
 	struct ipv4_fragment *frag;
-	size_t expected_offset;
-	struct io_buffer *new_iobuf;
+	struct io_buffer *reassembled;
+	struct iphdr *reassembled_iphdr;
+	size_t total;
+	int rc;
 
-	/* Find matching fragment reassembly buffer, if any */
+	/* Sanity check fragment */
+	if ( more_frags && ( ( len == 0 ) || ( len & 0x07 ) ) ) {
+		DBGC ( iphdr->src, "IPv4 dropping fragment %04x with invalid "
+		       "length %zd\n", ntohs ( iphdr->ident ), len );
+		goto drop;
+	}
+	if ( end > IP_FRAG_MAX_LEN ) {
+		DBGC ( iphdr->src, "IPv4 dropping fragment %04x beyond "
+		       "maximum length (%zd+%zd)\n",
+		       ntohs ( iphdr->ident ), offset, len );
+		goto drop;
+	}
+
+	/* Find or create matching fragment reassembly buffer */
 	frag = ipv4_fragment ( iphdr );
+	if ( ! frag ) {
+		frag = ipv4_fragment_create ( iphdr );
+		if ( ! frag )
+			goto drop;
+	}
 
-	/* Drop out-of-order fragments */
-	expected_offset = ( frag ? frag->offset : 0 );
-	if ( offset != expected_offset ) {
-		DBGC ( iphdr->src, "IPv4 dropping out-of-sequence fragment "
-		       "%04x (%zd+%zd, expected %zd)\n",
-		       ntohs ( iphdr->ident ), offset,
-		      ( iob_len ( iobuf ) - hdrlen ), expected_offset );
+	/* Check consistency with any known total length */
+	if ( ( frag->len && ( end > frag->len ) ) ||
+	     ( ( ! more_frags ) &&
+	       ( ( frag->len && ( end != frag->len ) ) ||
+		 ( end < frag->extent ) ) ) ) {
+		DBGC ( iphdr->src, "IPv4 dropping inconsistent fragment "
+		       "%04x (%zd+%zd, length %zd)\n", ntohs ( iphdr->ident ),
+		       offset, len, frag->len );
 		goto drop;
 	}
 
-	/* Create or extend fragment reassembly buffer as applicable */
-	if ( frag == NULL ) {
+	/* Ensure there is space for this fragment */
+	total = ( more_frags ? frag->len : end );
+	if ( ( rc = ipv4_fragment_reserve ( frag, end, total ) ) != 0 ) {
+		DBGC ( iphdr->src, "IPv4 could not extend reassembly buffer "
+		       "%04x to %zd bytes: %s\n", ntohs ( iphdr->ident ),
+		       end, strerror ( rc ) );
+		goto drop_frag;
+	}
 
-		/* Create new fragment reassembly buffer */
-		frag = zalloc ( sizeof ( *frag ) );
-		if ( ! frag )
-			goto drop;
-		list_add ( &frag->list, &ipv4_fragments );
-		frag->iobuf = iobuf;
-		frag->offset = ( iob_len ( iobuf ) - hdrlen );
-		timer_init ( &frag->timer, ipv4_fragment_expired, NULL );
+	/* Update hole list.  The final fragment also fills the
+	 * (conceptually infinite) hole beyond the end of the datagram.
+	 */
+	if ( ( rc = ipv4_fragment_fill ( frag, offset,
+					 ( more_frags ? end :
+					   ~( ( size_t ) 0 ) ) ) ) != 0 ) {
+		goto drop_frag;
+	}
+	frag->len = total;
 
-	} else {
+	/* Copy header (from first fragment) and payload into place */
+	if ( offset == 0 ) {
+		memcpy ( ( frag->iobuf->data - hdrlen ), iphdr, hdrlen );
+		frag->hdrlen = hdrlen;
+	}
+	memcpy ( ( frag->iobuf->data + offset ), ( iobuf->data + hdrlen ),
+		 len );
+	if ( frag->extent < end )
+		frag->extent = end;
+	free_iob ( iobuf );
 
-		/* Extend reassembly buffer */
-		iob_pull ( iobuf, hdrlen );
-		new_iobuf = alloc_iob ( iob_len ( frag->iobuf ) +
-					iob_len ( iobuf ) );
-		if ( ! new_iobuf ) {
-			DBGC ( iphdr->src, "IPv4 could not extend reassembly "
-			       "buffer to %zd bytes\n",
-			       iob_len ( frag->iobuf ) + iob_len ( iobuf ) );
-			goto drop;
-		}
-		memcpy ( iob_put ( new_iobuf, iob_len ( frag->iobuf ) ),
-			 frag->iobuf->data, iob_len ( frag->iobuf ) );
-		memcpy ( iob_put ( new_iobuf, iob_len ( iobuf ) ),
-			 iobuf->data, iob_len ( iobuf ) );
-		free_iob ( frag->iobuf );
-		frag->iobuf = new_iobuf;
-		frag->offset += iob_len ( iobuf );
-		free_iob ( iobuf );
-		iphdr = frag->iobuf->data;
-		iphdr->len = ntohs ( iob_len ( frag->iobuf ) );
-
-		/* Stop fragment reassembly timer */
-		stop_timer ( &frag->timer );
-
-		/* If this is the final fragment, return it */
-		if ( ! more_frags ) {
-			iobuf = frag->iobuf;
-			list_del ( &frag->list );
-			free ( frag );
-			return iobuf;
-		}
+	/* If there are no holes remaining, return the datagram */
+	if ( list_empty ( &frag->holes ) ) {
+		reassembled = frag->iobuf;
+		frag->iobuf = NULL;
+		iob_put ( reassembled, frag->len );
+		reassembled_iphdr = iob_push ( reassembled, frag->hdrlen );
+		reassembled_iphdr->len = htons ( iob_len ( reassembled ) );
+		reassembled_iphdr->frags = 0;
+		reassembled_iphdr->chksum = 0;
+		reassembled_iphdr->chksum =
+			tcpip_chksum ( reassembled_iphdr, frag->hdrlen );
+		DBGC2 ( reassembled_iphdr->src, "IPv4 reassembled %04x "
+			"(%zd bytes)\n", ntohs ( reassembled_iphdr->ident ),
+			frag->len );
+		ipv4_fragment_stats.reassembled++;
+		ipv4_fragment_free ( frag );
+		return reassembled;
 	}
 
 	/* (Re)start fragment reassembly timer */
@@ -253,7 +566,14 @@ static struct io_buffer * ipv4_reassemble ( struct io_buffer *iobuf ) {
 
 	return NULL;
 
+ drop_frag:
+	/* Discard a reassembly buffer which has not yet received
+	 * any fragments.
+	 */
+	if ( ! frag->extent )
+		ipv4_fragment_free ( frag );
  drop:
+	ipv4_fragment_stats.dropped++;
 	free_iob ( iobuf );
 	return NULL;
 }
@@ -438,6 +758,43 @@ static int ipv4_has_addr ( struct net_device *netdev, struct in_addr addr ) {
 	return 0;
 }
 
+/**
+ * Check if unicast packet is destined for us
+ *
+ * @v netdev		Network device
+ * @v dest		Destination IPv4 address
+ * @ret is_local	Packet should be accepted
+ */
+static int ipv4_rx_is_local ( struct net_device *netdev,
+			      struct in_addr dest ) {
+
+	/* Use cached result, if applicable */
+	if ( ( netdev == ipv4_rx_netdev ) &&
+	     ( dest.s_addr == ipv4_rx_dest.s_addr ) )
+		return 1;
+
+	/* Reject if we have addresses but not this one */
+	if ( ipv4_has_any_addr ( netdev ) &&
+	     ( ! ipv4_has_addr ( netdev, dest ) ) )
+		return 0;
+
+	/* Cache result for remainder of batch */
+	ipv4_rx_netdev = netdev;
+	ipv4_rx_dest = dest;
+	return 1;
+}
+
+/**
+ * Complete a batch of received packets
+ *
+ * @v netdev		Network device
+ */
+static void ipv4_rx_batch_end ( struct net_device *netdev __unused ) {
+
+	/* Invalidate cached receive destination */
+	ipv4_rx_netdev = NULL;
+}
+
 /**
  * Process incoming packets
  *
@@ -517,8 +874,7 @@ static int ipv4_rx ( struct io_buffer *iobuf,
 
 	/* Discard unicast packets not destined for us */
 	if ( ( ! ( flags & LL_MULTICAST ) ) &&
-	     ipv4_has_any_addr ( netdev ) &&
-	     ( ! ipv4_has_addr ( netdev, iphdr->dest ) ) ) {
+	     ( ! ipv4_rx_is_local ( netdev, iphdr->dest ) ) ) {
 		DBGC ( iphdr->src, "IPv4 discarding non-local unicast packet "
 		       "for %s\n", inet_ntoa ( iphdr->dest ) );
 		goto err;
@@ -609,6 +965,7 @@ struct net_protocol ipv4_protocol __net_protocol = {
 	.net_addr_len = sizeof ( struct in_addr ),
 	.rx = ipv4_rx,
 	.ntoa = ipv4_ntoa,
+	.rx_batch_end = ipv4_rx_batch_end,
 };
 
 /** IPv4 TCPIP net protocol */
@@ -705,6 +1062,34 @@ static int ipv4_create_routes ( void ) {
 	return 0;
 }
 
+/**
+ * Handle IPv4 network device creation
+ *
+ * @v netdev		Network device
+ * @ret rc		Return status code
+ */
+static int ipv4_probe ( struct net_device *netdev __unused ) {
+	/* Nothing to do */
+	return 0;
+}
+
+/**
+ * Invalidate IPv4 routing cache on network device state change or removal
+ *
+ * @v netdev		Network device
+ */
+static void ipv4_notify ( struct net_device *netdev __unused ) {
+	ipv4_route_invalidate();
+}
+
+/** IPv4 driver (for net device notifications) */
+struct net_driver ipv4_net_driver __net_driver = {
+	.name = "IPv4",
+	.probe = ipv4_probe,
+	.notify = ipv4_notify,
+	.remove = ipv4_notify,
+};
+
 /** IPv4 settings applicator */
 struct settings_applicator ipv4_settings_applicator __settings_applicator = {
 	.apply = ipv4_create_routes,
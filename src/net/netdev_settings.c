@@ -27,6 +27,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/settings.h>
 #include <ipxe/device.h>
 #include <ipxe/netdevice.h>
+#include <config/general.h>
 
 /** @file
  *
@@ -47,6 +48,12 @@ struct setting busid_setting __setting ( SETTING_NETDEV ) = {
 	.type = &setting_type_hex,
 	.tag = NETDEV_SETTING_TAG_BUS_ID,
 };
+struct setting rxbudget_setting __setting ( SETTING_NETDEV ) = {
+	.name = "rxbudget",
+	.description = "Receive budget",
+	.type = &setting_type_uint16,
+	.tag = NETDEV_SETTING_TAG_RX_BUDGET,
+};
 
 /**
  * Check applicability of network device setting
@@ -75,6 +82,7 @@ static int netdev_store ( struct settings *settings, struct setting *setting,
 			  const void *data, size_t len ) {
 	struct net_device *netdev = container_of ( settings, struct net_device,
 						   settings.settings );
+	uint16_t budget;
 
 	if ( setting_cmp ( setting, &mac_setting ) == 0 ) {
 		if ( len != netdev->ll_protocol->ll_addr_len )
@@ -84,6 +92,19 @@ static int netdev_store ( struct settings *settings, struct setting *setting,
 	}
 	if ( setting_cmp ( setting, &busid_setting ) == 0 )
 		return -ENOTSUP;
+	if ( setting_cmp ( setting, &rxbudget_setting ) == 0 ) {
+		if ( ! data ) {
+			netdev->rx_budget = NETDEV_RX_BUDGET;
+			return 0;
+		}
+		if ( len != sizeof ( budget ) )
+			return -EINVAL;
+		memcpy ( &budget, data, sizeof ( budget ) );
+		if ( ! budget )
+			return -EINVAL;
+		netdev->rx_budget = ntohs ( budget );
+		return 0;
+	}
 
 	return generic_settings_store ( settings, setting, data, len );
 }
@@ -103,6 +124,7 @@ static int netdev_fetch ( struct settings *settings, struct setting *setting,
 						   settings.settings );
 	struct device_description *desc = &netdev->dev->desc;
 	struct dhcp_netdev_desc dhcp_desc;
+	uint16_t budget;
 
 	if ( setting_cmp ( setting, &mac_setting ) == 0 ) {
 		if ( len > netdev->ll_protocol->ll_addr_len )
@@ -119,6 +141,13 @@ static int netdev_fetch ( struct settings *settings, struct setting *setting,
 		memcpy ( data, &dhcp_desc, len );
 		return sizeof ( dhcp_desc );
 	}
+	if ( setting_cmp ( setting, &rxbudget_setting ) == 0 ) {
+		budget = htons ( netdev->rx_budget );
+		if ( len > sizeof ( budget ) )
+			len = sizeof ( budget );
+		memcpy ( data, &budget, len );
+		return sizeof ( budget );
+	}
 
 	return generic_settings_fetch ( settings, setting, data, len );
 }
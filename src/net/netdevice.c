@@ -424,6 +424,7 @@ struct net_device * alloc_netdev ( size_t priv_size ) {
 		netdev->link_rc = -EUNKNOWN_LINK_STATUS;
 		INIT_LIST_HEAD ( &netdev->tx_queue );
 		INIT_LIST_HEAD ( &netdev->rx_queue );
+		netdev->rx_budget = NETDEV_RX_BUDGET;
 		netdev_settings_init ( netdev );
 		netdev->priv = ( ( ( void * ) netdev ) + sizeof ( *netdev ) );
 	}
@@ -716,26 +717,123 @@ int net_rx ( struct io_buffer *iobuf, struct net_device *netdev,
 }
 
 /**
- * Poll the network stack
+ * Count packets waiting on receive queue
  *
- * This polls all interfaces for received packets, and processes
- * packets from the RX queue.
+ * @v netdev		Network device
+ * @ret count		Number of packets waiting to be processed
  */
-void net_poll ( void ) {
-	struct net_device *netdev;
+static unsigned int netdev_rx_backlog ( struct net_device *netdev ) {
+	struct io_buffer *iobuf;
+	unsigned int count = 0;
+
+	list_for_each_entry ( iobuf, &netdev->rx_queue, list ) {
+		if ( ++count >= netdev->rx_budget )
+			break;
+	}
+	return count;
+}
+
+/**
+ * Complete a batch of received packets
+ *
+ * @v netdev		Network device
+ * @v count		Number of packets in batch
+ * @v exhausted		Batch was terminated by exhaustion of budget
+ */
+static void net_rx_batch_end ( struct net_device *netdev, unsigned int count,
+			       int exhausted ) {
+	struct net_protocol *net_protocol;
+
+	/* Notify network-layer protocols */
+	for_each_table_entry ( net_protocol, NET_PROTOCOLS ) {
+		if ( net_protocol->rx_batch_end )
+			net_protocol->rx_batch_end ( netdev );
+	}
+
+	/* Update statistics */
+	netdev->rx_batch_stats.batches++;
+	netdev->rx_batch_stats.packets += count;
+	if ( exhausted ) {
+		DBGC2 ( netdev, "NETDEV %s exhausted RX budget of %d "
+			"packets\n", netdev->name, netdev->rx_budget );
+		netdev->rx_batch_stats.exhausted++;
+	}
+}
+
+/**
+ * Process a batch of received packets
+ *
+ * @v netdev		Network device
+ *
+ * At most netdev->rx_budget packets are processed; any remaining
+ * packets are left on the receive queue until the next poll.
+ */
+static void net_rx_batch ( struct net_device *netdev ) {
 	struct io_buffer *iobuf;
 	struct ll_protocol *ll_protocol;
 	const void *ll_dest;
 	const void *ll_source;
 	uint16_t net_proto;
 	unsigned int flags;
+	unsigned int count = 0;
 	int rc;
 
+	/* Process received packets, up to the device's budget */
+	while ( count < netdev->rx_budget ) {
+
+		/* Dequeue next packet, if any */
+		if ( ! ( iobuf = netdev_rx_dequeue ( netdev ) ) )
+			break;
+		count++;
+
+		DBGC2 ( netdev, "NETDEV %s processing %p (%p+%zx)\n",
+			netdev->name, iobuf, iobuf->data, iob_len ( iobuf ) );
+
+		/* Remove link-layer header */
+		ll_protocol = netdev->ll_protocol;
+		if ( ( rc = ll_protocol->pull ( netdev, iobuf, &ll_dest,
+						&ll_source, &net_proto,
+						&flags ) ) != 0 ) {
+			free_iob ( iobuf );
+			continue;
+		}
+
+		/* Hand packet to network layer */
+		if ( ( rc = net_rx ( iob_disown ( iobuf ), netdev, net_proto,
+				     ll_dest, ll_source, flags ) ) != 0 ) {
+			/* Record error for diagnosis */
+			netdev_rx_err ( netdev, NULL, rc );
+		}
+	}
+
+	/* Complete batch, if any packets were processed */
+	if ( count ) {
+		net_rx_batch_end ( netdev, count,
+				   ( ! list_empty ( &netdev->rx_queue ) ) );
+	}
+}
+
+/**
+ * Poll the network stack
+ *
+ * This polls all interfaces for received packets, and processes a
+ * batch of packets from each device's RX queue.
+ */
+void net_poll ( void ) {
+	struct net_device *netdev;
+
 	/* Poll and process each network device */
 	list_for_each_entry ( netdev, &net_devices, list ) {
 
-		/* Poll for new packets */
-		netdev_poll ( netdev );
+		/* Poll for new packets, unless a full budget's worth
+		 * of packets is already waiting to be processed.  This
+		 * bounds the length of the receive queue for all
+		 * drivers, leaving any further packets in the
+		 * hardware until we have caught up.
+		 */
+		if ( netdev_rx_frozen ( netdev ) ||
+		     ( netdev_rx_backlog ( netdev ) < netdev->rx_budget ) )
+			netdev_poll ( netdev );
 
 		/* Leave received packets on the queue if receive
 		 * queue processing is currently frozen.  This will
@@ -746,31 +844,8 @@ void net_poll ( void ) {
 		if ( netdev_rx_frozen ( netdev ) )
 			continue;
 
-		/* Process all received packets */
-		while ( ( iobuf = netdev_rx_dequeue ( netdev ) ) ) {
-
-			DBGC2 ( netdev, "NETDEV %s processing %p (%p+%zx)\n",
-				netdev->name, iobuf, iobuf->data,
-				iob_len ( iobuf ) );
-
-			/* Remove link-layer header */
-			ll_protocol = netdev->ll_protocol;
-			if ( ( rc = ll_protocol->pull ( netdev, iobuf,
-							&ll_dest, &ll_source,
-							&net_proto,
-							&flags ) ) != 0 ) {
-				free_iob ( iobuf );
-				continue;
-			}
-
-			/* Hand packet to network layer */
-			if ( ( rc = net_rx ( iob_disown ( iobuf ), netdev,
-					     net_proto, ll_dest,
-					     ll_source, flags ) ) != 0 ) {
-				/* Record error for diagnosis */
-				netdev_rx_err ( netdev, NULL, rc );
-			}
-		}
+		/* Process a batch of received packets */
+		net_rx_batch ( netdev );
 	}
 }
 
@@ -784,4 +859,4 @@ static void net_step ( struct process *process __unused ) {
 }
 
 /** Networking stack process */
-PERMANENT_PROCESS ( net_process, net_step );
+PERMANENT_PROCESS_PRIO ( net_process, net_step, PROC_PRIO_HIGH );
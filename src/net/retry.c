@@ -39,15 +39,12 @@ FILE_LICENCE ( GPL2_OR_LATER );
  * 
  */
 
-/* The theoretical minimum that the algorithm in stop_timer() can
- * adjust the timeout back down to is seven ticks, so set the minimum
- * timeout to at least that value for the sake of consistency.
- */
-#define MIN_TIMEOUT 7
-
 /** List of running timers */
 static LIST_HEAD ( timers );
 
+/** Retry timer process */
+extern struct process retry_process;
+
 /**
  * Start timer
  *
@@ -63,6 +60,9 @@ void start_timer ( struct retry_timer *timer ) {
 		ref_get ( timer->refcnt );
 	}
 	timer->start = currticks();
+
+	/* Ensure that the new expiry time is taken into account */
+	process_wake ( &retry_process );
 	timer->running = 1;
 
 	/* 0 means "use default timeout" */
@@ -203,9 +203,38 @@ void retry_poll ( void ) {
  * Single-step the retry timer list
  *
  * @v process		Retry timer process
+ *
+ * If no timer has expired, the process sleeps until the earliest
+ * expiry time (or indefinitely, if no timers are running).  Starting
+ * a timer will wake the process.
  */
-static void retry_step ( struct process *process __unused ) {
+static void retry_step ( struct process *process ) {
+	struct retry_timer *timer;
+	unsigned long now;
+	unsigned long used;
+	unsigned long remaining;
+	unsigned long sleep = 0;
+
+	/* Process any expired timer */
 	retry_poll();
+
+	/* Stay awake if any timer remains due */
+	now = currticks();
+	list_for_each_entry ( timer, &timers, list ) {
+		used = ( now - timer->start );
+		if ( used >= timer->timeout )
+			return;
+		remaining = ( timer->timeout - used );
+		if ( ( sleep == 0 ) || ( remaining < sleep ) )
+			sleep = remaining;
+	}
+
+	/* Sleep until the next timer is due to expire */
+	if ( sleep ) {
+		process_sleep_timeout ( process, sleep );
+	} else {
+		process_sleep ( process );
+	}
 }
 
 /** Retry timer process */
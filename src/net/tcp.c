@@ -163,6 +163,9 @@ static LIST_HEAD ( tcp_conns );
 */
 static struct tcp_connection *listener;
 
+/** TCP statistics */
+struct tcp_stats tcp_stats;
+
 /* Forward declarations */
 static struct interface_descriptor tcp_xfer_desc;
 static void tcp_expired ( struct retry_timer *timer, int over );
@@ -697,6 +700,7 @@ static void tcp_expired ( struct retry_timer *timer, int over ) {
 		tcp_close ( tcp, -ETIMEDOUT );
 	} else {
 		/* Otherwise, retransmit the packet */
+		tcp_stats.retransmits++;
 		tcp_xmit ( tcp );
 	}
 }
@@ -174,6 +174,17 @@ static int bt_count_peers ( struct bt_request *bt ) {
 	return i;
 }
 
+/** Check if any BT peer has an open window and queued data */
+static int bt_peers_window ( struct bt_request *bt ) {
+	struct bt_peer *peer;
+	list_for_each_entry ( peer, &bt->peers, list ) {
+		if ( ! list_empty ( &peer->queue ) &&
+		     xfer_window ( &peer->socket ) )
+			return 1;
+	}
+	return 0;
+}
+
 /** Handle new data arriving via BitTorrent peer connection
 *	There is an assumption here that only PIECE messages are segmented.
 */
@@ -617,14 +628,25 @@ static void bt_step ( struct bt_request *bt ) {
 			list_for_each_entry ( tmp, &bt->peers, list ) {
 			 	bt_peer_xmit ( tmp );
 			}
+			/* Nothing sendable: sleep until a peer window
+			 * opens or a new piece is queued.
+			 */
+			if ( ! bt_peers_window ( bt ) )
+				process_sleep ( &bt->process );
 			break;
 		case BT_COMPLETE:
 			//bt_close ( bt, 0 ); 
+			process_sleep ( &bt->process );
 			break;
 	}
 	return;
 }
 
+/** Handle change in peer socket window */
+static void bt_peer_window_changed ( struct bt_peer *peer ) {
+	process_wake ( &peer->bt->process );
+}
+
 static size_t bt_xfer_window ( struct bt_request *bt __unused ) {
 	return 1;
 }
@@ -640,7 +662,9 @@ static size_t bt_peer_socket_window ( struct bt_peer *peer __unused ) {
 static struct interface_operation bt_peer_operations[] = {
 	INTF_OP ( intf_close, struct bt_peer *, bt_peer_close ),
 	INTF_OP ( xfer_deliver, struct bt_peer *, bt_peer_socket_deliver ),
-	INTF_OP ( xfer_window, struct bt_peer *, bt_peer_socket_window )
+	INTF_OP ( xfer_window, struct bt_peer *, bt_peer_socket_window ),
+	INTF_OP ( xfer_window_changed, struct bt_peer *,
+		  bt_peer_window_changed ),
 };
 
 /** BitTorrent peer socket interface descriptor */
@@ -853,6 +877,7 @@ static int bt_tx_piece ( struct bt_peer *peer, uint32_t index, uint32_t begin __
 	DBG ( "BT queueing PIECE %08x to %p\n", index, peer );
 	DBG2 ( "BT freemem is %zd\n", freemem );
 	list_add_tail ( &iobuf->list, &peer->queue );
+	process_wake ( &peer->bt->process );
 	return bt_peer_xmit ( peer );
 }
 
@@ -955,6 +980,7 @@ static int bt_xfer_open_child ( struct bt_request *bt,
 
 	/** Add new peer to list of BTpeers */
 	list_add ( &peer->list, &bt->peers );
+	process_wake ( &bt->process );
 
 	DBG ( "BT remote peer connected\n" );
 
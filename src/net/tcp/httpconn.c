@@ -0,0 +1,285 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+/**
+ * @file
+ *
+ * Hyper Text Transfer Protocol (HTTP) connection pool
+ *
+ * Connections which the server has agreed to keep alive are parked
+ * here when a request completes, and handed to the next request for
+ * the same origin.  This avoids a fresh TCP (and TLS) handshake for
+ * each file fetched from the same server.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <ipxe/refcnt.h>
+#include <ipxe/list.h>
+#include <ipxe/iobuf.h>
+#include <ipxe/xfer.h>
+#include <ipxe/uri.h>
+#include <ipxe/retry.h>
+#include <ipxe/timer.h>
+#include <ipxe/http.h>
+
+/** An idle HTTP connection */
+struct http_connection {
+	/** Reference count */
+	struct refcnt refcnt;
+	/** List of idle connections */
+	struct list_head list;
+	/** Transport layer interface */
+	struct interface socket;
+	/** Idle timeout timer */
+	struct retry_timer timer;
+
+	/** Server host name */
+	char *host;
+	/** Server port */
+	unsigned int port;
+	/** Filter (if any) */
+	int ( * filter ) ( struct interface *xfer,
+			   const char *name,
+			   struct interface **next );
+};
+
+/** Idle HTTP connections, most recently used first */
+static LIST_HEAD ( http_connections );
+
+/**
+ * Free idle HTTP connection
+ *
+ * @v refcnt		Reference count
+ */
+static void http_connection_free ( struct refcnt *refcnt ) {
+	struct http_connection *conn =
+		container_of ( refcnt, struct http_connection, refcnt );
+
+	free ( conn->host );
+	free ( conn );
+}
+
+/**
+ * Close idle HTTP connection
+ *
+ * @v conn		Idle HTTP connection
+ * @v rc		Reason for close
+ */
+static void http_connection_close ( struct http_connection *conn, int rc ) {
+
+	/* Do nothing if already closed */
+	if ( list_empty ( &conn->list ) )
+		return;
+
+	DBGC ( conn, "HTTPCONN %p closed: %s\n", conn, strerror ( rc ) );
+
+	/* Stop timer and shut down socket */
+	stop_timer ( &conn->timer );
+	intf_shutdown ( &conn->socket, rc );
+
+	/* Remove from pool and drop pool's reference */
+	list_del ( &conn->list );
+	INIT_LIST_HEAD ( &conn->list );
+	ref_put ( &conn->refcnt );
+}
+
+/**
+ * Handle idle timeout
+ *
+ * @v timer		Idle timeout timer
+ * @v fail		Failure indicator
+ */
+static void http_connection_expired ( struct retry_timer *timer,
+				      int fail __unused ) {
+	struct http_connection *conn =
+		container_of ( timer, struct http_connection, timer );
+
+	http_connection_close ( conn, 0 );
+}
+
+/**
+ * Receive data on idle HTTP connection
+ *
+ * @v conn		Idle HTTP connection
+ * @v iobuf		I/O buffer
+ * @v meta		Data transfer metadata
+ * @ret rc		Return status code
+ */
+static int http_connection_deliver ( struct http_connection *conn,
+				     struct io_buffer *iobuf,
+				     struct xfer_metadata *meta __unused ) {
+
+	/* Any data received on an idle connection leaves the protocol
+	 * in an unknown state; discard the connection.
+	 */
+	DBGC ( conn, "HTTPCONN %p received %zd unsolicited bytes\n",
+	       conn, iob_len ( iobuf ) );
+	free_iob ( iobuf );
+	http_connection_close ( conn, -EPROTO );
+	return -EPROTO;
+}
+
+/** Idle HTTP connection socket interface operations */
+static struct interface_operation http_connection_socket_op[] = {
+	INTF_OP ( xfer_deliver, struct http_connection *,
+		  http_connection_deliver ),
+	INTF_OP ( intf_close, struct http_connection *,
+		  http_connection_close ),
+};
+
+/** Idle HTTP connection socket interface descriptor */
+static struct interface_descriptor http_connection_socket_desc =
+	INTF_DESC ( struct http_connection, socket,
+		    http_connection_socket_op );
+
+/**
+ * Check if idle HTTP connection matches origin
+ *
+ * @v conn		Idle HTTP connection
+ * @v uri		Uniform Resource Identifier
+ * @v default_port	Default port number
+ * @v filter		Filter to apply to socket, or NULL
+ * @ret match		Connection matches origin
+ */
+static int
+http_connection_match ( struct http_connection *conn, struct uri *uri,
+			unsigned int default_port,
+			int ( * filter ) ( struct interface *xfer,
+					   const char *name,
+					   struct interface **next ) ) {
+
+	return ( ( strcasecmp ( conn->host, uri->host ) == 0 ) &&
+		 ( conn->port == uri_port ( uri, default_port ) ) &&
+		 ( conn->filter == filter ) );
+}
+
+/**
+ * Park HTTP connection in idle connection pool
+ *
+ * @v socket		Transport layer interface
+ * @v uri		Uniform Resource Identifier
+ * @v default_port	Default port number
+ * @v filter		Filter applied to socket, or NULL
+ *
+ * On success, the transport layer interface is unplugged and the
+ * underlying connection is owned by the pool.  On failure, the
+ * interface is left untouched and the caller should close it as
+ * usual.
+ */
+void http_connection_put ( struct interface *socket, struct uri *uri,
+			   unsigned int default_port,
+			   int ( * filter ) ( struct interface *xfer,
+					      const char *name,
+					      struct interface **next ) ) {
+	struct http_connection *conn;
+	struct http_connection *tmp;
+	struct interface *dest;
+	unsigned int count = 0;
+	unsigned int origin_count = 0;
+
+	/* Enforce pool limits by discarding the least recently used
+	 * connections beyond the limits (leaving room for this one).
+	 */
+	list_for_each_entry_safe ( conn, tmp, &http_connections, list ) {
+		count++;
+		if ( http_connection_match ( conn, uri, default_port,
+					     filter ) ) {
+			origin_count++;
+		}
+		if ( ( count >= HTTP_POOL_MAX ) ||
+		     ( ( origin_count >= HTTP_POOL_MAX_PER_ORIGIN ) &&
+		       http_connection_match ( conn, uri, default_port,
+					       filter ) ) ) {
+			http_connection_close ( conn, 0 );
+			count--;
+		}
+	}
+
+	/* Allocate and populate idle connection */
+	conn = zalloc ( sizeof ( *conn ) );
+	if ( ! conn )
+		return;
+	ref_init ( &conn->refcnt, http_connection_free );
+	intf_init ( &conn->socket, &http_connection_socket_desc,
+		    &conn->refcnt );
+	timer_init ( &conn->timer, http_connection_expired, &conn->refcnt );
+	conn->host = strdup ( uri->host );
+	if ( ! conn->host ) {
+		ref_put ( &conn->refcnt );
+		return;
+	}
+	conn->port = uri_port ( uri, default_port );
+	conn->filter = filter;
+
+	/* Take over transport layer interface */
+	dest = intf_get ( socket->dest );
+	intf_unplug ( socket );
+	intf_plug_plug ( &conn->socket, dest );
+	intf_put ( dest );
+
+	/* Add to pool (which inherits our reference) */
+	list_add ( &conn->list, &http_connections );
+	start_timer_fixed ( &conn->timer, HTTP_POOL_TIMEOUT );
+	DBGC ( conn, "HTTPCONN %p parked for %s:%d\n",
+	       conn, conn->host, conn->port );
+}
+
+/**
+ * Reuse HTTP connection from idle connection pool
+ *
+ * @v socket		Transport layer interface
+ * @v uri		Uniform Resource Identifier
+ * @v default_port	Default port number
+ * @v filter		Filter to apply to socket, or NULL
+ * @ret rc		Return status code
+ *
+ * Returns -ENOENT if no idle connection to the same origin exists.
+ */
+int http_connection_get ( struct interface *socket, struct uri *uri,
+			  unsigned int default_port,
+			  int ( * filter ) ( struct interface *xfer,
+					     const char *name,
+					     struct interface **next ) ) {
+	struct http_connection *conn;
+	struct interface *dest;
+
+	list_for_each_entry ( conn, &http_connections, list ) {
+		if ( ! http_connection_match ( conn, uri, default_port,
+					       filter ) )
+			continue;
+
+		/* Hand over transport layer interface */
+		DBGC ( conn, "HTTPCONN %p reused for %s:%d\n",
+		       conn, conn->host, conn->port );
+		dest = intf_get ( conn->socket.dest );
+		intf_unplug ( &conn->socket );
+		intf_plug_plug ( socket, dest );
+		intf_put ( dest );
+
+		/* Discard idle connection */
+		http_connection_close ( conn, 0 );
+		return 0;
+	}
+
+	return -ENOENT;
+}
@@ -41,6 +41,8 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/uri.h>
 #include <ipxe/refcnt.h>
 #include <ipxe/iobuf.h>
+#include <ipxe/uaccess.h>
+#include <ipxe/umalloc.h>
 #include <ipxe/xfer.h>
 #include <ipxe/open.h>
 #include <ipxe/socket.h>
@@ -53,6 +55,8 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/blockdev.h>
 #include <ipxe/acpi.h>
 #include <ipxe/version.h>
+#include <ipxe/settings.h>
+#include <ipxe/dhcp.h>
 #include <ipxe/http.h>
 
 /* Disambiguate the various error causes */
@@ -65,6 +69,9 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #define EIO_CONTENT_LENGTH __einfo_error ( EINFO_EIO_CONTENT_LENGTH )
 #define EINFO_EIO_CONTENT_LENGTH \
 	__einfo_uniqify ( EINFO_EIO, 0x02, "Content length mismatch" )
+#define EIO_RANGE __einfo_error ( EINFO_EIO_RANGE )
+#define EINFO_EIO_RANGE \
+	__einfo_uniqify ( EINFO_EIO, 0x03, "Range request not honoured" )
 #define EINVAL_RESPONSE __einfo_error ( EINFO_EINVAL_RESPONSE )
 #define EINFO_EINVAL_RESPONSE \
 	__einfo_uniqify ( EINFO_EINVAL, 0x01, "Invalid content length" )
@@ -90,6 +97,24 @@ FILE_LICENCE ( GPL2_OR_LATER );
 /** Block size used for HTTP block device request */
 #define HTTP_BLKSIZE 512
 
+/** Size of each range request within a segmented download */
+#define HTTP_SEGMENT_SIZE ( 2 * 1024 * 1024 )
+
+/** Maximum number of connections used for a segmented download */
+#define HTTP_MAX_CONNECTIONS 8
+
+/** Maximum number of outstanding HTTP block device reads */
+#define HTTP_MAX_READS 16
+
+/** Maximum length of a coalesced HTTP block device range request */
+#define HTTP_RANGE_MAX_LEN ( 1024 * 1024 )
+
+/** Length of HTTP block device read-ahead */
+#define HTTP_READAHEAD_LEN ( 256 * 1024 )
+
+/** Maximum number of pipelined HTTP block device range requests */
+#define HTTP_MAX_PIPELINE 8
+
 time_t start;
 time_t end;
 
@@ -109,6 +134,16 @@ enum http_flags {
 	HTTP_BASIC_AUTH = 0x0020,
 	/** Provide Digest authentication details */
 	HTTP_DIGEST_AUTH = 0x0040,
+	/** Server accepts byte range requests */
+	HTTP_ACCEPT_RANGES = 0x0080,
+	/** Download has been split into segments */
+	HTTP_SEGMENTED = 0x0100,
+	/** Return connection to idle connection pool when complete */
+	HTTP_POOL = 0x0200,
+	/** Connection has already carried a previous request */
+	HTTP_REUSED = 0x0400,
+	/** Request is serving block device reads */
+	HTTP_BLOCK = 0x0800,
 };
 
 /** HTTP receive state */
@@ -185,8 +220,99 @@ struct http_request {
 	char *auth_nonce;
 	/** Authentication opaque string (if any) */
 	char *auth_opaque;
+
+	/** Parent request (if this request fetches a segment) */
+	struct http_request *parent;
+	/** List of segments within parent request */
+	struct list_head list;
+	/** Segment requests (if this is a segmented download) */
+	struct list_head segments;
+	/** Start of data already claimed by segment requests
+	 *
+	 * The parent request receives everything before this offset;
+	 * segment requests claim ranges working downwards from the
+	 * end of the content.
+	 */
+	size_t segment_end;
+
+	/** Block device reads */
+	struct list_head reads;
+	/** Number of block device reads */
+	unsigned int num_reads;
+	/** Outstanding block device range requests, oldest first */
+	struct list_head ranges;
+	/** Number of outstanding block device range requests */
+	unsigned int num_ranges;
+	/** Maximum number of pipelined block device range requests */
+	unsigned int pipeline;
+	/** Block device capacity (in bytes) */
+	size_t capacity;
+	/** Offset following most recent block device range request */
+	size_t next_offset;
+	/** Read-ahead buffer */
+	userptr_t ra_buffer;
+	/** Starting offset of read-ahead buffer */
+	size_t ra_start;
+	/** Length of data requested into read-ahead buffer */
+	size_t ra_len;
+	/** Length of valid data within read-ahead buffer */
+	size_t ra_valid;
+};
+
+/** An HTTP block device range request */
+struct http_range {
+	/** List of outstanding range requests */
+	struct list_head list;
+	/** Starting offset */
+	size_t start;
+	/** Length (including any read-ahead) */
+	size_t len;
+	/** Length of read-ahead at end of range */
+	size_t readahead;
+};
+
+/** An HTTP block device read */
+struct http_read {
+	/** Reference count */
+	struct refcnt refcnt;
+	/** HTTP request */
+	struct http_request *http;
+	/** List of block device reads */
+	struct list_head list;
+	/** Block data interface */
+	struct interface block;
+
+	/** Starting offset */
+	size_t offset;
+	/** Length */
+	size_t len;
+	/** Data buffer (or UNULL if the read has been aborted) */
+	userptr_t buffer;
+	/** Range request which will satisfy this read (if issued) */
+	struct http_range *range;
+	/** Read will be satisfied from the read-ahead buffer */
+	int readahead;
+};
+
+/** HTTP download connection count setting */
+struct setting http_connections_setting __setting ( SETTING_MISC ) = {
+	.name = "http-connections",
+	.description = "HTTP download connections",
+	.tag = DHCP_EB_HTTP_CONNECTIONS,
+	.type = &setting_type_uint8,
+};
+
+/** HTTP block device pipeline depth setting */
+struct setting http_pipeline_setting __setting ( SETTING_SANBOOT_EXTRA ) = {
+	.name = "http-pipeline",
+	.description = "HTTP SAN pipelined requests",
+	.tag = DHCP_EB_HTTP_PIPELINE,
+	.type = &setting_type_uint8,
 };
 
+static void http_segment_close ( struct http_request *segment, int rc );
+static int http_segment_start ( struct http_request *http );
+
 /**
  * Free HTTP request
  *
@@ -201,9 +327,83 @@ static void http_free ( struct refcnt *refcnt ) {
 	free ( http->auth_realm );
 	free ( http->auth_nonce );
 	free ( http->auth_opaque );
+	if ( http->parent )
+		ref_put ( &http->parent->refcnt );
+	ufree ( http->ra_buffer );
 	free ( http );
 };
 
+/**
+ * Free HTTP block device read
+ *
+ * @v refcnt		Reference counter
+ */
+static void http_read_free ( struct refcnt *refcnt ) {
+	struct http_read *read =
+		container_of ( refcnt, struct http_read, refcnt );
+
+	ref_put ( &read->http->refcnt );
+	free ( read );
+}
+
+/**
+ * Complete HTTP block device read
+ *
+ * @v read		Block device read
+ * @v rc		Return status code
+ */
+static void http_read_done ( struct http_read *read, int rc ) {
+	struct http_request *http = read->http;
+
+	/* Remove from list of block device reads */
+	list_del ( &read->list );
+	http->num_reads--;
+
+	/* Shut down interface and drop list's reference */
+	intf_shutdown ( &read->block, rc );
+	ref_put ( &read->refcnt );
+
+	/* Allow block device to issue further reads */
+	xfer_window_changed ( &http->xfer );
+}
+
+/**
+ * Discard all outstanding HTTP block device range requests
+ *
+ * @v http		HTTP request
+ *
+ * Any reads which were waiting for the discarded range requests
+ * become pending again, and will be reissued.
+ */
+static void http_ranges_reset ( struct http_request *http ) {
+	struct http_range *range;
+	struct http_range *tmp_range;
+	struct http_read *read;
+	struct http_read *tmp;
+
+	/* Return reads to pending state, discarding any aborted reads */
+	list_for_each_entry_safe ( read, tmp, &http->reads, list ) {
+		if ( read->buffer == UNULL ) {
+			list_del ( &read->list );
+			http->num_reads--;
+			ref_put ( &read->refcnt );
+			continue;
+		}
+		read->range = NULL;
+		read->readahead = 0;
+	}
+
+	/* Discard range requests */
+	list_for_each_entry_safe ( range, tmp_range, &http->ranges, list ) {
+		list_del ( &range->list );
+		free ( range );
+	}
+	http->num_ranges = 0;
+
+	/* Abandon any read-ahead still in progress */
+	http->ra_len = http->ra_valid;
+}
+
 /**
  * Close HTTP request
  *
@@ -211,6 +411,17 @@ static void http_free ( struct refcnt *refcnt ) {
  * @v rc		Return status code
  */
 static void http_close ( struct http_request *http, int rc ) {
+	struct http_request *segment;
+	struct http_request *tmp;
+	struct http_read *read;
+
+	/* Park connection for reuse, if applicable */
+	if ( ( rc == 0 ) && ( http->rx_state == HTTP_RX_IDLE ) &&
+	     ( http->flags & HTTP_POOL ) &&
+	     ( http->flags & HTTP_SERVER_KEEPALIVE ) ) {
+		http_connection_put ( &http->socket, http->uri,
+				      http->default_port, http->filter );
+	}
 
 	/* Prevent further processing of any current packet */
 	http->rx_state = HTTP_RX_DEAD;
@@ -226,6 +437,23 @@ static void http_close ( struct http_request *http, int rc ) {
 	intf_shutdown ( &http->partial, rc );
 	intf_shutdown ( &http->xfer, rc );
 
+	/* Fail any outstanding block device reads */
+	http_ranges_reset ( http );
+	while ( ( read = list_first_entry ( &http->reads, struct http_read,
+					    list ) ) != NULL ) {
+		http_read_done ( read, ( rc ? rc : -ECANCELED ) );
+	}
+
+	/* Close any segment requests */
+	list_for_each_entry_safe ( segment, tmp, &http->segments, list )
+		http_close ( segment, rc );
+
+	/* Detach from parent request, if applicable */
+	if ( http->parent ) {
+		http_segment_close ( http, rc );
+		return;
+	}
+
 	end = time ( NULL );
 	printf ( "HTTP ended at %lld\n", end );
 	printf ( "HTTP time elapsed %lld\n", end - start );
@@ -243,6 +471,16 @@ static int http_socket_open ( struct http_request *http ) {
 	struct interface *socket;
 	int rc;
 
+	/* Reuse an idle connection to the same server, if available */
+	if ( ( http->flags & HTTP_POOL ) &&
+	     ( http_connection_get ( &http->socket, uri, http->default_port,
+				     http->filter ) == 0 ) ) {
+		DBGC ( http, "HTTP %p reusing idle connection\n", http );
+		http->flags |= HTTP_REUSED;
+		return 0;
+	}
+	http->flags &= ~HTTP_REUSED;
+
 	/* Open socket */
 	memset ( &server, 0, sizeof ( server ) );
 	server.st_port = htons ( uri_port ( uri, http->default_port ) );
@@ -259,6 +497,237 @@ static int http_socket_open ( struct http_request *http ) {
 	return 0;
 }
 
+/**
+ * Claim next segment of a segmented download
+ *
+ * @v segment		Segment request
+ * @ret claimed		A segment was claimed
+ */
+static int http_segment_claim ( struct http_request *segment ) {
+	struct http_request *http = segment->parent;
+
+	/* Leave the final segment to the parent request, which is
+	 * already receiving data sequentially from the start.
+	 */
+	if ( ( http->segment_end - http->rx_len ) <= HTTP_SEGMENT_SIZE )
+		return 0;
+
+	/* Claim the highest unclaimed segment */
+	http->segment_end -= HTTP_SEGMENT_SIZE;
+	segment->partial_start = http->segment_end;
+	segment->partial_len = HTTP_SEGMENT_SIZE;
+	DBGC2 ( http, "HTTP %p segment %p claimed [%zd,%zd)\n", http, segment,
+		segment->partial_start,
+		( segment->partial_start + segment->partial_len ) );
+
+	/* Schedule request */
+	segment->flags |= HTTP_TX_PENDING;
+	segment->rx_state = HTTP_RX_RESPONSE;
+	process_add ( &segment->process );
+
+	return 1;
+}
+
+/**
+ * Check for completion of segmented download
+ *
+ * @v http		HTTP request
+ */
+static void http_segments_check ( struct http_request *http ) {
+
+	/* Complete when our own part has been received and all
+	 * segment requests have finished.
+	 */
+	if ( ( http->rx_len == http->segment_end ) &&
+	     list_empty ( &http->segments ) ) {
+		DBGC ( http, "HTTP %p segmented download complete\n", http );
+		http_close ( http, 0 );
+	}
+}
+
+/**
+ * Handle closure of segment request
+ *
+ * @v segment		Segment request
+ * @v rc		Reason for close
+ */
+static void http_segment_close ( struct http_request *segment, int rc ) {
+	struct http_request *http = segment->parent;
+
+	/* Do nothing if not attached to parent request */
+	if ( list_empty ( &segment->list ) )
+		return;
+	list_del ( &segment->list );
+	INIT_LIST_HEAD ( &segment->list );
+
+	/* Abort the whole download on error, otherwise check for
+	 * completion.  (Ignore closures triggered by the parent
+	 * request itself closing.)
+	 */
+	if ( http->rx_state != HTTP_RX_DEAD ) {
+		if ( rc != 0 ) {
+			DBGC ( http, "HTTP %p segment %p failed: %s\n",
+			       http, segment, strerror ( rc ) );
+			http_close ( http, rc );
+		} else {
+			http_segments_check ( http );
+		}
+	}
+
+	/* Drop parent request's reference to segment */
+	ref_put ( &segment->refcnt );
+}
+
+/**
+ * Find HTTP block device read which has been satisfied
+ *
+ * @v http		HTTP request
+ * @v range		Range request being received, or NULL
+ * @v end		End of data received for range request
+ * @ret read		Satisfied block device read, or NULL
+ */
+static struct http_read * http_read_satisfied ( struct http_request *http,
+						struct http_range *range,
+						size_t end ) {
+	struct http_read *read;
+	size_t read_end;
+
+	list_for_each_entry ( read, &http->reads, list ) {
+		read_end = ( read->offset + read->len );
+		if ( range && ( read->range == range ) && ( read_end <= end ) )
+			return read;
+		if ( read->readahead && ( read->offset >= http->ra_start ) &&
+		     ( read_end <= ( http->ra_start + http->ra_valid ) ) )
+			return read;
+	}
+	return NULL;
+}
+
+/**
+ * Complete any HTTP block device reads which have been satisfied
+ *
+ * @v http		HTTP request
+ * @v range		Range request being received, or NULL
+ * @v end		End of data received for range request
+ */
+static void http_reads_check ( struct http_request *http,
+			       struct http_range *range, size_t end ) {
+	struct http_read *read;
+
+	while ( ( read = http_read_satisfied ( http, range, end ) ) != NULL ) {
+		if ( read->readahead ) {
+			memcpy_user ( read->buffer, 0, http->ra_buffer,
+				      ( read->offset - http->ra_start ),
+				      read->len );
+		}
+		http_read_done ( read, 0 );
+	}
+}
+
+/**
+ * Receive data for HTTP block device range request
+ *
+ * @v http		HTTP request
+ * @v data		Data
+ * @v len		Length of data
+ *
+ * Data is scattered directly into the buffers of the block device
+ * reads which were coalesced into the current range request, with
+ * any trailing read-ahead data going to the read-ahead buffer.
+ */
+static void http_range_rx ( struct http_request *http, const void *data,
+			    size_t len ) {
+	struct http_range *range;
+	struct http_read *read;
+	size_t start = ( http->partial_start + http->rx_len );
+	size_t end = ( start + len );
+	size_t frag_start;
+	size_t frag_end;
+
+	range = list_first_entry ( &http->ranges, struct http_range, list );
+	assert ( range != NULL );
+
+	/* Copy to block device read buffers */
+	list_for_each_entry ( read, &http->reads, list ) {
+		if ( ( read->range != range ) || ( read->buffer == UNULL ) )
+			continue;
+		frag_start = ( ( start > read->offset ) ? start : read->offset );
+		frag_end = ( read->offset + read->len );
+		if ( frag_end > end )
+			frag_end = end;
+		if ( frag_start < frag_end ) {
+			copy_to_user ( read->buffer,
+				       ( frag_start - read->offset ),
+				       ( data + ( frag_start - start ) ),
+				       ( frag_end - frag_start ) );
+		}
+	}
+
+	/* Copy to read-ahead buffer */
+	if ( range->readahead ) {
+		frag_start = ( ( start > http->ra_start ) ?
+			       start : http->ra_start );
+		frag_end = ( http->ra_start + http->ra_len );
+		if ( frag_end > end )
+			frag_end = end;
+		if ( frag_start < frag_end ) {
+			copy_to_user ( http->ra_buffer,
+				       ( frag_start - http->ra_start ),
+				       ( data + ( frag_start - start ) ),
+				       ( frag_end - frag_start ) );
+			http->ra_valid = ( frag_end - http->ra_start );
+		}
+	}
+
+	/* Complete any reads which are now satisfied */
+	http_reads_check ( http, range, end );
+}
+
+/**
+ * Prepare to receive response to next HTTP block device range request
+ *
+ * @v http		HTTP request
+ */
+static void http_range_expect ( struct http_request *http ) {
+	struct http_range *range;
+
+	range = list_first_entry ( &http->ranges, struct http_range, list );
+	if ( ! range )
+		return;
+	http->partial_start = range->start;
+	http->partial_len = range->len;
+	http->rx_state = HTTP_RX_RESPONSE;
+}
+
+/**
+ * Complete HTTP block device range request
+ *
+ * @v http		HTTP request
+ */
+static void http_range_done ( struct http_request *http ) {
+	struct http_range *range;
+	struct http_read *read;
+
+	/* Do nothing unless a range request is outstanding */
+	range = list_first_entry ( &http->ranges, struct http_range, list );
+	if ( ! range )
+		return;
+	list_del ( &range->list );
+	http->num_ranges--;
+
+	/* Complete all reads satisfied by this range request */
+	http_reads_check ( http, range, ( range->start + range->len ) );
+
+	/* Any reads still waiting for read-ahead data must be reissued */
+	if ( range->readahead ) {
+		http->ra_len = http->ra_valid;
+		list_for_each_entry ( read, &http->reads, list )
+			read->readahead = 0;
+	}
+
+	free ( range );
+}
+
 /**
  * Mark HTTP request as completed successfully
  *
@@ -295,6 +764,13 @@ static void http_done ( struct http_request *http ) {
 	assert ( http->chunked == 0 );
 	assert ( http->chunk_remaining == 0 );
 
+	/* Complete block device range request, if applicable */
+	if ( ! ( http->flags & HTTP_TRY_AGAIN ) ) {
+		http_range_done ( http );
+		if ( http->rx_state == HTTP_RX_DEAD )
+			return;
+	}
+
 	/* Close partial transfer interface */
 	if ( ! ( http->flags & HTTP_TRY_AGAIN ) )
 		intf_restart ( &http->partial, 0 );
@@ -305,6 +781,19 @@ static void http_done ( struct http_request *http ) {
 		return;
 	}
 
+	/* Close segment request if there is nothing left to claim */
+	if ( http->parent && ( ! ( http->flags & HTTP_TRY_AGAIN ) ) &&
+	     ( ! http_segment_claim ( http ) ) ) {
+		http_close ( http, 0 );
+		return;
+	}
+
+	/* Responses to any further pipelined range requests will
+	 * also need to be retried; start afresh on a new connection.
+	 */
+	if ( ( http->flags & HTTP_TRY_AGAIN ) && ( http->num_ranges > 1 ) )
+		http->flags &= ~HTTP_SERVER_KEEPALIVE;
+
 	/* If the server is not intending to keep the connection
 	 * alive, then reopen the socket.
 	 */
@@ -315,14 +804,31 @@ static void http_done ( struct http_request *http ) {
 			http_close ( http, rc );
 			return;
 		}
+		/* Any pipelined range requests have been lost */
+		http_ranges_reset ( http );
+	} else {
+		http->flags |= HTTP_REUSED;
 	}
 	http->flags &= ~HTTP_SERVER_KEEPALIVE;
 
 	/* Retry the request if applicable */
 	if ( http->flags & HTTP_TRY_AGAIN ) {
 		http->flags &= ~HTTP_TRY_AGAIN;
-		http->flags |= HTTP_TX_PENDING;
-		http->rx_state = HTTP_RX_RESPONSE;
+		if ( http->flags & HTTP_BLOCK ) {
+			/* Reissue all range requests, since any
+			 * pipelined requests will also have failed.
+			 */
+			http_ranges_reset ( http );
+		} else {
+			http->flags |= HTTP_TX_PENDING;
+			http->rx_state = HTTP_RX_RESPONSE;
+		}
+		process_add ( &http->process );
+	}
+
+	/* Await response to next pipelined range request, if any */
+	if ( http->flags & HTTP_BLOCK ) {
+		http_range_expect ( http );
 		process_add ( &http->process );
 	}
 }
@@ -443,6 +949,7 @@ static int http_rx_content_length ( struct http_request *http, char *value ) {
 
 	/* Report block device capacity if applicable */
 	if ( http->flags & HTTP_HEAD_ONLY ) {
+		http->capacity = content_len;
 		capacity.blocks = ( content_len / HTTP_BLKSIZE );
 		capacity.blksize = HTTP_BLKSIZE;
 		capacity.max_count = -1U;
@@ -485,6 +992,23 @@ static int http_rx_connection ( struct http_request *http, char *value ) {
 	return 0;
 }
 
+/**
+ * Handle HTTP Accept-Ranges header
+ *
+ * @v http		HTTP request
+ * @v value		HTTP header value
+ * @ret rc		Return status code
+ */
+static int http_rx_accept_ranges ( struct http_request *http, char *value ) {
+
+	if ( strcasecmp ( value, "bytes" ) == 0 ) {
+		/* Mark server as accepting byte range requests */
+		http->flags |= HTTP_ACCEPT_RANGES;
+	}
+
+	return 0;
+}
+
 /**
  * Handle WWW-Authenticate Basic header
  *
@@ -679,6 +1203,10 @@ static struct http_header_handler http_header_handlers[] = {
 		.header = "Connection",
 		.rx = http_rx_connection,
 	},
+	{
+		.header = "Accept-Ranges",
+		.rx = http_rx_accept_ranges,
+	},
 	{
 		.header = "WWW-Authenticate",
 		.rx = http_rx_www_authenticate,
@@ -716,8 +1244,18 @@ static int http_rx_header ( struct http_request *http, char *header ) {
 					   HTTP_RX_CHUNK_LEN : HTTP_RX_DATA );
 			if ( ( http->partial_len != 0 ) &&
 			     ( ! ( http->flags & HTTP_TRY_AGAIN ) ) ) {
+				if ( ( http->parent ||
+				       ( http->flags & HTTP_BLOCK ) ) &&
+				     ( http->code != 206 ) ) {
+					DBGC ( http, "HTTP %p range request "
+					       "returned %d\n", http,
+					       http->code );
+					return -EIO_RANGE;
+				}
 				http->remaining = http->partial_len;
 			}
+			if ( ( rc = http_segment_start ( http ) ) != 0 )
+				return rc;
 			return 0;
 		} else {
 			DBGC ( http, "HTTP %p end of trailer\n", http );
@@ -793,6 +1331,32 @@ static int http_rx_chunk_len ( struct http_request *http, char *length ) {
 	return 0;
 }
 
+/**
+ * Construct metadata for received data
+ *
+ * @v http		HTTP request
+ * @v meta		Data transfer metadata to fill in
+ * @ret dest		Interface to which received data should be delivered
+ *
+ * Data received as part of a segmented download may arrive out of
+ * order, and so is always delivered with an absolute offset.
+ */
+static struct interface * http_rx_meta ( struct http_request *http,
+					 struct xfer_metadata *meta ) {
+
+	memset ( meta, 0, sizeof ( *meta ) );
+	if ( http->parent ) {
+		meta->flags = XFER_FL_ABS_OFFSET;
+		meta->offset = ( http->partial_start + http->rx_len );
+		return &http->parent->xfer;
+	}
+	if ( http->flags & HTTP_SEGMENTED ) {
+		meta->flags = XFER_FL_ABS_OFFSET;
+		meta->offset = http->rx_len;
+	}
+	return &http->xfer;
+}
+
 /** An HTTP line-based data handler */
 struct http_line_handler {
 	/** Handle line
@@ -824,6 +1388,8 @@ static int http_socket_deliver ( struct http_request *http,
 				 struct io_buffer *iobuf,
 				 struct xfer_metadata *meta __unused ) {
 	struct http_line_handler *lh;
+	struct xfer_metadata rx_meta;
+	struct interface *dest;
 	char *line;
 	size_t data_len;
 	ssize_t line_len;
@@ -854,9 +1420,18 @@ static int http_socket_deliver ( struct http_request *http,
 			     ( http->remaining < data_len ) ) {
 				data_len = http->remaining;
 			}
+			if ( ( http->flags & HTTP_SEGMENTED ) &&
+			     ( ( http->segment_end - http->rx_len ) <
+			       data_len ) ) {
+				data_len = ( http->segment_end - http->rx_len );
+			}
 			if ( http->flags & HTTP_TRY_AGAIN ) {
 				/* Discard all received data */
 				iob_pull ( iobuf, data_len );
+			} else if ( http->flags & HTTP_BLOCK ) {
+				/* Copy to block device read buffers */
+				http_range_rx ( http, iobuf->data, data_len );
+				iob_pull ( iobuf, data_len );
 			} else if ( http->rx_buffer != UNULL ) {
 				/* Copy to partial transfer buffer */
 				copy_to_user ( http->rx_buffer, http->rx_len,
@@ -864,18 +1439,35 @@ static int http_socket_deliver ( struct http_request *http,
 				iob_pull ( iobuf, data_len );
 			} else if ( data_len < iob_len ( iobuf ) ) {
 				/* Deliver partial buffer as raw data */
-				rc = xfer_deliver_raw ( &http->xfer,
-							iobuf->data, data_len );
+				dest = http_rx_meta ( http, &rx_meta );
+				rc = xfer_deliver_raw_meta ( dest, iobuf->data,
+							     data_len,
+							     &rx_meta );
 				iob_pull ( iobuf, data_len );
 				if ( rc != 0 )
 					goto done;
 			} else {
 				/* Deliver whole I/O buffer */
-				if ( ( rc = xfer_deliver_iob ( &http->xfer,
-						 iob_disown ( iobuf ) ) ) != 0 )
+				dest = http_rx_meta ( http, &rx_meta );
+				if ( ( rc = xfer_deliver ( dest,
+							   iob_disown ( iobuf ),
+							   &rx_meta ) ) != 0 )
 					goto done;
 			}
 			http->rx_len += data_len;
+			if ( ( http->flags & HTTP_SEGMENTED ) &&
+			     ( http->rx_len == http->segment_end ) ) {
+				/* Remaining data belongs to segment
+				 * requests; drop our own connection.
+				 */
+				DBGC ( http, "HTTP %p received first %zd "
+				       "bytes\n", http, http->rx_len );
+				intf_restart ( &http->socket, 0 );
+				http->flags &= ~HTTP_SERVER_KEEPALIVE;
+				http->rx_state = HTTP_RX_IDLE;
+				http_segments_check ( http );
+				goto done;
+			}
 			if ( http->chunk_remaining ) {
 				http->chunk_remaining -= data_len;
 				if ( http->chunk_remaining == 0 )
@@ -947,6 +1539,35 @@ static size_t http_socket_window ( struct http_request *http __unused ) {
  */
 static void http_socket_close ( struct http_request *http, int rc ) {
 
+	/* A server may close an idle keep-alive connection just as we
+	 * send a new request on it, or may close a connection after
+	 * answering only some of a series of pipelined requests.  If
+	 * nothing at all has been received for the current request,
+	 * retry on a fresh connection.
+	 */
+	if ( ( http->flags & HTTP_REUSED ) &&
+	     ( http->rx_state == HTTP_RX_RESPONSE ) &&
+	     ( http->linebuf.len == 0 ) ) {
+		DBGC ( http, "HTTP %p reused connection closed (%s); "
+		       "retrying\n", http, strerror ( rc ) );
+		intf_restart ( &http->socket, 0 );
+		if ( ( rc = http_socket_open ( http ) ) != 0 ) {
+			http_close ( http, rc );
+			return;
+		}
+		if ( http->flags & HTTP_BLOCK ) {
+			http_ranges_reset ( http );
+			http->rx_state = HTTP_RX_IDLE;
+		} else {
+			http->flags |= HTTP_TX_PENDING;
+		}
+		process_add ( &http->process );
+		return;
+	}
+
+	/* The connection cannot be kept alive once it has closed */
+	http->flags &= ~HTTP_SERVER_KEEPALIVE;
+
 	/* If we have an error, terminate */
 	if ( rc != 0 ) {
 		http_close ( http, rc );
@@ -1071,36 +1692,23 @@ static char * http_digest_auth ( struct http_request *http,
 }
 
 /**
- * HTTP process
+ * Transmit HTTP request
  *
  * @v http		HTTP request
+ * @v method		HTTP method (e.g. "GET")
+ * @v start		Starting offset of range request
+ * @v len		Length of range request, or zero for whole content
+ * @ret rc		Return status code
  */
-static void http_step ( struct http_request *http ) {
+static int http_tx_request ( struct http_request *http, const char *method,
+			     size_t start, size_t len ) {
 	size_t uri_len;
-	char *method;
 	char *uri;
+	const char *accept;
 	char *range;
 	char *auth;
-	int len;
 	int rc;
 
-	/* Do nothing if we have already transmitted the request */
-	if ( ! ( http->flags & HTTP_TX_PENDING ) )
-		return;
-
-	/* Do nothing until socket is ready */
-	if ( ! xfer_window ( &http->socket ) )
-		return;
-
-	/* Force a HEAD request if we have nowhere to send any received data */
-	if ( ( xfer_window ( &http->xfer ) == 0 ) &&
-	     ( http->rx_buffer == UNULL ) ) {
-		http->flags |= ( HTTP_HEAD_ONLY | HTTP_CLIENT_KEEPALIVE );
-	}
-
-	/* Determine method */
-	method = ( ( http->flags & HTTP_HEAD_ONLY ) ? "HEAD" : "GET" );
-
 	/* Construct path?query request */
 	uri_len = ( unparse_uri ( NULL, 0, http->uri,
 				  URI_PATH_BIT | URI_QUERY_BIT )
@@ -1117,19 +1725,30 @@ static void http_step ( struct http_request *http ) {
 	}
 
 	/* Calculate range request parameters if applicable */
-	if ( http->partial_len ) {
-		len = asprintf ( &range, "Range: bytes=%zd-%zd\r\n",
-				 http->partial_start,
-				 ( http->partial_start + http->partial_len
-				   - 1 ) );
-		if ( len < 0 ) {
-			rc = len;
+	if ( len ) {
+		rc = asprintf ( &range, "Range: bytes=%zd-%zd\r\n",
+				start, ( start + len - 1 ) );
+		if ( rc < 0 )
 			goto err_range;
-		}
 	} else {
 		range = NULL;
 	}
 
+	/* Offer to accept compressed content for whole-file downloads,
+	 * if and only if the recipient has asked for decompression.
+	 * Servers often label static compressed files (e.g.
+	 * "initrd.gz") with a Content-Encoding; such files must
+	 * otherwise be delivered exactly as stored.
+	 */
+	if ( ( ! len ) && ( ! http->parent ) &&
+	     ( http->rx_buffer == UNULL ) &&
+	     ( ! ( http->flags & ( HTTP_HEAD_ONLY | HTTP_BLOCK ) ) ) &&
+	     xfer_decompressing ( &http->xfer ) ) {
+		accept = "Accept-Encoding: gzip\r\n";
+	} else {
+		accept = "";
+	}
+
 	/* Construct authorisation, if applicable */
 	if ( http->flags & HTTP_BASIC_AUTH ) {
 		auth = http_basic_auth ( http );
@@ -1147,36 +1766,173 @@ static void http_step ( struct http_request *http ) {
 		auth = NULL;
 	}
 
-	/* Mark request as transmitted */
-	http->flags &= ~HTTP_TX_PENDING;
-
 	/* Send request */
-	if ( ( rc = xfer_printf ( &http->socket,
-				  "%s %s HTTP/1.1\r\n"
-				  "User-Agent: iPXE/%s\r\n"
-				  "Host: %s%s%s\r\n"
-				  "%s%s%s"
-				  "\r\n",
-				  method, uri, product_version, http->uri->host,
-				  ( http->uri->port ?
-				    ":" : "" ),
-				  ( http->uri->port ?
-				    http->uri->port : "" ),
-				  ( ( http->flags & HTTP_CLIENT_KEEPALIVE ) ?
-				    "Connection: keep-alive\r\n" : "" ),
-				  ( range ? range : "" ),
-				  ( auth ? auth : "" ) ) ) != 0 ) {
-		goto err_xfer;
-	}
+	rc = xfer_printf ( &http->socket,
+			   "%s %s HTTP/1.1\r\n"
+			   "User-Agent: iPXE/%s\r\n"
+			   "Host: %s%s%s\r\n"
+			   "%s%s%s%s"
+			   "\r\n",
+			   method, uri, product_version, http->uri->host,
+			   ( http->uri->port ?
+			     ":" : "" ),
+			   ( http->uri->port ?
+			     http->uri->port : "" ),
+			   ( ( http->flags & ( HTTP_CLIENT_KEEPALIVE |
+					       HTTP_POOL ) ) ?
+			     "Connection: keep-alive\r\n" : "" ),
+			   ( range ? range : "" ), accept,
+			   ( auth ? auth : "" ) );
 
- err_xfer:
 	free ( auth );
  err_auth:
 	free ( range );
  err_range:
 	free ( uri );
  err_uri:
-	if ( rc != 0 )
+	return rc;
+}
+
+/**
+ * Issue HTTP block device range request
+ *
+ * @v http		HTTP request
+ * @v first		First pending block device read
+ * @ret rc		Return status code
+ *
+ * Any immediately following pending reads for adjacent blocks are
+ * coalesced into the same range request.  If the access pattern is
+ * sequential, the range is extended to read ahead into the
+ * read-ahead buffer.
+ */
+static int http_range_issue ( struct http_request *http,
+			      struct http_read *first ) {
+	struct http_range *range;
+	struct http_read *read;
+	size_t end;
+	size_t readahead;
+
+	/* Allocate range request */
+	range = zalloc ( sizeof ( *range ) );
+	if ( ! range )
+		return -ENOMEM;
+	range->start = first->offset;
+	end = ( first->offset + first->len );
+	first->range = range;
+
+	/* Coalesce adjacent reads */
+	read = first;
+	list_for_each_entry_continue ( read, &http->reads, list ) {
+		if ( read->range || read->readahead ||
+		     ( read->offset != end ) ||
+		     ( ( end + read->len - range->start ) >
+		       HTTP_RANGE_MAX_LEN ) )
+			break;
+		read->range = range;
+		end += read->len;
+	}
+
+	/* Read ahead if access is sequential and no other range
+	 * request is using the read-ahead buffer.
+	 */
+	if ( ( range->start == http->next_offset ) &&
+	     list_empty ( &http->ranges ) && ( end < http->capacity ) ) {
+		if ( ! http->ra_buffer )
+			http->ra_buffer = umalloc ( HTTP_READAHEAD_LEN );
+		if ( http->ra_buffer ) {
+			readahead = ( http->capacity - end );
+			if ( readahead > HTTP_READAHEAD_LEN )
+				readahead = HTTP_READAHEAD_LEN;
+			range->readahead = readahead;
+			http->ra_start = end;
+			http->ra_len = readahead;
+			http->ra_valid = 0;
+		}
+	}
+	range->len = ( end - range->start + range->readahead );
+	http->next_offset = ( range->start + range->len );
+	DBGC2 ( http, "HTTP %p range [%zd,%zd) read-ahead %zd\n", http,
+		range->start, ( range->start + range->len ), range->readahead );
+
+	/* Add to list of outstanding range requests */
+	list_add_tail ( &range->list, &http->ranges );
+	http->num_ranges++;
+	if ( http->rx_state == HTTP_RX_IDLE )
+		http_range_expect ( http );
+
+	/* Transmit request */
+	return http_tx_request ( http, "GET", range->start, range->len );
+}
+
+/**
+ * Issue pending HTTP block device reads
+ *
+ * @v http		HTTP request
+ */
+static void http_block_step ( struct http_request *http ) {
+	struct http_read *read;
+	int rc;
+
+	/* Do nothing while any other request is in progress */
+	if ( list_empty ( &http->ranges ) &&
+	     ( http->rx_state != HTTP_RX_IDLE ) )
+		return;
+
+	/* Complete any reads satisfied from the read-ahead buffer */
+	http_reads_check ( http, NULL, 0 );
+
+	/* Issue range requests, pipelining if permitted */
+	list_for_each_entry ( read, &http->reads, list ) {
+		if ( http->num_ranges >= http->pipeline )
+			break;
+		if ( ! xfer_window ( &http->socket ) )
+			break;
+		if ( read->range || read->readahead )
+			continue;
+		if ( ( rc = http_range_issue ( http, read ) ) != 0 ) {
+			http_close ( http, rc );
+			return;
+		}
+	}
+}
+
+/**
+ * HTTP process
+ *
+ * @v http		HTTP request
+ */
+static void http_step ( struct http_request *http ) {
+	const char *method;
+	int rc;
+
+	/* Issue block device reads if we have already transmitted
+	 * the initial request.
+	 */
+	if ( ! ( http->flags & HTTP_TX_PENDING ) ) {
+		if ( http->flags & HTTP_BLOCK )
+			http_block_step ( http );
+		return;
+	}
+
+	/* Do nothing until socket is ready */
+	if ( ! xfer_window ( &http->socket ) )
+		return;
+
+	/* Force a HEAD request if we have nowhere to send any received data */
+	if ( ( xfer_window ( &http->xfer ) == 0 ) &&
+	     ( http->rx_buffer == UNULL ) && ( ! http->parent ) ) {
+		http->flags |= ( HTTP_HEAD_ONLY | HTTP_CLIENT_KEEPALIVE );
+	}
+
+	/* Determine method */
+	method = ( ( http->flags & HTTP_HEAD_ONLY ) ? "HEAD" : "GET" );
+
+	/* Mark request as transmitted */
+	http->flags &= ~HTTP_TX_PENDING;
+
+	/* Send request */
+	if ( ( rc = http_tx_request ( http, method, http->partial_start,
+				      http->partial_len ) ) != 0 )
 		http_close ( http, rc );
 }
 
@@ -1188,8 +1944,16 @@ static void http_step ( struct http_request *http ) {
  */
 static size_t http_xfer_window ( struct http_request *http ) {
 
-	/* New block commands may be issued only when we are idle */
-	return ( ( http->rx_state == HTTP_RX_IDLE ) ? 1 : 0 );
+	/* New block commands may not be issued while any other
+	 * request is in progress.
+	 */
+	if ( ( http->flags & HTTP_TX_PENDING ) ||
+	     ( list_empty ( &http->ranges ) &&
+	       ( http->rx_state != HTTP_RX_IDLE ) ) )
+		return 0;
+
+	/* Otherwise, allow a bounded number of outstanding reads */
+	return ( HTTP_MAX_READS - http->num_reads );
 }
 
 /**
@@ -1207,7 +1971,8 @@ static int http_partial_read ( struct http_request *http,
 			       size_t offset, userptr_t buffer, size_t len ) {
 
 	/* Sanity check */
-	if ( http_xfer_window ( http ) == 0 )
+	if ( ( http_xfer_window ( http ) == 0 ) ||
+	     ( ! list_empty ( &http->reads ) ) )
 		return -EBUSY;
 
 	/* Initialise partial transfer parameters */
@@ -1217,7 +1982,8 @@ static int http_partial_read ( struct http_request *http,
 
 	/* Schedule request */
 	http->rx_state = HTTP_RX_RESPONSE;
-	http->flags = ( HTTP_TX_PENDING | HTTP_CLIENT_KEEPALIVE );
+	http->flags = ( ( http->flags & HTTP_BLOCK ) |
+			HTTP_TX_PENDING | HTTP_CLIENT_KEEPALIVE );
 	if ( ! len )
 		http->flags |= HTTP_HEAD_ONLY;
 	process_add ( &http->process );
@@ -1228,6 +1994,37 @@ static int http_partial_read ( struct http_request *http,
 	return 0;
 }
 
+/**
+ * Close HTTP block device read
+ *
+ * @v read		Block device read
+ * @v rc		Reason for close
+ */
+static void http_read_close ( struct http_read *read, int rc ) {
+
+	/* A read which forms part of an outstanding range request
+	 * must remain in place until the response has been received;
+	 * just stop delivering data to it.
+	 */
+	if ( read->range ) {
+		read->buffer = UNULL;
+		intf_restart ( &read->block, rc );
+		return;
+	}
+
+	/* Otherwise, discard the read */
+	http_read_done ( read, rc );
+}
+
+/** HTTP block device read interface operations */
+static struct interface_operation http_read_operations[] = {
+	INTF_OP ( intf_close, struct http_read *, http_read_close ),
+};
+
+/** HTTP block device read interface descriptor */
+static struct interface_descriptor http_read_desc =
+	INTF_DESC ( struct http_read, block, http_read_operations );
+
 /**
  * Issue HTTP block device read
  *
@@ -1238,14 +2035,62 @@ static int http_partial_read ( struct http_request *http,
  * @v buffer		Data buffer
  * @v len		Length of data buffer
  * @ret rc		Return status code
+ *
+ * Reads are queued and issued by the HTTP process, so that adjacent
+ * reads may be coalesced into a single range request.
  */
 static int http_block_read ( struct http_request *http,
 			     struct interface *block,
 			     uint64_t lba, unsigned int count,
 			     userptr_t buffer, size_t len __unused ) {
+	struct http_read *read;
+
+	/* Sanity check */
+	if ( http_xfer_window ( http ) == 0 )
+		return -EBUSY;
+
+	/* Allocate and populate block device read */
+	read = zalloc ( sizeof ( *read ) );
+	if ( ! read )
+		return -ENOMEM;
+	ref_init ( &read->refcnt, http_read_free );
+	intf_init ( &read->block, &http_read_desc, &read->refcnt );
+	read->http = http;
+	ref_get ( &http->refcnt );
+	read->offset = ( lba * HTTP_BLKSIZE );
+	read->len = ( count * HTTP_BLKSIZE );
+	read->buffer = buffer;
+
+	/* Switch to issuing range requests for block device reads */
+	if ( ! ( http->flags & HTTP_BLOCK ) ) {
+		http->pipeline = fetch_uintz_setting ( NULL,
+						       &http_pipeline_setting );
+		if ( ! http->pipeline )
+			http->pipeline = 1;
+		if ( http->pipeline > HTTP_MAX_PIPELINE )
+			http->pipeline = HTTP_MAX_PIPELINE;
+		http->flags |= HTTP_BLOCK;
+		DBGC ( http, "HTTP %p using block device pipeline depth %d\n",
+		       http, http->pipeline );
+	}
+	http->flags &= ~HTTP_HEAD_ONLY;
+	http->rx_buffer = UNULL;
+
+	/* Wait for read-ahead data if already requested */
+	if ( ( read->offset >= http->ra_start ) &&
+	     ( ( read->offset + read->len ) <=
+	       ( http->ra_start + http->ra_len ) ) ) {
+		read->readahead = 1;
+	}
+
+	/* Add to list of reads (which inherits our reference) */
+	list_add_tail ( &read->list, &http->reads );
+	http->num_reads++;
+	process_add ( &http->process );
 
-	return http_partial_read ( http, block, ( lba * HTTP_BLKSIZE ),
-				   buffer, ( count * HTTP_BLKSIZE ) );
+	/* Attach to parent interface and return */
+	intf_plug_plug ( &read->block, block );
+	return 0;
 }
 
 /**
@@ -1321,6 +2166,149 @@ static struct interface_descriptor http_xfer_desc =
 static struct process_descriptor http_process_desc =
 	PROC_DESC_ONCE ( struct http_request, process, http_step );
 
+/**
+ * Allocate HTTP request
+ *
+ * @v uri		Uniform Resource Identifier
+ * @v default_port	Default port number
+ * @v filter		Filter to apply to socket, or NULL
+ * @ret http		HTTP request, or NULL on error
+ */
+static struct http_request *
+http_alloc ( struct uri *uri, unsigned int default_port,
+	     int ( * filter ) ( struct interface *xfer, const char *name,
+				struct interface **next ) ) {
+	struct http_request *http;
+
+	/* Allocate and populate HTTP structure */
+	http = zalloc ( sizeof ( *http ) );
+	if ( ! http )
+		return NULL;
+	ref_init ( &http->refcnt, http_free );
+	intf_init ( &http->xfer, &http_xfer_desc, &http->refcnt );
+	intf_init ( &http->partial, &http_partial_desc, &http->refcnt );
+	http->uri = uri_get ( uri );
+	http->default_port = default_port;
+	http->filter = filter;
+	intf_init ( &http->socket, &http_socket_desc, &http->refcnt );
+	process_init_stopped ( &http->process, &http_process_desc,
+			       &http->refcnt );
+	INIT_LIST_HEAD ( &http->list );
+	INIT_LIST_HEAD ( &http->segments );
+	INIT_LIST_HEAD ( &http->reads );
+	INIT_LIST_HEAD ( &http->ranges );
+
+	return http;
+}
+
+/**
+ * Open segment request
+ *
+ * @v http		HTTP request
+ * @ret rc		Return status code
+ */
+static int http_segment_open ( struct http_request *http ) {
+	struct http_request *segment;
+	int rc;
+
+	/* Allocate segment request */
+	segment = http_alloc ( http->uri, http->default_port, http->filter );
+	if ( ! segment ) {
+		rc = -ENOMEM;
+		goto err_alloc;
+	}
+	segment->parent = http;
+	ref_get ( &http->refcnt );
+	segment->flags = ( HTTP_CLIENT_KEEPALIVE | HTTP_POOL |
+			   ( http->flags & ( HTTP_BASIC_AUTH |
+					     HTTP_DIGEST_AUTH ) ) );
+
+	/* Reuse any authentication parameters */
+	if ( ( http->auth_realm &&
+	       ( ! ( segment->auth_realm = strdup ( http->auth_realm ) ) ) ) ||
+	     ( http->auth_nonce &&
+	       ( ! ( segment->auth_nonce = strdup ( http->auth_nonce ) ) ) ) ||
+	     ( http->auth_opaque &&
+	       ( ! ( segment->auth_opaque =
+		     strdup ( http->auth_opaque ) ) ) ) ) {
+		rc = -ENOMEM;
+		goto err_auth;
+	}
+
+	/* Open socket */
+	if ( ( rc = http_socket_open ( segment ) ) != 0 )
+		goto err_open;
+
+	/* Attach to parent request (which inherits our reference) and
+	 * claim first segment.
+	 */
+	list_add_tail ( &segment->list, &http->segments );
+	DBGC ( http, "HTTP %p opened segment %p\n", http, segment );
+	if ( ! http_segment_claim ( segment ) )
+		http_close ( segment, 0 );
+
+	return 0;
+
+ err_open:
+ err_auth:
+	http_close ( segment, rc );
+	ref_put ( &segment->refcnt );
+ err_alloc:
+	return rc;
+}
+
+/**
+ * Split download into segments, if applicable
+ *
+ * @v http		HTTP request
+ * @ret rc		Return status code
+ */
+static int http_segment_start ( struct http_request *http ) {
+	unsigned int connections;
+	unsigned int i;
+	int rc;
+
+	/* Segment only plain, complete, range-capable downloads of a
+	 * known length that is large enough to be worth splitting.
+	 */
+	if ( http->parent || ( http->flags & ( HTTP_TRY_AGAIN |
+					       HTTP_HEAD_ONLY |
+					       HTTP_SEGMENTED ) ) ||
+	     ( ! ( http->flags & HTTP_ACCEPT_RANGES ) ) ||
+	     ( http->code != 200 ) || http->chunked ||
+	     ( http->rx_buffer != UNULL ) ||
+	     ( http->remaining < ( 2 * HTTP_SEGMENT_SIZE ) ) ) {
+		return 0;
+	}
+
+	/* Do not fetch segments out of order for a recipient that
+	 * cannot use them (e.g. a decompressor).
+	 */
+	if ( xfer_sequential ( &http->xfer ) )
+		return 0;
+	connections = fetch_uintz_setting ( NULL, &http_connections_setting );
+	if ( connections <= 1 )
+		return 0;
+	if ( connections > HTTP_MAX_CONNECTIONS )
+		connections = HTTP_MAX_CONNECTIONS;
+
+	/* Open additional connections */
+	DBGC ( http, "HTTP %p splitting %zd bytes across %d connections\n",
+	       http, http->remaining, connections );
+	http->flags |= HTTP_SEGMENTED;
+	http->segment_end = http->remaining;
+	for ( i = 1 ; i < connections ; i++ ) {
+		if ( ( rc = http_segment_open ( http ) ) != 0 ) {
+			/* Continue with whatever connections we have */
+			DBGC ( http, "HTTP %p could not open segment: %s\n",
+			       http, strerror ( rc ) );
+			break;
+		}
+	}
+
+	return 0;
+}
+
 /**
  * Initiate an HTTP connection, with optional filter
  *
@@ -1352,18 +2340,11 @@ int http_open_filter ( struct interface *xfer, struct uri *uri,
 		return -EINVAL;
 
 	/* Allocate and populate HTTP structure */
-	http = zalloc ( sizeof ( *http ) );
+	http = http_alloc ( uri, default_port, filter );
 	if ( ! http )
 		return -ENOMEM;
-	ref_init ( &http->refcnt, http_free );
-	intf_init ( &http->xfer, &http_xfer_desc, &http->refcnt );
-	intf_init ( &http->partial, &http_partial_desc, &http->refcnt );
-	http->uri = uri_get ( uri );
-	http->default_port = default_port;
-	http->filter = filter;
-	intf_init ( &http->socket, &http_socket_desc, &http->refcnt );
-	process_init ( &http->process, &http_process_desc, &http->refcnt );
-	http->flags = HTTP_TX_PENDING;
+	process_add ( &http->process );
+	http->flags = ( HTTP_TX_PENDING | HTTP_POOL );
 
 	/* Open socket */
 	if ( ( rc = http_socket_open ( http ) ) != 0 )
@@ -141,10 +141,12 @@ FEATURE ( FEATURE_PROTOCOL, "iSCSI", DHCP_EB_FEATURE_ISCSI, 1 );
 #define EINFO_EPROTO_VALUE_REJECTED					\
 	__einfo_uniqify ( EINFO_EPROTO, 0x06, "Parameter rejected" )
 
-static void iscsi_start_tx ( struct iscsi_session *iscsi );
+static void iscsi_start_tx ( struct iscsi_session *iscsi,
+			     struct iscsi_task *task );
+static void iscsi_tx_resume ( struct iscsi_session *iscsi );
 static void iscsi_start_login ( struct iscsi_session *iscsi );
 static void iscsi_start_data_out ( struct iscsi_session *iscsi,
-				   unsigned int datasn );
+				   struct iscsi_task *task );
 
 /**
  * Finish receiving PDU data into buffer
@@ -204,10 +206,80 @@ static void iscsi_free ( struct refcnt *refcnt ) {
 	free ( iscsi->target_password );
 	chap_finish ( &iscsi->chap );
 	iscsi_rx_buffered_data_done ( iscsi );
-	free ( iscsi->command );
 	free ( iscsi );
 }
 
+/**
+ * Free iSCSI task
+ *
+ * @v refcnt		Reference counter
+ */
+static void iscsi_task_free ( struct refcnt *refcnt ) {
+	struct iscsi_task *task =
+		container_of ( refcnt, struct iscsi_task, refcnt );
+
+	ref_put ( &task->iscsi->refcnt );
+	free ( task );
+}
+
+/**
+ * Find outstanding iSCSI task
+ *
+ * @v iscsi		iSCSI session
+ * @v itt		Initiator task tag
+ * @ret task		iSCSI task, or NULL if not found
+ */
+static struct iscsi_task * iscsi_find_task ( struct iscsi_session *iscsi,
+					     uint32_t itt ) {
+	struct iscsi_task *task;
+
+	list_for_each_entry ( task, &iscsi->tasks, list ) {
+		if ( task->itt == itt )
+			return task;
+	}
+	return NULL;
+}
+
+/**
+ * Mark iSCSI task as complete
+ *
+ * @v task		iSCSI task
+ * @v rc		Return status code
+ * @v rsp		SCSI response, if any
+ *
+ * The task is removed from the list of outstanding tasks, and the
+ * SCSI command interface is closed.
+ */
+static void iscsi_scsi_done ( struct iscsi_task *task, int rc,
+			      struct scsi_rsp *rsp ) {
+	struct iscsi_session *iscsi = task->iscsi;
+
+	/* Do nothing if task is already complete */
+	if ( list_empty ( &task->list ) )
+		return;
+
+	DBGC2 ( iscsi, "iSCSI %p ITT %08x complete: %s\n",
+		iscsi, task->itt, strerror ( rc ) );
+
+	/* Remove from list of outstanding tasks */
+	list_del ( &task->list );
+	INIT_LIST_HEAD ( &task->list );
+	iscsi->num_tasks--;
+
+	/* Send SCSI response, if any */
+	if ( rsp )
+		scsi_response ( &task->data, rsp );
+
+	/* Close SCSI command */
+	intf_shutdown ( &task->data, rc );
+
+	/* Drop list's reference to task */
+	ref_put ( &task->refcnt );
+
+	/* Notify SCSI layer of window change */
+	xfer_window_changed ( &iscsi->control );
+}
+
 /**
  * Shut down iSCSI interface
  *
@@ -215,6 +287,7 @@ static void iscsi_free ( struct refcnt *refcnt ) {
  * @v rc		Reason for close
  */
 static void iscsi_close ( struct iscsi_session *iscsi, int rc ) {
+	struct iscsi_task *task;
 
 	/* A TCP graceful close is still an error from our point of view */
 	if ( rc == 0 )
@@ -225,21 +298,43 @@ static void iscsi_close ( struct iscsi_session *iscsi, int rc ) {
 	/* Stop transmission process */
 	process_del ( &iscsi->process );
 
+	/* Release task owning the current TX PDU, if any */
+	if ( iscsi->tx_task ) {
+		ref_put ( &iscsi->tx_task->refcnt );
+		iscsi->tx_task = NULL;
+	}
+
 	/* Shut down interfaces */
 	intf_shutdown ( &iscsi->socket, rc );
 	intf_shutdown ( &iscsi->control, rc );
-	intf_shutdown ( &iscsi->data, rc );
+
+	/* Fail any outstanding tasks.  (Closing one task may cause
+	 * the SCSI layer to close others, so restart from the head of
+	 * the list each time.)
+	 */
+	while ( ( task = list_first_entry ( &iscsi->tasks, struct iscsi_task,
+					    list ) ) != NULL ) {
+		iscsi_scsi_done ( task, rc, NULL );
+	}
 }
 
 /**
  * Assign new iSCSI initiator task tag
  *
  * @v iscsi		iSCSI session
+ * @ret itt		Initiator task tag
+ *
+ * Tags belonging to outstanding tasks are never reused.
  */
-static void iscsi_new_itt ( struct iscsi_session *iscsi ) {
+static uint32_t iscsi_new_itt ( struct iscsi_session *iscsi ) {
 	static uint16_t itt_idx;
+	uint32_t itt;
+
+	do {
+		itt = ( ISCSI_TAG_MAGIC | (++itt_idx) );
+	} while ( iscsi_find_task ( iscsi, itt ) );
 
-	iscsi->itt = ( ISCSI_TAG_MAGIC | (++itt_idx) );
+	return itt;
 }
 
 /**
@@ -278,7 +373,7 @@ static int iscsi_open_connection ( struct iscsi_session *iscsi ) {
 	iscsi->isid_iana_qual = ( random() & 0xffff );
 
 	/* Assign fresh initiator task tag */
-	iscsi_new_itt ( iscsi );
+	iscsi->itt = iscsi_new_itt ( iscsi );
 
 	/* Initiate login */
 	iscsi_start_login ( iscsi );
@@ -313,42 +408,6 @@ static void iscsi_close_connection ( struct iscsi_session *iscsi, int rc ) {
 	iscsi_rx_buffered_data_done ( iscsi );
 }
 
-/**
- * Mark iSCSI SCSI operation as complete
- *
- * @v iscsi		iSCSI session
- * @v rc		Return status code
- * @v rsp		SCSI response, if any
- *
- * Note that iscsi_scsi_done() will not close the connection, and must
- * therefore be called only when the internal state machines are in an
- * appropriate state, otherwise bad things may happen on the next call
- * to iscsi_scsi_command().  The general rule is to call
- * iscsi_scsi_done() only at the end of receiving a PDU; at this point
- * the TX and RX engines should both be idle.
- */
-static void iscsi_scsi_done ( struct iscsi_session *iscsi, int rc,
-			      struct scsi_rsp *rsp ) {
-	uint32_t itt = iscsi->itt;
-
-	assert ( iscsi->tx_state == ISCSI_TX_IDLE );
-
-	/* Clear command */
-	free ( iscsi->command );
-	iscsi->command = NULL;
-
-	/* Send SCSI response, if any */
-	if ( rsp )
-		scsi_response ( &iscsi->data, rsp );
-
-	/* Close SCSI command, if this is still the same command.  (It
-	 * is possible that the command interface has already been
-	 * closed as a result of the SCSI response we sent.)
-	 */
-	if ( iscsi->itt == itt )
-		intf_restart ( &iscsi->data, rc );
-}
-
 /****************************************************************************
  *
  * iSCSI SCSI command issuing
@@ -359,41 +418,65 @@ static void iscsi_scsi_done ( struct iscsi_session *iscsi, int rc,
  * Build iSCSI SCSI command BHS
  *
  * @v iscsi		iSCSI session
+ * @v task		iSCSI task
  *
  * We don't currently support bidirectional commands (i.e. with both
  * Data-In and Data-Out segments); these would require providing code
  * to generate an AHS, and there doesn't seem to be any need for it at
  * the moment.
  */
-static void iscsi_start_command ( struct iscsi_session *iscsi ) {
+static void iscsi_start_command ( struct iscsi_session *iscsi,
+				  struct iscsi_task *task ) {
 	struct iscsi_bhs_scsi_command *command = &iscsi->tx_bhs.scsi_command;
 
-	assert ( ! ( iscsi->command->data_in && iscsi->command->data_out ) );
+	assert ( ! ( task->command.data_in && task->command.data_out ) );
 
 	/* Construct BHS and initiate transmission */
-	iscsi_start_tx ( iscsi );
+	iscsi_start_tx ( iscsi, task );
 	command->opcode = ISCSI_OPCODE_SCSI_COMMAND;
 	command->flags = ( ISCSI_FLAG_FINAL |
 			   ISCSI_COMMAND_ATTR_SIMPLE );
-	if ( iscsi->command->data_in )
+	if ( task->command.data_in )
 		command->flags |= ISCSI_COMMAND_FLAG_READ;
-	if ( iscsi->command->data_out )
+	if ( task->command.data_out )
 		command->flags |= ISCSI_COMMAND_FLAG_WRITE;
 	/* lengths left as zero */
-	memcpy ( &command->lun, &iscsi->command->lun,
+	memcpy ( &command->lun, &task->command.lun,
 		 sizeof ( command->lun ) );
-	command->itt = htonl ( iscsi->itt );
-	command->exp_len = htonl ( iscsi->command->data_in_len |
-				   iscsi->command->data_out_len );
-	command->cmdsn = htonl ( iscsi->cmdsn );
+	command->itt = htonl ( task->itt );
+	command->exp_len = htonl ( task->command.data_in_len |
+				   task->command.data_out_len );
+	command->cmdsn = htonl ( task->cmdsn );
 	command->expstatsn = htonl ( iscsi->statsn + 1 );
-	memcpy ( &command->cdb, &iscsi->command->cdb, sizeof ( command->cdb ));
-	DBGC2 ( iscsi, "iSCSI %p start " SCSI_CDB_FORMAT " %s %#zx\n",
-		iscsi, SCSI_CDB_DATA ( command->cdb ),
-		( iscsi->command->data_in ? "in" : "out" ),
-		( iscsi->command->data_in ?
-		  iscsi->command->data_in_len :
-		  iscsi->command->data_out_len ) );
+	memcpy ( &command->cdb, &task->command.cdb, sizeof ( command->cdb ));
+	DBGC2 ( iscsi, "iSCSI %p ITT %08x CmdSN %#x start " SCSI_CDB_FORMAT
+		" %s %#zx\n", iscsi, task->itt, task->cmdsn,
+		SCSI_CDB_DATA ( command->cdb ),
+		( task->command.data_in ? "in" : "out" ),
+		( task->command.data_in ?
+		  task->command.data_in_len :
+		  task->command.data_out_len ) );
+
+	/* Command PDU is now under way */
+	task->flags &= ~ISCSI_TASK_TX_COMMAND;
+}
+
+/**
+ * Identify task for received PDU
+ *
+ * @v iscsi		iSCSI session
+ * @ret task		iSCSI task, or NULL if not found
+ */
+static struct iscsi_task * iscsi_rx_task ( struct iscsi_session *iscsi ) {
+	uint32_t itt = ntohl ( iscsi->rx_bhs.common.itt );
+	struct iscsi_task *task;
+
+	task = iscsi_find_task ( iscsi, itt );
+	if ( ! task ) {
+		DBGC ( iscsi, "iSCSI %p received opcode %02x for unknown "
+		       "ITT %08x\n", iscsi, iscsi->rx_bhs.common.opcode, itt );
+	}
+	return task;
 }
 
 /**
@@ -410,6 +493,7 @@ static int iscsi_rx_scsi_response ( struct iscsi_session *iscsi,
 				    size_t remaining ) {
 	struct iscsi_bhs_scsi_response *response
 		= &iscsi->rx_bhs.scsi_response;
+	struct iscsi_task *task;
 	struct scsi_rsp rsp;
 	uint32_t residual_count;
 	int rc;
@@ -441,8 +525,13 @@ static int iscsi_rx_scsi_response ( struct iscsi_session *iscsi,
 	if ( response->response != ISCSI_RESPONSE_COMMAND_COMPLETE )
 		return -EIO;
 
+	/* Identify task */
+	task = iscsi_rx_task ( iscsi );
+	if ( ! task )
+		return -EPROTO;
+
 	/* Mark as completed */
-	iscsi_scsi_done ( iscsi, 0, &rsp );
+	iscsi_scsi_done ( task, 0, &rsp );
 	return 0;
 }
 
@@ -459,14 +548,28 @@ static int iscsi_rx_data_in ( struct iscsi_session *iscsi,
 			      const void *data, size_t len,
 			      size_t remaining ) {
 	struct iscsi_bhs_data_in *data_in = &iscsi->rx_bhs.data_in;
+	struct iscsi_task *task;
 	unsigned long offset;
 
-	/* Copy data to data-in buffer */
+	/* Identify task */
+	task = iscsi_rx_task ( iscsi );
+	if ( ! task )
+		return -EPROTO;
+
+	/* Copy data to data-in buffer, unless task has been abandoned */
 	offset = ntohl ( data_in->offset ) + iscsi->rx_offset;
-	assert ( iscsi->command != NULL );
-	assert ( iscsi->command->data_in );
-	assert ( ( offset + len ) <= iscsi->command->data_in_len );
-	copy_to_user ( iscsi->command->data_in, offset, data, len );
+	if ( ! task->command.data_in ) {
+		DBGC ( iscsi, "iSCSI %p ITT %08x received unexpected data-in\n",
+		       iscsi, task->itt );
+		return -EPROTO;
+	}
+	if ( ( offset + len ) > task->command.data_in_len ) {
+		DBGC ( iscsi, "iSCSI %p ITT %08x data-in overrun\n",
+		       iscsi, task->itt );
+		return -EPROTO;
+	}
+	if ( ! ( task->flags & ISCSI_TASK_ORPHAN ) )
+		copy_to_user ( task->command.data_in, offset, data, len );
 
 	/* Wait for whole SCSI response to arrive */
 	if ( remaining )
@@ -474,10 +577,10 @@ static int iscsi_rx_data_in ( struct iscsi_session *iscsi,
 
 	/* Mark as completed if status is present */
 	if ( data_in->flags & ISCSI_DATA_FLAG_STATUS ) {
-		assert ( ( offset + len ) == iscsi->command->data_in_len );
+		assert ( ( offset + len ) == task->command.data_in_len );
 		assert ( data_in->flags & ISCSI_FLAG_FINAL );
 		/* iSCSI cannot return an error status via a data-in */
-		iscsi_scsi_done ( iscsi, 0, NULL );
+		iscsi_scsi_done ( task, 0, NULL );
 	}
 
 	return 0;
@@ -496,12 +599,25 @@ static int iscsi_rx_r2t ( struct iscsi_session *iscsi,
 			  const void *data __unused, size_t len __unused,
 			  size_t remaining __unused ) {
 	struct iscsi_bhs_r2t *r2t = &iscsi->rx_bhs.r2t;
+	struct iscsi_task *task;
 
-	/* Record transfer parameters and trigger first data-out */
-	iscsi->ttt = ntohl ( r2t->ttt );
-	iscsi->transfer_offset = ntohl ( r2t->offset );
-	iscsi->transfer_len = ntohl ( r2t->len );
-	iscsi_start_data_out ( iscsi, 0 );
+	/* Identify task */
+	task = iscsi_rx_task ( iscsi );
+	if ( ! task )
+		return -EPROTO;
+	if ( ! task->command.data_out ) {
+		DBGC ( iscsi, "iSCSI %p ITT %08x received unexpected R2T\n",
+		       iscsi, task->itt );
+		return -EPROTO;
+	}
+
+	/* Record transfer parameters and schedule data-out PDUs */
+	task->ttt = ntohl ( r2t->ttt );
+	task->transfer_offset = ntohl ( r2t->offset );
+	task->transfer_len = ntohl ( r2t->len );
+	task->datasn = 0;
+	task->flags |= ISCSI_TASK_TX_DATA_OUT;
+	iscsi_tx_resume ( iscsi );
 
 	return 0;
 }
@@ -510,11 +626,11 @@ static int iscsi_rx_r2t ( struct iscsi_session *iscsi,
  * Build iSCSI data-out BHS
  *
  * @v iscsi		iSCSI session
- * @v datasn		Data sequence number within the transfer
+ * @v task		iSCSI task
  *
  */
 static void iscsi_start_data_out ( struct iscsi_session *iscsi,
-				   unsigned int datasn ) {
+				   struct iscsi_task *task ) {
 	struct iscsi_bhs_data_out *data_out = &iscsi->tx_bhs.data_out;
 	unsigned long offset;
 	unsigned long remaining;
@@ -523,26 +639,26 @@ static void iscsi_start_data_out ( struct iscsi_session *iscsi,
 	/* We always send 512-byte Data-Out PDUs; this removes the
 	 * need to worry about the target's MaxRecvDataSegmentLength.
 	 */
-	offset = datasn * 512;
-	remaining = iscsi->transfer_len - offset;
+	offset = task->datasn * 512;
+	remaining = task->transfer_len - offset;
 	len = remaining;
 	if ( len > 512 )
 		len = 512;
 
 	/* Construct BHS and initiate transmission */
-	iscsi_start_tx ( iscsi );
+	iscsi_start_tx ( iscsi, task );
 	data_out->opcode = ISCSI_OPCODE_DATA_OUT;
 	if ( len == remaining )
 		data_out->flags = ( ISCSI_FLAG_FINAL );
 	ISCSI_SET_LENGTHS ( data_out->lengths, 0, len );
-	data_out->lun = iscsi->command->lun;
-	data_out->itt = htonl ( iscsi->itt );
-	data_out->ttt = htonl ( iscsi->ttt );
+	data_out->lun = task->command.lun;
+	data_out->itt = htonl ( task->itt );
+	data_out->ttt = htonl ( task->ttt );
 	data_out->expstatsn = htonl ( iscsi->statsn + 1 );
-	data_out->datasn = htonl ( datasn );
-	data_out->offset = htonl ( iscsi->transfer_offset + offset );
-	DBGC ( iscsi, "iSCSI %p start data out DataSN %#x len %#lx\n",
-	       iscsi, datasn, len );
+	data_out->datasn = htonl ( task->datasn );
+	data_out->offset = htonl ( task->transfer_offset + offset );
+	DBGC ( iscsi, "iSCSI %p ITT %08x start data out DataSN %#x len %#lx\n",
+	       iscsi, task->itt, task->datasn, len );
 }
 
 /**
@@ -553,12 +669,16 @@ static void iscsi_start_data_out ( struct iscsi_session *iscsi,
  */
 static void iscsi_data_out_done ( struct iscsi_session *iscsi ) {
 	struct iscsi_bhs_data_out *data_out = &iscsi->tx_bhs.data_out;
+	struct iscsi_task *task = iscsi->tx_task;
 
-	/* If we haven't reached the end of the sequence, start
-	 * sending the next data-out PDU.
+	/* If we haven't reached the end of the sequence, leave the
+	 * task scheduled to send the next data-out PDU.
 	 */
-	if ( ! ( data_out->flags & ISCSI_FLAG_FINAL ) )
-		iscsi_start_data_out ( iscsi, ntohl ( data_out->datasn ) + 1 );
+	if ( data_out->flags & ISCSI_FLAG_FINAL ) {
+		task->flags &= ~ISCSI_TASK_TX_DATA_OUT;
+	} else {
+		task->datasn++;
+	}
 }
 
 /**
@@ -569,6 +689,7 @@ static void iscsi_data_out_done ( struct iscsi_session *iscsi ) {
  */
 static int iscsi_tx_data_out ( struct iscsi_session *iscsi ) {
 	struct iscsi_bhs_data_out *data_out = &iscsi->tx_bhs.data_out;
+	struct iscsi_task *task = iscsi->tx_task;
 	struct io_buffer *iobuf;
 	unsigned long offset;
 	size_t len;
@@ -578,16 +699,23 @@ static int iscsi_tx_data_out ( struct iscsi_session *iscsi ) {
 	len = ISCSI_DATA_LEN ( data_out->lengths );
 	pad_len = ISCSI_DATA_PAD_LEN ( data_out->lengths );
 
-	assert ( iscsi->command != NULL );
-	assert ( iscsi->command->data_out );
-	assert ( ( offset + len ) <= iscsi->command->data_out_len );
+	assert ( task != NULL );
+	assert ( task->command.data_out );
+	assert ( ( offset + len ) <= task->command.data_out_len );
 
 	iobuf = xfer_alloc_iob ( &iscsi->socket, ( len + pad_len ) );
 	if ( ! iobuf )
 		return -ENOMEM;
-	
-	copy_from_user ( iob_put ( iobuf, len ),
-			 iscsi->command->data_out, offset, len );
+
+	/* The PDU header has already been sent, so if the task has
+	 * completed in the meantime we must still send (dummy) data.
+	 */
+	if ( list_empty ( &task->list ) ) {
+		memset ( iob_put ( iobuf, len ), 0, len );
+	} else {
+		copy_from_user ( iob_put ( iobuf, len ),
+				 task->command.data_out, offset, len );
+	}
 	memset ( iob_put ( iobuf, pad_len ), 0, pad_len );
 
 	return xfer_deliver_iob ( &iscsi->socket, iobuf );
@@ -761,7 +889,7 @@ static void iscsi_start_login ( struct iscsi_session *iscsi ) {
 	}
 
 	/* Construct BHS and initiate transmission */
-	iscsi_start_tx ( iscsi );
+	iscsi_start_tx ( iscsi, NULL );
 	request->opcode = ( ISCSI_OPCODE_LOGIN_REQUEST |
 			    ISCSI_FLAG_IMMEDIATE );
 	request->flags = ( ( iscsi->status & ISCSI_STATUS_PHASE_MASK ) |
@@ -1362,17 +1490,26 @@ static void iscsi_tx_resume ( struct iscsi_session *iscsi ) {
  * Start up a new TX PDU
  *
  * @v iscsi		iSCSI session
+ * @v task		iSCSI task owning the PDU, or NULL
  *
  * This initiates the process of sending a new PDU.  Only one PDU may
  * be in transit at any one time.
  */
-static void iscsi_start_tx ( struct iscsi_session *iscsi ) {
+static void iscsi_start_tx ( struct iscsi_session *iscsi,
+			     struct iscsi_task *task ) {
 
 	assert ( iscsi->tx_state == ISCSI_TX_IDLE );
+	assert ( iscsi->tx_task == NULL );
 
 	/* Initialise TX BHS */
 	memset ( &iscsi->tx_bhs, 0, sizeof ( iscsi->tx_bhs ) );
 
+	/* Record owning task, if any */
+	if ( task ) {
+		ref_get ( &task->refcnt );
+		iscsi->tx_task = task;
+	}
+
 	/* Flag TX engine to start transmitting */
 	iscsi->tx_state = ISCSI_TX_BHS;
 
@@ -1436,18 +1573,48 @@ static int iscsi_tx_data ( struct iscsi_session *iscsi ) {
 static void iscsi_tx_done ( struct iscsi_session *iscsi ) {
 	struct iscsi_bhs_common *common = &iscsi->tx_bhs.common;
 
-	/* Stop transmission process */
-	iscsi_tx_pause ( iscsi );
-
 	switch ( common->opcode & ISCSI_OPCODE_MASK ) {
 	case ISCSI_OPCODE_DATA_OUT:
 		iscsi_data_out_done ( iscsi );
+		break;
 	case ISCSI_OPCODE_LOGIN_REQUEST:
 		iscsi_login_request_done ( iscsi );
+		break;
 	default:
 		/* No action */
 		break;
 	}
+
+	/* Release owning task, if any */
+	if ( iscsi->tx_task ) {
+		ref_put ( &iscsi->tx_task->refcnt );
+		iscsi->tx_task = NULL;
+	}
+}
+
+/**
+ * Start next queued TX PDU
+ *
+ * @v iscsi		iSCSI session
+ * @ret started		A new PDU was started
+ *
+ * Tasks are serviced in order of issue, so that SCSI command PDUs
+ * are always transmitted in CmdSN order.
+ */
+static int iscsi_tx_next ( struct iscsi_session *iscsi ) {
+	struct iscsi_task *task;
+
+	list_for_each_entry ( task, &iscsi->tasks, list ) {
+		if ( task->flags & ISCSI_TASK_TX_COMMAND ) {
+			iscsi_start_command ( iscsi, task );
+			return 1;
+		}
+		if ( task->flags & ISCSI_TASK_TX_DATA_OUT ) {
+			iscsi_start_data_out ( iscsi, task );
+			return 1;
+		}
+	}
+	return 0;
 }
 
 /**
@@ -1485,6 +1652,9 @@ static void iscsi_tx_step ( struct iscsi_session *iscsi ) {
 			next_state = ISCSI_TX_IDLE;
 			break;
 		case ISCSI_TX_IDLE:
+			/* Start next queued PDU, if any */
+			if ( iscsi_tx_next ( iscsi ) )
+				continue;
 			/* Nothing to do; pause processing */
 			iscsi_tx_pause ( iscsi );
 			return;
@@ -1583,11 +1753,29 @@ static int iscsi_rx_data ( struct iscsi_session *iscsi, const void *data,
 			   size_t len, size_t remaining ) {
 	struct iscsi_bhs_common_response *response
 		= &iscsi->rx_bhs.common_response;
+	uint32_t expcmdsn = ntohl ( response->expcmdsn );
+	uint32_t maxcmdsn = ntohl ( response->maxcmdsn );
 
-	/* Update cmdsn and statsn */
-	iscsi->cmdsn = ntohl ( response->expcmdsn );
+	/* Update statsn */
 	iscsi->statsn = ntohl ( response->statsn );
 
+	/* Update command sequence numbers.  Login requests are
+	 * immediate and so do not consume a CmdSN; the target's
+	 * ExpCmdSN therefore defines our starting CmdSN.  Thereafter,
+	 * we assign CmdSNs ourselves and track only the window
+	 * advertised by the target, ignoring any MaxCmdSN that is
+	 * stale or (per RFC 3720 section 3.2.2.1) invalid.
+	 */
+	if ( ( response->opcode & ISCSI_OPCODE_MASK ) ==
+	     ISCSI_OPCODE_LOGIN_RESPONSE ) {
+		iscsi->cmdsn = expcmdsn;
+		iscsi->maxcmdsn = maxcmdsn;
+	} else if ( ( ( int32_t ) ( maxcmdsn - iscsi->maxcmdsn ) > 0 ) &&
+		    ( ( int32_t ) ( maxcmdsn - expcmdsn ) >= -1 ) ) {
+		iscsi->maxcmdsn = maxcmdsn;
+		xfer_window_changed ( &iscsi->control );
+	}
+
 	switch ( response->opcode & ISCSI_OPCODE_MASK ) {
 	case ISCSI_OPCODE_LOGIN_RESPONSE:
 		return iscsi_rx_login_response ( iscsi, data, len, remaining );
@@ -1753,19 +1941,76 @@ static struct interface_descriptor iscsi_socket_desc =
  *
  * @v iscsi		iSCSI session
  * @ret len		Length of window
+ *
+ * The window is the number of further commands which may be issued,
+ * limited by both the number of outstanding tasks and the target's
+ * command sequence number window.
  */
 static size_t iscsi_scsi_window ( struct iscsi_session *iscsi ) {
+	int32_t cmdsn_window;
+	size_t window;
 
-	if ( ( ( iscsi->status & ISCSI_STATUS_PHASE_MASK ) ==
-	       ISCSI_STATUS_FULL_FEATURE_PHASE ) &&
-	     ( iscsi->command == NULL ) ) {
-		/* We cannot handle concurrent commands */
-		return 1;
-	} else {
+	/* Refuse commands until login is complete */
+	if ( ( iscsi->status & ISCSI_STATUS_PHASE_MASK ) !=
+	     ISCSI_STATUS_FULL_FEATURE_PHASE )
 		return 0;
+
+	/* Limit to number of free task slots */
+	window = ( ISCSI_MAX_TASKS - iscsi->num_tasks );
+
+	/* Limit to target's command window */
+	cmdsn_window = ( iscsi->maxcmdsn - iscsi->cmdsn + 1 );
+	if ( cmdsn_window < 0 )
+		cmdsn_window = 0;
+	if ( window > ( size_t ) cmdsn_window )
+		window = cmdsn_window;
+
+	return window;
+}
+
+/**
+ * Close iSCSI task
+ *
+ * @v task		iSCSI task
+ * @v rc		Reason for close
+ */
+static void iscsi_task_close ( struct iscsi_task *task, int rc ) {
+	struct iscsi_session *iscsi = task->iscsi;
+
+	/* Restart interface */
+	intf_restart ( &task->data, rc );
+
+	/* Do nothing more if task is already complete */
+	if ( list_empty ( &task->list ) )
+		return;
+
+	/* Treat unsolicited closures of write commands as fatal,
+	 * because we have no way to abandon a partially-completed
+	 * data-out sequence.
+	 */
+	if ( task->command.data_out ) {
+		iscsi_close ( iscsi, ( ( rc == 0 ) ? -ECANCELED : rc ) );
+		return;
 	}
+
+	/* Abandon read commands: the task remains outstanding (and
+	 * its CmdSN remains consumed) until the target responds, but
+	 * any received data will be discarded.
+	 */
+	DBGC2 ( iscsi, "iSCSI %p ITT %08x abandoned: %s\n",
+		iscsi, task->itt, strerror ( rc ) );
+	task->flags |= ISCSI_TASK_ORPHAN;
 }
 
+/** iSCSI SCSI command interface operations */
+static struct interface_operation iscsi_task_data_op[] = {
+	INTF_OP ( intf_close, struct iscsi_task *, iscsi_task_close ),
+};
+
+/** iSCSI SCSI command interface descriptor */
+static struct interface_descriptor iscsi_task_data_desc =
+	INTF_DESC ( struct iscsi_task, data, iscsi_task_data_op );
+
 /**
  * Issue iSCSI SCSI command
  *
@@ -1777,31 +2022,42 @@ static size_t iscsi_scsi_window ( struct iscsi_session *iscsi ) {
 static int iscsi_scsi_command ( struct iscsi_session *iscsi,
 				struct interface *parent,
 				struct scsi_cmd *command ) {
+	struct iscsi_task *task;
 
-	/* This iSCSI implementation cannot handle multiple concurrent
-	 * commands or commands arriving before login is complete.
+	/* Refuse commands arriving before login is complete or
+	 * beyond the flow-control window.
 	 */
 	if ( iscsi_scsi_window ( iscsi ) == 0 ) {
-		DBGC ( iscsi, "iSCSI %p cannot handle concurrent commands\n",
+		DBGC ( iscsi, "iSCSI %p cannot accept further commands\n",
 		       iscsi );
 		return -EOPNOTSUPP;
 	}
 
-	/* Store command */
-	iscsi->command = malloc ( sizeof ( *command ) );
-	if ( ! iscsi->command )
+	/* Allocate and initialise task */
+	task = zalloc ( sizeof ( *task ) );
+	if ( ! task )
 		return -ENOMEM;
-	memcpy ( iscsi->command, command, sizeof ( *command ) );
-
-	/* Assign new ITT */
-	iscsi_new_itt ( iscsi );
-
-	/* Start sending command */
-	iscsi_start_command ( iscsi );
+	ref_init ( &task->refcnt, iscsi_task_free );
+	intf_init ( &task->data, &iscsi_task_data_desc, &task->refcnt );
+	task->iscsi = iscsi;
+	ref_get ( &iscsi->refcnt );
+	memcpy ( &task->command, command, sizeof ( task->command ) );
+
+	/* Assign ITT and CmdSN */
+	task->itt = iscsi_new_itt ( iscsi );
+	task->cmdsn = iscsi->cmdsn++;
+
+	/* Add to list of outstanding tasks (inheriting our reference)
+	 * and schedule command PDU for transmission.
+	 */
+	task->flags = ISCSI_TASK_TX_COMMAND;
+	list_add_tail ( &task->list, &iscsi->tasks );
+	iscsi->num_tasks++;
+	iscsi_tx_resume ( iscsi );
 
 	/* Attach to parent interface and return */
-	intf_plug_plug ( &iscsi->data, parent );
-	return iscsi->itt;
+	intf_plug_plug ( &task->data, parent );
+	return task->itt;
 }
 
 /** iSCSI SCSI command-issuing interface operations */
@@ -1816,33 +2072,6 @@ static struct interface_operation iscsi_control_op[] = {
 static struct interface_descriptor iscsi_control_desc =
 	INTF_DESC ( struct iscsi_session, control, iscsi_control_op );
 
-/**
- * Close iSCSI command
- *
- * @v iscsi		iSCSI session
- * @v rc		Reason for close
- */
-static void iscsi_command_close ( struct iscsi_session *iscsi, int rc ) {
-
-	/* Restart interface */
-	intf_restart ( &iscsi->data, rc );
-
-	/* Treat unsolicited command closures mid-command as fatal,
-	 * because we have no code to handle partially-completed PDUs.
-	 */
-	if ( iscsi->command != NULL )
-		iscsi_close ( iscsi, ( ( rc == 0 ) ? -ECANCELED : rc ) );
-}
-
-/** iSCSI SCSI command interface operations */
-static struct interface_operation iscsi_data_op[] = {
-	INTF_OP ( intf_close, struct iscsi_session *, iscsi_command_close ),
-};
-
-/** iSCSI SCSI command interface descriptor */
-static struct interface_descriptor iscsi_data_desc =
-	INTF_DESC ( struct iscsi_session, data, iscsi_data_op );
-
 /****************************************************************************
  *
  * Instantiator
@@ -2072,10 +2301,10 @@ static int iscsi_open ( struct interface *parent, struct uri *uri ) {
 	}
 	ref_init ( &iscsi->refcnt, iscsi_free );
 	intf_init ( &iscsi->control, &iscsi_control_desc, &iscsi->refcnt );
-	intf_init ( &iscsi->data, &iscsi_data_desc, &iscsi->refcnt );
 	intf_init ( &iscsi->socket, &iscsi_socket_desc, &iscsi->refcnt );
 	process_init_stopped ( &iscsi->process, &iscsi_process_desc,
 			       &iscsi->refcnt );
+	INIT_LIST_HEAD ( &iscsi->tasks );
 
 	/* Parse root path */
 	if ( ( rc = iscsi_parse_root_path ( iscsi, uri->opaque ) ) != 0 )
@@ -115,6 +115,46 @@ struct setting use_cached_setting __setting ( SETTING_MISC ) = {
 	.type = &setting_type_uint8,
 };
 
+/** ProxyDHCP wait time setting */
+struct setting dhcp_proxy_wait_setting __setting ( SETTING_MISC ) = {
+	.name = "dhcp-proxy-wait",
+	.description = "ProxyDHCP wait time (in ms)",
+	.tag = DHCP_EB_DHCP_PROXY_WAIT,
+	.type = &setting_type_uint16,
+};
+
+/** DHCP rapid commit setting */
+struct setting dhcp_rapid_commit_setting __setting ( SETTING_MISC ) = {
+	.name = "dhcp-rapid-commit",
+	.description = "Request DHCP rapid commit",
+	.tag = DHCP_EB_DHCP_RAPID_COMMIT,
+	.type = &setting_type_uint8,
+};
+
+/** DHCP discovery time setting */
+struct setting dhcp_discover_time_setting __setting ( SETTING_MISC ) = {
+	.name = "dhcp-discover-time",
+	.description = "DHCP discovery time (in ms)",
+	.tag = DHCP_EB_DHCP_DISCOVER_TIME,
+	.type = &setting_type_uint32,
+};
+
+/** DHCP request time setting */
+struct setting dhcp_request_time_setting __setting ( SETTING_MISC ) = {
+	.name = "dhcp-request-time",
+	.description = "DHCP request time (in ms)",
+	.tag = DHCP_EB_DHCP_REQUEST_TIME,
+	.type = &setting_type_uint32,
+};
+
+/** ProxyDHCP request time setting */
+struct setting dhcp_proxy_time_setting __setting ( SETTING_MISC ) = {
+	.name = "dhcp-proxy-time",
+	.description = "ProxyDHCP request time (in ms)",
+	.tag = DHCP_EB_DHCP_PROXY_TIME,
+	.type = &setting_type_uint32,
+};
+
 /**
  * Most recent DHCP transaction ID
  *
@@ -187,12 +227,18 @@ struct dhcp_session_state {
 	uint8_t tx_msgtype;
 	/** Apply minimum timeout */
 	uint8_t apply_min_timeout;
+	/** Setting used to record time spent in this state, if any */
+	struct setting *timing;
 };
 
 static struct dhcp_session_state dhcp_state_discover;
 static struct dhcp_session_state dhcp_state_request;
 static struct dhcp_session_state dhcp_state_proxy;
 static struct dhcp_session_state dhcp_state_pxebs;
+static void dhcp_request_rx ( struct dhcp_session *dhcp,
+			      struct dhcp_packet *dhcppkt,
+			      struct sockaddr_in *peer, uint8_t msgtype,
+			      struct in_addr server_id );
 
 /** A DHCP session */
 struct dhcp_session {
@@ -227,6 +273,10 @@ struct dhcp_session {
 	struct dhcp_packet *proxy_offer;
 	/** ProxyDHCP offer priority */
 	int proxy_priority;
+	/** Time to wait for ProxyDHCP offers (in ticks) */
+	unsigned long proxy_wait;
+	/** Rapid commit has been requested */
+	int rapid_commit;
 
 	/** PXE Boot Server type */
 	uint16_t pxe_type;
@@ -257,6 +307,32 @@ static void dhcp_free ( struct refcnt *refcnt ) {
 	free ( dhcp );
 }
 
+/**
+ * Record time spent in current DHCP session state
+ *
+ * @v dhcp		DHCP session
+ */
+static void dhcp_record_time ( struct dhcp_session *dhcp ) {
+	struct dhcp_session_state *state = dhcp->state;
+	unsigned long elapsed;
+	uint32_t msecs;
+	int rc;
+
+	/* Do nothing unless this state is timed */
+	if ( ! ( state && state->timing ) )
+		return;
+
+	/* Store elapsed time as a network device setting */
+	elapsed = ( currticks() - dhcp->start );
+	msecs = htonl ( ( elapsed * 1000 ) / TICKS_PER_SEC );
+	if ( ( rc = store_setting ( netdev_settings ( dhcp->netdev ),
+				    state->timing, &msecs,
+				    sizeof ( msecs ) ) ) != 0 ) {
+		DBGC ( dhcp, "DHCP %p could not record %s time: %s\n",
+		       dhcp, state->name, strerror ( rc ) );
+	}
+}
+
 /**
  * Mark DHCP session as complete
  *
@@ -265,6 +341,9 @@ static void dhcp_free ( struct refcnt *refcnt ) {
  */
 static void dhcp_finished ( struct dhcp_session *dhcp, int rc ) {
 
+	/* Record time spent in final state */
+	dhcp_record_time ( dhcp );
+
 	/* Stop retry timer */
 	stop_timer ( &dhcp->timer );
 
@@ -283,6 +362,7 @@ static void dhcp_set_state ( struct dhcp_session *dhcp,
 			     struct dhcp_session_state *state ) {
 
 	DBGC ( dhcp, "DHCP %p entering %s state\n", dhcp, state->name );
+	dhcp_record_time ( dhcp );
 	dhcp->state = state;
 	dhcp->start = currticks();
 	stop_timer ( &dhcp->timer );
@@ -292,6 +372,22 @@ static void dhcp_set_state ( struct dhcp_session *dhcp,
 	start_timer_nodelay ( &dhcp->timer );
 }
 
+/**
+ * Check if DHCP packet contains the "PXEClient" vendor class
+ *
+ * @v dhcppkt		DHCP packet
+ * @ret has_pxeclient	DHCP packet contains "PXEClient" vendor class
+ */
+static int dhcp_has_pxeclient ( struct dhcp_packet *dhcppkt ) {
+	char vci[9]; /* "PXEClient" */
+	int vci_len;
+
+	vci_len = dhcppkt_fetch ( dhcppkt, DHCP_VENDOR_CLASS_ID,
+				  vci, sizeof ( vci ) );
+	return ( ( vci_len >= ( int ) sizeof ( vci ) ) &&
+		 ( strncmp ( "PXEClient", vci, sizeof ( vci ) ) == 0 ) );
+}
+
 /**
  * Check if DHCP packet contains PXE options
  *
@@ -314,6 +410,61 @@ static int dhcp_has_pxeopts ( struct dhcp_packet *dhcppkt ) {
 	return 0;
 }
 
+/**
+ * Handle potential ProxyDHCP offer
+ *
+ * @v dhcp		DHCP session
+ * @v dhcppkt		DHCP packet
+ * @v server_id		DHCP server ID
+ * @v priority		Offer priority
+ */
+static void dhcp_proxy_offer_rx ( struct dhcp_session *dhcp,
+				  struct dhcp_packet *dhcppkt,
+				  struct in_addr server_id, int priority ) {
+
+	/* Select as ProxyDHCP offer, if applicable */
+	if ( server_id.s_addr && dhcp_has_pxeclient ( dhcppkt ) &&
+	     ( priority >= dhcp->proxy_priority ) ) {
+		dhcppkt_put ( dhcp->proxy_offer );
+		dhcp->proxy_server = server_id;
+		dhcp->proxy_offer = dhcppkt_get ( dhcppkt );
+		dhcp->proxy_priority = priority;
+	}
+}
+
+/**
+ * Append rapid commit option to DHCP packet
+ *
+ * @v dhcppkt		DHCP packet
+ * @ret rc		Return status code
+ *
+ * The rapid commit option has zero length, which dhcppkt_store()
+ * would interpret as a request to delete the option, so it is
+ * written directly in place of the terminating DHCP_END.
+ */
+static int dhcp_store_rapid_commit ( struct dhcp_packet *dhcppkt ) {
+	struct dhcp_options *options = &dhcppkt->options;
+	uint8_t *end;
+
+	/* Sanity checks */
+	if ( ! options->used_len )
+		return -EINVAL;
+	end = ( options->data + options->used_len - 1 );
+	if ( *end != DHCP_END )
+		return -EINVAL;
+	if ( ( options->used_len + DHCP_OPTION_HEADER_LEN ) >
+	     options->alloc_len )
+		return -ENOSPC;
+
+	/* Insert option before DHCP_END */
+	end[0] = DHCP_RAPID_COMMIT;
+	end[1] = 0;
+	end[2] = DHCP_END;
+	options->used_len += DHCP_OPTION_HEADER_LEN;
+
+	return 0;
+}
+
 /****************************************************************************
  *
  * DHCP state machine
@@ -328,10 +479,17 @@ static int dhcp_has_pxeopts ( struct dhcp_packet *dhcppkt ) {
  * @v peer		Destination address
  */
 static int dhcp_discovery_tx ( struct dhcp_session *dhcp,
-			       struct dhcp_packet *dhcppkt __unused,
+			       struct dhcp_packet *dhcppkt,
 			       struct sockaddr_in *peer ) {
+	int rc;
+
+	DBGC ( dhcp, "DHCP %p DHCPDISCOVER%s\n", dhcp,
+	       ( dhcp->rapid_commit ? " with rapid commit" : "" ) );
 
-	DBGC ( dhcp, "DHCP %p DHCPDISCOVER\n", dhcp );
+	/* Request rapid commit, if applicable */
+	if ( dhcp->rapid_commit &&
+	     ( ( rc = dhcp_store_rapid_commit ( dhcppkt ) ) != 0 ) )
+		return rc;
 
 	/* Set server address */
 	peer->sin_addr.s_addr = INADDR_BROADCAST;
@@ -354,9 +512,6 @@ static void dhcp_discovery_rx ( struct dhcp_session *dhcp,
 				struct sockaddr_in *peer, uint8_t msgtype,
 				struct in_addr server_id ) {
 	struct in_addr ip;
-	char vci[9]; /* "PXEClient" */
-	int vci_len;
-	int has_pxeclient;
 	int8_t priority = 0;
 	uint8_t no_pxedhcp = 0;
 	unsigned long elapsed;
@@ -373,11 +528,7 @@ static void dhcp_discovery_rx ( struct dhcp_session *dhcp,
 		DBGC ( dhcp, " for %s", inet_ntoa ( ip ) );
 
 	/* Identify "PXEClient" vendor class */
-	vci_len = dhcppkt_fetch ( dhcppkt, DHCP_VENDOR_CLASS_ID,
-				  vci, sizeof ( vci ) );
-	has_pxeclient = ( ( vci_len >= ( int ) sizeof ( vci ) ) &&
-			  ( strncmp ( "PXEClient", vci, sizeof (vci) ) == 0 ));
-	if ( has_pxeclient ) {
+	if ( dhcp_has_pxeclient ( dhcppkt ) ) {
 		DBGC ( dhcp, "%s",
 		       ( dhcp_has_pxeopts ( dhcppkt ) ? " pxe" : " proxy" ) );
 	}
@@ -406,12 +557,21 @@ static void dhcp_discovery_rx ( struct dhcp_session *dhcp,
 	}
 
 	/* Select as ProxyDHCP offer, if applicable */
-	if ( server_id.s_addr && has_pxeclient &&
-	     ( priority >= dhcp->proxy_priority ) ) {
-		dhcppkt_put ( dhcp->proxy_offer );
-		dhcp->proxy_server = server_id;
-		dhcp->proxy_offer = dhcppkt_get ( dhcppkt );
-		dhcp->proxy_priority = priority;
+	dhcp_proxy_offer_rx ( dhcp, dhcppkt, server_id, priority );
+
+	/* Accept a rapid commit DHCPACK as though it were the
+	 * response to our DHCPREQUEST.  There is no further
+	 * opportunity to wait for ProxyDHCPOFFERs.
+	 */
+	if ( dhcp->rapid_commit && ip.s_addr &&
+	     ( peer->sin_port == htons ( BOOTPS_PORT ) ) &&
+	     ( msgtype == DHCPACK ) &&
+	     ( dhcppkt_fetch ( dhcppkt, DHCP_RAPID_COMMIT, NULL, 0 ) >= 0 ) ) {
+		dhcp->offer = ip;
+		dhcp->server = server_id;
+		dhcp->no_pxedhcp = no_pxedhcp;
+		dhcp_request_rx ( dhcp, dhcppkt, peer, msgtype, server_id );
+		return;
 	}
 
 	/* We can exit the discovery state when we have a valid
@@ -420,6 +580,9 @@ static void dhcp_discovery_rx ( struct dhcp_session *dhcp,
 	 *  o  The DHCPOFFER instructs us to ignore ProxyDHCPOFFERs, or
 	 *  o  We have a valid ProxyDHCPOFFER, or
 	 *  o  We have allowed sufficient time for ProxyDHCPOFFERs.
+	 *
+	 * ProxyDHCPOFFERs arriving after we have exited the discovery
+	 * state will still be picked up during the request state.
 	 */
 
 	/* If we don't yet have a DHCPOFFER, do nothing */
@@ -429,7 +592,7 @@ static void dhcp_discovery_rx ( struct dhcp_session *dhcp,
 	/* If we can't yet transition to DHCPREQUEST, do nothing */
 	elapsed = ( currticks() - dhcp->start );
 	if ( ! ( dhcp->no_pxedhcp || dhcp->proxy_offer ||
-		 ( elapsed > PROXYDHCP_MAX_TIMEOUT ) ) )
+		 ( elapsed >= dhcp->proxy_wait ) ) )
 		return;
 
 	/* Transition to DHCPREQUEST */
@@ -445,7 +608,7 @@ static void dhcp_discovery_expired ( struct dhcp_session *dhcp ) {
 	unsigned long elapsed = ( currticks() - dhcp->start );
 
 	/* Give up waiting for ProxyDHCP before we reach the failure point */
-	if ( dhcp->offer.s_addr && ( elapsed > PROXYDHCP_MAX_TIMEOUT ) ) {
+	if ( dhcp->offer.s_addr && ( elapsed >= dhcp->proxy_wait ) ) {
 		dhcp_set_state ( dhcp, &dhcp_state_request );
 		return;
 	}
@@ -462,6 +625,7 @@ static struct dhcp_session_state dhcp_state_discover = {
 	.expired		= dhcp_discovery_expired,
 	.tx_msgtype		= DHCPDISCOVER,
 	.apply_min_timeout	= 1,
+	.timing			= &dhcp_discover_time_setting,
 };
 
 /**
@@ -515,6 +679,7 @@ static void dhcp_request_rx ( struct dhcp_session *dhcp,
 	struct in_addr ip;
 	struct settings *parent;
 	struct settings *settings;
+	int8_t priority = 0;
 	int rc;
 
 	DBGC ( dhcp, "DHCP %p %s from %s:%d", dhcp,
@@ -529,6 +694,15 @@ static void dhcp_request_rx ( struct dhcp_session *dhcp,
 		DBGC ( dhcp, " for %s", inet_ntoa ( ip ) );
 	DBGC ( dhcp, "\n" );
 
+	/* Continue to listen for ProxyDHCPOFFERs, which may arrive
+	 * after we have stopped waiting for them.
+	 */
+	if ( msgtype == DHCPOFFER ) {
+		dhcppkt_fetch ( dhcppkt, DHCP_EB_PRIORITY, &priority,
+				sizeof ( priority ) );
+		dhcp_proxy_offer_rx ( dhcp, dhcppkt, server_id, priority );
+	}
+
 	/* Filter out unacceptable responses */
 	if ( peer->sin_port != htons ( BOOTPS_PORT ) )
 		return;
@@ -599,6 +773,7 @@ static struct dhcp_session_state dhcp_state_request = {
 	.expired		= dhcp_request_expired,
 	.tx_msgtype		= DHCPREQUEST,
 	.apply_min_timeout	= 0,
+	.timing			= &dhcp_request_time_setting,
 };
 
 /**
@@ -700,6 +875,7 @@ static struct dhcp_session_state dhcp_state_proxy = {
 	.expired		= dhcp_proxy_expired,
 	.tx_msgtype		= DHCPREQUEST,
 	.apply_min_timeout	= 0,
+	.timing			= &dhcp_proxy_time_setting,
 };
 
 /**
@@ -1301,7 +1477,9 @@ __weak void get_cached_dhcpack ( void ) { __keepme }
  * having fetched the appropriate data from cached information.
  */
 int start_dhcp ( struct interface *job, struct net_device *netdev ) {
+	struct settings *settings = netdev_settings ( netdev );
 	struct dhcp_session *dhcp;
+	unsigned long proxy_wait;
 	int rc;
 
 	/* Check for cached DHCP information */
@@ -1327,6 +1505,21 @@ int start_dhcp ( struct interface *job, struct net_device *netdev ) {
 	/* Store DHCP transaction ID for fakedhcp code */
 	dhcp_last_xid = dhcp->xid;
 
+	/* Identify ProxyDHCP wait time and rapid commit policy */
+	if ( fetch_uint_setting ( NULL, &dhcp_proxy_wait_setting,
+				  &proxy_wait ) >= 0 ) {
+		dhcp->proxy_wait = ( ( proxy_wait * TICKS_PER_SEC ) / 1000 );
+	} else {
+		dhcp->proxy_wait = PROXYDHCP_MAX_TIMEOUT;
+	}
+	dhcp->rapid_commit = fetch_uintz_setting ( NULL,
+						  &dhcp_rapid_commit_setting );
+
+	/* Clear any timings recorded by a previous DHCP session */
+	delete_setting ( settings, &dhcp_discover_time_setting );
+	delete_setting ( settings, &dhcp_request_time_setting );
+	delete_setting ( settings, &dhcp_proxy_time_setting );
+
 	/* Instantiate child objects and attach to our interfaces */
 	if ( ( rc = xfer_open_socket ( &dhcp->xfer, SOCK_DGRAM, &dhcp_peer,
 				  ( struct sockaddr * ) &dhcp->local ) ) != 0 )
@@ -25,6 +25,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <stdio.h>
 #include <errno.h>
 #include <byteswap.h>
@@ -34,6 +35,8 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/open.h>
 #include <ipxe/resolv.h>
 #include <ipxe/retry.h>
+#include <ipxe/timer.h>
+#include <ipxe/process.h>
 #include <ipxe/tcpip.h>
 #include <ipxe/settings.h>
 #include <ipxe/features.h>
@@ -63,6 +66,31 @@ static struct sockaddr_tcpip nameserver = {
 /** The local domain */
 static char *localdomain;
 
+/** A DNS cache entry */
+struct dns_cache_entry {
+	/** List of cache entries, most recently used first */
+	struct list_head list;
+	/** Time at which entry was created */
+	unsigned long created;
+	/** Lifetime (in ticks) */
+	unsigned long lifetime;
+	/** Resolved address */
+	struct in_addr address;
+	/** Status code (for a negative cache entry) */
+	int rc;
+	/** Fully-qualified name
+	 *
+	 * Must be at end of structure
+	 */
+	char name[0];
+};
+
+/** DNS cache */
+static LIST_HEAD ( dns_cache );
+
+/** Number of entries in DNS cache */
+static unsigned int dns_cache_count;
+
 /** A DNS request */
 struct dns_request {
 	/** Reference counter */
@@ -86,8 +114,123 @@ struct dns_request {
 	struct dns_query_info *qinfo;
 	/** Recursion counter */
 	unsigned int recursion;
+	/** Minimum TTL (in seconds) of records used in the answer */
+	unsigned long ttl;
+	/** Process (used to report a cached answer) */
+	struct process process;
+	/** Status code of a cached answer */
+	int rc;
+	/** Fully-qualified name being resolved
+	 *
+	 * Must be at end of structure
+	 */
+	char name[0];
 };
 
+/******************************************************************************
+ *
+ * Cache
+ *
+ ******************************************************************************
+ */
+
+/**
+ * Remove DNS cache entry
+ *
+ * @v entry		DNS cache entry
+ */
+static void dns_cache_del ( struct dns_cache_entry *entry ) {
+
+	list_del ( &entry->list );
+	dns_cache_count--;
+	free ( entry );
+}
+
+/**
+ * Find DNS cache entry
+ *
+ * @v name		Fully-qualified name
+ * @ret entry		DNS cache entry, or NULL if not found
+ *
+ * Expired entries are discarded.  A valid entry is moved to the
+ * front of the cache.
+ */
+static struct dns_cache_entry * dns_cache_find ( const char *name ) {
+	struct dns_cache_entry *entry;
+
+	list_for_each_entry ( entry, &dns_cache, list ) {
+		if ( strcasecmp ( entry->name, name ) != 0 )
+			continue;
+		if ( ( currticks() - entry->created ) >= entry->lifetime ) {
+			DBG ( "DNS cache entry for %s expired\n", name );
+			dns_cache_del ( entry );
+			return NULL;
+		}
+		list_del ( &entry->list );
+		list_add ( &entry->list, &dns_cache );
+		return entry;
+	}
+
+	return NULL;
+}
+
+/**
+ * Add DNS cache entry
+ *
+ * @v name		Fully-qualified name
+ * @v address		Resolved address
+ * @v ttl		Time to live (in seconds)
+ * @v rc		Status code (for a negative cache entry)
+ */
+static void dns_cache_add ( const char *name, struct in_addr address,
+			    unsigned long ttl, int rc ) {
+	struct dns_cache_entry *entry;
+	size_t name_len = ( strlen ( name ) + 1 /* NUL */ );
+
+	/* Do not cache records which must not be cached */
+	if ( ! ttl )
+		return;
+	if ( ttl > DNS_CACHE_MAX_TTL )
+		ttl = DNS_CACHE_MAX_TTL;
+
+	/* Remove any existing entry */
+	if ( ( entry = dns_cache_find ( name ) ) != NULL )
+		dns_cache_del ( entry );
+
+	/* Discard least recently used entry if cache is full */
+	if ( dns_cache_count >= DNS_CACHE_MAX_ENTRIES ) {
+		entry = list_last_entry ( &dns_cache, struct dns_cache_entry,
+					  list );
+		dns_cache_del ( entry );
+	}
+
+	/* Allocate and populate entry */
+	entry = zalloc ( sizeof ( *entry ) + name_len );
+	if ( ! entry )
+		return;
+	entry->created = currticks();
+	entry->lifetime = ( ttl * TICKS_PER_SEC );
+	entry->address = address;
+	entry->rc = rc;
+	memcpy ( entry->name, name, name_len );
+	list_add ( &entry->list, &dns_cache );
+	dns_cache_count++;
+	DBG ( "DNS cached %s as %s for %lds\n", name,
+	      ( rc ? strerror ( rc ) : inet_ntoa ( address ) ), ttl );
+}
+
+/**
+ * Flush DNS cache
+ *
+ */
+static void dns_cache_flush ( void ) {
+	struct dns_cache_entry *entry;
+	struct dns_cache_entry *tmp;
+
+	list_for_each_entry_safe ( entry, tmp, &dns_cache, list )
+		dns_cache_del ( entry );
+}
+
 /**
  * Mark DNS request as complete
  *
@@ -96,8 +239,9 @@ struct dns_request {
  */
 static void dns_done ( struct dns_request *dns, int rc ) {
 
-	/* Stop the retry timer */
+	/* Stop the retry timer and any cached answer process */
 	stop_timer ( &dns->timer );
+	process_del ( &dns->process );
 
 	/* Shut down interfaces */
 	intf_shutdown ( &dns->socket, rc );
@@ -346,6 +490,7 @@ static int dns_xfer_deliver ( struct dns_request *dns,
 	const struct dns_header *reply = iobuf->data;
 	union dns_rr_info *rr_info;
 	struct sockaddr_in *sin;
+	struct in_addr no_address = { 0 };
 	unsigned int qtype = dns->qinfo->qtype;
 	int rc;
 
@@ -375,12 +520,27 @@ static int dns_xfer_deliver ( struct dns_request *dns,
 	 */
 	stop_timer ( &dns->timer );
 
+	/* Give up immediately if the name does not exist */
+	if ( DNS_FLAG_RCODE ( ntohs ( reply->flags ) ) == DNS_FLAG_RCODE_NX ) {
+		DBGC ( dns, "DNS %p name does not exist\n", dns );
+		dns_cache_add ( dns->name, no_address, DNS_CACHE_NEGATIVE_TTL,
+				-ENXIO_NO_RECORD );
+		dns_done ( dns, -ENXIO_NO_RECORD );
+		rc = 0;
+		goto done;
+	}
+
 	/* Search through response for useful answers.  Do this
 	 * multiple times, to take advantage of useful nameservers
 	 * which send us e.g. the CNAME *and* the A record for the
 	 * pointed-to name.
 	 */
 	while ( ( rr_info = dns_find_rr ( dns, reply ) ) ) {
+
+		/* Record minimum TTL of records used */
+		if ( dns->ttl > ntohl ( rr_info->common.ttl ) )
+			dns->ttl = ntohl ( rr_info->common.ttl );
+
 		switch ( rr_info->common.type ) {
 
 		case htons ( DNS_TYPE_A ):
@@ -392,6 +552,9 @@ static int dns_xfer_deliver ( struct dns_request *dns,
 			sin->sin_family = AF_INET;
 			sin->sin_addr = rr_info->a.in_addr;
 
+			/* Add to cache */
+			dns_cache_add ( dns->name, sin->sin_addr, dns->ttl, 0 );
+
 			/* Return resolved address */
 			resolv_done ( &dns->resolv, &dns->sa );
 
@@ -453,6 +616,9 @@ static int dns_xfer_deliver ( struct dns_request *dns,
 			goto done;
 		} else {
 			DBGC ( dns, "DNS %p found no CNAME record\n", dns );
+			dns_cache_add ( dns->name, no_address,
+					DNS_CACHE_NEGATIVE_TTL,
+					-ENXIO_NO_RECORD );
 			dns_done ( dns, -ENXIO_NO_RECORD );
 			rc = 0;
 			goto done;
@@ -504,6 +670,22 @@ static struct interface_operation dns_resolv_op[] = {
 static struct interface_descriptor dns_resolv_desc =
 	INTF_DESC ( struct dns_request, resolv, dns_resolv_op );
 
+/**
+ * Report cached DNS answer
+ *
+ * @v dns		DNS request
+ */
+static void dns_cache_step ( struct dns_request *dns ) {
+
+	if ( dns->rc == 0 )
+		resolv_done ( &dns->resolv, &dns->sa );
+	dns_done ( dns, dns->rc );
+}
+
+/** Cached DNS answer process descriptor */
+static struct process_descriptor dns_cache_process_desc =
+	PROC_DESC_ONCE ( struct dns_request, process, dns_cache_step );
+
 /**
  * Resolve name using DNS
  *
@@ -514,7 +696,9 @@ static struct interface_descriptor dns_resolv_desc =
  */
 static int dns_resolv ( struct interface *resolv,
 			const char *name, struct sockaddr *sa ) {
+	struct dns_cache_entry *entry;
 	struct dns_request *dns;
+	struct sockaddr_in *sin;
 	char *fqdn;
 	int rc;
 
@@ -534,7 +718,7 @@ static int dns_resolv ( struct interface *resolv,
 	}
 
 	/* Allocate DNS structure */
-	dns = zalloc ( sizeof ( *dns ) );
+	dns = zalloc ( sizeof ( *dns ) + strlen ( fqdn ) + 1 /* NUL */ );
 	if ( ! dns ) {
 		rc = -ENOMEM;
 		goto err_alloc_dns;
@@ -543,7 +727,23 @@ static int dns_resolv ( struct interface *resolv,
 	intf_init ( &dns->resolv, &dns_resolv_desc, &dns->refcnt );
 	intf_init ( &dns->socket, &dns_socket_desc, &dns->refcnt );
 	timer_init ( &dns->timer, dns_timer_expired, &dns->refcnt );
+	process_init_stopped ( &dns->process, &dns_cache_process_desc,
+			       &dns->refcnt );
 	memcpy ( &dns->sa, sa, sizeof ( dns->sa ) );
+	strcpy ( dns->name, fqdn );
+	dns->ttl = DNS_CACHE_MAX_TTL;
+
+	/* Use cached answer, if available */
+	if ( ( entry = dns_cache_find ( fqdn ) ) != NULL ) {
+		DBGC ( dns, "DNS %p using cached answer for %s\n",
+		       dns, fqdn );
+		sin = ( struct sockaddr_in * ) &dns->sa;
+		sin->sin_family = AF_INET;
+		sin->sin_addr = entry->address;
+		dns->rc = entry->rc;
+		process_add ( &dns->process );
+		goto attach;
+	}
 
 	/* Create query */
 	dns->query.dns.flags = htons ( DNS_FLAG_QUERY | DNS_FLAG_OPCODE_QUERY |
@@ -565,6 +765,7 @@ static int dns_resolv ( struct interface *resolv,
 	/* Send first DNS packet */
 	dns_send_packet ( dns );
 
+ attach:
 	/* Attach parent interface, mortalise self, and return */
 	intf_plug_plug ( &dns->resolv, resolv );
 	ref_put ( &dns->refcnt );
@@ -586,6 +787,25 @@ struct resolver dns_resolver __resolver ( RESOLV_NORMAL ) = {
 	.resolv = dns_resolv,
 };
 
+/**
+ * Invalidate DNS cache entry
+ *
+ * @v name		Name (which will be qualified if necessary)
+ *
+ * The next attempt to resolve the name will send a fresh query.
+ */
+void dns_cache_invalidate ( const char *name ) {
+	struct dns_cache_entry *entry;
+	char *fqdn;
+
+	fqdn = dns_qualify_name ( name );
+	if ( ! fqdn )
+		return;
+	if ( ( entry = dns_cache_find ( fqdn ) ) != NULL )
+		dns_cache_del ( entry );
+	free ( fqdn );
+}
+
 /******************************************************************************
  *
  * Settings
@@ -609,9 +829,11 @@ struct setting dns_setting __setting ( SETTING_IPv4_EXTRA ) = {
 static int apply_dns_settings ( void ) {
 	struct sockaddr_in *sin_nameserver =
 		( struct sockaddr_in * ) &nameserver;
+	struct sockaddr_in old_nameserver;
 	int len;
 
 	/* Fetch DNS server address */
+	memcpy ( &old_nameserver, sin_nameserver, sizeof ( old_nameserver ) );
 	nameserver.st_family = 0;
 	if ( ( len = fetch_ipv4_setting ( NULL, &dns_setting,
 					  &sin_nameserver->sin_addr ) ) >= 0 ){
@@ -620,6 +842,13 @@ static int apply_dns_settings ( void ) {
 		      inet_ntoa ( sin_nameserver->sin_addr ) );
 	}
 
+	/* Flush cache if DNS server has changed */
+	if ( ( sin_nameserver->sin_family != old_nameserver.sin_family ) ||
+	     ( sin_nameserver->sin_addr.s_addr !=
+	       old_nameserver.sin_addr.s_addr ) ) {
+		dns_cache_flush();
+	}
+
 	/* Get local domain DHCP option */
 	free ( localdomain );
 	if ( ( len = fetch_string_setting_copy ( NULL, &domain_setting,
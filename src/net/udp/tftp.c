@@ -81,6 +81,9 @@ FEATURE ( FEATURE_PROTOCOL, "TFTP", DHCP_EB_FEATURE_TFTP, 1 );
 #define EINVAL_MC_INVALID_PORT __einfo_error ( EINFO_EINVAL_MC_INVALID_PORT )
 #define EINFO_EINVAL_MC_INVALID_PORT __einfo_uniqify \
 	( EINFO_EINVAL, 0x07, "Invalid multicast port" )
+#define EINVAL_WINDOWSIZE __einfo_error ( EINFO_EINVAL_WINDOWSIZE )
+#define EINFO_EINVAL_WINDOWSIZE __einfo_uniqify \
+	( EINFO_EINVAL, 0x08, "Invalid windowsize" )
 
 /**
  * A TFTP request
@@ -114,6 +117,21 @@ struct tftp_request {
 	 * "tsize" option, this value will be zero.
 	 */
 	unsigned long tsize;
+	/** Window size
+	 *
+	 * This is the "windowsize" option (RFC 7440) negotiated with
+	 * the TFTP server, i.e. the number of DATA blocks sent by the
+	 * server for each ACK.  If the TFTP server does not support
+	 * the "windowsize" option, this will default to 1.
+	 */
+	unsigned int windowsize;
+	/** First missing block at the time of the most recent ACK
+	 *
+	 * This marks the start of the current window.
+	 */
+	unsigned int window_ack;
+	/** Number of lost blocks or timeouts detected */
+	unsigned int losses;
 	
 	/** Server port
 	 *
@@ -153,7 +171,7 @@ struct tftp_request {
 enum {
 	/** Send ACK packets */
 	TFTP_FL_SEND_ACK = 0x0001,
-	/** Request blksize and tsize options */
+	/** Request blksize, tsize and windowsize options */
 	TFTP_FL_RRQ_SIZES = 0x0002,
 	/** Request multicast option */
 	TFTP_FL_RRQ_MULTICAST = 0x0004,
@@ -220,6 +238,11 @@ static int tftp_reopen ( struct tftp_request *tftp ) {
 	/* Disable ACK sending. */
 	tftp->flags &= ~TFTP_FL_SEND_ACK;
 
+	/* Reset window */
+	tftp->windowsize = TFTP_DEFAULT_WINDOWSIZE;
+	tftp->window_ack = 0;
+	tftp->losses = 0;
+
 	/* Reset peer address */
 	memset ( &tftp->peer, 0, sizeof ( tftp->peer ) );
 
@@ -301,6 +324,9 @@ static int tftp_presize ( struct tftp_request *tftp, size_t filesize ) {
 	return 0;
 }
 
+/** TFTP statistics */
+struct tftp_stats tftp_stats;
+
 /**
  * TFTP requested blocksize
  *
@@ -319,6 +345,29 @@ void tftp_set_request_blksize ( unsigned int blksize ) {
 	tftp_request_blksize = blksize;
 }
 
+/**
+ * TFTP requested window size
+ *
+ * This is treated as a global configuration parameter.  It is
+ * adapted according to the outcome of each windowed transfer:
+ * halved whenever a transfer experiences loss, and doubled (up to
+ * TFTP_MAX_WINDOWSIZE) whenever a full window completes cleanly.
+ */
+static unsigned int tftp_request_windowsize = TFTP_INITIAL_WINDOWSIZE;
+
+/**
+ * Set TFTP request window size
+ *
+ * @v windowsize	Requested window size
+ */
+void tftp_set_request_windowsize ( unsigned int windowsize ) {
+	if ( windowsize < TFTP_DEFAULT_WINDOWSIZE )
+		windowsize = TFTP_DEFAULT_WINDOWSIZE;
+	if ( windowsize > TFTP_MAX_WINDOWSIZE )
+		windowsize = TFTP_MAX_WINDOWSIZE;
+	tftp_request_windowsize = windowsize;
+}
+
 /**
  * MTFTP multicast receive address
  *
@@ -379,6 +428,7 @@ static int tftp_send_rrq ( struct tftp_request *tftp ) {
 		+ 5 + 1 /* "octet" + NUL */
 		+ 7 + 1 + 5 + 1 /* "blksize" + NUL + ddddd + NUL */
 		+ 5 + 1 + 1 + 1 /* "tsize" + NUL + "0" + NUL */ 
+		+ 10 + 1 + 5 + 1 /* "windowsize" + NUL + ddddd + NUL */
 		+ 9 + 1 + 1 /* "multicast" + NUL + NUL */ );
 	iobuf = xfer_alloc_iob ( &tftp->socket, len );
 	if ( ! iobuf )
@@ -394,6 +444,13 @@ static int tftp_send_rrq ( struct tftp_request *tftp ) {
 					    iob_tailroom ( iobuf ),
 					    "blksize%c%d%ctsize%c0", 0,
 					    tftp_request_blksize, 0, 0 ) + 1 );
+		if ( tftp_request_windowsize > TFTP_DEFAULT_WINDOWSIZE ) {
+			iob_put ( iobuf, snprintf ( iobuf->tail,
+						    iob_tailroom ( iobuf ),
+						    "windowsize%c%d", 0,
+						    tftp_request_windowsize )
+				  + 1 );
+		}
 	}
 	if ( tftp->flags & TFTP_FL_RRQ_MULTICAST ) {
 		iob_put ( iobuf, snprintf ( iobuf->tail,
@@ -425,6 +482,9 @@ static int tftp_send_ack ( struct tftp_request *tftp ) {
 	block = bitmap_first_gap ( &tftp->bitmap );
 	DBGC2 ( tftp, "TFTP %p sending ACK for block %d\n", tftp, block );
 
+	/* Record start of next window */
+	tftp->window_ack = block;
+
 	/* Allocate buffer */
 	iobuf = xfer_alloc_iob ( &tftp->socket, sizeof ( *ack ) );
 	if ( ! iobuf )
@@ -506,6 +566,29 @@ static int tftp_send_packet ( struct tftp_request *tftp ) {
 	}
 }
 
+/**
+ * Record loss within a windowed transfer
+ *
+ * @v tftp		TFTP connection
+ *
+ * The window size requested for subsequent transfers is halved upon
+ * the first loss detected within a transfer.
+ */
+static void tftp_window_loss ( struct tftp_request *tftp ) {
+
+	/* Do nothing unless a window has been negotiated */
+	if ( tftp->windowsize <= TFTP_DEFAULT_WINDOWSIZE )
+		return;
+
+	/* Shrink requested window size on first loss */
+	tftp_stats.losses++;
+	if ( tftp->losses++ == 0 ) {
+		tftp_set_request_windowsize ( tftp->windowsize / 2 );
+		DBGC ( tftp, "TFTP %p detected loss; requested windowsize "
+		       "reduced to %d\n", tftp, tftp_request_windowsize );
+	}
+}
+
 /**
  * Handle TFTP retransmission timer expiry
  *
@@ -564,7 +647,10 @@ static void tftp_timer_expired ( struct retry_timer *timer, int fail ) {
 			rc = -ETIMEDOUT;
 			goto err;
 		}
+		/* Treat timeout during a windowed transfer as loss */
+		tftp_window_loss ( tftp );
 	}
+	tftp_stats.retransmits++;
 	tftp_send_packet ( tftp );
 	return;
 
@@ -616,6 +702,28 @@ static int tftp_process_tsize ( struct tftp_request *tftp,
 	return 0;
 }
 
+/**
+ * Process TFTP "windowsize" option
+ *
+ * @v tftp		TFTP connection
+ * @v value		Option value
+ * @ret rc		Return status code
+ */
+static int tftp_process_windowsize ( struct tftp_request *tftp,
+				     const char *value ) {
+	char *end;
+
+	tftp->windowsize = strtoul ( value, &end, 10 );
+	if ( *end || ( tftp->windowsize == 0 ) ) {
+		DBGC ( tftp, "TFTP %p got invalid windowsize \"%s\"\n",
+		       tftp, value );
+		return -EINVAL_WINDOWSIZE;
+	}
+	DBGC ( tftp, "TFTP %p windowsize=%d\n", tftp, tftp->windowsize );
+
+	return 0;
+}
+
 /**
  * Process TFTP "multicast" option
  *
@@ -703,6 +811,7 @@ struct tftp_option {
 static struct tftp_option tftp_options[] = {
 	{ "blksize", tftp_process_blksize },
 	{ "tsize", tftp_process_tsize },
+	{ "windowsize", tftp_process_windowsize },
 	{ "multicast", tftp_process_multicast },
 	{ NULL, NULL }
 };
@@ -814,6 +923,68 @@ static int tftp_rx_oack ( struct tftp_request *tftp, void *buf, size_t len ) {
 	return rc;
 }
 
+/**
+ * Acknowledge received DATA block, if applicable
+ *
+ * @v tftp		TFTP connection
+ * @v block		Index of received block
+ *
+ * When a window size greater than one has been negotiated, the
+ * server sends a full window of blocks for each ACK.  We send an ACK
+ * only when the window is complete, when the final block has been
+ * received, when a gap is detected (in which case the ACK identifies
+ * the first missing block, causing the server to resume from that
+ * point), or when the last block of the previous window is received
+ * again (indicating that our ACK was lost).
+ */
+static void tftp_ack_window ( struct tftp_request *tftp,
+			      unsigned int block ) {
+	unsigned int next = bitmap_first_gap ( &tftp->bitmap );
+
+	/* Acknowledge every block unless a window is in use */
+	if ( tftp->windowsize <= TFTP_DEFAULT_WINDOWSIZE ) {
+		tftp_send_packet ( tftp );
+		return;
+	}
+
+	if ( block > next ) {
+		/* Gap detected: acknowledge once per gap */
+		if ( next != tftp->window_ack ) {
+			DBGC ( tftp, "TFTP %p missing block %d\n", tftp, next );
+			tftp_window_loss ( tftp );
+			tftp_send_packet ( tftp );
+		}
+	} else if ( ( next >= ( tftp->window_ack + tftp->windowsize ) ) ||
+		    ( ( block + 1 ) == tftp->window_ack ) ||
+		    bitmap_full ( &tftp->bitmap ) ) {
+		/* Window complete (or previous ACK lost) */
+		tftp_send_packet ( tftp );
+	} else {
+		/* Window in progress: restart retransmission timer */
+		stop_timer ( &tftp->timer );
+		start_timer ( &tftp->timer );
+	}
+}
+
+/**
+ * Complete windowed transfer
+ *
+ * @v tftp		TFTP connection
+ *
+ * The window size requested for subsequent transfers is doubled if
+ * the negotiated window was used without any loss.
+ */
+static void tftp_window_done ( struct tftp_request *tftp ) {
+
+	if ( ( tftp->windowsize > TFTP_DEFAULT_WINDOWSIZE ) &&
+	     ( tftp->losses == 0 ) &&
+	     ( tftp->windowsize >= tftp_request_windowsize ) ) {
+		tftp_set_request_windowsize ( tftp->windowsize * 2 );
+		DBGC ( tftp, "TFTP %p requested windowsize increased to %d\n",
+		       tftp, tftp_request_windowsize );
+	}
+}
+
 /**
  * Receive DATA
  *
@@ -827,6 +998,7 @@ static int tftp_rx_data ( struct tftp_request *tftp,
 			  struct io_buffer *iobuf ) {
 	struct tftp_data *data = iobuf->data;
 	struct xfer_metadata meta;
+	long abs_block;
 	unsigned int block;
 	off_t offset;
 	size_t data_len;
@@ -848,13 +1020,15 @@ static int tftp_rx_data ( struct tftp_request *tftp,
 	}
 
 	/* Calculate block number */
-	block = ( ( bitmap_first_gap ( &tftp->bitmap ) + 1 ) & ~0xffff );
-	if ( data->block == 0 && block == 0 ) {
-		DBGC ( tftp, "TFTP %p received data block 0\n", tftp );
+	abs_block = tftp_block ( bitmap_first_gap ( &tftp->bitmap ),
+				 ntohs ( data->block ) );
+	if ( abs_block < 0 ) {
+		DBGC ( tftp, "TFTP %p received invalid data block %d\n",
+		       tftp, ntohs ( data->block ) );
 		rc = -EINVAL;
 		goto done;
 	}
-	block += ( ntohs ( data->block ) - 1 );
+	block = abs_block;
 
 	/* Extract data */
 	offset = ( block * tftp->blksize );
@@ -885,12 +1059,14 @@ static int tftp_rx_data ( struct tftp_request *tftp,
 	/* Mark block as received */
 	bitmap_set ( &tftp->bitmap, block );
 
-	/* Acknowledge block */
-	tftp_send_packet ( tftp );
+	/* Acknowledge block, if applicable */
+	tftp_ack_window ( tftp, block );
 
 	/* If all blocks have been received, finish. */
-	if ( bitmap_full ( &tftp->bitmap ) )
+	if ( bitmap_full ( &tftp->bitmap ) ) {
+		tftp_window_done ( tftp );
 		tftp_done ( tftp, 0 );
+	}
 
  done:
 	free_iob ( iobuf );
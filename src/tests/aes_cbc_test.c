@@ -115,6 +115,10 @@ struct aes_cbc_test {
 	cbc_decrypt_ok ( cipher, (test)->key, (test)->key_len,		\
 			 (test)->iv, (test)->ciphertext,		\
 			 (test)->plaintext, (test)->ciphertext_len );	\
+	cbc_decrypt_ok ( cipher, (test)->key, (test)->key_len,		\
+			 (test)->iv, (test)->ciphertext,		\
+			 (test)->plaintext,				\
+			 ( (test)->ciphertext_len - cipher->blocksize ) );\
 	} while ( 0 )
 
 /** CBC_AES128 */
@@ -165,10 +169,12 @@ AES_CBC_TEST ( test_256,
 		     0xda, 0x6c, 0x19, 0x07, 0x8c, 0x6a, 0x9d, 0x1b ) );
 
 /**
- * Perform AES-in-CBC-mode self-test
+ * Perform AES-in-CBC-mode self-test using the currently selected
+ * implementation
  *
+ * @v impl		Implementation name
  */
-static void aes_cbc_test_exec ( void ) {
+static void aes_cbc_test_impl ( const char *impl ) {
 	struct cipher_algorithm *cipher = &aes_cbc_algorithm;
 
 	/* Correctness tests */
@@ -176,14 +182,24 @@ static void aes_cbc_test_exec ( void ) {
 	aes_cbc_ok ( &test_256 );
 
 	/* Speed tests */
-	DBG ( "AES128 encryption required %ld cycles per byte\n",
-	      cbc_cost_encrypt ( cipher, test_128.key_len ) );
-	DBG ( "AES128 decryption required %ld cycles per byte\n",
-	      cbc_cost_decrypt ( cipher, test_128.key_len ) );
-	DBG ( "AES256 encryption required %ld cycles per byte\n",
-	      cbc_cost_encrypt ( cipher, test_256.key_len ) );
-	DBG ( "AES256 decryption required %ld cycles per byte\n",
-	      cbc_cost_decrypt ( cipher, test_256.key_len ) );
+	DBG ( "AES128 (%s) encryption required %ld cycles per byte\n",
+	      impl, cbc_cost_encrypt ( cipher, test_128.key_len ) );
+	DBG ( "AES128 (%s) decryption required %ld cycles per byte\n",
+	      impl, cbc_cost_decrypt ( cipher, test_128.key_len ) );
+	DBG ( "AES256 (%s) encryption required %ld cycles per byte\n",
+	      impl, cbc_cost_encrypt ( cipher, test_256.key_len ) );
+	DBG ( "AES256 (%s) decryption required %ld cycles per byte\n",
+	      impl, cbc_cost_decrypt ( cipher, test_256.key_len ) );
+}
+
+/**
+ * Perform AES-in-CBC-mode self-test
+ *
+ */
+static void aes_cbc_test_exec ( void ) {
+
+	/* Test generic and accelerated implementations */
+	accel_test ( aes_accel, NULL, aes_cbc_test_impl );
 }
 
 /** AES-in-CBC-mode self-test */
@@ -0,0 +1,123 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+/** @file
+ *
+ * Block cache self-tests
+ *
+ */
+
+/* Forcibly enable assertions */
+#undef NDEBUG
+
+#include <string.h>
+#include <ipxe/blockcache.h>
+#include <ipxe/test.h>
+
+/** Block size used for tests */
+#define BLOCKCACHE_TEST_BLKSIZE 512
+
+/** Number of blocks used for tests */
+#define BLOCKCACHE_TEST_COUNT 20
+
+/** Cache size used for tests */
+#define BLOCKCACHE_TEST_CACHE_LEN ( 256 * 1024 )
+
+/** Test data */
+static uint8_t blockcache_data[ BLOCKCACHE_TEST_COUNT *
+				BLOCKCACHE_TEST_BLKSIZE ];
+
+/** Test read buffer */
+static uint8_t blockcache_buf[ BLOCKCACHE_TEST_COUNT *
+			       BLOCKCACHE_TEST_BLKSIZE ];
+
+/** Test cache */
+static struct block_cache blockcache_test_cache;
+
+/**
+ * Perform block cache self-tests
+ *
+ */
+static void blockcache_test_exec ( void ) {
+	struct block_cache *cache = &blockcache_test_cache;
+	unsigned int i;
+
+	/* Construct test data */
+	for ( i = 0 ; i < sizeof ( blockcache_data ) ; i++ )
+		blockcache_data[i] = ( i ^ ( i / BLOCKCACHE_TEST_BLKSIZE ) );
+
+	/* Initialise cache */
+	ok ( block_cache_init ( cache, BLOCKCACHE_TEST_BLKSIZE,
+				BLOCKCACHE_TEST_CACHE_LEN ) == 0 );
+	ok ( cache->stats.size > 0 );
+
+	/* Empty cache should miss everything */
+	ok ( block_cache_read ( cache, 5, BLOCKCACHE_TEST_COUNT,
+				virt_to_user ( blockcache_buf ) ) == 0 );
+	ok ( block_cache_missing ( cache, 5, BLOCKCACHE_TEST_COUNT ) ==
+	     BLOCKCACHE_TEST_COUNT );
+
+	/* Insert unaligned run spanning several lines and read it back */
+	block_cache_insert ( cache, 5, BLOCKCACHE_TEST_COUNT,
+			     virt_to_user ( blockcache_data ) );
+	memset ( blockcache_buf, 0, sizeof ( blockcache_buf ) );
+	ok ( block_cache_read ( cache, 5, BLOCKCACHE_TEST_COUNT,
+				virt_to_user ( blockcache_buf ) ) ==
+	     BLOCKCACHE_TEST_COUNT );
+	ok ( memcmp ( blockcache_buf, blockcache_data,
+		      sizeof ( blockcache_buf ) ) == 0 );
+	ok ( cache->stats.hits == BLOCKCACHE_TEST_COUNT );
+
+	/* Reads must stop at the first uncached block */
+	ok ( block_cache_read ( cache, 20, 10,
+				virt_to_user ( blockcache_buf ) ) == 5 );
+	ok ( block_cache_missing ( cache, 25, 10 ) == 10 );
+	ok ( block_cache_missing ( cache, 0, 10 ) == 5 );
+
+	/* Invalidation must split a cached run */
+	block_cache_invalidate ( cache, 10, 2 );
+	ok ( block_cache_read ( cache, 5, BLOCKCACHE_TEST_COUNT,
+				virt_to_user ( blockcache_buf ) ) == 5 );
+	ok ( block_cache_missing ( cache, 10, 10 ) == 2 );
+	ok ( block_cache_read ( cache, 12, 3,
+				virt_to_user ( blockcache_buf ) ) == 3 );
+	ok ( memcmp ( blockcache_buf,
+		      &blockcache_data[ 7 * BLOCKCACHE_TEST_BLKSIZE ],
+		      ( 3 * BLOCKCACHE_TEST_BLKSIZE ) ) == 0 );
+
+	/* Writes must update cached data */
+	block_cache_write ( cache, 12, 1,
+			    virt_to_user ( &blockcache_data[0] ) );
+	ok ( block_cache_read ( cache, 12, 1,
+				virt_to_user ( blockcache_buf ) ) == 1 );
+	ok ( memcmp ( blockcache_buf, blockcache_data,
+		      BLOCKCACHE_TEST_BLKSIZE ) == 0 );
+	ok ( cache->stats.writes == 1 );
+
+	/* Free cache */
+	block_cache_fini ( cache );
+	ok ( block_cache_read ( cache, 5, 1,
+				virt_to_user ( blockcache_buf ) ) == 0 );
+}
+
+/** Block cache self-test */
+struct self_test blockcache_test __self_test = {
+	.name = "blockcache",
+	.exec = blockcache_test_exec,
+};
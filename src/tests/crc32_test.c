@@ -35,8 +35,11 @@ FILE_LICENCE ( GPL2_OR_LATER );
 /* Forcibly enable assertions */
 #undef NDEBUG
 
+#include <stddef.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <ipxe/crc32.h>
+#include <ipxe/profile.h>
 #include <ipxe/test.h>
 
 /** Define inline data */
@@ -96,17 +99,92 @@ CRC32_TEST ( hw_split_part1_test,
 CRC32_TEST ( hw_split_part2_test,
 	     DATA ( ' ', 'w', 'o', 'r', 'l', 'd' ),
 	     0xc9ef5979UL, 0xf2b5ee7aUL );
+CRC32_TEST ( check_test,
+	     DATA ( '1', '2', '3', '4', '5', '6', '7', '8', '9' ),
+	     0xffffffffUL, 0x340bc6d9UL );
+CRC32_TEST ( seq_test,
+	     DATA ( 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09,
+		    0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10, 0x11, 0x12, 0x13,
+		    0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d,
+		    0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27,
+		    0x28, 0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30, 0x31,
+		    0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b,
+		    0x3c, 0x3d, 0x3e, 0x3f, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45,
+		    0x46, 0x47, 0x48, 0x49, 0x4a, 0x4b, 0x4c, 0x4d, 0x4e, 0x4f,
+		    0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59,
+		    0x5a, 0x5b, 0x5c, 0x5d, 0x5e, 0x5f, 0x60, 0x61, 0x62, 0x63,
+		    0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x6b, 0x6c, 0x6d,
+		    0x6e, 0x6f, 0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77,
+		    0x78, 0x79, 0x7a, 0x7b, 0x7c, 0x7d, 0x7e, 0x7f ),
+	     0xffffffffUL, 0xdb9af2a8UL );
+CRC32_TEST ( odd_test,
+	     DATA ( 0x0b, 0x30, 0x55, 0x7a, 0x9f, 0xc4, 0xe9, 0x0e, 0x33, 0x58,
+		    0x7d, 0xa2, 0xc7, 0xec, 0x11, 0x36, 0x5b, 0x80, 0xa5, 0xca,
+		    0xef, 0x14, 0x39, 0x5e, 0x83, 0xa8, 0xcd, 0xf2, 0x17, 0x3c,
+		    0x61, 0x86, 0xab, 0xd0, 0xf5, 0x1a, 0x3f, 0x64, 0x89, 0xae,
+		    0xd3, 0xf8, 0x1d, 0x42, 0x67, 0x8c, 0xb1, 0xd6, 0xfb, 0x20,
+		    0x45, 0x6a, 0x8f, 0xb4, 0xd9, 0xfe, 0x23, 0x48, 0x6d, 0x92,
+		    0xb7, 0xdc, 0x01, 0x26, 0x4b, 0x70, 0x95, 0xba, 0xdf, 0x04,
+		    0x29, 0x4e, 0x73, 0x98, 0xbd, 0xe2, 0x07 ),
+	     0x12345678UL, 0xd17473b5UL );
 
 /**
- * Perform CRC32 self-tests
+ * Calculate CRC32 cost
  *
+ * @ret cost		Cost (in cycles per byte)
  */
-static void crc32_test_exec ( void ) {
+static unsigned long crc32_cost ( void ) {
+	static uint8_t random[8192]; /* Too large for stack */
+	union profiler profiler;
+	unsigned long long elapsed;
+	unsigned long cost;
+	unsigned int i;
+
+	/* Fill buffer with pseudo-random data */
+	srand ( 0x1234568 );
+	for ( i = 0 ; i < sizeof ( random ) ; i++ )
+		random[i] = rand();
+
+	/* Time CRC calculation */
+	profile ( &profiler );
+	crc32_le ( ~( ( uint32_t ) 0 ), random, sizeof ( random ) );
+	elapsed = profile ( &profiler );
+
+	/* Round to nearest whole number of cycles per byte */
+	cost = ( ( elapsed + ( sizeof ( random ) / 2 ) ) / sizeof ( random ) );
+
+	return cost;
+}
+
+/**
+ * Perform CRC32 self-tests using the currently selected implementation
+ *
+ * @v impl		Implementation name
+ */
+static void crc32_test_impl ( const char *impl ) {
 
+	/* Correctness tests */
 	crc32_ok ( &empty_test );
 	crc32_ok ( &hw_test );
 	crc32_ok ( &hw_split_part1_test );
 	crc32_ok ( &hw_split_part2_test );
+	crc32_ok ( &check_test );
+	crc32_ok ( &seq_test );
+	crc32_ok ( &odd_test );
+
+	/* Speed test */
+	DBG ( "CRC32 (%s) required %ld cycles per byte\n",
+	      impl, crc32_cost() );
+}
+
+/**
+ * Perform CRC32 self-tests
+ *
+ */
+static void crc32_test_exec ( void ) {
+
+	/* Test generic and accelerated implementations */
+	accel_test ( crc32_le_accel, NULL, crc32_test_impl );
 }
 
 /** CRC32 self-test */
@@ -0,0 +1,355 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+/** @file
+ *
+ * HTTP content encoding self-tests
+ *
+ * Each test fetch is answered by a scripted server, which is inserted
+ * between the HTTP client and its socket via the HTTP socket filter.
+ *
+ */
+
+/* Forcibly enable assertions */
+#undef NDEBUG
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <ipxe/iobuf.h>
+#include <ipxe/xfer.h>
+#include <ipxe/interface.h>
+#include <ipxe/process.h>
+#include <ipxe/uri.h>
+#include <ipxe/http.h>
+#include <ipxe/decompress.h>
+#include <ipxe/test.h>
+
+/** Maximum number of scheduler steps to wait for each event */
+#define HTTP_TEST_MAX_STEPS 1000
+
+/** Decompressed test content */
+static const char http_test_plain[] =
+	"This initrd must arrive exactly as stored.\n";
+
+/** gzip-compressed test content */
+static const uint8_t http_test_gzip[] = {
+	0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x02, 0x03, 0x0b, 0xc9, 0xc8, 0x2c, 0x56, 0xc8,
+	0xcc, 0xcb, 0x2c, 0x29, 0x4a, 0x51, 0xc8, 0x2d,
+	0x2d, 0x2e, 0x51, 0x48, 0x2c, 0x2a, 0xca, 0x2c,
+	0x4b, 0x55, 0x48, 0xad, 0x48, 0x4c, 0x2e, 0xc9,
+	0xa9, 0x54, 0x48, 0x2c, 0x56, 0x28, 0x2e, 0xc9,
+	0x2f, 0x4a, 0x4d, 0xd1, 0xe3, 0x02, 0x00, 0x39,
+	0xb1, 0xd0, 0x58, 0x2b, 0x00, 0x00, 0x00,
+};
+
+/** A scripted HTTP server */
+struct http_test_server {
+	/** Connection to HTTP client */
+	struct interface client;
+	/** Connection to underlying socket (unused) */
+	struct interface socket;
+	/** Received request */
+	char request[512];
+	/** Length of received request */
+	size_t len;
+};
+
+/** A downloaded file */
+struct http_test_file {
+	/** Data transfer interface */
+	struct interface xfer;
+	/** Received data */
+	uint8_t data[256];
+	/** Current position */
+	size_t pos;
+	/** Length of received data */
+	size_t len;
+	/** Download has completed */
+	int done;
+	/** Download completion status */
+	int rc;
+};
+
+/** Test server */
+static struct http_test_server http_test_server;
+
+/** Test file */
+static struct http_test_file http_test_file;
+
+/**
+ * Close scripted server
+ *
+ * @v server		Scripted server
+ * @v rc		Reason for close
+ */
+static void http_test_server_close ( struct http_test_server *server,
+				     int rc ) {
+	intf_restart ( &server->client, rc );
+	intf_restart ( &server->socket, rc );
+}
+
+/**
+ * Check scripted server flow control window
+ *
+ * @v server		Scripted server
+ * @ret len		Length of window
+ */
+static size_t http_test_server_window ( struct http_test_server *server ) {
+	return ( sizeof ( server->request ) - 1 - server->len );
+}
+
+/**
+ * Receive request at scripted server
+ *
+ * @v server		Scripted server
+ * @v iobuf		I/O buffer
+ * @v meta		Data transfer metadata
+ * @ret rc		Return status code
+ */
+static int http_test_server_deliver ( struct http_test_server *server,
+				      struct io_buffer *iobuf,
+				      struct xfer_metadata *meta __unused ) {
+	size_t len = iob_len ( iobuf );
+
+	ok ( len <= http_test_server_window ( server ) );
+	if ( len > http_test_server_window ( server ) )
+		len = http_test_server_window ( server );
+	memcpy ( ( server->request + server->len ), iobuf->data, len );
+	server->len += len;
+	free_iob ( iobuf );
+	return 0;
+}
+
+/** Scripted server client interface operations */
+static struct interface_operation http_test_client_op[] = {
+	INTF_OP ( xfer_deliver, struct http_test_server *,
+		  http_test_server_deliver ),
+	INTF_OP ( xfer_window, struct http_test_server *,
+		  http_test_server_window ),
+	INTF_OP ( intf_close, struct http_test_server *,
+		  http_test_server_close ),
+};
+
+/** Scripted server client interface descriptor */
+static struct interface_descriptor http_test_client_desc =
+	INTF_DESC ( struct http_test_server, client, http_test_client_op );
+
+/** Scripted server socket interface operations */
+static struct interface_operation http_test_socket_op[] = {
+	INTF_OP ( intf_close, struct http_test_server *,
+		  http_test_server_close ),
+};
+
+/** Scripted server socket interface descriptor */
+static struct interface_descriptor http_test_socket_desc =
+	INTF_DESC ( struct http_test_server, socket, http_test_socket_op );
+
+/**
+ * Insert scripted server in front of HTTP socket
+ *
+ * @v xfer		HTTP socket interface
+ * @v name		Server name
+ * @v next		Interface to be opened as underlying socket
+ * @ret rc		Return status code
+ */
+static int http_test_filter ( struct interface *xfer,
+			      const char *name __unused,
+			      struct interface **next ) {
+	struct http_test_server *server = &http_test_server;
+
+	intf_plug_plug ( &server->client, xfer );
+	*next = &server->socket;
+	return 0;
+}
+
+/**
+ * Check downloaded file flow control window
+ *
+ * @v file		Downloaded file
+ * @ret len		Length of window
+ */
+static size_t http_test_file_window ( struct http_test_file *file ) {
+	return sizeof ( file->data );
+}
+
+/**
+ * Receive data for downloaded file
+ *
+ * @v file		Downloaded file
+ * @v iobuf		I/O buffer
+ * @v meta		Data transfer metadata
+ * @ret rc		Return status code
+ */
+static int http_test_file_deliver ( struct http_test_file *file,
+				    struct io_buffer *iobuf,
+				    struct xfer_metadata *meta ) {
+	size_t len = iob_len ( iobuf );
+
+	if ( meta->flags & XFER_FL_ABS_OFFSET )
+		file->pos = 0;
+	file->pos += meta->offset;
+	if ( len ) {
+		ok ( ( file->pos + len ) <= sizeof ( file->data ) );
+		if ( ( file->pos + len ) <= sizeof ( file->data ) ) {
+			memcpy ( ( file->data + file->pos ), iobuf->data,
+				 len );
+		}
+		file->pos += len;
+		if ( file->len < file->pos )
+			file->len = file->pos;
+	}
+	free_iob ( iobuf );
+	return 0;
+}
+
+/**
+ * Complete downloaded file
+ *
+ * @v file		Downloaded file
+ * @v rc		Reason for close
+ */
+static void http_test_file_close ( struct http_test_file *file, int rc ) {
+	intf_restart ( &file->xfer, rc );
+	file->done = 1;
+	file->rc = rc;
+}
+
+/** Downloaded file interface operations */
+static struct interface_operation http_test_file_op[] = {
+	INTF_OP ( xfer_deliver, struct http_test_file *,
+		  http_test_file_deliver ),
+	INTF_OP ( xfer_window, struct http_test_file *,
+		  http_test_file_window ),
+	INTF_OP ( intf_close, struct http_test_file *,
+		  http_test_file_close ),
+};
+
+/** Downloaded file interface descriptor */
+static struct interface_descriptor http_test_file_desc =
+	INTF_DESC ( struct http_test_file, xfer, http_test_file_op );
+
+/**
+ * Fetch gzip-labelled test file
+ *
+ * @v decompress	Ask for downloaded data to be decompressed
+ */
+static void http_test_fetch ( int decompress ) {
+	struct http_test_server *server = &http_test_server;
+	struct http_test_file *file = &http_test_file;
+	struct content_encoding *encoding;
+	struct interface *xfer;
+	struct uri *uri;
+	char header[128];
+	unsigned int i;
+
+	/* Initialise server and file */
+	memset ( server, 0, sizeof ( *server ) );
+	intf_init ( &server->client, &http_test_client_desc, NULL );
+	intf_init ( &server->socket, &http_test_socket_desc, NULL );
+	memset ( file, 0, sizeof ( *file ) );
+	intf_init ( &file->xfer, &http_test_file_desc, NULL );
+
+	/* Add decompressor, if applicable */
+	xfer = &file->xfer;
+	if ( decompress ) {
+		encoding = find_content_encoding ( "gzip" );
+		ok ( encoding != NULL );
+		if ( ! encoding )
+			return;
+		ok ( encoding->add ( &file->xfer, &xfer ) == 0 );
+	}
+
+	/* Open HTTP request */
+	uri = parse_uri ( "http://192.168.0.1/initrd.gz" );
+	ok ( uri != NULL );
+	if ( ! uri )
+		goto done;
+	ok ( http_open_filter ( xfer, uri, HTTP_PORT,
+				http_test_filter ) == 0 );
+	uri_put ( uri );
+
+	/* Wait for request */
+	for ( i = 0 ; ( ( i < HTTP_TEST_MAX_STEPS ) &&
+			( ! strstr ( server->request, "\r\n\r\n" ) ) ) ; i++ ) {
+		step();
+	}
+	ok ( strstr ( server->request, "\r\n\r\n" ) != NULL );
+
+	/* Send gzip-labelled response, as a typical server would for
+	 * a static compressed file regardless of Accept-Encoding.
+	 */
+	snprintf ( header, sizeof ( header ),
+		   "HTTP/1.1 200 OK\r\n"
+		   "Content-Length: %zd\r\n"
+		   "Content-Encoding: gzip\r\n"
+		   "Connection: close\r\n\r\n", sizeof ( http_test_gzip ) );
+	ok ( xfer_deliver_raw ( &server->client, header,
+				strlen ( header ) ) == 0 );
+	ok ( xfer_deliver_raw ( &server->client, http_test_gzip,
+				sizeof ( http_test_gzip ) ) == 0 );
+
+	/* Wait for download to complete */
+	for ( i = 0 ; ( ( i < HTTP_TEST_MAX_STEPS ) && ( ! file->done ) ) ;
+	      i++ ) {
+		step();
+	}
+	ok ( file->done );
+	ok ( file->rc == 0 );
+
+ done:
+	http_test_server_close ( server, 0 );
+	intf_restart ( &file->xfer, 0 );
+}
+
+/**
+ * Perform HTTP self-tests
+ *
+ */
+static void http_test_exec ( void ) {
+	struct http_test_server *server = &http_test_server;
+	struct http_test_file *file = &http_test_file;
+
+	/* Plain fetch: gzip-labelled content must be delivered
+	 * byte-for-byte as stored, without asking for compression.
+	 */
+	http_test_fetch ( 0 );
+	ok ( strstr ( server->request, "GET /initrd.gz " ) != NULL );
+	ok ( strstr ( server->request, "Accept-Encoding" ) == NULL );
+	ok ( file->len == sizeof ( http_test_gzip ) );
+	ok ( memcmp ( file->data, http_test_gzip,
+		      sizeof ( http_test_gzip ) ) == 0 );
+
+	/* Fetch with decompression explicitly requested */
+	if ( find_content_encoding ( "gzip" ) ) {
+		http_test_fetch ( 1 );
+		ok ( strstr ( server->request,
+			      "Accept-Encoding: gzip\r\n" ) != NULL );
+		ok ( file->len == strlen ( http_test_plain ) );
+		ok ( memcmp ( file->data, http_test_plain,
+			      strlen ( http_test_plain ) ) == 0 );
+	}
+}
+
+/** HTTP self-test */
+struct self_test http_test __self_test = {
+	.name = "http",
+	.exec = http_test_exec,
+};
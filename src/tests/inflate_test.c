@@ -0,0 +1,399 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+/** @file
+ *
+ * DEFLATE decompression self-tests
+ *
+ * Test vectors generated using Python's zlib and gzip modules.
+ *
+ */
+
+/* Forcibly enable assertions */
+#undef NDEBUG
+
+#include <stdint.h>
+#include <string.h>
+#include <ipxe/inflate.h>
+#include <ipxe/test.h>
+
+/** Define inline data */
+#define DATA(...) { __VA_ARGS__ }
+
+/** A DEFLATE decompression test */
+struct inflate_test {
+	/** Data format */
+	enum inflate_format format;
+	/** Compressed data */
+	const void *compressed;
+	/** Length of compressed data */
+	size_t compressed_len;
+	/** Expected decompressed data */
+	const void *expected;
+	/** Length of expected decompressed data */
+	size_t expected_len;
+};
+
+/**
+ * Define a DEFLATE decompression test
+ *
+ * @v name		Test name
+ * @v FORMAT		Data format
+ * @v COMPRESSED	Compressed data
+ * @v EXPECTED		Expected decompressed data
+ * @v EXPECTED_LEN	Length of expected decompressed data
+ * @ret test		DEFLATE decompression test
+ */
+#define INFLATE_TEST( name, FORMAT, COMPRESSED, EXPECTED, EXPECTED_LEN ) \
+	static const uint8_t name ## _compressed[] = COMPRESSED;	\
+	static struct inflate_test name = {				\
+		.format = FORMAT,					\
+		.compressed = name ## _compressed,			\
+		.compressed_len = sizeof ( name ## _compressed ),	\
+		.expected = EXPECTED,					\
+		.expected_len = EXPECTED_LEN,				\
+	};
+
+/** A DEFLATE decompression test in progress */
+struct inflate_test_context {
+	/** Decompressor */
+	struct inflate inflate;
+	/** Test */
+	struct inflate_test *test;
+	/** Length of data delivered so far */
+	size_t len;
+	/** Delivered data did not match expected data */
+	int mismatch;
+};
+
+/** Short test text */
+#define HELLO "Hello from the iPXE inflate self-test!\n"
+
+/** Short test text repeated four times */
+static const char hello4[] = HELLO HELLO HELLO HELLO;
+
+/** Short test text repeated five times */
+static const char hello5[] = HELLO HELLO HELLO HELLO HELLO;
+
+/** Length of generated test data */
+#define GENERATED_LEN 70000
+
+/** Generated test data (larger than the sliding window) */
+static uint8_t generated[GENERATED_LEN];
+
+/* gzip format, fixed Huffman codes, with original file name */
+INFLATE_TEST ( gzip_fixed, INFLATE_GZIP,
+	       DATA ( 0x1f, 0x8b, 0x08, 0x08, 0x00, 0x00, 0x00, 0x00, 0x02, 0xff,
+		    0x68, 0x65, 0x6c, 0x6c, 0x6f, 0x2e, 0x74, 0x78, 0x74, 0x00,
+		    0xf3, 0x48, 0xcd, 0xc9, 0xc9, 0x57, 0x48, 0x2b, 0xca, 0xcf,
+		    0x55, 0x28, 0xc9, 0x48, 0x55, 0xc8, 0x0c, 0x88, 0x70, 0x55,
+		    0xc8, 0xcc, 0x4b, 0xcb, 0x49, 0x2c, 0x49, 0x55, 0x28, 0x4e,
+		    0xcd, 0x49, 0xd3, 0x2d, 0x49, 0x2d, 0x2e, 0x51, 0xe4, 0x02,
+		    0x00, 0x9e, 0x64, 0xb7, 0x91, 0x27, 0x00, 0x00, 0x00 ),
+	       HELLO, ( sizeof ( HELLO ) - 1 ) );
+
+/* gzip format, two concatenated members */
+INFLATE_TEST ( gzip_multi, INFLATE_GZIP,
+	       DATA ( 0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03,
+		    0xf3, 0x48, 0xcd, 0xc9, 0xc9, 0x57, 0x48, 0x2b, 0xca, 0xcf,
+		    0x55, 0x28, 0xc9, 0x48, 0x55, 0xc8, 0x0c, 0x88, 0x70, 0x55,
+		    0xc8, 0xcc, 0x4b, 0xcb, 0x49, 0x2c, 0x49, 0x55, 0x28, 0x4e,
+		    0xcd, 0x49, 0xd3, 0x2d, 0x49, 0x2d, 0x2e, 0x51, 0xe4, 0x02,
+		    0x00, 0x9e, 0x64, 0xb7, 0x91, 0x27, 0x00, 0x00, 0x00, 0x1f,
+		    0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xf3,
+		    0x48, 0xcd, 0xc9, 0xc9, 0x57, 0x48, 0x2b, 0xca, 0xcf, 0x55,
+		    0x28, 0xc9, 0x48, 0x55, 0xc8, 0x0c, 0x88, 0x70, 0x55, 0xc8,
+		    0xcc, 0x4b, 0xcb, 0x49, 0x2c, 0x49, 0x55, 0x28, 0x4e, 0xcd,
+		    0x49, 0xd3, 0x2d, 0x49, 0x2d, 0x2e, 0x51, 0xe4, 0xf2, 0x18,
+		    0x08, 0x65, 0x00, 0x37, 0xf5, 0x8d, 0x24, 0x9c, 0x00, 0x00,
+		    0x00 ),
+	       hello5, ( sizeof ( hello5 ) - 1 ) );
+
+/* zlib format, stored block */
+INFLATE_TEST ( zlib_stored, INFLATE_ZLIB,
+	       DATA ( 0x78, 0x01, 0x01, 0x27, 0x00, 0xd8, 0xff, 0x48, 0x65, 0x6c,
+		    0x6c, 0x6f, 0x20, 0x66, 0x72, 0x6f, 0x6d, 0x20, 0x74, 0x68,
+		    0x65, 0x20, 0x69, 0x50, 0x58, 0x45, 0x20, 0x69, 0x6e, 0x66,
+		    0x6c, 0x61, 0x74, 0x65, 0x20, 0x73, 0x65, 0x6c, 0x66, 0x2d,
+		    0x74, 0x65, 0x73, 0x74, 0x21, 0x0a, 0x14, 0x61, 0x0d, 0x85 ),
+	       HELLO, ( sizeof ( HELLO ) - 1 ) );
+
+/* zlib format, fixed Huffman codes with matches */
+INFLATE_TEST ( zlib_match, INFLATE_ZLIB,
+	       DATA ( 0x78, 0xda, 0xf3, 0x48, 0xcd, 0xc9, 0xc9, 0x57, 0x48, 0x2b,
+		    0xca, 0xcf, 0x55, 0x28, 0xc9, 0x48, 0x55, 0xc8, 0x0c, 0x88,
+		    0x70, 0x55, 0xc8, 0xcc, 0x4b, 0xcb, 0x49, 0x2c, 0x49, 0x55,
+		    0x28, 0x4e, 0xcd, 0x49, 0xd3, 0x2d, 0x49, 0x2d, 0x2e, 0x51,
+		    0xe4, 0xf2, 0x18, 0x08, 0x65, 0x00, 0xac, 0xe0, 0x36, 0x11 ),
+	       hello4, ( sizeof ( hello4 ) - 1 ) );
+
+/* Raw DEFLATE, dynamic Huffman codes, output larger than window */
+INFLATE_TEST ( raw_dynamic, INFLATE_RAW,
+	       DATA ( 0xed, 0xd3, 0x39, 0x56, 0xc4, 0x30, 0x0c, 0x00, 0xd0, 0x9e,
+		    0x53, 0xe4, 0x32, 0xf4, 0x94, 0xb4, 0xec, 0x0c, 0x5b, 0x58,
+		    0x66, 0xd8, 0x4e, 0xcf, 0xb3, 0x44, 0x6c, 0x25, 0x8f, 0x9a,
+		    0xea, 0x17, 0x33, 0xcf, 0x8b, 0x2c, 0xcb, 0xb1, 0xff, 0xee,
+		    0xe4, 0xf4, 0x78, 0xda, 0xb5, 0xbf, 0xeb, 0xf9, 0x73, 0x9a,
+		    0xdf, 0xaf, 0x5e, 0xa7, 0x97, 0xc3, 0xee, 0xe2, 0x7e, 0xba,
+		    0x9c, 0x6f, 0xa6, 0xfd, 0xed, 0xd5, 0x74, 0x3e, 0xcf, 0xfb,
+		    0xa3, 0xf3, 0xd7, 0xf9, 0xe3, 0x69, 0x7a, 0x38, 0xfb, 0xfe,
+		    0xca, 0x7e, 0x9b, 0xbc, 0x3b, 0x3c, 0x3e, 0xbf, 0x45, 0x48,
+		    0xac, 0x6a, 0xcb, 0x63, 0xae, 0x35, 0xda, 0x7c, 0x44, 0xc7,
+		    0x5f, 0xa4, 0xdf, 0xa4, 0xce, 0xd5, 0xd9, 0x8f, 0xa9, 0xb2,
+		    0x45, 0xce, 0xc5, 0x68, 0x36, 0x73, 0x6e, 0xbb, 0xb8, 0x6d,
+		    0x94, 0x63, 0x63, 0x97, 0xb1, 0xd5, 0xaa, 0x8c, 0x51, 0x61,
+		    0x64, 0x1a, 0xeb, 0x5b, 0xf9, 0xa3, 0x97, 0xb3, 0x91, 0x23,
+		    0x9b, 0x2d, 0x41, 0xfb, 0x65, 0x85, 0xcb, 0xe9, 0x72, 0xd3,
+		    0x71, 0xfe, 0x98, 0x88, 0x55, 0x2d, 0x36, 0x7a, 0xe3, 0xf0,
+		    0x2d, 0x20, 0xe6, 0xca, 0xd1, 0xca, 0x59, 0xcb, 0x67, 0xd9,
+		    0xd6, 0xd1, 0x5a, 0x3d, 0x45, 0x64, 0xcd, 0xb8, 0x72, 0xe6,
+		    0x6c, 0xf6, 0x3b, 0x88, 0xa0, 0xf2, 0xf5, 0x5a, 0x86, 0xdf,
+		    0x1d, 0x7b, 0x89, 0xb9, 0xa4, 0x7e, 0xd1, 0x8c, 0x88, 0xd2,
+		    0x63, 0x34, 0x96, 0x46, 0xfa, 0x5e, 0x41, 0xbd, 0xad, 0xfe,
+		    0x58, 0xd6, 0x5f, 0x31, 0x86, 0x5b, 0xa3, 0x57, 0x9b, 0xcf,
+		    0x65, 0x1c, 0xb5, 0xed, 0xb0, 0x44, 0xff, 0x56, 0xd1, 0xc3,
+		    0x62, 0xcf, 0xf2, 0x0e, 0x7a, 0xa2, 0x51, 0xd1, 0x2a, 0x77,
+		    0x39, 0xe4, 0xe6, 0xaf, 0x96, 0xba, 0xda, 0xb6, 0xdf, 0xcd,
+		    0x32, 0x10, 0x9d, 0xf5, 0x61, 0x73, 0xd9, 0x9f, 0xd1, 0xe3,
+		    0x0e, 0x4b, 0xee, 0xcd, 0x1b, 0x1f, 0x31, 0x4b, 0x8a, 0xf1,
+		    0x66, 0xcb, 0xdb, 0x1a, 0xbb, 0xd4, 0xe7, 0xb8, 0x7e, 0xba,
+		    0xe5, 0xbe, 0xc7, 0x07, 0x5a, 0x3b, 0x2d, 0x37, 0x3b, 0x6a,
+		    0xdf, 0x2e, 0x59, 0xaa, 0xd9, 0x71, 0xce, 0x39, 0xe7, 0x9c,
+		    0x73, 0xce, 0x39, 0xe7, 0x9c, 0x73, 0xce, 0x39, 0xe7, 0x9c,
+		    0x73, 0xce, 0x39, 0xe7, 0x9c, 0x73, 0xce, 0x39, 0xe7, 0x9c,
+		    0x73, 0xce, 0x39, 0xe7, 0x9c, 0x73, 0xce, 0x39, 0xe7, 0x9c,
+		    0x73, 0xce, 0x39, 0xe7, 0x9c, 0x73, 0xce, 0x39, 0xe7, 0x9c,
+		    0x73, 0xce, 0x39, 0xe7, 0x9c, 0x73, 0xce, 0x39, 0xe7, 0x9c,
+		    0x73, 0xce, 0x39, 0xe7, 0x9c, 0x73, 0xce, 0x39, 0xe7, 0x9c,
+		    0x73, 0xce, 0x39, 0xe7, 0x9c, 0x73, 0xce, 0x39, 0xe7, 0x9c,
+		    0x73, 0xce, 0x39, 0xe7, 0x9c, 0x73, 0xce, 0x39, 0xe7, 0x9c,
+		    0x73, 0xce, 0x39, 0xe7, 0x9c, 0x73, 0xce, 0x39, 0xe7, 0x9c,
+		    0x73, 0xce, 0x39, 0xe7, 0x9c, 0x73, 0xce, 0x39, 0xe7, 0x9c,
+		    0x73, 0xce, 0x39, 0xe7, 0x9c, 0x73, 0xce, 0x39, 0xe7, 0x9c,
+		    0x73, 0xce, 0x39, 0xe7, 0x9c, 0x73, 0xce, 0x39, 0xe7, 0x9c,
+		    0x73, 0xce, 0x39, 0xe7, 0x9c, 0x73, 0xce, 0x39, 0xe7, 0x9c,
+		    0x73, 0xce, 0x39, 0xe7, 0x9c, 0x73, 0xce, 0x39, 0xe7, 0x9c,
+		    0x73, 0xce, 0x39, 0xe7, 0x9c, 0x73, 0xce, 0x39, 0xe7, 0x9c,
+		    0x73, 0xce, 0x39, 0xe7, 0x9c, 0x73, 0xce, 0x39, 0xe7, 0x9c,
+		    0x73, 0xce, 0x39, 0xe7, 0x9c, 0x73, 0xce, 0x39, 0xe7, 0x9c,
+		    0x73, 0xce, 0x39, 0xe7, 0x9c, 0x73, 0xce, 0x39, 0xe7, 0x9c,
+		    0x73, 0xce, 0x39, 0xe7, 0x9c, 0x73, 0xce, 0x39, 0xe7, 0x9c,
+		    0x73, 0xce, 0x39, 0xe7, 0x9c, 0x73, 0xce, 0x39, 0xe7, 0x9c,
+		    0x73, 0xce, 0x39, 0xe7, 0x9c, 0x73, 0xce, 0x39, 0xe7, 0x9c,
+		    0x73, 0xce, 0x39, 0xe7, 0x9c, 0x73, 0xce, 0x39, 0xe7, 0x9c,
+		    0x73, 0xce, 0x39, 0xe7, 0x9c, 0x73, 0xce, 0x39, 0xe7, 0x9c,
+		    0x73, 0xce, 0x39, 0xe7, 0x9c, 0x73, 0xce, 0x39, 0xe7, 0x9c,
+		    0x73, 0xce, 0x39, 0xe7, 0x9c, 0x73, 0xce, 0x39, 0xe7, 0x9c,
+		    0x73, 0xce, 0x39, 0xe7, 0x9c, 0x73, 0xce, 0x39, 0xe7, 0x9c,
+		    0x73, 0xce, 0x39, 0xe7, 0x9c, 0x73, 0xce, 0x39, 0xe7, 0x9c,
+		    0x73, 0xce, 0x39, 0xe7, 0x9c, 0x73, 0xce, 0x39, 0xe7, 0x9c,
+		    0x73, 0xce, 0x39, 0xe7, 0x9c, 0x73, 0xce, 0x39, 0xe7, 0x9c,
+		    0x73, 0xce, 0x39, 0xe7, 0x9c, 0x73, 0xce, 0x39, 0xe7, 0x9c,
+		    0x73, 0xce, 0x39, 0xe7, 0x9c, 0x73, 0xce, 0x39, 0xe7, 0x9c,
+		    0x73, 0xce, 0x39, 0xe7, 0x9c, 0x73, 0xce, 0x39, 0xe7, 0x9c,
+		    0x73, 0xce, 0x39, 0xe7, 0x9c, 0x73, 0xce, 0x39, 0xe7, 0xff,
+		    0xee, 0xfc, 0x07 ),
+	       generated, sizeof ( generated ) );
+
+/** Context for test in progress */
+static struct inflate_test_context inflate_test_ctx;
+
+/**
+ * Construct generated test data
+ *
+ * The data consists of a 1000-byte block of pseudo-randomly chosen
+ * words, repeated to fill the buffer.
+ */
+static void inflate_test_generate ( void ) {
+	static const char *words[] = { "the ", "quick ", "brown ", "fox ",
+				       "jumps ", "over ", "lazy ", "dog ",
+				       "iPXE ", "boot\n" };
+	uint32_t seed = 1;
+	const char *word;
+	size_t len = 0;
+	size_t frag_len;
+
+	while ( len < 1000 ) {
+		seed = ( ( ( seed * 1103515245UL ) + 12345 ) & 0x7fffffffUL );
+		word = words[ ( seed >> 16 ) % 10 ];
+		frag_len = strlen ( word );
+		if ( frag_len > ( 1000 - len ) )
+			frag_len = ( 1000 - len );
+		memcpy ( &generated[len], word, frag_len );
+		len += frag_len;
+	}
+	for ( ; len < sizeof ( generated ) ; len++ )
+		generated[len] = generated[ len - 1000 ];
+}
+
+/**
+ * Receive decompressed test data
+ *
+ * @v inflate		Decompressor
+ * @v data		Decompressed data
+ * @v len		Length of decompressed data
+ * @ret rc		Return status code
+ */
+static int inflate_test_deliver ( struct inflate *inflate, const void *data,
+				  size_t len ) {
+	struct inflate_test_context *ctx =
+		container_of ( inflate, struct inflate_test_context, inflate );
+	struct inflate_test *test = ctx->test;
+
+	if ( ( ( ctx->len + len ) > test->expected_len ) ||
+	     ( memcmp ( ( test->expected + ctx->len ), data, len ) != 0 ) )
+		ctx->mismatch = 1;
+	ctx->len += len;
+	return 0;
+}
+
+/**
+ * Decompress test data
+ *
+ * @v test		DEFLATE decompression test
+ * @v data		Compressed data
+ * @v len		Length of compressed data
+ * @v frag_len		Length of each input fragment
+ * @ret rc		Return status code
+ */
+static int inflate_test_run ( struct inflate_test *test, const void *data,
+			      size_t len, size_t frag_len ) {
+	struct inflate_test_context *ctx = &inflate_test_ctx;
+	int rc;
+
+	ctx->test = test;
+	ctx->len = 0;
+	ctx->mismatch = 0;
+	if ( ( rc = inflate_init ( &ctx->inflate, test->format,
+				   inflate_test_deliver ) ) != 0 )
+		return rc;
+	for ( ; len ; data += frag_len, len -= frag_len ) {
+		if ( frag_len > len )
+			frag_len = len;
+		if ( ( rc = inflate_data ( &ctx->inflate, data,
+					   frag_len ) ) != 0 )
+			break;
+	}
+	return rc;
+}
+
+/**
+ * Report a DEFLATE decompression test result
+ *
+ * @v test		DEFLATE decompression test
+ * @v frag_len		Length of each input fragment
+ */
+#define inflate_ok( test, frag_len ) do {				\
+	struct inflate_test_context *ctx = &inflate_test_ctx;		\
+	ok ( inflate_test_run ( (test), (test)->compressed,		\
+				(test)->compressed_len,			\
+				(frag_len) ) == 0 );			\
+	ok ( inflate_finished ( &ctx->inflate ) );			\
+	ok ( ctx->len == (test)->expected_len );			\
+	ok ( ! ctx->mismatch );						\
+	inflate_free ( &ctx->inflate );					\
+	} while ( 0 )
+
+/**
+ * Report a corrupted DEFLATE decompression test result
+ *
+ * @v name		Test name
+ * @v offset		Offset of byte to corrupt
+ */
+#define inflate_corrupt_ok( name, offset ) do {				\
+	struct inflate_test_context *ctx = &inflate_test_ctx;		\
+	static uint8_t buf[ sizeof ( name ## _compressed ) ];		\
+	int rc;								\
+	memcpy ( buf, name ## _compressed, sizeof ( buf ) );		\
+	buf[offset] ^= 0x01;						\
+	rc = inflate_test_run ( &name, buf, sizeof ( buf ),		\
+				sizeof ( buf ) );			\
+	ok ( ( rc != 0 ) || ctx->mismatch );				\
+	inflate_free ( &ctx->inflate );					\
+	} while ( 0 )
+
+/**
+ * Perform DEFLATE decompression self-tests
+ *
+ */
+static void inflate_test_exec ( void ) {
+	struct inflate_test_context *ctx = &inflate_test_ctx;
+
+	/* Construct generated test data */
+	inflate_test_generate();
+
+	/* Decompress in a single piece */
+	inflate_ok ( &gzip_fixed, gzip_fixed.compressed_len );
+	inflate_ok ( &gzip_multi, gzip_multi.compressed_len );
+	inflate_ok ( &zlib_stored, zlib_stored.compressed_len );
+	inflate_ok ( &zlib_match, zlib_match.compressed_len );
+	inflate_ok ( &raw_dynamic, raw_dynamic.compressed_len );
+
+	/* Decompress one byte at a time */
+	inflate_ok ( &gzip_fixed, 1 );
+	inflate_ok ( &gzip_multi, 1 );
+	inflate_ok ( &zlib_stored, 1 );
+	inflate_ok ( &zlib_match, 1 );
+	inflate_ok ( &raw_dynamic, 1 );
+
+	/* Truncated stream is not finished */
+	ok ( inflate_test_run ( &gzip_fixed, gzip_fixed.compressed,
+				( gzip_fixed.compressed_len - 1 ),
+				gzip_fixed.compressed_len ) == 0 );
+	ok ( ! inflate_finished ( &ctx->inflate ) );
+	inflate_free ( &ctx->inflate );
+
+	/* Corrupted header, data, checksum and length */
+	inflate_corrupt_ok ( gzip_fixed, 0 );
+	inflate_corrupt_ok ( zlib_stored, 1 );
+	inflate_corrupt_ok ( zlib_stored, 3 );
+	inflate_corrupt_ok ( gzip_fixed, ( gzip_fixed.compressed_len - 5 ) );
+	inflate_corrupt_ok ( gzip_fixed, ( gzip_fixed.compressed_len - 1 ) );
+	inflate_corrupt_ok ( zlib_match, ( zlib_match.compressed_len - 1 ) );
+	inflate_corrupt_ok ( raw_dynamic, 20 );
+	inflate_corrupt_ok ( gzip_multi, 59 );
+	inflate_corrupt_ok ( gzip_multi, ( gzip_multi.compressed_len - 4 ) );
+
+	/* Truncated second gzip member is not finished */
+	ok ( inflate_test_run ( &gzip_multi, gzip_multi.compressed,
+				( gzip_multi.compressed_len - 1 ), 1 ) == 0 );
+	ok ( ! inflate_finished ( &ctx->inflate ) );
+	inflate_free ( &ctx->inflate );
+
+	/* Non-gzip data following a gzip member is rejected */
+	ok ( inflate_test_run ( &gzip_fixed, gzip_fixed.compressed,
+				gzip_fixed.compressed_len, 1 ) == 0 );
+	ok ( inflate_data ( &ctx->inflate, "junk", 4 ) != 0 );
+	inflate_free ( &ctx->inflate );
+
+	/* Trailing data following a raw DEFLATE stream is ignored */
+	ok ( inflate_test_run ( &raw_dynamic, raw_dynamic.compressed,
+				raw_dynamic.compressed_len, 1 ) == 0 );
+	ok ( inflate_data ( &ctx->inflate, "junk", 4 ) == 0 );
+	ok ( inflate_finished ( &ctx->inflate ) );
+	ok ( ctx->inflate.trailing == 4 );
+	ok ( ctx->len == sizeof ( generated ) );
+	inflate_free ( &ctx->inflate );
+}
+
+/** DEFLATE decompression self-test */
+struct self_test inflate_test __self_test = {
+	.name = "inflate",
+	.exec = inflate_test_exec,
+};
@@ -0,0 +1,318 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+/** @file
+ *
+ * IPv4 fragment reassembly self-tests
+ *
+ */
+
+/* Forcibly enable assertions */
+#undef NDEBUG
+
+#include <stdint.h>
+#include <string.h>
+#include <byteswap.h>
+#include <ipxe/iobuf.h>
+#include <ipxe/in.h>
+#include <ipxe/ip.h>
+#include <ipxe/tcpip.h>
+#include <ipxe/netdevice.h>
+#include <ipxe/test.h>
+
+/** Fragment payload length used for tests */
+#define IPV4_TEST_FRAG_LEN 504
+
+/** Number of fragments used for tests */
+#define IPV4_TEST_FRAG_COUNT 6
+
+/** Datagram payload length used for tests (last fragment is short) */
+#define IPV4_TEST_LEN ( ( IPV4_TEST_FRAG_LEN * \
+			  ( IPV4_TEST_FRAG_COUNT - 1 ) ) + 123 )
+
+/** Transport-layer protocol used for tests (reserved for testing) */
+#define IPV4_TEST_PROTO 253
+
+/** Test payload */
+static uint8_t ipv4_test_data[IPV4_TEST_LEN];
+
+/** Most recently received test datagram */
+static struct io_buffer *ipv4_test_iobuf;
+
+/** Source address of most recently received test datagram */
+static struct in_addr ipv4_test_src;
+
+/**
+ * Construct test source address
+ *
+ * @v ident		Identification
+ * @ret src		Source address
+ *
+ * Each test datagram is sent from a distinct source address, so that
+ * the identity of each reassembled datagram can be verified.
+ */
+static struct in_addr ipv4_test_source ( unsigned int ident ) {
+	struct in_addr src;
+
+	src.s_addr = htonl ( 0x0a000000UL | ident );
+	return src;
+}
+
+/**
+ * Receive reassembled test datagram
+ *
+ * @v iobuf		I/O buffer
+ * @v st_src		Partially-filled source address
+ * @v st_dest		Partially-filled destination address
+ * @v pshdr_csum	Pseudo-header checksum
+ * @ret rc		Return status code
+ */
+static int ipv4_test_tcpip_rx ( struct io_buffer *iobuf,
+				struct sockaddr_tcpip *st_src,
+				struct sockaddr_tcpip *st_dest __unused,
+				uint16_t pshdr_csum __unused ) {
+	struct sockaddr_in *sin_src = ( ( struct sockaddr_in * ) st_src );
+
+	ok ( ipv4_test_iobuf == NULL );
+	free_iob ( ipv4_test_iobuf );
+	ipv4_test_iobuf = iobuf;
+	ipv4_test_src = sin_src->sin_addr;
+	return 0;
+}
+
+/** Test transport-layer protocol */
+struct tcpip_protocol ipv4_test_tcpip_protocol __tcpip_protocol = {
+	.name = "IPV4TEST",
+	.rx = ipv4_test_tcpip_rx,
+	.tcpip_proto = IPV4_TEST_PROTO,
+};
+
+/**
+ * Deliver test fragment
+ *
+ * @v ident		Identification
+ * @v data		Datagram payload
+ * @v offset		Fragment offset
+ * @v len		Fragment length
+ * @v more		More fragments follow
+ * @ret iobuf		Reassembled datagram payload, or NULL
+ */
+static struct io_buffer * ipv4_test_rx ( unsigned int ident,
+					 const void *data, size_t offset,
+					 size_t len, int more ) {
+	struct io_buffer *iobuf;
+	struct iphdr *iphdr;
+
+	iobuf = alloc_iob ( sizeof ( *iphdr ) + len );
+	ok ( iobuf != NULL );
+	if ( ! iobuf )
+		return NULL;
+	iphdr = iob_put ( iobuf, sizeof ( *iphdr ) );
+	memset ( iphdr, 0, sizeof ( *iphdr ) );
+	iphdr->verhdrlen = ( IP_VER | ( sizeof ( *iphdr ) / 4 ) );
+	iphdr->len = htons ( sizeof ( *iphdr ) + len );
+	iphdr->ident = htons ( ident );
+	iphdr->frags = htons ( ( offset >> 3 ) |
+			       ( more ? IP_MASK_MOREFRAGS : 0 ) );
+	iphdr->ttl = IP_TTL;
+	iphdr->protocol = IPV4_TEST_PROTO;
+	iphdr->src = ipv4_test_source ( ident );
+	iphdr->dest.s_addr = htonl ( 0xc0a80002 );
+	iphdr->chksum = tcpip_chksum ( iphdr, sizeof ( *iphdr ) );
+	memcpy ( iob_put ( iobuf, len ), ( data + offset ), len );
+
+	/* Hand to IPv4 as a multicast packet, to bypass the check
+	 * for a local destination address.
+	 */
+	ok ( ipv4_protocol.rx ( iobuf, NULL, NULL, NULL,
+				LL_MULTICAST ) == 0 );
+	iobuf = ipv4_test_iobuf;
+	ipv4_test_iobuf = NULL;
+	return iobuf;
+}
+
+/**
+ * Deliver numbered test fragment
+ *
+ * @v ident		Identification
+ * @v index		Fragment index
+ * @ret iobuf		Reassembled packet, or NULL
+ */
+static struct io_buffer * ipv4_test_rx_index ( unsigned int ident,
+					       unsigned int index ) {
+	size_t offset = ( index * IPV4_TEST_FRAG_LEN );
+	int more = ( index < ( IPV4_TEST_FRAG_COUNT - 1 ) );
+	size_t len = ( more ? IPV4_TEST_FRAG_LEN :
+		       ( IPV4_TEST_LEN - offset ) );
+
+	return ipv4_test_rx ( ident, ipv4_test_data, offset, len, more );
+}
+
+/**
+ * Check reassembled test datagram
+ *
+ * @v iobuf		Reassembled datagram payload
+ * @v ident		Expected identification
+ * @v data		Expected payload
+ * @v len		Expected payload length
+ * @ret ok		Datagram is correct
+ */
+static int ipv4_test_check ( struct io_buffer *iobuf, unsigned int ident,
+			     const void *data, size_t len ) {
+	int correct;
+
+	correct = ( ( iob_len ( iobuf ) == len ) &&
+		    ( ipv4_test_src.s_addr ==
+		      ipv4_test_source ( ident ).s_addr ) &&
+		    ( memcmp ( iobuf->data, data, len ) == 0 ) );
+	free_iob ( iobuf );
+	return correct;
+}
+
+/**
+ * Report a fragment ordering test result
+ *
+ * @v ident		Identification
+ * @v ORDER		Order in which to deliver fragments
+ */
+#define ipv4_reassemble_ok( ident, ORDER ) do {				\
+	static const uint8_t order[] = ORDER;				\
+	struct io_buffer *iobuf = NULL;					\
+	unsigned int i;							\
+									\
+	for ( i = 0 ; i < sizeof ( order ) ; i++ ) {			\
+		ok ( iobuf == NULL );					\
+		iobuf = ipv4_test_rx_index ( (ident), order[i] );	\
+	}								\
+	ok ( iobuf != NULL );						\
+	if ( iobuf ) {							\
+		ok ( ipv4_test_check ( iobuf, (ident), ipv4_test_data,	\
+				       IPV4_TEST_LEN ) );		\
+	}								\
+	} while ( 0 )
+
+/** Define inline fragment order */
+#define ORDER(...) { __VA_ARGS__ }
+
+/**
+ * Perform IPv4 fragment reassembly self-tests
+ *
+ */
+static void ipv4_test_exec ( void ) {
+	static uint8_t big[ 60000 ];
+	struct ipv4_fragment_stats before;
+	struct io_buffer *iobuf;
+	unsigned int i;
+
+	/* Construct test data */
+	for ( i = 0 ; i < sizeof ( ipv4_test_data ) ; i++ )
+		ipv4_test_data[i] = ( ( i * 7 ) ^ ( i >> 8 ) );
+	for ( i = 0 ; i < sizeof ( big ) ; i++ )
+		big[i] = ( i ^ ( i >> 8 ) );
+
+	/* In order, reverse order and shuffled */
+	ipv4_reassemble_ok ( 0x1001, ORDER ( 0, 1, 2, 3, 4, 5 ) );
+	ipv4_reassemble_ok ( 0x1002, ORDER ( 5, 4, 3, 2, 1, 0 ) );
+	ipv4_reassemble_ok ( 0x1003, ORDER ( 3, 0, 5, 1, 4, 2 ) );
+
+	/* Duplicated fragments */
+	ipv4_reassemble_ok ( 0x1004, ORDER ( 1, 1, 5, 0, 5, 3, 2, 0, 4 ) );
+
+	/* Overlapping fragments */
+	ok ( ipv4_test_rx ( 0x1005, ipv4_test_data, 0, 1000, 1 ) == NULL );
+	ok ( ipv4_test_rx ( 0x1005, ipv4_test_data, 2000,
+			    ( IPV4_TEST_LEN - 2000 ), 0 ) == NULL );
+	ok ( ipv4_test_rx ( 0x1005, ipv4_test_data, 1200, 400, 1 ) == NULL );
+	iobuf = ipv4_test_rx ( 0x1005, ipv4_test_data, 800, 1400, 1 );
+	ok ( iobuf != NULL );
+	if ( iobuf ) {
+		ok ( ipv4_test_check ( iobuf, 0x1005, ipv4_test_data,
+				       IPV4_TEST_LEN ) );
+	}
+
+	/* Interleaved datagrams */
+	for ( i = 0 ; i < ( IPV4_TEST_FRAG_COUNT - 1 ) ; i++ ) {
+		ok ( ipv4_test_rx_index ( 0x1006, i ) == NULL );
+		ok ( ipv4_test_rx_index ( 0x1007,
+					  ( IPV4_TEST_FRAG_COUNT - 1 - i ) )
+		     == NULL );
+	}
+	iobuf = ipv4_test_rx_index ( 0x1007, 0 );
+	ok ( iobuf != NULL );
+	if ( iobuf ) {
+		ok ( ipv4_test_check ( iobuf, 0x1007, ipv4_test_data,
+				       IPV4_TEST_LEN ) );
+	}
+	iobuf = ipv4_test_rx_index ( 0x1006, ( IPV4_TEST_FRAG_COUNT - 1 ) );
+	ok ( iobuf != NULL );
+	if ( iobuf ) {
+		ok ( ipv4_test_check ( iobuf, 0x1006, ipv4_test_data,
+				       IPV4_TEST_LEN ) );
+	}
+
+	/* Invalid and inconsistent fragments */
+	before = ipv4_fragment_stats;
+	ok ( ipv4_test_rx ( 0x1008, ipv4_test_data, 0, 100, 1 ) == NULL );
+	ok ( ipv4_test_rx ( 0x1008, ipv4_test_data, 0, 512, 1 ) == NULL );
+	ok ( ipv4_test_rx ( 0x1008, ipv4_test_data, 1024, 100, 0 ) == NULL );
+	ok ( ipv4_test_rx ( 0x1008, ipv4_test_data, 1024, 200, 1 ) == NULL );
+	ok ( ipv4_test_rx ( 0x1008, ipv4_test_data, 1024, 8, 0 ) == NULL );
+	ok ( ipv4_test_rx ( 0x1008, ipv4_test_data, 256, 8, 0 ) == NULL );
+	ok ( ipv4_fragment_stats.dropped == ( before.dropped + 4 ) );
+	iobuf = ipv4_test_rx ( 0x1008, ipv4_test_data, 512, 512, 1 );
+	ok ( iobuf != NULL );
+	if ( iobuf ) {
+		ok ( ipv4_test_check ( iobuf, 0x1008, ipv4_test_data,
+				       1124 ) );
+	}
+
+	/* Memory limit: the fifth large partial datagram causes the
+	 * oldest to be evicted.
+	 */
+	before = ipv4_fragment_stats;
+	for ( i = 0 ; i < 5 ; i++ ) {
+		ok ( ipv4_test_rx ( ( 0x2000 + i ), big, ( sizeof ( big ) - 8 ),
+				    8, 0 ) == NULL );
+	}
+	ok ( ipv4_fragment_stats.evicted == ( before.evicted + 1 ) );
+	ok ( ipv4_test_rx ( 0x2000, big, 0, 8, 1 ) == NULL );
+	for ( i = 1 ; i < 5 ; i++ ) {
+		iobuf = ipv4_test_rx ( ( 0x2000 + i ), big, 0,
+				       ( sizeof ( big ) - 8 ), 1 );
+		ok ( iobuf != NULL );
+		if ( iobuf ) {
+			ok ( ipv4_test_check ( iobuf, ( 0x2000 + i ), big,
+					       sizeof ( big ) ) );
+		}
+	}
+	iobuf = ipv4_test_rx ( 0x2000, big, 8, ( sizeof ( big ) - 16 ), 1 );
+	ok ( iobuf == NULL );
+	iobuf = ipv4_test_rx ( 0x2000, big, ( sizeof ( big ) - 8 ), 8, 0 );
+	ok ( iobuf != NULL );
+	if ( iobuf ) {
+		ok ( ipv4_test_check ( iobuf, 0x2000, big, sizeof ( big ) ) );
+	}
+	ok ( ipv4_fragment_stats.reassembled == ( before.reassembled + 5 ) );
+}
+
+/** IPv4 fragment reassembly self-test */
+struct self_test ipv4_test __self_test = {
+	.name = "ipv4",
+	.exec = ipv4_test_exec,
+};
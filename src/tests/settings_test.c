@@ -28,10 +28,15 @@ FILE_LICENCE ( GPL2_OR_LATER );
 /* Forcibly enable assertions */
 #undef NDEBUG
 
+#include <stdlib.h>
 #include <string.h>
 #include <ipxe/settings.h>
+#include <ipxe/profile.h>
 #include <ipxe/test.h>
 
+/** Number of expansions used to measure setting expansion cost */
+#define SETTINGS_TEST_EXPAND_COUNT 256
+
 /** Define inline raw data */
 #define RAW(...) { __VA_ARGS__ }
 
@@ -170,6 +175,45 @@ static struct setting test_uuid_setting = {
 	.type = &setting_type_uuid,
 };
 
+/**
+ * Report a string fetch test result
+ *
+ * @v settings		Settings block, or NULL to search all blocks
+ * @v setting		Setting
+ * @v expected		Expected value
+ */
+#define fetch_string_ok( settings, setting, expected ) do {		\
+	char actual[ strlen ( expected ) + 1 ];				\
+	int len;							\
+									\
+	len = fetch_string_setting ( settings, setting, actual,		\
+				     sizeof ( actual ) );		\
+	ok ( len == ( int ) strlen ( expected ) );			\
+	ok ( strcmp ( actual, expected ) == 0 );			\
+	} while ( 0 )
+
+/**
+ * Calculate setting expansion cost
+ *
+ * @ret cost		Cost (in cycles per expansion)
+ */
+static unsigned long settings_expand_cost ( void ) {
+	union profiler profiler;
+	unsigned long long elapsed;
+	char *expanded;
+	unsigned int i;
+
+	/* Time repeated expansion of a setting from a registered block */
+	profile ( &profiler );
+	for ( i = 0 ; i < SETTINGS_TEST_EXPAND_COUNT ; i++ ) {
+		expanded = expand_settings ( "${test_string}" );
+		free ( expanded );
+	}
+	elapsed = profile ( &profiler );
+
+	return ( elapsed / SETTINGS_TEST_EXPAND_COUNT );
+}
+
 /**
  * Perform settings self-tests
  *
@@ -266,6 +310,36 @@ static void settings_test_exec ( void ) {
 			  0x7a, 0x7c, 0xfe, 0x4f, 0xca, 0x4a, 0x57 ),
 		    "1a6a749d-0eda-461a-a87a-7cfe4fca4a57" );
 
+	/* Named setting index */
+	ok ( find_setting ( "hostname" ) == &hostname_setting );
+	ok ( find_setting ( "test_string" ) == NULL );
+	ok ( find_setting ( "" ) == NULL );
+
+	/* Cached lookups must observe stores and (un)registrations */
+	ok ( storef_setting ( &test_settings, &test_string_setting,
+			      "hello" ) == 0 );
+	fetch_string_ok ( NULL, &test_string_setting, "hello" );
+	fetch_string_ok ( NULL, &test_string_setting, "hello" );
+	ok ( fetch_setting_origin ( NULL, &test_string_setting ) ==
+	     &test_settings );
+	ok ( storef_setting ( &test_settings, &test_string_setting,
+			      "world" ) == 0 );
+	fetch_string_ok ( NULL, &test_string_setting, "world" );
+	ok ( storef_setting ( NULL, &test_string_setting, "root" ) == 0 );
+	fetch_string_ok ( NULL, &test_string_setting, "root" );
+	fetch_string_ok ( &test_settings, &test_string_setting, "world" );
+	ok ( delete_setting ( NULL, &test_string_setting ) == 0 );
+	fetch_string_ok ( NULL, &test_string_setting, "world" );
+	DBG ( "Setting expansion required %ld cycles\n",
+	      settings_expand_cost() );
+	unregister_settings ( &test_settings );
+	ok ( fetch_setting_len ( NULL, &test_string_setting ) < 0 );
+	ok ( fetch_setting_len ( NULL, &test_string_setting ) < 0 );
+	ok ( register_settings ( &test_settings, NULL, "test" ) == 0 );
+	fetch_string_ok ( NULL, &test_string_setting, "world" );
+	ok ( delete_setting ( &test_settings, &test_string_setting ) == 0 );
+	ok ( fetch_setting_len ( NULL, &test_string_setting ) < 0 );
+
 	/* Clear and unregister test settings block */
 	clear_settings ( &test_settings );
 	unregister_settings ( &test_settings );
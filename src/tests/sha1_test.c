@@ -59,6 +59,13 @@ static struct sha1_test_vector sha1_test_vectors[] = {
 	{ "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 56,
 	  { 0x84, 0x98, 0x3e, 0x44, 0x1c, 0x3b, 0xd2, 0x6e, 0xba, 0xae,
 	    0x4a, 0xa1, 0xf9, 0x51, 0x29, 0xe5, 0xe5, 0x46, 0x70, 0xf1 } },
+	/* Multi-block test data and expected digest taken from the
+	 * NIST Cryptographic Toolkit Algorithm Examples (as above)
+	 */
+	{ "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmn"
+	  "hijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu", 112,
+	  { 0xa4, 0x9b, 0x24, 0x46, 0xa0, 0x2c, 0x64, 0x5b, 0xf4, 0x19,
+	    0xf9, 0x95, 0xb6, 0x70, 0x91, 0x25, 0x3a, 0x04, 0xa2, 0x59 } },
 };
 
 /** SHA-1 test fragment lists */
@@ -69,10 +76,11 @@ static struct digest_test_fragments sha1_test_fragments[] = {
 };
 
 /**
- * Perform SHA-1 self-test
+ * Perform SHA-1 self-test using the currently selected implementation
  *
+ * @v impl		Implementation name
  */
-static void sha1_test_exec ( void ) {
+static void sha1_test_impl ( const char *impl ) {
 	struct digest_algorithm *digest = &sha1_algorithm;
 	struct sha1_test_vector *test;
 	unsigned long cost;
@@ -95,7 +103,17 @@ static void sha1_test_exec ( void ) {
 
 	/* Speed test */
 	cost = digest_cost ( digest );
-	DBG ( "SHA1 required %ld cycles per byte\n", cost );
+	DBG ( "SHA1 (%s) required %ld cycles per byte\n", impl, cost );
+}
+
+/**
+ * Perform SHA-1 self-test
+ *
+ */
+static void sha1_test_exec ( void ) {
+
+	/* Test generic and accelerated implementations */
+	accel_test ( sha1_blocks, sha1_blocks_generic, sha1_test_impl );
 }
 
 /** SHA-1 self-test */
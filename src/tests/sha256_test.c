@@ -62,6 +62,14 @@ static struct sha256_test_vector sha256_test_vectors[] = {
 	  { 0x24, 0x8d, 0x6a, 0x61, 0xd2, 0x06, 0x38, 0xb8, 0xe5, 0xc0, 0x26,
 	    0x93, 0x0c, 0x3e, 0x60, 0x39, 0xa3, 0x3c, 0xe4, 0x59, 0x64, 0xff,
 	    0x21, 0x67, 0xf6, 0xec, 0xed, 0xd4, 0x19, 0xdb, 0x06, 0xc1 } },
+	/* Multi-block test data and expected digest taken from the
+	 * NIST Cryptographic Toolkit Algorithm Examples (as above)
+	 */
+	{ "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmn"
+	  "hijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu", 112,
+	  { 0xcf, 0x5b, 0x16, 0xa7, 0x78, 0xaf, 0x83, 0x80, 0x03, 0x6c, 0xe5,
+	    0x9e, 0x7b, 0x04, 0x92, 0x37, 0x0b, 0x24, 0x9b, 0x11, 0xe8, 0xf0,
+	    0x7a, 0x51, 0xaf, 0xac, 0x45, 0x03, 0x7a, 0xfe, 0xe9, 0xd1 } },
 };
 
 /** SHA-256 test fragment lists */
@@ -72,10 +80,11 @@ static struct digest_test_fragments sha256_test_fragments[] = {
 };
 
 /**
- * Perform SHA-256 self-test
+ * Perform SHA-256 self-test using the currently selected implementation
  *
+ * @v impl		Implementation name
  */
-static void sha256_test_exec ( void ) {
+static void sha256_test_impl ( const char *impl ) {
 	struct digest_algorithm *digest = &sha256_algorithm;
 	struct sha256_test_vector *test;
 	unsigned long cost;
@@ -98,7 +107,17 @@ static void sha256_test_exec ( void ) {
 
 	/* Speed test */
 	cost = digest_cost ( digest );
-	DBG ( "SHA256 required %ld cycles per byte\n", cost );
+	DBG ( "SHA256 (%s) required %ld cycles per byte\n", impl, cost );
+}
+
+/**
+ * Perform SHA-256 self-test
+ *
+ */
+static void sha256_test_exec ( void ) {
+
+	/* Test generic and accelerated implementations */
+	accel_test ( sha256_blocks, sha256_blocks_generic, sha256_test_impl );
 }
 
 /** SHA-256 self-test */
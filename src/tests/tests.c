@@ -28,13 +28,19 @@ FILE_LICENCE ( GPL2_OR_LATER );
 /* Drag in all applicable self-tests */
 REQUIRE_OBJECT ( memcpy_test );
 REQUIRE_OBJECT ( string_test );
+REQUIRE_OBJECT ( vsprintf_test );
 REQUIRE_OBJECT ( list_test );
+REQUIRE_OBJECT ( blockcache_test );
 REQUIRE_OBJECT ( byteswap_test );
 REQUIRE_OBJECT ( base64_test );
 REQUIRE_OBJECT ( settings_test );
 REQUIRE_OBJECT ( time_test );
 REQUIRE_OBJECT ( tcpip_test );
+REQUIRE_OBJECT ( ipv4_test );
+REQUIRE_OBJECT ( tftp_test );
 REQUIRE_OBJECT ( crc32_test );
+REQUIRE_OBJECT ( inflate_test );
+REQUIRE_OBJECT ( http_test );
 REQUIRE_OBJECT ( md5_test );
 REQUIRE_OBJECT ( sha1_test );
 REQUIRE_OBJECT ( sha256_test );
@@ -0,0 +1,81 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+/** @file
+ *
+ * TFTP block numbering self-tests
+ *
+ */
+
+/* Forcibly enable assertions */
+#undef NDEBUG
+
+#include <ipxe/tftp.h>
+#include <ipxe/test.h>
+
+/**
+ * Perform TFTP self-tests
+ *
+ */
+static void tftp_test_exec ( void ) {
+
+	/* Start of file: block number 1 is block index 0 */
+	ok ( tftp_block ( 0, 1 ) == 0 );
+	ok ( tftp_block ( 0, 8 ) == 7 );
+	ok ( tftp_block ( 0, 0 ) < 0 );
+	ok ( tftp_block ( 0, 0xfff0 ) < 0 );
+
+	/* Duplicates from behind the first missing block */
+	ok ( tftp_block ( 100, 101 ) == 100 );
+	ok ( tftp_block ( 100, 95 ) == 94 );
+
+	/* Window in progress across the first wraparound */
+	ok ( tftp_block ( 0xfff8, 0xfffa ) == 0xfff9 );
+	ok ( tftp_block ( 0xfff8, 0xffff ) == 0xfffe );
+	ok ( tftp_block ( 0xfff8, 0 ) == 0xffff );
+	ok ( tftp_block ( 0xfff8, 1 ) == 0x10000 );
+	ok ( tftp_block ( 0xfff8, 7 ) == 0x10006 );
+
+	/* Hole just before the wraparound: blocks arriving after the
+	 * wraparound must not be mistaken for the start of the file.
+	 */
+	ok ( tftp_block ( 0xfffe, 0xffff ) == 0xfffe );
+	ok ( tftp_block ( 0xfffe, 0 ) == 0xffff );
+	ok ( tftp_block ( 0xfffe, 1 ) == 0x10000 );
+	ok ( tftp_block ( 0xfffe, 5 ) == 0x10004 );
+	ok ( tftp_block ( 0xfffe, 0xfffd ) == 0xfffc );
+
+	/* Hole just after the wraparound */
+	ok ( tftp_block ( 0xffff, 0 ) == 0xffff );
+	ok ( tftp_block ( 0xffff, 3 ) == 0x10002 );
+	ok ( tftp_block ( 0xffff, 0xfffe ) == 0xfffd );
+	ok ( tftp_block ( 0x10000, 1 ) == 0x10000 );
+	ok ( tftp_block ( 0x10000, 0xffff ) == 0xfffe );
+
+	/* Hole at the second wraparound */
+	ok ( tftp_block ( 0x1fffe, 0 ) == 0x1ffff );
+	ok ( tftp_block ( 0x1fffe, 2 ) == 0x20001 );
+	ok ( tftp_block ( 0x1fffe, 0xfffe ) == 0x1fffd );
+}
+
+/** TFTP self-test */
+struct self_test tftp_test __self_test = {
+	.name = "tftp",
+	.exec = tftp_test_exec,
+};
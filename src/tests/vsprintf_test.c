@@ -0,0 +1,108 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+/** @file
+ *
+ * vsprintf() self-tests
+ *
+ */
+
+/* Forcibly enable assertions */
+#undef NDEBUG
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <ipxe/test.h>
+
+/**
+ * Report a snprintf() test result
+ *
+ * @v expected		Expected formatted string
+ * @v fmt		Format string
+ * @v ...		Arguments
+ */
+#define snprintf_ok( expected, fmt, ... ) do {				\
+	char buf[64];							\
+	int len;							\
+	len = snprintf ( buf, sizeof ( buf ), fmt, __VA_ARGS__ );	\
+	ok ( len == ( int ) strlen ( expected ) );			\
+	ok ( strcmp ( buf, expected ) == 0 );				\
+	} while ( 0 )
+
+/**
+ * Perform vsprintf() self-tests
+ *
+ */
+static void vsprintf_test_exec ( void ) {
+
+	/* Basic unsigned conversions */
+	snprintf_ok ( "0", "%u", 0U );
+	snprintf_ok ( "42", "%u", 42U );
+	snprintf_ok ( "42", "%lu", 42UL );
+	snprintf_ok ( "42", "%llu", 42ULL );
+	snprintf_ok ( "42", "%zu", ( ( size_t ) 42 ) );
+
+	/* Values above INT_MAX must not be printed as negative */
+	snprintf_ok ( "2147483648", "%u", 0x80000000U );
+	snprintf_ok ( "4294967295", "%u", 4294967295U );
+	snprintf_ok ( "4294967295", "%lu", 4294967295UL );
+	snprintf_ok ( "4294967295", "%zu", ( ( size_t ) 4294967295U ) );
+
+	/* Values above LONG_MAX must not be printed as negative */
+	if ( sizeof ( unsigned long ) == sizeof ( uint64_t ) ) {
+		snprintf_ok ( "9223372036854775808", "%lu",
+			      ( ( unsigned long ) LONG_MAX + 1UL ) );
+	} else {
+		snprintf_ok ( "2147483648", "%lu",
+			      ( ( unsigned long ) LONG_MAX + 1UL ) );
+	}
+	snprintf_ok ( "9223372036854775808", "%llu", 0x8000000000000000ULL );
+	snprintf_ok ( "18446744073709551615", "%llu",
+		      18446744073709551615ULL );
+
+	/* Width padding */
+	snprintf_ok ( "   42", "%5u", 42U );
+	snprintf_ok ( "   42", "%5lu", 42UL );
+	snprintf_ok ( "   42", "%5llu", 42ULL );
+	snprintf_ok ( "   42", "%5zu", ( ( size_t ) 42 ) );
+	snprintf_ok ( "4294967295", "%5u", 4294967295U );
+
+	/* Zero padding */
+	snprintf_ok ( "00000042", "%08u", 42U );
+	snprintf_ok ( "00000000", "%08u", 0U );
+	snprintf_ok ( "00000042", "%08lu", 42UL );
+	snprintf_ok ( "00000042", "%08llu", 42ULL );
+	snprintf_ok ( "00000042", "%08zu", ( ( size_t ) 42 ) );
+	snprintf_ok ( "0000000004294967295", "%019llu", 4294967295ULL );
+	snprintf_ok ( "018446744073709551615", "%021llu",
+		      18446744073709551615ULL );
+
+	/* Mixed conversions */
+	snprintf_ok ( "3000000000/  3000000000/03000000000",
+		      "%lu/%12llu/%011u", 3000000000UL, 3000000000ULL,
+		      3000000000U );
+}
+
+/** vsprintf() self-test */
+struct self_test vsprintf_test __self_test = {
+	.name = "vsprintf",
+	.exec = vsprintf_test_exec,
+};
@@ -107,6 +107,14 @@ struct setting keep_san_setting __setting ( SETTING_SANBOOT_EXTRA ) = {
 	.type = &setting_type_int8,
 };
 
+/** The "dhcp-parallel" setting */
+struct setting dhcp_parallel_setting __setting ( SETTING_MISC ) = {
+	.name = "dhcp-parallel",
+	.description = "Configure network devices in parallel",
+	.tag = DHCP_EB_DHCP_PARALLEL,
+	.type = &setting_type_uint8,
+};
+
 /** The "skip-san-boot" setting */
 struct setting skip_san_boot_setting __setting ( SETTING_SANBOOT_EXTRA ) = {
 	.name = "skip-san-boot",
@@ -159,7 +167,7 @@ int uriboot ( struct uri *filename, struct uri *root_path, int drive,
 
 	/* Attempt filename boot if applicable */
 	if ( filename ) {
-		if ( ( rc = imgdownload ( filename, &image ) ) != 0 )
+		if ( ( rc = imgdownload ( filename, 0, &image ) ) != 0 )
 			goto err_download;
 		image->flags |= IMAGE_AUTO_UNREGISTER;
 		if ( ( rc = image_exec ( image ) ) != 0 ) {
@@ -316,27 +324,17 @@ static int have_pxe_menu ( void ) {
 }
 
 /**
- * Boot from a network device
+ * Boot from a configured network device
  *
  * @v netdev		Network device
  * @ret rc		Return status code
  */
-int netboot ( struct net_device *netdev ) {
+static int netboot_configured ( struct net_device *netdev ) {
 	struct uri *filename;
 	struct uri *root_path;
 	int rc;
 
-	/* Close all other network devices */
-	close_all_netdevs();
-
-	/* Open device and display device status */
-	if ( ( rc = ifopen ( netdev ) ) != 0 )
-		goto err_ifopen;
-	ifstat ( netdev );
-
-	/* Configure device via DHCP */
-	if ( ( rc = dhcp ( netdev ) ) != 0 )
-		goto err_dhcp;
+	/* Display routing table */
 	route();
 
 	/* Try PXE menu boot, if applicable */
@@ -348,8 +346,10 @@ int netboot ( struct net_device *netdev ) {
 
 	/* Fetch next server and filename */
 	filename = fetch_next_server_and_filename ( NULL );
-	if ( ! filename )
+	if ( ! filename ) {
+		rc = -ENOMEM;
 		goto err_filename;
+	}
 	if ( ! uri_has_path ( filename ) ) {
 		/* Ignore empty filename */
 		uri_put ( filename );
@@ -358,8 +358,10 @@ int netboot ( struct net_device *netdev ) {
 
 	/* Fetch root path */
 	root_path = fetch_root_path ( NULL );
-	if ( ! root_path )
+	if ( ! root_path ) {
+		rc = -ENOMEM;
 		goto err_root_path;
+	}
 	if ( ! uri_is_absolute ( root_path ) ) {
 		/* Ignore empty root path */
 		uri_put ( root_path );
@@ -396,6 +398,33 @@ int netboot ( struct net_device *netdev ) {
 	uri_put ( filename );
  err_filename:
  err_pxe_menu_boot:
+	return rc;
+}
+
+/**
+ * Boot from a network device
+ *
+ * @v netdev		Network device
+ * @ret rc		Return status code
+ */
+int netboot ( struct net_device *netdev ) {
+	int rc;
+
+	/* Close all other network devices */
+	close_all_netdevs();
+
+	/* Open device and display device status */
+	if ( ( rc = ifopen ( netdev ) ) != 0 )
+		goto err_ifopen;
+	ifstat ( netdev );
+
+	/* Configure device via DHCP */
+	if ( ( rc = dhcp ( netdev ) ) != 0 )
+		goto err_dhcp;
+
+	/* Boot from device */
+	rc = netboot_configured ( netdev );
+
  err_dhcp:
  err_ifopen:
 	return rc;
@@ -409,9 +438,18 @@ int autoboot ( void ) {
 	struct net_device *netdev;
 	int rc = -ENODEV;
 
-	/* If we have an identifable boot device, try that first */
-	if ( ( boot_netdev = find_boot_netdev() ) )
+	if ( fetch_uintz_setting ( NULL, &dhcp_parallel_setting ) ) {
+		/* If parallel configuration is enabled, try whichever
+		 * device is configured first.  There is no point in
+		 * retrying each device in turn if none was configured.
+		 */
+		if ( ( rc = dhcp_any ( &boot_netdev ) ) != 0 )
+			return rc;
+		rc = netboot_configured ( boot_netdev );
+	} else if ( ( boot_netdev = find_boot_netdev() ) ) {
+		/* If we have an identifable boot device, try that first */
 		rc = netboot ( boot_netdev );
+	}
 
 	/* If that fails, try booting from any of the other devices */
 	for_each_netdev ( netdev ) {
@@ -0,0 +1,181 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <stdio.h>
+#include <errno.h>
+#include <ipxe/image.h>
+#include <ipxe/downloader.h>
+#include <ipxe/monojob.h>
+#include <ipxe/open.h>
+#include <ipxe/uri.h>
+#include <ipxe/timer.h>
+#include <ipxe/malloc.h>
+#include <ipxe/netdevice.h>
+#include <ipxe/ip.h>
+#include <ipxe/tcp.h>
+#include <ipxe/tftp.h>
+#include <usr/benchmark.h>
+
+/** @file
+ *
+ * Download benchmarking
+ *
+ */
+
+/** A benchmark snapshot */
+struct benchmark_snapshot {
+	/** Elapsed time, in ticks */
+	unsigned long ticks;
+	/** CPU time consumed, in microseconds */
+	unsigned long cpu_usecs;
+	/** Number of packets received */
+	unsigned long rx_packets;
+	/** Number of packets transmitted */
+	unsigned long tx_packets;
+	/** Free heap memory */
+	size_t freemem;
+	/** Allocator statistics */
+	struct malloc_stats malloc;
+	/** TCP statistics */
+	struct tcp_stats tcp;
+	/** TFTP statistics */
+	struct tftp_stats tftp;
+	/** IPv4 fragment reassembly statistics */
+	struct ipv4_fragment_stats frag;
+};
+
+/**
+ * Record benchmark snapshot
+ *
+ * @v snapshot		Snapshot to fill in
+ */
+static void benchmark_snapshot ( struct benchmark_snapshot *snapshot ) {
+	struct net_device *netdev;
+
+	snapshot->ticks = currticks();
+	snapshot->cpu_usecs = cpu_usecs();
+	snapshot->rx_packets = 0;
+	snapshot->tx_packets = 0;
+	for_each_netdev ( netdev ) {
+		snapshot->rx_packets += netdev->rx_stats.good;
+		snapshot->tx_packets += netdev->tx_stats.good;
+	}
+	snapshot->freemem = freemem;
+	snapshot->malloc = malloc_stats;
+	snapshot->tcp = tcp_stats;
+	snapshot->tftp = tftp_stats;
+	snapshot->frag = ipv4_fragment_stats;
+}
+
+/**
+ * Benchmark download
+ *
+ * @v uri		URI
+ * @v run		Run number (used only for reporting)
+ * @ret rc		Return status code
+ *
+ * The data is downloaded into a temporary (unregistered) image, which
+ * is freed once the download completes.  Results are reported as a
+ * single line of space-separated "key=value" pairs, to allow for
+ * automated comparison between builds.
+ */
+int benchmark ( struct uri *uri, unsigned int run ) {
+	struct benchmark_snapshot before;
+	struct benchmark_snapshot after;
+	struct image *image;
+	unsigned long long len;
+	unsigned long long msecs;
+	unsigned long long packets;
+	unsigned long long rate;
+	unsigned long cpu;
+	int rc;
+
+	/* Allocate image */
+	image = alloc_image ( uri );
+	if ( ! image ) {
+		rc = -ENOMEM;
+		goto err_alloc_image;
+	}
+
+	/* Record starting snapshot */
+	benchmark_snapshot ( &before );
+
+	/* Create downloader */
+	if ( ( rc = create_downloader ( &monojob, image, NULL,
+					LOCATION_URI, uri ) ) != 0 )
+		goto err_create_downloader;
+
+	/* Wait for download to complete */
+	if ( ( rc = monojob_wait ( NULL ) ) != 0 )
+		goto err_monojob_wait;
+	len = image->len;
+
+	/* Free downloaded data before recording final snapshot.  The
+	 * heap delta will still include memory legitimately retained
+	 * after the transfer (e.g. pooled connections and cached DNS
+	 * results), so is not in itself evidence of a leak.
+	 */
+	image_put ( image );
+	benchmark_snapshot ( &after );
+
+	/* Calculate derived figures, avoiding division by zero */
+	msecs = ( ( ( after.ticks - before.ticks ) * 1000ULL ) /
+		  TICKS_PER_SEC );
+	if ( ! msecs )
+		msecs = 1;
+	packets = ( ( after.rx_packets - before.rx_packets ) +
+		    ( after.tx_packets - before.tx_packets ) );
+	rate = ( ( len * 1000 ) / msecs );
+	cpu = ( after.cpu_usecs - before.cpu_usecs );
+
+	/* Report results */
+	printf ( "benchmark run=%u proto=%s bytes=%llu msecs=%llu "
+		 "MBps=%llu.%03llu rx_packets=%lu tx_packets=%lu pps=%llu "
+		 "cpu_usecs=%lu cpu_usecs_per_MB=%llu allocs=%lu frees=%lu "
+		 "alloc_failures=%lu heap_delta=%ld tcp_retransmits=%lu "
+		 "tftp_retransmits=%lu tftp_losses=%lu ip_reassembled=%u "
+		 "ip_frag_dropped=%u ip_frag_timeouts=%u ip_frag_evicted=%u\n",
+		 run,
+		 ( uri->scheme ? uri->scheme : "none" ), len, msecs,
+		 ( rate / 1000000 ), ( ( rate / 1000 ) % 1000 ),
+		 ( after.rx_packets - before.rx_packets ),
+		 ( after.tx_packets - before.tx_packets ),
+		 ( ( packets * 1000 ) / msecs ), cpu,
+		 ( len ? ( ( cpu * 1000000ULL ) / len ) : 0 ),
+		 ( after.malloc.allocs - before.malloc.allocs ),
+		 ( after.malloc.frees - before.malloc.frees ),
+		 ( after.malloc.failures - before.malloc.failures ),
+		 ( ( long ) ( before.freemem - after.freemem ) ),
+		 ( after.tcp.retransmits - before.tcp.retransmits ),
+		 ( after.tftp.retransmits - before.tftp.retransmits ),
+		 ( after.tftp.losses - before.tftp.losses ),
+		 ( after.frag.reassembled - before.frag.reassembled ),
+		 ( after.frag.dropped - before.frag.dropped ),
+		 ( after.frag.timeouts - before.frag.timeouts ),
+		 ( after.frag.evicted - before.frag.evicted ) );
+
+	return 0;
+
+ err_monojob_wait:
+ err_create_downloader:
+	image_put ( image );
+ err_alloc_image:
+	return rc;
+}
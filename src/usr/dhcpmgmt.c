@@ -20,12 +20,17 @@
 FILE_LICENCE ( GPL2_OR_LATER );
 
 #include <string.h>
+#include <stdlib.h>
 #include <stdio.h>
 #include <errno.h>
 #include <ipxe/netdevice.h>
 #include <ipxe/dhcp.h>
+#include <ipxe/job.h>
 #include <ipxe/monojob.h>
 #include <ipxe/process.h>
+#include <ipxe/timer.h>
+#include <ipxe/console.h>
+#include <ipxe/keys.h>
 #include <usr/ifmgmt.h>
 #include <usr/dhcpmgmt.h>
 
@@ -71,3 +76,185 @@ int pxebs ( struct net_device *netdev, unsigned int pxe_type ) {
 
 	return rc;
 }
+
+/** A DHCP attempt on one of several network devices */
+struct dhcp_attempt {
+	/** Job control interface */
+	struct interface job;
+	/** Network device */
+	struct net_device *netdev;
+	/** DHCP has been started */
+	int started;
+	/** Final status code, or -EINPROGRESS */
+	int rc;
+};
+
+/**
+ * Handle completion of DHCP attempt
+ *
+ * @v attempt		DHCP attempt
+ * @v rc		Reason for completion
+ */
+static void dhcp_attempt_close ( struct dhcp_attempt *attempt, int rc ) {
+
+	attempt->rc = rc;
+	intf_restart ( &attempt->job, rc );
+}
+
+/** DHCP attempt job control interface operations */
+static struct interface_operation dhcp_attempt_op[] = {
+	INTF_OP ( intf_close, struct dhcp_attempt *, dhcp_attempt_close ),
+};
+
+/** DHCP attempt job control interface descriptor */
+static struct interface_descriptor dhcp_attempt_desc =
+	INTF_DESC ( struct dhcp_attempt, job, dhcp_attempt_op );
+
+/**
+ * Start DHCP attempt, once link is up
+ *
+ * @v attempt		DHCP attempt
+ * @v elapsed		Time since attempts were started (in ticks)
+ */
+static void dhcp_attempt_start ( struct dhcp_attempt *attempt,
+				 unsigned long elapsed ) {
+	struct net_device *netdev = attempt->netdev;
+	int rc;
+
+	/* Wait for link-up, up to the usual limit */
+	if ( ! netdev_link_ok ( netdev ) ) {
+		if ( elapsed > ( ( LINK_WAIT_MS * TICKS_PER_SEC ) / 1000 ) )
+			attempt->rc = netdev->link_rc;
+		return;
+	}
+
+	/* Start DHCP */
+	attempt->started = 1;
+	if ( ( rc = start_dhcp ( &attempt->job, netdev ) ) != 0 )
+		attempt->rc = ( ( rc > 0 ) ? 0 : rc );
+}
+
+/**
+ * Perform DHCP on all network devices in parallel
+ *
+ * @ret netdev		Network device configured first
+ * @ret rc		Return status code
+ *
+ * DHCP is performed on every network device concurrently.  The first
+ * device to be configured successfully is returned, and all other
+ * attempts are cancelled and their devices closed.  This avoids
+ * waiting through a full DHCP timeout on each unconnected device in
+ * turn.
+ */
+int dhcp_any ( struct net_device **netdev ) {
+	struct dhcp_attempt *attempts;
+	struct dhcp_attempt *attempt;
+	struct dhcp_attempt *winner = NULL;
+	struct net_device *tmp;
+	unsigned long start;
+	unsigned long last_keycheck;
+	unsigned long last_progress;
+	unsigned long now;
+	unsigned int count = 0;
+	unsigned int in_progress;
+	unsigned int i;
+	int rc = -ENODEV;
+
+	/* Allocate attempts */
+	for_each_netdev ( tmp )
+		count++;
+	if ( ! count )
+		return -ENODEV;
+	attempts = zalloc ( count * sizeof ( attempts[0] ) );
+	if ( ! attempts )
+		return -ENOMEM;
+
+	/* Open all network devices */
+	printf ( "DHCP (" );
+	i = 0;
+	for_each_netdev ( tmp ) {
+		attempt = &attempts[i++];
+		intf_init ( &attempt->job, &dhcp_attempt_desc, NULL );
+		attempt->netdev = netdev_get ( tmp );
+		attempt->rc = ifopen ( tmp );
+		if ( attempt->rc == 0 ) {
+			attempt->rc = -EINPROGRESS;
+			netdev_poll ( tmp );
+		}
+		printf ( "%s%s", ( ( i == 1 ) ? "" : " " ), tmp->name );
+	}
+	printf ( ")..." );
+
+	/* Wait for the first successful attempt */
+	start = last_keycheck = last_progress = currticks();
+	while ( 1 ) {
+
+		/* Start any attempts that are waiting for link-up,
+		 * and check for completion.
+		 */
+		in_progress = 0;
+		for ( i = 0 ; i < count ; i++ ) {
+			attempt = &attempts[i];
+			if ( ( attempt->rc == -EINPROGRESS ) &&
+			     ( ! attempt->started ) ) {
+				dhcp_attempt_start ( attempt,
+						     ( currticks() - start ) );
+			}
+			if ( attempt->rc == 0 ) {
+				winner = attempt;
+				break;
+			} else if ( attempt->rc == -EINPROGRESS ) {
+				in_progress++;
+			} else {
+				rc = attempt->rc;
+			}
+		}
+		if ( winner || ( ! in_progress ) )
+			break;
+
+		/* Allow attempts to progress */
+		step();
+		now = currticks();
+
+		/* Check for cancellation.  This can be time-consuming,
+		 * so check only once per clock tick.
+		 */
+		if ( now != last_keycheck ) {
+			if ( iskey() && ( getchar() == CTRL_C ) ) {
+				rc = -ECANCELED;
+				break;
+			}
+			last_keycheck = now;
+		}
+
+		/* Display progress */
+		if ( ( now - last_progress ) >= TICKS_PER_SEC ) {
+			printf ( "." );
+			last_progress = now;
+		}
+	}
+
+	/* Cancel remaining attempts and close all other devices */
+	for ( i = 0 ; i < count ; i++ ) {
+		attempt = &attempts[i];
+		intf_shutdown ( &attempt->job, -ECANCELED );
+		if ( attempt != winner )
+			netdev_close ( attempt->netdev );
+	}
+
+	/* Report result */
+	if ( winner ) {
+		printf ( " ok (%s)\n", winner->netdev->name );
+		*netdev = winner->netdev;
+		rc = 0;
+	} else {
+		printf ( " %s\n", strerror ( rc ) );
+	}
+
+	/* Free attempts */
+	for ( i = 0 ; i < count ; i++ )
+		netdev_put ( attempts[i].netdev );
+	free ( attempts );
+
+	return rc;
+}
@@ -100,6 +100,10 @@ void ifstat ( struct net_device *netdev ) {
 		printf ( "  [Link status: %s]\n",
 			 strerror ( netdev->link_rc ) );
 	}
+	printf ( "  [RXB:%d pkts:%d exhausted:%d budget:%d]\n",
+		 netdev->rx_batch_stats.batches,
+		 netdev->rx_batch_stats.packets,
+		 netdev->rx_batch_stats.exhausted, netdev->rx_budget );
 	ifstat_errors ( &netdev->tx_stats, "TXE" );
 	ifstat_errors ( &netdev->rx_stats, "RXE" );
 }
@@ -28,6 +28,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/monojob.h>
 #include <ipxe/open.h>
 #include <ipxe/uri.h>
+#include <ipxe/decompress.h>
 #include <usr/imgmgmt.h>
 
 /** @file
@@ -40,15 +41,27 @@ FILE_LICENCE ( GPL2_OR_LATER );
  * Download a new image
  *
  * @v uri		URI
+ * @v decompress	Decompress downloaded data
  * @v image		Image to fill in
  * @ret rc		Return status code
  */
-int imgdownload ( struct uri *uri, struct image **image ) {
+int imgdownload ( struct uri *uri, int decompress, struct image **image ) {
 	size_t len = ( unparse_uri ( NULL, 0, uri, URI_ALL ) + 1 );
 	char uri_string_redacted[len];
+	struct content_encoding *encoding = NULL;
 	const char *password;
 	int rc;
 
+	/* Find decompressor, if applicable */
+	if ( decompress ) {
+		encoding = find_content_encoding ( "gzip" );
+		if ( ! encoding ) {
+			printf ( "Decompression not supported\n" );
+			rc = -ENOTSUP;
+			goto err_encoding;
+		}
+	}
+
 	/* Allocate image */
 	*image = alloc_image ( uri );
 	if ( ! *image ) {
@@ -65,8 +78,9 @@ int imgdownload ( struct uri *uri, struct image **image ) {
 	uri->password = password;
 
 	/* Create downloader */
-	if ( ( rc = create_downloader ( &monojob, *image, LOCATION_URI,
-					uri ) ) != 0 ) {
+	if ( ( rc = create_downloader ( &monojob, *image,
+					( encoding ? encoding->add : NULL ),
+					LOCATION_URI, uri ) ) != 0 ) {
 		printf ( "Could not start download: %s\n", strerror ( rc ) );
 		goto err_create_downloader;
 	}
@@ -93,6 +107,7 @@ int imgdownload ( struct uri *uri, struct image **image ) {
  err_create_downloader:
 	image_put ( *image );
  err_alloc_image:
+ err_encoding:
 	return rc;
 }
 
@@ -100,17 +115,19 @@ int imgdownload ( struct uri *uri, struct image **image ) {
  * Download a new image
  *
  * @v uri_string	URI string
+ * @v decompress	Decompress downloaded data
  * @v image		Image to fill in
  * @ret rc		Return status code
  */
-int imgdownload_string ( const char *uri_string, struct image **image ) {
+int imgdownload_string ( const char *uri_string, int decompress,
+			 struct image **image ) {
 	struct uri *uri;
 	int rc;
 
 	if ( ! ( uri = parse_uri ( uri_string ) ) )
 		return -ENOMEM;
 
-	rc = imgdownload ( uri, image );
+	rc = imgdownload ( uri, decompress, image );
 
 	uri_put ( uri );
 	return rc;
@@ -120,10 +137,12 @@ int imgdownload_string ( const char *uri_string, struct image **image ) {
  * Acquire an image
  *
  * @v name_uri		Name or URI string
+ * @v decompress	Decompress downloaded data
  * @v image		Image to fill in
  * @ret rc		Return status code
  */
-int imgacquire ( const char *name_uri, struct image **image ) {
+int imgacquire ( const char *name_uri, int decompress,
+		 struct image **image ) {
 
 	/* If we already have an image with the specified name, use it */
 	*image = find_image ( name_uri );
@@ -131,7 +150,7 @@ int imgacquire ( const char *name_uri, struct image **image ) {
 		return 0;
 
 	/* Otherwise, download a new image */
-	return imgdownload_string ( name_uri, image );
+	return imgdownload_string ( name_uri, decompress, image );
 }
 
 /**
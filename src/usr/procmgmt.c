@@ -0,0 +1,73 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdio.h>
+#include <ipxe/process.h>
+#include <usr/procmgmt.h>
+
+/** @file
+ *
+ * Process management
+ *
+ */
+
+/** Process scheduling priority names */
+static const char *pstat_priorities[PROC_NUM_PRIORITIES] = {
+	[PROC_PRIO_HIGH] = "high",
+	[PROC_PRIO_NORMAL] = "normal",
+	[PROC_PRIO_LOW] = "low",
+};
+
+/**
+ * Print status of a process
+ *
+ * @v process		Process
+ *
+ * Execution time is shown in units of 1024 CPU-specific profiling
+ * ticks (i.e. TSC cycles).
+ */
+static void pstat_process ( struct process *process ) {
+	unsigned int priority = process->desc->priority;
+
+	printf ( PROC_FMT " %p %s %s steps %ld time %ldk\n",
+		 PROC_DBG ( process ), process->desc->step,
+		 ( ( priority < PROC_NUM_PRIORITIES ) ?
+		   pstat_priorities[priority] : "?" ),
+		 ( process_sleeping ( process ) ? "sleeping" : "runnable" ),
+		 process->steps,
+		 ( ( unsigned long ) ( process->time >> 10 ) ) );
+}
+
+/**
+ * Print status of all running processes
+ *
+ */
+void pstat ( void ) {
+	struct process *process;
+	unsigned int priority;
+
+	for ( priority = 0 ; priority < PROC_NUM_PRIORITIES ; priority++ ) {
+		list_for_each_entry ( process, &process_run_queues[priority],
+				      list ) {
+			pstat_process ( process );
+		}
+	}
+	list_for_each_entry ( process, &process_sleep_queue, list )
+		pstat_process ( process );
+}